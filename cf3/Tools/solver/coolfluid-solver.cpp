@@ -110,6 +110,8 @@ int main(int argc, char ** argv)
 
   notifier = new Notifier( mgr );
 
+  // The queue of the manager listens to the typed tree update signal, and only builds the frames
+  // that it forwards to the client
   notifier->listen_to_event("tree_updated", true);
 
   // set the forwarder, if needed
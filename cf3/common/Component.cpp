@@ -8,6 +8,10 @@
 #include <boost/cast.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/detail/atomic_count.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "rapidxml/rapidxml.hpp"
 
@@ -198,8 +202,50 @@ Component::Component ( const std::string& name ) :
 }
 
 
+namespace detail
+{
+  /// Incremented on each change of the tree structure, invalidating the caches of access_component.
+  /// Atomic, since it is read by lookups from all threads.
+  boost::detail::atomic_count& tree_revision()
+  {
+    static boost::detail::atomic_count revision(0);
+    return revision;
+  }
+
+  typedef boost::unordered_map< std::pair<const Component*, std::string>, Handle<Component> > PathCacheT;
+
+  /// Cache of access_component results, valid while revision equals tree_revision()
+  struct PathCache
+  {
+    PathCache() : revision(0) {}
+    PathCacheT entries;
+    long revision;
+  };
+
+  /// Cache of the calling thread, so concurrent lookups don't need any locking
+  PathCache& path_cache()
+  {
+    static boost::thread_specific_ptr<PathCache> cache;
+    if(cache.get() == 0)
+      cache.reset(new PathCache());
+    return *cache;
+  }
+
+  /// Maximum number of cached paths
+  const Uint max_path_cache_size = 16384;
+
+  /// Protects the descendant indices of all components, since const lookups may come from several threads
+  boost::mutex& descendant_index_mutex()
+  {
+    static boost::mutex mutex;
+    return mutex;
+  }
+}
+
 Component::~Component()
 {
+  // Components at the same address must not get the cached paths of this one
+  ++detail::tree_revision();
 }
 
 
@@ -221,6 +267,7 @@ void Component::rename ( const std::string& name )
 
   // notification should be done before the real renaming since the path changes
   raise_tree_updated_event();
+  ++detail::tree_revision();
 
   if(is_not_null(m_parent))
   {
@@ -247,6 +294,18 @@ URI Component::uri() const
   return m_parent->uri() / URI(name(), URI::Scheme::CPATH);
 }
 
+bool Component::is_descendant_of(const Component& ancestor) const
+{
+  for(const Component* comp = this; comp != 0; comp = comp->m_parent)
+  {
+    if(comp == &ancestor)
+      return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 Handle<Component> Component::parent() const
 {
   if(m_parent)
@@ -300,6 +359,8 @@ Component& Component::add_component ( const boost::shared_ptr<Component>& subcom
   cf3_assert(m_component_lookup.size() == m_components.size());
 
   subcomp->m_parent = this;
+  ++detail::tree_revision();
+  clear_descendant_index();
 
   raise_tree_updated_event();
 
@@ -377,6 +438,7 @@ boost::shared_ptr<Component> Component::remove_component ( const std::string& na
       new_storage.push_back(m_components[i]);
     }
     m_components = new_storage;
+    clear_descendant_index();
 
     raise_tree_updated_event();
 
@@ -464,6 +526,45 @@ void Component::change_parent(Handle<Component> to_parent)
 {
   // modifiy the parent, may be NULL
   m_parent = to_parent.get();
+  ++detail::tree_revision();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr<void const> Component::cached_descendants(const std::type_info& list_type) const
+{
+  boost::lock_guard<boost::mutex> lock(detail::descendant_index_mutex());
+  if(!m_descendant_index)
+    return boost::shared_ptr<void const>();
+  const DescendantIndexT::const_iterator found = m_descendant_index->find(list_type.name());
+  return found == m_descendant_index->end() ? boost::shared_ptr<void const>() : found->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void Component::cache_descendants(const std::type_info& list_type, const boost::shared_ptr<void const>& list) const
+{
+  boost::lock_guard<boost::mutex> lock(detail::descendant_index_mutex());
+  if(!m_descendant_index)
+    m_descendant_index.reset(new DescendantIndexT());
+  (*m_descendant_index)[list_type.name()] = list;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void Component::clear_descendant_index()
+{
+  // The lists hold the components, so release them only after unlocking
+  std::vector< boost::shared_ptr<DescendantIndexT> > released;
+  boost::lock_guard<boost::mutex> lock(detail::descendant_index_mutex());
+  for(Component* comp = this; comp != 0; comp = comp->m_parent)
+  {
+    if(comp->m_descendant_index)
+    {
+      released.push_back(comp->m_descendant_index);
+      comp->m_descendant_index.reset();
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -479,6 +580,33 @@ void Component::move_to ( Component& new_parent )
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 Handle<Component> Component::access_component(const URI& path) const
+{
+  detail::PathCache& cache = detail::path_cache();
+  const std::pair<const Component*, std::string> key(this, path.string());
+
+  const long revision = detail::tree_revision();
+  if(cache.revision != revision)
+  {
+    cache.entries.clear();
+    cache.revision = revision;
+  }
+
+  const detail::PathCacheT::const_iterator found = cache.entries.find(key);
+  if(found != cache.entries.end() && is_not_null(found->second))
+    return found->second;
+
+  Handle<Component> result = resolve_path(path);
+  if(is_not_null(result))
+  {
+    if(cache.entries.size() >= detail::max_path_cache_size)
+      cache.entries.clear();
+    if(revision == detail::tree_revision())
+      cache.entries[key] = result;
+  }
+  return result;
+}
+
+Handle<Component> Component::resolve_path(const URI& path) const
 {
   // Return self for trivial path or at end of recursion.
   if(path.path() == "." || path.empty())
@@ -499,7 +627,7 @@ Handle<Component> Component::access_component(const URI& path) const
     }
 
     // Pass the rest to root
-    return root()->access_component(URI(new_path, cf3::common::URI::Scheme::CPATH));
+    return root()->resolve_path(URI(new_path, cf3::common::URI::Scheme::CPATH));
   }
 
   // Relative path
@@ -519,16 +647,16 @@ Handle<Component> Component::access_component(const URI& path) const
 
   // Dispatch to self
   if(current_part == "." || current_part.empty())
-    return access_component(next_part);
+    return resolve_path(next_part);
 
   // Dispatch to parent
   if(current_part == "..")
-    return m_parent ? m_parent->access_component(next_part) : Handle<Component>();
+    return m_parent ? m_parent->resolve_path(next_part) : Handle<Component>();
 
   // Dispatch to child
   Handle<Component const> child = get_child(current_part);
   if(is_not_null(child))
-    return child->access_component(next_part);
+    return child->resolve_path(next_part);
 
   // Return null if not found
   return Handle<Component>();
@@ -1027,8 +1155,7 @@ void Component::signal_signature( SignalArgs & args )
 
 void Component::raise_tree_updated_event ()
 {
-  SignalFrame frame ( "tree_updated", uri(), uri() );
-  EventHandler::instance().raise_event("tree_updated", frame ); // no error if event doesn't exist
+  EventHandler::instance().raise_tree_updated(*this);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -1297,36 +1424,30 @@ Component::const_iterator Component::end() const
 
 Component::iterator Component::recursive_begin()
 {
-  std::vector<boost::shared_ptr<Component> > vec;
-  put_components<Component>(vec, true);  // recursive
-  return Component::iterator(vec, 0);    // begin
+  return Component::iterator(descendants<Component>(), 0);    // begin
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 Component::iterator Component::recursive_end()
 {
-  std::vector<boost::shared_ptr<Component> > vec;
-  put_components<Component>(vec, true);         // recursive
-  return Component::iterator(vec, vec.size());  // end
+  const boost::shared_ptr< const std::vector< boost::shared_ptr<Component> > > vec = descendants<Component>();
+  return Component::iterator(vec, vec->size());  // end
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 Component::const_iterator Component::recursive_begin() const
 {
-  std::vector<boost::shared_ptr<Component const> > vec;
-  put_components<Component>(vec, true);  // recursive
-  return Component::const_iterator(vec, 0);    // begin
+  return Component::const_iterator(descendants<Component>(), 0);    // begin
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 Component::const_iterator Component::recursive_end() const
 {
-  std::vector<boost::shared_ptr<Component const> > vec;
-  put_components<Component>(vec, true);         // recursive
-  return Component::const_iterator(vec, vec.size());  // end
+  const boost::shared_ptr< const std::vector< boost::shared_ptr<Component const> > > vec = descendants<Component>();
+  return Component::const_iterator(vec, vec->size());  // end
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
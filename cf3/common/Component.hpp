@@ -13,7 +13,10 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <typeinfo>
+
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "common/AllocatedComponent.hpp"
 #include "common/Assertions.hpp"
@@ -98,7 +101,10 @@ private: // typedef
   typedef std::vector< boost::shared_ptr<Component> > CompStorageT;
 
   /// Type for storing component lookup-by-name
-  typedef std::map<std::string, Uint> CompLookupT;
+  typedef boost::unordered_map<std::string, Uint> CompLookupT;
+
+  /// Type for the cached lists of descendants, by the typeid name of the list type
+  typedef boost::unordered_map<std::string, boost::shared_ptr<void const> > DescendantIndexT;
 
 public: // functions
 
@@ -186,6 +192,9 @@ public: // functions
   /// @returns the handle to the parent component, which can be null if there is no parent
   Handle<Component> parent() const;
 
+  /// True if this is ancestor, or is found below it in the tree
+  bool is_descendant_of(const Component& ancestor) const;
+
   /// @returns the upper-most component in the tree, or self if there is no parent
   Handle<Component const> root() const;
   Handle<Component> root();
@@ -392,6 +401,15 @@ public: // functions
   template<typename ComponentT>
   void put_components(std::vector< boost::shared_ptr<ComponentT const> >& vec, const bool recurse) const;
 
+  /// All subcomponents of type ComponentT, recursively and in the order of put_components.
+  /// The list is cached per type until a component is added to or removed from this subtree,
+  /// so repeated calls cost a lookup instead of a traversal with a dynamic_cast per component.
+  template<typename ComponentT>
+  boost::shared_ptr< const std::vector< boost::shared_ptr<ComponentT> > > descendants();
+
+  /// All subcomponents of type ComponentT, recursively (const version)
+  template<typename ComponentT>
+  boost::shared_ptr< const std::vector< boost::shared_ptr<ComponentT const> > > descendants() const;
 
 
 protected: // functions
@@ -403,6 +421,18 @@ private: // helper functions
   /// Modify the parent of this component
   void change_parent(Handle<Component> to_parent);
 
+  /// Walk the path to find a component, without using the cache of access_component
+  Handle<Component> resolve_path ( const URI& path ) const;
+
+  /// Cached list of descendants with the given list type, or null
+  boost::shared_ptr<void const> cached_descendants ( const std::type_info& list_type ) const;
+
+  /// Store a list of descendants in the cache
+  void cache_descendants ( const std::type_info& list_type, const boost::shared_ptr<void const>& list ) const;
+
+  /// Drop the cached descendants of this component and its parents, after the subtree changed
+  void clear_descendant_index();
+
   /// insures the sub component has a unique name within this component
   std::string ensure_unique_name ( Component& subcomp );
 
@@ -429,6 +459,8 @@ private: // data
   CompLookupT m_component_lookup;
   /// pointer to parent, naked pointer because of static components
   Component* m_parent;
+  /// cached lists returned by descendants(), created on first use
+  mutable boost::shared_ptr<DescendantIndexT> m_descendant_index;
 
 protected: // functions
 
@@ -515,6 +547,40 @@ inline void Component::put_components<Component>(std::vector<boost::shared_ptr<C
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+template<typename ComponentT>
+boost::shared_ptr< const std::vector< boost::shared_ptr<ComponentT> > > Component::descendants()
+{
+  typedef std::vector< boost::shared_ptr<ComponentT> > ListT;
+  boost::shared_ptr<ListT const> result = boost::static_pointer_cast<ListT const>(cached_descendants(typeid(ListT)));
+  if(!result)
+  {
+    boost::shared_ptr<ListT> list(new ListT());
+    put_components<ComponentT>(*list, true);
+    cache_descendants(typeid(ListT), list);
+    result = list;
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename ComponentT>
+boost::shared_ptr< const std::vector< boost::shared_ptr<ComponentT const> > > Component::descendants() const
+{
+  typedef std::vector< boost::shared_ptr<ComponentT const> > ListT;
+  boost::shared_ptr<ListT const> result = boost::static_pointer_cast<ListT const>(cached_descendants(typeid(ListT)));
+  if(!result)
+  {
+    boost::shared_ptr<ListT> list(new ListT());
+    put_components<ComponentT>(*list, true);
+    cache_descendants(typeid(ListT), list);
+    result = list;
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 /// Create a component by providing the name of its builder
 /// No factory name is needed, so no factories are used (also no auto-loading of factory).
 /// Component is built directly from the builder.
@@ -4,6 +4,8 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <iostream>
+
 #include "common/Signal.hpp"
 #include "common/OptionT.hpp"
 #include "common/Builder.hpp"
@@ -11,7 +13,9 @@
 #include "common/LogLevel.hpp"
 #include "common/Log.hpp"
 #include "common/Environment.hpp"
+#include "common/Profiler.hpp"
 #include "common/PropertyList.hpp"
+#include "common/ThreadPool.hpp"
 
 namespace cf3 {
 namespace common {
@@ -102,8 +106,36 @@ Environment::Environment ( const std::string& name) : Component ( name )
       .mark_basic()
       .attach_trigger(boost::bind(&Environment::trigger_log_level,this));
 
+  options().add("nb_threads", ThreadPool::instance().nb_threads())
+      .pretty_name("Number of Threads")
+      .description("Number of threads used by shared-memory parallel loops in each process. Must be the same on all processes.")
+      .mark_basic()
+      .attach_trigger(boost::bind(&Environment::trigger_nb_threads,this));
+
+  options().add("reproducible_loops", ThreadPool::instance().reproducible())
+      .pretty_name("Reproducible Loops")
+      .description("If true, threaded loops produce bit-identical results regardless of the number of threads.")
+      .mark_basic()
+      .attach_trigger(boost::bind(&Environment::trigger_reproducible_loops,this));
+
+  options().add("profiling", Profiler::instance().enabled())
+      .pretty_name("Profiling")
+      .description("Record the time spent in the instrumented parts of the code, such as communication, element loops, linear solves and mesh I/O")
+      .mark_basic()
+      .attach_trigger(boost::bind(&Environment::trigger_profiling,this));
+
   trigger_log_level();
 
+  regist_signal("print_profile")
+    .connect(boost::bind( &Environment::signal_print_profile, this, _1 ))
+    .description("Print the profile call tree, with the timings over all processes. Must be called on all processes.")
+    .pretty_name("Print Profile");
+
+  regist_signal("reset_profile")
+    .connect(boost::bind( &Environment::signal_reset_profile, this, _1 ))
+    .description("Clear the timings recorded by the profiler")
+    .pretty_name("Reset Profile");
+
   // signals
   signal("create_component")->hidden(true);
   signal("rename_component")->hidden(true);
@@ -180,5 +212,40 @@ void Environment::trigger_log_level()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void Environment::trigger_nb_threads()
+{
+  ThreadPool::instance().set_nb_threads(options().value<Uint>("nb_threads"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::trigger_reproducible_loops()
+{
+  ThreadPool::instance().set_reproducible(options().value<bool>("reproducible_loops"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::trigger_profiling()
+{
+  Profiler::instance().set_enabled(options().value<bool>("profiling"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::signal_print_profile(SignalArgs& args)
+{
+  Profiler::instance().print_report(std::cout);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Environment::signal_reset_profile(SignalArgs& args)
+{
+  Profiler::instance().reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // common
 } // cf3
@@ -51,6 +51,16 @@ private: // functions
 
   void trigger_log_level();
 
+  void trigger_nb_threads();
+
+  void trigger_reproducible_loops();
+
+  void trigger_profiling();
+
+  void signal_print_profile(SignalArgs& args);
+
+  void signal_reset_profile(SignalArgs& args);
+
 }; // Environment
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4,7 +4,12 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <exception>
+
+#include "common/Component.hpp"
 #include "common/EventHandler.hpp"
+#include "common/Log.hpp"
+#include "common/XML/SignalFrame.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -20,7 +25,8 @@ EventHandler& EventHandler::instance()
 }
 
 
-EventHandler::EventHandler ()
+EventHandler::EventHandler () :
+  m_batch(0)
 {}
 
 EventHandler::~EventHandler()
@@ -37,5 +43,90 @@ void EventHandler::raise_event( const std::string& ename, SignalArgs& args)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+boost::signals2::connection EventHandler::connect_to_tree_updated( const TreeUpdatedSignalT::slot_type& slot )
+{
+  return m_tree_updated.connect(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void EventHandler::raise_tree_updated( Component& component )
+{
+  for(TreeUpdateBatch* batch = m_batch; batch != 0; batch = batch->m_previous)
+  {
+    if(is_not_null(batch->m_scope) && component.is_descendant_of(*batch->m_scope))
+    {
+      batch->m_changed = true;
+      return;
+    }
+  }
+
+  if(!m_tree_updated.empty())
+    m_tree_updated(component);
+
+  if(signal_exists("tree_updated"))
+  {
+    SignalFrame frame ( "tree_updated", component.uri(), component.uri() );
+    call_signal("tree_updated", frame);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TreeUpdateBatch::TreeUpdateBatch( Component& scope ) :
+  m_scope(scope.handle()),
+  m_active(true),
+  m_changed(false),
+  m_previous(EventHandler::instance().m_batch)
+{
+  EventHandler::instance().m_batch = this;
+}
+
+TreeUpdateBatch::~TreeUpdateBatch()
+{
+  if(!m_active)
+    return;
+
+  // Listeners must not throw while another exception is in flight
+  if(std::uncaught_exception())
+  {
+    end();
+    return;
+  }
+
+  try
+  {
+    commit();
+  }
+  catch(std::exception& e)
+  {
+    CFerror << "Exception while notifying the tree update of " << (is_not_null(m_scope) ? m_scope->uri().string() : std::string("a removed component")) << ": " << e.what() << CFendl;
+  }
+  catch(...)
+  {
+    CFerror << "Unknown exception while notifying a tree update" << CFendl;
+  }
+}
+
+void TreeUpdateBatch::commit()
+{
+  if(!m_active)
+    return;
+
+  end();
+  if(m_changed && is_not_null(m_scope))
+    EventHandler::instance().raise_tree_updated(*m_scope);
+}
+
+void TreeUpdateBatch::end()
+{
+  EventHandler& handler = EventHandler::instance();
+  cf3_assert(handler.m_batch == this);
+  handler.m_batch = m_previous;
+  m_active = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // common
 } // cf3
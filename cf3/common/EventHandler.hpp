@@ -9,6 +9,9 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <boost/signals2/signal.hpp>
+
+#include "common/Handle.hpp"
 #include "common/Signal.hpp"
 #include "common/SignalHandler.hpp"
 
@@ -17,6 +20,9 @@
 namespace cf3 {
 namespace common {
 
+class Component;
+class TreeUpdateBatch;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /// Global Event Handler class
@@ -44,15 +50,67 @@ public: // methods
 
   /// raises an event and dispatches immedietly to all listeners
   void raise_event( const std::string& ename, SignalArgs& args);
-  
+
+  /// Signature of a tree update listener, called with the component of which the subtree changed
+  typedef boost::signals2::signal< void (Component&) > TreeUpdatedSignalT;
+
+  /// Listen to tree updates without going through XML signal frames.
+  /// Only listeners that forward the update, such as the NotificationQueue of a solver, need to build a frame.
+  boost::signals2::connection connect_to_tree_updated( const TreeUpdatedSignalT::slot_type& slot );
+
+  /// Notify that the tree changed at component. Typed listeners are called directly. A "tree_updated" event frame
+  /// is only built if a listener was registered using connect_to_event, so this is cheap when nobody listens.
+  /// If component is in the scope of a TreeUpdateBatch, the notification is postponed until the batch ends.
+  void raise_tree_updated( Component& component );
+
 private:
   /// Constructor
   EventHandler();
 
+  friend class TreeUpdateBatch;
+
+  /// Typed tree update listeners
+  TreeUpdatedSignalT m_tree_updated;
+
+  /// Innermost active batch
+  TreeUpdateBatch* m_batch;
+
 }; // class EventHandler
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// While a TreeUpdateBatch exists, the tree updates of its scope component and all components below it
+/// are coalesced into a single notification for the scope, raised by commit.
+/// Use it around bulk operations, such as reading or partitioning a mesh. Batches can be nested.
+/// A batch that is destroyed without commit notifies its changes from the destructor, catching any exception
+/// of the listeners, except if it is destroyed during stack unwinding. In that case nothing is notified.
+class Common_API TreeUpdateBatch : public boost::noncopyable
+{
+public:
+  TreeUpdateBatch( Component& scope );
+  ~TreeUpdateBatch();
+
+  /// End the batch and notify the changes, if any. Exceptions raised by the listeners are passed on.
+  /// Must be called on the innermost batch. Does nothing if the batch was already committed.
+  void commit();
+
+private:
+  friend class EventHandler;
+
+  /// Remove this batch from the stack of active batches
+  void end();
+
+  Handle<Component> m_scope;
+  /// True until the batch is committed
+  bool m_active;
+  /// True if the tree changed in the scope during the batch
+  bool m_changed;
+  /// Enclosing batch
+  TreeUpdateBatch* m_previous;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // common
 } // cf3
 
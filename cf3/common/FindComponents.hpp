@@ -90,20 +90,19 @@ inline typename ComponentIteratorSelector<ParentT,ComponentT>::type component_en
   return typename ComponentIteratorSelector<ParentT,ComponentT>::type(vec, vec.size()); // end
 }
 
+/// Recursive iterators share the cached list of Component::descendants, so they don't copy or rebuild it
 template<typename ComponentT, typename ParentT>
 inline typename ComponentIteratorSelector<ParentT,ComponentT>::type component_recursive_begin(ParentT& component)
 {
-  std::vector< typename ComponentPtr<ParentT,ComponentT>::type > vec;
-  component.template put_components<ComponentT>(vec, true); // recursive
-  return typename ComponentIteratorSelector<ParentT,ComponentT>::type(vec, 0); // begin
+  return typename ComponentIteratorSelector<ParentT,ComponentT>::type(component.template descendants<ComponentT>(), 0); // begin
 }
 
 template<typename ComponentT, typename ParentT>
 inline typename ComponentIteratorSelector<ParentT,ComponentT>::type component_recursive_end(ParentT& component)
 {
-  std::vector< typename ComponentPtr<ParentT,ComponentT>::type > vec;
-  component.template put_components<ComponentT>(vec, true); // recursive
-  return typename ComponentIteratorSelector<ParentT,ComponentT>::type(vec, vec.size()); // end
+  typedef typename ComponentIteratorSelector<ParentT,ComponentT>::type IteratorT;
+  const boost::shared_ptr< const std::vector< typename ComponentPtr<ParentT,ComponentT>::type > > vec = component.template descendants<ComponentT>();
+  return IteratorT(vec, vec->size()); // end
 }
 
 ////////////////////////////////////////////////////////////////////////////////
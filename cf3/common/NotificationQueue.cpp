@@ -4,6 +4,7 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include "common/Component.hpp"
 #include "common/URI.hpp"
 #include "common/NotificationQueue.hpp"
 
@@ -45,6 +46,14 @@ void NotificationQueue::add_notification ( SignalArgs & args )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void NotificationQueue::add_tree_updated ( Component & component )
+{
+  SignalFrame frame ( "tree_updated", component.uri(), component.uri() );
+  add_notification( frame );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 cf3::Uint NotificationQueue::nb_notifications ( const std::string & name ) const
 {
   cf3::Uint count = 0;
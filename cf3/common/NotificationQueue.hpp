@@ -62,6 +62,12 @@ namespace common {
     /// @param sender_path Path of the component that emitted the event
     void add_notification ( SignalArgs &args );
 
+    /// @brief Adds a "tree_updated" notification for the component.
+    /// The queue listens to tree updates through the typed signal of the
+    /// EventHandler, and only builds the frame that is forwarded here.
+    /// @param component The component of which the subtree changed
+    void add_tree_updated ( Component & component );
+
     /// @brief Counts the notifications for a speficied event.
 
     /// @param name The event name. If empty, the number of all notifications
@@ -119,6 +125,9 @@ namespace common {
     /// notifier.
     EventSigsStorage_t m_event_signals;
 
+    /// @brief Connection to the tree updates of the EventHandler.
+    boost::signals2::scoped_connection m_tree_updated_connection;
+
   }; // class NotificationQueue
 
   ///////////////////////////////////////////////////////////////////////////////
@@ -140,7 +149,13 @@ namespace common {
     else
       sig = m_event_signals[name];
 
-    EventHandler::instance().connect_to_event(name, this, &NotificationQueue::add_notification);
+    if( name == "tree_updated" )
+    {
+      if( !m_tree_updated_connection.connected() )
+        m_tree_updated_connection = EventHandler::instance().connect_to_tree_updated( boost::bind(&NotificationQueue::add_tree_updated, this, _1) );
+    }
+    else
+      EventHandler::instance().connect_to_event(name, this, &NotificationQueue::add_notification);
 
     m_sig_begin_flush->connect(boost::bind(&NOTIFIER::begin_notify, receiver));
     sig->connect( boost::bind(fcnt, receiver, _1, _2) ); // _2 because 2 arguments
@@ -6,6 +6,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <cstring>
+
 #include "boost/lexical_cast.hpp"
 
 #include "common/BoostAssertions.hpp"
@@ -13,6 +15,7 @@
 #include "common/FindComponents.hpp"
 #include "common/Builder.hpp"
 #include "common/Log.hpp"
+#include "common/Profiler.hpp"
 
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
@@ -32,6 +35,11 @@ namespace cf3 {
 namespace common  {
 namespace PE {
 
+////////////////////////////////////////////////////////////////////////////////
+
+/// tag of the messages exchanged by begin_synchronize and end_synchronize
+static const int synchronize_tag=7913;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Provider
 ////////////////////////////////////////////////////////////////////////////////
@@ -51,7 +59,9 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
   m_sendCount(PE::Comm::instance().size(),0),
   m_sendMap(0),
   m_recvCount(PE::Comm::instance().size(),0),
-  m_recvMap(0)
+  m_recvMap(0),
+  m_synchronizing(false),
+  m_request_wordsize(0)
 {
   //self->regist_signal ( "update" , "Executes communication patterns on all the registered data.", "" ).connect ( boost::bind ( &CommPattern2::update, self, _1 ) );
   m_isUpToDate=false;
@@ -62,6 +72,7 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
 
 CommPattern::~CommPattern()
 {
+  if (PE::Comm::instance().is_active()) free_requests();
   if (m_gid.get()!=nullptr) m_gid->remove_tag("gid_of_"+this->name());
 }
 
@@ -266,6 +277,8 @@ PECheckPoint(1000,"004");
 
 void CommPattern::setup()
 {
+  ScopedTimer timer("CommPattern::setup");
+
 #define COMPUTE_IRANK(inode,nproc,nnode) ((((unsigned long long)(inode))*((unsigned long long)(nproc)))/((unsigned long long)(nnode)))
 #define COMPUTE_INODE(irank,nproc,nnode) (((unsigned long long)(nnode))>((unsigned long long)(nproc))?((((unsigned long long)(irank))*((unsigned long long)(nnode)))%((unsigned long long)(nproc))==0?(((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)):((((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)))+1ul):((unsigned long long)(irank)))
 
@@ -275,6 +288,7 @@ void CommPattern::setup()
   if (m_gid.get()==nullptr) throw cf3::common::BadValue(FromHere(),"Gid is not registered for for commpattern: " + name());
   if (m_gid->stride()!=1) throw cf3::common::BadValue(FromHere(),"Gid is not of stride==1 for commpattern: " + name());
   if (m_gid->is_data_type_Uint()!=true) throw cf3::common::CastingFailed(FromHere(),"Gid is not of type Uint for commpattern: " + name());
+  if (m_synchronizing) throw cf3::common::ShouldNotBeHere(FromHere(),"Commpattern '" + name() + "' is modified while a synchronization is in progress.");
 
   // look around for max gid for the global array's size
   Uint nglobalarray=0;
@@ -467,6 +481,7 @@ void CommPattern::setup()
   m_rem_buffer.clear();
   m_mov_buffer.clear();
   m_free_lids.assign(1,m_isUpdatable.size());
+  free_requests();
   for(int i=0; i<(const int)global.size(); i++)
     if (global_nelems[i]!=0)
       delete[] global[i];
@@ -562,31 +577,24 @@ void CommPattern::setup()
 
 void CommPattern::synchronize_all()
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
-  BOOST_FOREACH( CommWrapper& pobj, find_components_recursively<CommWrapper>(*this) )
-  {
-    synchronize_this(pobj,sndbuf,rcvbuf);
-  }
+  begin_synchronize_all();
+  end_synchronize();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void CommPattern::synchronize( const std::string& name )
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
-  Handle<CommWrapper> pobj(get_child(name));
-  synchronize_this(*pobj,sndbuf,rcvbuf);
+  begin_synchronize(name);
+  end_synchronize();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void CommPattern::synchronize( const CommWrapper& pobj )
 {
-  std::vector<unsigned char> sndbuf(1);
-  std::vector<unsigned char> rcvbuf(1);
-  synchronize_this(pobj,sndbuf,rcvbuf);
+  begin_synchronize(pobj);
+  end_synchronize();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -607,6 +615,172 @@ void CommPattern::synchronize_this( const CommWrapper& pobj, std::vector<unsigne
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void CommPattern::begin_synchronize_all()
+{
+  std::vector< Handle<CommWrapper const> > pobjs;
+  BOOST_FOREACH( CommWrapper& pobj, find_components_recursively<CommWrapper>(*this) )
+  {
+    pobjs.push_back(pobj.handle<CommWrapper>());
+  }
+  begin_synchronize(pobjs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::begin_synchronize( const std::string& name )
+{
+  Handle<CommWrapper> pobj(get_child(name));
+  if (is_null(pobj)) throw common::ValueNotFound(FromHere(),"No data named '" + name + "' is registered in commpattern '" + uri().path() + "'.");
+  begin_synchronize(std::vector< Handle<CommWrapper const> >(1,pobj));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::begin_synchronize( const CommWrapper& pobj )
+{
+  begin_synchronize(std::vector< Handle<CommWrapper const> >(1,pobj.handle<CommWrapper>()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// all objects go in a single message per neighbouring rank
+// inside the segment for a rank, the data of the first object comes first, followed by the second object and so on
+void CommPattern::begin_synchronize( const std::vector< Handle<CommWrapper const> >& pobjs )
+{
+  if (m_synchronizing) throw common::ShouldNotBeHere(FromHere(),"Commpattern '" + uri().path() + "' is asked to start a synchronization while the previous one is not ended.");
+  ScopedTimer timer("CommPattern::begin_synchronize");
+
+  m_pending.clear();
+  int wordsize=0;
+  BOOST_FOREACH( const Handle<CommWrapper const>& pobj, pobjs )
+  {
+    if (pobj->needs_update())
+    {
+      m_pending.push_back(pobj);
+      wordsize+=pobj->size_of()*pobj->stride();
+    }
+  }
+  m_synchronizing=true;
+  if (wordsize==0) return;
+
+  if (wordsize!=m_request_wordsize) init_requests(wordsize);
+  if (m_requests.empty()) return;
+
+  if (m_sendMap.empty())
+  {
+    // only receiving
+  }
+  else if (m_pending.size()==1)
+  {
+    m_pending.front()->pack(m_sendMap,&m_async_sndbuf[0]);
+  }
+  else
+  {
+    const int nproc=(const int)m_sendCount.size();
+    int objoffset=0;
+    BOOST_FOREACH( const Handle<CommWrapper const>& pobj, m_pending )
+    {
+      const int objsize=pobj->size_of()*pobj->stride();
+      pobj->pack(m_pack_buf,m_sendMap);
+      int start=0;
+      for (int i=0; i<nproc; i++)
+      {
+        if (m_sendCount[i]!=0) memcpy(&m_async_sndbuf[start*wordsize+objoffset*m_sendCount[i]],&m_pack_buf[start*objsize],m_sendCount[i]*objsize);
+        start+=m_sendCount[i];
+      }
+      objoffset+=objsize;
+    }
+  }
+
+  MPI_CHECK_RESULT(MPI_Startall,((int)m_requests.size(),&m_requests[0]));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::end_synchronize()
+{
+  if (!m_synchronizing) throw common::ShouldNotBeHere(FromHere(),"Commpattern '" + uri().path() + "' is asked to end a synchronization that was not started.");
+  m_synchronizing=false;
+  if (m_pending.empty() || m_requests.empty()) return;
+  ScopedTimer timer("CommPattern::end_synchronize");
+
+  MPI_CHECK_RESULT(MPI_Waitall,((int)m_requests.size(),&m_requests[0],MPI_STATUSES_IGNORE));
+
+  if (m_recvMap.empty()) return;
+  if (m_pending.size()==1)
+  {
+    m_pending.front()->unpack(&m_async_rcvbuf[0],m_recvMap);
+  }
+  else
+  {
+    const int nproc=(const int)m_recvCount.size();
+    int objoffset=0;
+    BOOST_FOREACH( const Handle<CommWrapper const>& pobj, m_pending )
+    {
+      const int objsize=pobj->size_of()*pobj->stride();
+      m_pack_buf.resize(m_recvMap.size()*objsize);
+      int start=0;
+      for (int i=0; i<nproc; i++)
+      {
+        if (m_recvCount[i]!=0) memcpy(&m_pack_buf[start*objsize],&m_async_rcvbuf[start*m_request_wordsize+objoffset*m_recvCount[i]],m_recvCount[i]*objsize);
+        start+=m_recvCount[i];
+      }
+      pobj->unpack(m_pack_buf,m_recvMap);
+      objoffset+=objsize;
+    }
+  }
+  m_pending.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::init_requests( const int wordsize )
+{
+  free_requests();
+
+  const int nproc=(const int)m_sendCount.size();
+  const Communicator comm=PE::Comm::instance().communicator();
+  m_async_sndbuf.resize(m_sendMap.size()*wordsize);
+  m_async_rcvbuf.resize(m_recvMap.size()*wordsize);
+
+  // receives are put first, so MPI_Startall posts them before any send
+  int start=0;
+  for (int i=0; i<nproc; i++)
+  {
+    if (m_recvCount[i]!=0)
+    {
+      m_requests.push_back(MPI_REQUEST_NULL);
+      MPI_CHECK_RESULT(MPI_Recv_init,(&m_async_rcvbuf[start*wordsize],m_recvCount[i]*wordsize,MPI_BYTE,i,synchronize_tag,comm,&m_requests.back()));
+    }
+    start+=m_recvCount[i];
+  }
+  start=0;
+  for (int i=0; i<nproc; i++)
+  {
+    if (m_sendCount[i]!=0)
+    {
+      m_requests.push_back(MPI_REQUEST_NULL);
+      MPI_CHECK_RESULT(MPI_Send_init,(&m_async_sndbuf[start*wordsize],m_sendCount[i]*wordsize,MPI_BYTE,i,synchronize_tag,comm,&m_requests.back()));
+    }
+    start+=m_sendCount[i];
+  }
+  m_request_wordsize=wordsize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::free_requests()
+{
+  BOOST_FOREACH( MPI_Request& request, m_requests )
+  {
+    if (request!=MPI_REQUEST_NULL) MPI_CHECK_RESULT(MPI_Request_free,(&request));
+  }
+  m_requests.clear();
+  m_request_wordsize=0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void CommPattern::add_global(Uint gid, Uint rank)
 {
   // later a mechanism could be implemented when commpattern can give gids by calling a "reserve(int num)" beforehand, to optimize performance
@@ -652,6 +826,19 @@ void CommPattern::remove_local(Uint lid, bool on_all_ranks)
   m_isUpToDate=false;
 }
 
+void CommPattern::renumber(const std::vector<Uint>& new_lids)
+{
+  if (m_synchronizing) throw common::ShouldNotBeHere(FromHere(),"Commpattern '" + name() + "' is renumbered while a synchronization is in progress.");
+  if (!m_isUpToDate) throw common::ShouldNotBeHere(FromHere(),"Commpattern '" + name() + "' has changes that are not set up, it can not be renumbered.");
+  if (new_lids.size()!=m_isUpdatable.size()) throw common::BadValue(FromHere(),"Renumbering of commpattern '" + name() + "' needs " + boost::lexical_cast<std::string>(m_isUpdatable.size()) + " local ids, got " + boost::lexical_cast<std::string>(new_lids.size()) + ".");
+
+  BOOST_FOREACH(CPint& lid, m_sendMap) lid=(CPint)new_lids[lid];
+  BOOST_FOREACH(CPint& lid, m_recvMap) lid=(CPint)new_lids[lid];
+  std::vector<bool> updatable(m_isUpdatable.size());
+  for (Uint i=0; i<new_lids.size(); i++) updatable[new_lids[i]]=m_isUpdatable[i];
+  m_isUpdatable.swap(updatable);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Component related
 ////////////////////////////////////////////////////////////////////////////////
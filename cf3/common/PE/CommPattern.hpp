@@ -229,6 +229,34 @@ public:
   /// @param name the name of the parallel object
   void synchronize( const CommWrapper& pobj );
 
+  /// start a non-blocking synchronization of all parallel objects
+  /// the data is packed into one message per neighbouring rank and the persistent send and receive requests are started,
+  /// so work that does not touch the ghost values can be done before calling end_synchronize
+  /// only one synchronization can be in progress per commpattern, and all ranks must call the begin and end functions in the same order
+  void begin_synchronize_all();
+
+  /// start a non-blocking synchronization of the parallel object designated by its name
+  /// @param name the name of the parallel object
+  /// @see begin_synchronize_all
+  void begin_synchronize( const std::string& name );
+
+  /// start a non-blocking synchronization of the parallel object designated by its commwrapper reference
+  /// @param pobj the parallel object
+  /// @see begin_synchronize_all
+  void begin_synchronize( const CommWrapper& pobj );
+
+  /// start a non-blocking synchronization of several parallel objects, sent together in one message per neighbouring rank
+  /// objects that do not need update are skipped
+  /// @param pobjs the parallel objects, in the same order on all ranks
+  /// @see begin_synchronize_all
+  void begin_synchronize( const std::vector< Handle<CommWrapper const> >& pobjs );
+
+  /// wait for the messages posted by the last begin_synchronize and unpack the ghost values
+  void end_synchronize();
+
+  /// accessor to check if a synchronization started by begin_synchronize is still to be completed
+  bool is_synchronizing() const { return m_synchronizing; }
+
   /// add element to the commpattern
   /// when all changes done, all needs to be committed by calling setup
   /// if global id is not on current rank, then a ghost is automatically created on current rank
@@ -260,6 +288,11 @@ public:
   /// @see setup for committing changes
   void remove_local(Uint lid, bool on_all_ranks=false);
 
+  /// change the local ids of the nodes without any communication, for example after reordering them for locality
+  /// the registered data must already be permuted the same way, the messages keep their layout
+  /// @param new_lids new local id of each node, indexed by the old local id
+  void renumber(const std::vector<Uint>& new_lids);
+
   //@} END COMMPATTERN HANDLING
 
   /// @name ACCESSORS
@@ -292,6 +325,13 @@ protected: // helper function
   /// @param rcvbuf vector for intermediate buffer for recieve
   void synchronize_this( const CommWrapper& pobj, std::vector<unsigned char>& sndbuf, std::vector<unsigned char>& rcvbuf );
 
+  /// (re)create the persistent requests and the buffers they are bound to
+  /// @param wordsize number of bytes sent for each node, summed over all objects in the exchange
+  void init_requests( const int wordsize );
+
+  /// release the persistent requests, must be called whenever the send or receive maps change
+  void free_requests();
+
 private:
 
   /// @name PROPERTIES
@@ -343,6 +383,32 @@ private:
   /// this is the map of receiveing communication pattern
   std::vector< CPint > m_recvMap;
 
+  /// @name SPLIT-PHASE SYNCHRONIZATION
+  //@{
+
+  /// flag telling if begin_synchronize was called without the matching end_synchronize
+  bool m_synchronizing;
+
+  /// objects that are being synchronized, in the order they appear in each message
+  std::vector< Handle<CommWrapper const> > m_pending;
+
+  /// persistent receive and send requests, one per neighbouring rank, bound to m_async_rcvbuf and m_async_sndbuf
+  std::vector<MPI_Request> m_requests;
+
+  /// number of bytes per node the persistent requests were created for, zero if there are no requests
+  int m_request_wordsize;
+
+  /// send buffer, reused as long as the pattern and the set of synchronized objects do not change
+  std::vector<unsigned char> m_async_sndbuf;
+
+  /// receive buffer, reused as long as the pattern and the set of synchronized objects do not change
+  std::vector<unsigned char> m_async_rcvbuf;
+
+  /// scratch buffer to interleave objects when more than one is synchronized in the same exchange
+  std::vector<unsigned char> m_pack_buf;
+
+  //@} END SPLIT-PHASE SYNCHRONIZATION
+
 }; // CommPattern
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,293 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_PE_directory_hpp
+#define cf3_common_PE_directory_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "common/BasicExceptions.hpp"
+
+#include "common/PE/Comm.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file directory.hpp
+  Distributed directory, used to find the owner of items that are known by a key, such as a hash of the coordinates
+  or a global index, without broadcasting the keys of every process to all others.
+  The entry for each key is stored on the process given by directory_rank, so a lookup takes two personalised
+  all_to_all calls (the questions and the answers), whatever the number of processes.
+**/
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+namespace PE {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Rank of the process that holds the directory entry of key. The key is mixed first,
+/// so keys that are numbered along a space filling curve or by partition still spread evenly.
+inline Uint directory_rank(const boost::uint64_t key, const Uint nb_procs)
+{
+  boost::uint64_t h = key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return static_cast<Uint>(h % nb_procs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+/// Directory entry: key, value and rank that registered it
+struct DirectoryEntry
+{
+  boost::uint64_t key;
+  boost::uint64_t value;
+  Uint rank;
+
+  bool operator<(const DirectoryEntry& other) const { return key < other.key; }
+};
+
+/// Value contributed for a key, and the position of the answer if the contributing rank asks for the key
+struct DirectoryContribution
+{
+  boost::uint64_t key;
+  boost::uint64_t value;
+  Uint rank;
+  Uint answer_idx;
+
+  bool operator<(const DirectoryContribution& other) const { return key < other.key; }
+};
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Find the values of the items that are owned by other processes. Collective.
+/// Each process registers the keys of the items it owns together with their value, and asks for the keys of the others.
+/// If a key is registered by more than one process, the lowest rank wins.
+/// @param [in] keys          key of each local item
+/// @param [in] owned         true for the items whose value is registered by this process
+/// @param [in,out] values    value of each item. The entries for the items that are not owned are filled in if their key was found.
+/// @param [in,out] ranks     rank of each item. The entries for the items that are not owned are set to the rank that registered the key, if found.
+/// @return number of items that were not owned and whose key was not found
+template<typename KeyT, typename ValueT>
+Uint directory_lookup(const std::vector<KeyT>& keys, const std::vector<bool>& owned, std::vector<ValueT>& values, std::vector<Uint>& ranks)
+{
+  cf3_assert(owned.size() == keys.size());
+  cf3_assert(values.size() == keys.size());
+  cf3_assert(ranks.size() == keys.size());
+
+  Comm& comm = Comm::instance();
+  const Uint nb_procs = comm.size();
+  const boost::uint64_t no_value = std::numeric_limits<boost::uint64_t>::max();
+
+  // Pairs of key and value (no_value for questions), sent to the rank that holds the entry
+  std::vector< std::vector<boost::uint64_t> > send(nb_procs);
+  // Local index of each question, in the order it was sent to each rank
+  std::vector< std::vector<Uint> > questions(nb_procs);
+  for(Uint i = 0; i != keys.size(); ++i)
+  {
+    const Uint dest = directory_rank(static_cast<boost::uint64_t>(keys[i]), nb_procs);
+    send[dest].push_back(static_cast<boost::uint64_t>(keys[i]));
+    if(owned[i])
+    {
+      send[dest].push_back(static_cast<boost::uint64_t>(values[i]));
+    }
+    else
+    {
+      send[dest].push_back(no_value);
+      questions[dest].push_back(i);
+    }
+  }
+
+  std::vector< std::vector<boost::uint64_t> > recv;
+  comm.all_to_all(send, recv);
+
+  // Sorted table of the registered entries. The stable sort keeps the lowest rank first for duplicated keys
+  std::vector<detail::DirectoryEntry> directory;
+  for(Uint rank = 0; rank != recv.size(); ++rank)
+  {
+    for(Uint j = 0; j < recv[rank].size(); j += 2)
+    {
+      if(recv[rank][j+1] == no_value)
+        continue;
+      detail::DirectoryEntry entry;
+      entry.key = recv[rank][j];
+      entry.value = recv[rank][j+1];
+      entry.rank = rank;
+      directory.push_back(entry);
+    }
+  }
+  std::stable_sort(directory.begin(), directory.end());
+
+  // Answer with the value and the registering rank, in the order of the questions
+  for(Uint rank = 0; rank != recv.size(); ++rank)
+  {
+    send[rank].clear();
+    for(Uint j = 0; j < recv[rank].size(); j += 2)
+    {
+      if(recv[rank][j+1] != no_value)
+        continue;
+      detail::DirectoryEntry question;
+      question.key = recv[rank][j];
+      const std::vector<detail::DirectoryEntry>::const_iterator found = std::lower_bound(directory.begin(), directory.end(), question);
+      if(found != directory.end() && found->key == question.key)
+      {
+        send[rank].push_back(found->value);
+        send[rank].push_back(found->rank);
+      }
+      else
+      {
+        send[rank].push_back(no_value);
+        send[rank].push_back(no_value);
+      }
+    }
+  }
+
+  comm.all_to_all(send, recv);
+
+  Uint nb_not_found = 0;
+  for(Uint rank = 0; rank != nb_procs; ++rank)
+  {
+    cf3_assert(recv[rank].size() == 2*questions[rank].size());
+    for(Uint j = 0; j != questions[rank].size(); ++j)
+    {
+      if(recv[rank][2*j] == no_value)
+      {
+        ++nb_not_found;
+        continue;
+      }
+      values[questions[rank][j]] = static_cast<ValueT>(recv[rank][2*j]);
+      ranks[questions[rank][j]] = static_cast<Uint>(recv[rank][2*j+1]);
+    }
+  }
+
+  return nb_not_found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Find, for each key asked by this process, the smallest value that the processes contributed for the same key. Collective.
+/// Ties are resolved in favour of the lowest rank.
+/// @param [in] keys          key of each local item. The keys must be unique on each process.
+/// @param [in] values        value contributed for each local item
+/// @param [in] ask           true for the items whose smallest value is needed
+/// @param [in] include_self  if false, the values contributed by this process are ignored for its own questions
+/// @param [out] min_values   for the asked items, the smallest value, or the maximum Uint if no other process has the key
+/// @param [out] min_ranks    for the asked items, the rank that contributed the smallest value, or the maximum Uint
+template<typename KeyT>
+void directory_min(const std::vector<KeyT>& keys, const std::vector<Uint>& values, const std::vector<bool>& ask, const bool include_self,
+                   std::vector<Uint>& min_values, std::vector<Uint>& min_ranks)
+{
+  cf3_assert(values.size() == keys.size());
+  cf3_assert(ask.size() == keys.size());
+
+  Comm& comm = Comm::instance();
+  const Uint nb_procs = comm.size();
+  const Uint not_found = std::numeric_limits<Uint>::max();
+
+  // Triplets of key, value and question flag, sent to the rank that holds the entry
+  std::vector< std::vector<boost::uint64_t> > send(nb_procs);
+  std::vector< std::vector<Uint> > questions(nb_procs);
+  for(Uint i = 0; i != keys.size(); ++i)
+  {
+    const Uint dest = directory_rank(static_cast<boost::uint64_t>(keys[i]), nb_procs);
+    send[dest].push_back(static_cast<boost::uint64_t>(keys[i]));
+    send[dest].push_back(values[i]);
+    send[dest].push_back(ask[i] ? 1u : 0u);
+    if(ask[i])
+      questions[dest].push_back(i);
+  }
+
+  std::vector< std::vector<boost::uint64_t> > recv;
+  comm.all_to_all(send, recv);
+
+  std::vector<detail::DirectoryContribution> directory;
+  for(Uint rank = 0; rank != recv.size(); ++rank)
+  {
+    send[rank].clear();
+    Uint nb_questions = 0;
+    for(Uint j = 0; j < recv[rank].size(); j += 3)
+    {
+      detail::DirectoryContribution entry;
+      entry.key = recv[rank][j];
+      entry.value = recv[rank][j+1];
+      entry.rank = rank;
+      entry.answer_idx = recv[rank][j+2] != 0 ? nb_questions++ : not_found;
+      directory.push_back(entry);
+    }
+    send[rank].resize(2*nb_questions);
+  }
+  std::sort(directory.begin(), directory.end());
+
+  // Few processes share a key, so each group of equal keys is small
+  for(Uint begin = 0; begin != directory.size(); )
+  {
+    Uint end = begin;
+    while(end != directory.size() && directory[end].key == directory[begin].key)
+      ++end;
+
+    for(Uint asker = begin; asker != end; ++asker)
+    {
+      if(directory[asker].answer_idx == not_found)
+        continue;
+      boost::uint64_t min_value = not_found;
+      Uint min_rank = not_found;
+      for(Uint j = begin; j != end; ++j)
+      {
+        if(!include_self && directory[j].rank == directory[asker].rank)
+          continue;
+        if(directory[j].value < min_value || (directory[j].value == min_value && directory[j].rank < min_rank))
+        {
+          min_value = directory[j].value;
+          min_rank = directory[j].rank;
+        }
+      }
+      std::vector<boost::uint64_t>& answer = send[directory[asker].rank];
+      answer[2*directory[asker].answer_idx] = min_value;
+      answer[2*directory[asker].answer_idx+1] = min_rank;
+    }
+    begin = end;
+  }
+
+  comm.all_to_all(send, recv);
+
+  min_values.assign(keys.size(), not_found);
+  min_ranks.assign(keys.size(), not_found);
+  for(Uint rank = 0; rank != nb_procs; ++rank)
+  {
+    cf3_assert(recv[rank].size() == 2*questions[rank].size());
+    for(Uint j = 0; j != questions[rank].size(); ++j)
+    {
+      min_values[questions[rank][j]] = static_cast<Uint>(recv[rank][2*j]);
+      min_ranks[questions[rank][j]] = static_cast<Uint>(recv[rank][2*j+1]);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // PE
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_PE_directory_hpp
@@ -0,0 +1,462 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Profiler.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#ifdef CF3_OS_LINUX
+extern "C"
+{
+  #include <time.h>
+}
+#else
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+/// Wall clock time in seconds, from an arbitrary starting point
+inline Real wall_time()
+{
+#ifdef CF3_OS_LINUX
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<Real>(now.tv_sec) + 1e-9 * static_cast<Real>(now.tv_nsec);
+#else
+  static const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  return 1e-6 * static_cast<Real>((boost::posix_time::microsec_clock::universal_time() - start).total_microseconds());
+#endif
+}
+
+/// Node of the call tree of a single thread
+struct ProfileNode
+{
+  ProfileNode(const std::string& node_name, const Uint parent_node) :
+    name(node_name),
+    parent(parent_node)
+  {
+    clear();
+  }
+
+  void clear()
+  {
+    calls = 0;
+    total_time = 0.;
+    fastest_call = std::numeric_limits<Real>::max();
+    slowest_call = 0.;
+  }
+
+  std::string name;
+  Uint parent;
+  std::vector<Uint> children;
+  Uint calls;
+  Real total_time;
+  Real fastest_call;
+  Real slowest_call;
+};
+
+/// Call tree of a single thread. Node 0 is the root, which is never timed
+struct ProfileThreadData
+{
+  ProfileThreadData() : current(0), generation(0)
+  {
+    nodes.push_back(ProfileNode("", 0));
+  }
+
+  /// Index of the child of the current node with the given name, created if needed
+  Uint child(const char* name)
+  {
+    const std::vector<Uint>& children = nodes[current].children;
+    for(std::vector<Uint>::const_iterator it = children.begin(); it != children.end(); ++it)
+    {
+      if(nodes[*it].name == name)
+        return *it;
+    }
+
+    const Uint result = nodes.size();
+    nodes.push_back(ProfileNode(name, current));
+    nodes[current].children.push_back(result);
+    return result;
+  }
+
+  std::vector<ProfileNode> nodes;
+  Uint current;
+  /// Incremented by each reset, so timers that were running at the time of the reset are discarded
+  Uint generation;
+};
+
+/// Statistics of one call tree path, merged over the threads of this process
+struct LocalStats
+{
+  LocalStats() : calls(0), total_time(0.), fastest_call(std::numeric_limits<Real>::max()), slowest_call(0.)
+  {
+  }
+
+  Uint calls;
+  Real total_time;
+  Real fastest_call;
+  Real slowest_call;
+};
+
+typedef std::map< std::vector<std::string>, LocalStats > LocalStatsT;
+
+/// Add the statistics of node and its children to stats
+void merge_node(const ProfileThreadData& data, const Uint node_idx, std::vector<std::string>& path, LocalStatsT& stats)
+{
+  const ProfileNode& node = data.nodes[node_idx];
+  if(node_idx != 0)
+  {
+    path.push_back(node.name);
+    LocalStats& entry = stats[path];
+    entry.calls += node.calls;
+    entry.total_time += node.total_time;
+    entry.fastest_call = std::min(entry.fastest_call, node.fastest_call);
+    entry.slowest_call = std::max(entry.slowest_call, node.slowest_call);
+  }
+
+  for(std::vector<Uint>::const_iterator it = node.children.begin(); it != node.children.end(); ++it)
+    merge_node(data, *it, path, stats);
+
+  if(node_idx != 0)
+    path.pop_back();
+}
+
+/// Separators used to send the paths over MPI
+const char path_separator = '\x1f';
+const char line_separator = '\n';
+
+void no_cleanup(ProfileThreadData*)
+{
+}
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+class Profiler::Implementation
+{
+public:
+  Implementation() :
+    m_enabled(0),
+    m_thread_data(&detail::no_cleanup)
+  {
+  }
+
+  /// Call tree of the calling thread. The data is owned by m_all_data, so it survives the thread
+  detail::ProfileThreadData& thread_data()
+  {
+    detail::ProfileThreadData* data = m_thread_data.get();
+    if(data == 0)
+    {
+      data = new detail::ProfileThreadData();
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_all_data.push_back(data);
+      m_thread_data.reset(data);
+    }
+    return *data;
+  }
+
+  /// Read by every ScopedTimer, possibly while another thread changes it. A whole word, so a reader sees
+  /// either value, and a timer that misses a change only records or skips one more call.
+  volatile std::sig_atomic_t m_enabled;
+  boost::thread_specific_ptr<detail::ProfileThreadData> m_thread_data;
+  boost::ptr_vector<detail::ProfileThreadData> m_all_data;
+  boost::mutex m_mutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+Profiler::Profiler() :
+  m_implementation(new Implementation())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Profiler::~Profiler()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Profiler& Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Profiler::enabled() const
+{
+  return m_implementation->m_enabled != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::set_enabled(const bool enabled)
+{
+  m_implementation->m_enabled = enabled ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::reset()
+{
+  if(ThreadPool::instance().in_parallel_region())
+    throw IllegalCall(FromHere(), "Profiler can't be reset from inside a threaded task");
+
+  boost::lock_guard<boost::mutex> lock(m_implementation->m_mutex);
+  for(boost::ptr_vector<detail::ProfileThreadData>::iterator data = m_implementation->m_all_data.begin(); data != m_implementation->m_all_data.end(); ++data)
+  {
+    for(std::vector<detail::ProfileNode>::iterator node = data->nodes.begin(); node != data->nodes.end(); ++node)
+      node->clear();
+    data->current = 0;
+    ++data->generation;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<ProfileEntry> Profiler::collect()
+{
+  if(ThreadPool::instance().in_parallel_region())
+    throw IllegalCall(FromHere(), "Profile can't be collected from inside a threaded task");
+
+  detail::LocalStatsT local_stats;
+  {
+    boost::lock_guard<boost::mutex> lock(m_implementation->m_mutex);
+    std::vector<std::string> path;
+    for(boost::ptr_vector<detail::ProfileThreadData>::const_iterator data = m_implementation->m_all_data.begin(); data != m_implementation->m_all_data.end(); ++data)
+      detail::merge_node(*data, 0, path, local_stats);
+  }
+
+  const bool parallel = PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1;
+
+  // Union of the paths over all processes. The set keeps them in call tree order
+  std::set< std::vector<std::string> > paths;
+  if(parallel)
+  {
+    std::vector<char> send_buffer;
+    for(detail::LocalStatsT::const_iterator it = local_stats.begin(); it != local_stats.end(); ++it)
+    {
+      for(Uint i = 0; i != it->first.size(); ++i)
+      {
+        if(i != 0)
+          send_buffer.push_back(detail::path_separator);
+        send_buffer.insert(send_buffer.end(), it->first[i].begin(), it->first[i].end());
+      }
+      send_buffer.push_back(detail::line_separator);
+    }
+    if(send_buffer.empty())
+      send_buffer.push_back(detail::line_separator);
+
+    std::vector< std::vector<char> > receive_buffers;
+    PE::Comm::instance().all_gather(send_buffer, receive_buffers);
+    for(Uint rank = 0; rank != receive_buffers.size(); ++rank)
+    {
+      std::vector<std::string> path;
+      std::string name;
+      for(std::vector<char>::const_iterator c = receive_buffers[rank].begin(); c != receive_buffers[rank].end(); ++c)
+      {
+        if(*c == detail::path_separator || *c == detail::line_separator)
+        {
+          path.push_back(name);
+          name.clear();
+        }
+        else
+        {
+          name.push_back(*c);
+        }
+
+        if(*c == detail::line_separator)
+        {
+          if(path.size() > 1 || !path.front().empty())
+            paths.insert(path);
+          path.clear();
+        }
+      }
+    }
+  }
+  else
+  {
+    for(detail::LocalStatsT::const_iterator it = local_stats.begin(); it != local_stats.end(); ++it)
+      paths.insert(it->first);
+  }
+
+  const Uint nb_entries = paths.size();
+  std::vector<Uint> present(nb_entries, 0), calls(nb_entries, 0);
+  std::vector<Real> times(nb_entries, 0.), fastest(nb_entries, std::numeric_limits<Real>::max()), slowest(nb_entries, 0.);
+  Uint idx = 0;
+  for(std::set< std::vector<std::string> >::const_iterator path = paths.begin(); path != paths.end(); ++path, ++idx)
+  {
+    detail::LocalStatsT::const_iterator found = local_stats.find(*path);
+    if(found == local_stats.end())
+      continue;
+    present[idx] = found->second.calls != 0 ? 1 : 0;
+    calls[idx] = found->second.calls;
+    times[idx] = found->second.total_time;
+    fastest[idx] = found->second.fastest_call;
+    slowest[idx] = found->second.slowest_call;
+  }
+
+  std::vector<Uint> nb_ranks(present), min_calls(calls), max_calls(calls);
+  std::vector<Real> min_time(times), sum_time(times), max_time(times), min_fastest(fastest), max_slowest(slowest);
+  Real nb_procs = 1.;
+  if(parallel && nb_entries != 0)
+  {
+    PE::Comm& comm = PE::Comm::instance();
+    comm.all_reduce(PE::plus(), present, nb_ranks);
+    comm.all_reduce(PE::min(), calls, min_calls);
+    comm.all_reduce(PE::max(), calls, max_calls);
+    comm.all_reduce(PE::min(), times, min_time);
+    comm.all_reduce(PE::plus(), times, sum_time);
+    comm.all_reduce(PE::max(), times, max_time);
+    comm.all_reduce(PE::min(), fastest, min_fastest);
+    comm.all_reduce(PE::max(), slowest, max_slowest);
+    nb_procs = static_cast<Real>(comm.size());
+  }
+
+  std::vector<ProfileEntry> result;
+  result.reserve(nb_entries);
+  idx = 0;
+  for(std::set< std::vector<std::string> >::const_iterator path = paths.begin(); path != paths.end(); ++path, ++idx)
+  {
+    // Skip scopes that were not called since the last reset
+    if(nb_ranks[idx] == 0)
+      continue;
+
+    ProfileEntry entry;
+    entry.path = *path;
+    entry.nb_ranks = nb_ranks[idx];
+    entry.min_calls = min_calls[idx];
+    entry.max_calls = max_calls[idx];
+    entry.min_time = min_time[idx];
+    entry.avg_time = sum_time[idx] / nb_procs;
+    entry.max_time = max_time[idx];
+    entry.fastest_call = min_fastest[idx];
+    entry.slowest_call = max_slowest[idx];
+    result.push_back(entry);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::print_report(std::ostream& stream)
+{
+  const std::vector<ProfileEntry> entries = collect();
+
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().rank() != 0)
+    return;
+
+  const Uint nb_procs = PE::Comm::instance().is_active() ? PE::Comm::instance().size() : 1;
+  stream << "Profile: wall clock time in seconds, with [min, avg, max] over " << nb_procs << " processes\n";
+  for(std::vector<ProfileEntry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+  {
+    const Real imbalance = entry->avg_time > 0. ? entry->max_time / entry->avg_time : 1.;
+    stream << std::string(2*entry->path.size(), ' ') << entry->path.back()
+           << ": time: [" << entry->min_time << ", " << entry->avg_time << ", " << entry->max_time << "]"
+           << ", imbalance: " << std::setprecision(3) << imbalance << std::setprecision(6)
+           << ", calls: [" << entry->min_calls << ", " << entry->max_calls << "]"
+           << ", per call: [" << entry->fastest_call << ", " << entry->slowest_call << "]";
+    if(entry->nb_ranks != nb_procs)
+      stream << ", on " << entry->nb_ranks << " processes";
+    stream << "\n";
+  }
+  stream << std::flush;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ScopedTimer::ScopedTimer(const char* name) :
+  m_data(0)
+{
+  if(Profiler::instance().enabled())
+    start(name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ScopedTimer::ScopedTimer(const std::string& name) :
+  m_data(0)
+{
+  if(Profiler::instance().enabled())
+    start(name.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ScopedTimer::~ScopedTimer()
+{
+  stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ScopedTimer::start(const char* name)
+{
+  detail::ProfileThreadData& data = Profiler::instance().m_implementation->thread_data();
+  m_parent = data.current;
+  m_node = data.child(name);
+  data.current = m_node;
+  m_data = &data;
+  m_generation = data.generation;
+  m_start_time = detail::wall_time();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ScopedTimer::stop()
+{
+  if(m_data == 0)
+    return;
+
+  if(m_data->generation != m_generation)
+  {
+    m_data = 0;
+    return;
+  }
+
+  const Real elapsed = detail::wall_time() - m_start_time;
+  detail::ProfileNode& node = m_data->nodes[m_node];
+  ++node.calls;
+  node.total_time += elapsed;
+  node.fastest_call = std::min(node.fastest_call, elapsed);
+  node.slowest_call = std::max(node.slowest_call, elapsed);
+
+  m_data->current = m_parent;
+  m_data = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
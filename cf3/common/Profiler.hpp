@@ -0,0 +1,120 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_Profiler_hpp
+#define cf3_common_Profiler_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+namespace detail { struct ProfileThreadData; }
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Statistics for one node of the profile call tree, combined over all threads and processes
+struct Common_API ProfileEntry
+{
+  /// Names of the nested scopes leading to this entry, outermost first
+  std::vector<std::string> path;
+  /// Number of processes that executed this scope at least once
+  Uint nb_ranks;
+  /// Number of calls, summed over the threads of a process, minimum and maximum over the processes
+  Uint min_calls;
+  Uint max_calls;
+  /// Total wall clock time (in seconds) summed over the threads of a process: minimum, average and maximum over the processes
+  Real min_time;
+  Real avg_time;
+  Real max_time;
+  /// Fastest and slowest single call over all threads and processes
+  Real fastest_call;
+  Real slowest_call;
+};
+
+/// Lightweight instrumentation of the hot paths, always compiled in and enabled at run time through the
+/// profiling option of the Environment. Code is instrumented by putting a ScopedTimer on the stack.
+/// Each thread accumulates its own call tree, so timers don't need any locking. The trees are merged
+/// and reduced over all processes when the report is made, so load imbalance shows up as a difference between
+/// the minimum and maximum time.
+/// Timers started in a worker thread of the ThreadPool are placed at the root of the tree of that thread.
+class Common_API Profiler : public boost::noncopyable
+{
+public:
+  /// Singleton access
+  static Profiler& instance();
+
+  ~Profiler();
+
+  /// True if the timers are recording
+  bool enabled() const;
+
+  /// Enable or disable recording. Timers that are running keep running until they go out of scope.
+  void set_enabled(const bool enabled);
+
+  /// Clear all statistics, keeping the structure of the call trees. Timers that are running are discarded,
+  /// so new timers start at the root of the tree. Must not be called from a threaded task.
+  void reset();
+
+  /// Merge the statistics of all threads and processes, in call tree order. Collective if the Comm is active.
+  std::vector<ProfileEntry> collect();
+
+  /// Print the call tree on rank 0. Collective if the Comm is active.
+  void print_report(std::ostream& stream);
+
+private:
+  Profiler();
+
+  friend class ScopedTimer;
+  class Implementation;
+  boost::scoped_ptr<Implementation> m_implementation;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Times the enclosing scope as a child of the innermost running ScopedTimer of the same thread.
+/// Does nothing except checking a flag if the Profiler is disabled.
+class Common_API ScopedTimer : public boost::noncopyable
+{
+public:
+  explicit ScopedTimer(const char* name);
+  explicit ScopedTimer(const std::string& name);
+  ~ScopedTimer();
+
+  /// Stop the timer before the end of the scope
+  void stop();
+
+private:
+  void start(const char* name);
+
+  /// Call tree of the thread that started the timer, null if not running
+  detail::ProfileThreadData* m_data;
+  Uint m_node;
+  Uint m_parent;
+  /// Generation of the call tree when the timer started
+  Uint m_generation;
+  Real m_start_time;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_Profiler_hpp
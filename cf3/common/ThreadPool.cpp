@@ -0,0 +1,245 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <exception>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/ThreadPool.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool::Implementation
+{
+public:
+  Implementation() :
+    m_nb_threads(1),
+    m_reproducible(false),
+    m_running(false),
+    m_generation(0),
+    m_nb_busy(0),
+    m_stop(false)
+  {
+  }
+
+  ~Implementation()
+  {
+    stop_workers();
+  }
+
+  void start_workers(const Uint nb_threads)
+  {
+    stop_workers();
+    m_nb_threads = nb_threads;
+    for(Uint i = 1; i < m_nb_threads; ++i)
+      m_workers.push_back(new boost::thread(boost::bind(&Implementation::worker_loop, this, i, m_generation)));
+  }
+
+  void stop_workers()
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_start_condition.notify_all();
+    for(boost::ptr_vector<boost::thread>::iterator it = m_workers.begin(); it != m_workers.end(); ++it)
+      it->join();
+    m_workers.clear();
+    m_stop = false;
+    m_nb_threads = 1;
+  }
+
+  void run(const TaskT& task)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_task = task;
+      m_error.clear();
+      m_nb_busy = m_nb_threads - 1;
+      m_running = true;
+      ++m_generation;
+    }
+    m_start_condition.notify_all();
+
+    execute(0);
+
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while(m_nb_busy != 0)
+      m_done_condition.wait(lock);
+
+    m_running = false;
+    m_task.clear();
+
+    if(!m_error.empty())
+      throw ParallelError(FromHere(), "Error in threaded task: " + m_error);
+  }
+
+  bool running()
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_running;
+  }
+
+  Uint m_nb_threads;
+  bool m_reproducible;
+
+private:
+  /// Main loop for the worker threads. start_generation is the generation at thread creation,
+  /// so a task that is started before the thread first locks the mutex is not missed.
+  void worker_loop(const Uint thread_idx, const Uint start_generation)
+  {
+    Uint seen_generation = start_generation;
+    while(true)
+    {
+      {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while(!m_stop && m_generation == seen_generation)
+          m_start_condition.wait(lock);
+        if(m_stop)
+          return;
+        seen_generation = m_generation;
+      }
+
+      execute(thread_idx);
+
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        --m_nb_busy;
+      }
+      m_done_condition.notify_one();
+    }
+  }
+
+  /// Run the task for the given index, storing the first error that occurs
+  void execute(const Uint thread_idx)
+  {
+    try
+    {
+      m_task(thread_idx);
+    }
+    catch(std::exception& e)
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(m_error.empty())
+        m_error = e.what();
+    }
+    catch(...)
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(m_error.empty())
+        m_error = "unknown exception";
+    }
+  }
+
+  boost::ptr_vector<boost::thread> m_workers;
+  boost::mutex m_mutex;
+  boost::condition_variable m_start_condition;
+  boost::condition_variable m_done_condition;
+
+  TaskT m_task;
+  std::string m_error;
+  bool m_running;
+  Uint m_generation;
+  Uint m_nb_busy;
+  bool m_stop;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool() :
+  m_implementation(new Implementation())
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::~ThreadPool()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool& ThreadPool::instance()
+{
+  static ThreadPool thread_pool;
+  return thread_pool;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint ThreadPool::nb_threads() const
+{
+  return m_implementation->m_nb_threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::set_nb_threads(const Uint nb_threads)
+{
+  if(nb_threads == 0)
+    throw BadValue(FromHere(), "Number of threads must be at least 1");
+
+  if(in_parallel_region())
+    throw IllegalCall(FromHere(), "Number of threads can't be changed from inside a threaded task");
+
+  if(nb_threads != m_implementation->m_nb_threads)
+    m_implementation->start_workers(nb_threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ThreadPool::reproducible() const
+{
+  return m_implementation->m_reproducible;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::set_reproducible(const bool reproducible)
+{
+  m_implementation->m_reproducible = reproducible;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ThreadPool::run(const TaskT& task)
+{
+  const Uint nb_threads = m_implementation->m_nb_threads;
+
+  // Serial execution if there is only one thread or we are already inside a threaded task
+  if(nb_threads == 1 || in_parallel_region())
+  {
+    for(Uint i = 0; i != nb_threads; ++i)
+      task(i);
+    return;
+  }
+
+  m_implementation->run(task);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ThreadPool::in_parallel_region() const
+{
+  return m_implementation->running();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
@@ -0,0 +1,87 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_ThreadPool_hpp
+#define cf3_common_ThreadPool_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Pool of worker threads used for shared-memory parallel loops inside one process.
+/// The number of threads is controlled through the nb_threads option of the Environment,
+/// and is 1 by default, in which case all tasks simply run in the calling thread.
+/// @note Tasks must not call MPI functions, since MPI is not initialized in threaded mode
+class Common_API ThreadPool : public boost::noncopyable
+{
+public:
+  /// Signature of a task. The argument is the index of the thread that executes it, in the range [0, nb_threads)
+  typedef boost::function<void (const Uint)> TaskT;
+
+  /// Singleton access
+  static ThreadPool& instance();
+
+  ~ThreadPool();
+
+  /// Number of threads, including the calling thread
+  Uint nb_threads() const;
+
+  /// Change the number of threads. Existing workers are stopped first.
+  void set_nb_threads(const Uint nb_threads);
+
+  /// If true, threaded loops must use an order of operations that does not depend on the number of threads,
+  /// so results are bit-reproducible for any value of nb_threads
+  bool reproducible() const;
+
+  /// Set the reproducible flag
+  void set_reproducible(const bool reproducible);
+
+  /// Execute task(thread_idx) for each thread index and return when all are finished.
+  /// Index 0 is executed by the calling thread. When called from inside a running task, all indices
+  /// are executed in sequence by the caller. The first exception thrown by a task is rethrown here.
+  void run(const TaskT& task);
+
+  /// True if the calling code is executed by one of the tasks of run
+  bool in_parallel_region() const;
+
+private:
+  ThreadPool();
+
+  class Implementation;
+  boost::scoped_ptr<Implementation> m_implementation;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Split the range [0, size) into nb_parts contiguous chunks of (nearly) equal size,
+/// returning the bounds of chunk part in begin and end
+inline void split_range(const Uint size, const Uint nb_parts, const Uint part, Uint& begin, Uint& end)
+{
+  const Uint chunk = size / nb_parts;
+  const Uint remainder = size % nb_parts;
+  begin = part * chunk + (part < remainder ? part : remainder);
+  end = begin + chunk + (part < remainder ? 1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_ThreadPool_hpp
@@ -81,6 +81,8 @@ public:
   //@} END INDIVIDUAL ACCESS
 
   /// @name EFFICCIENT ACCESS
+  /// set_values, add_values and get_values must support concurrent calls from several threads,
+  /// as long as the block accumulators of the different threads don't share any index
   //@{
 
   /// Set a list of values
@@ -122,6 +124,10 @@ public:
   /// Reset Matrix
   virtual void reset(Real reset_to=0.) = 0;
 
+  /// Called by System::solve before the solution strategy is run, for matrices that postpone work on the RHS until then.
+  /// Does nothing by default.
+  virtual void prepare_solve(LSS::Vector& solution, LSS::Vector& rhs) {}
+
   //@} END EFFICCIENT ACCESS
 
   /// @name MISCELLANEOUS
@@ -0,0 +1,422 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+#include <sstream>
+
+#include "common/Assertions.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/Tags.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+#include "math/LSS/MatrixFreeMatrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+MatrixFreeMatrix::MatrixFreeMatrix(const std::string& name) :
+  LSS::Matrix(name),
+  m_is_created(false),
+  m_neq(0),
+  m_mode(ASSEMBLE),
+  m_x(0),
+  m_result(0)
+{
+  options().add("operator_action", m_operator_action)
+    .pretty_name("Operator Action")
+    .description("Action that assembles the system matrix. It is executed again for each matrix-vector product.")
+    .link_to(&m_operator_action)
+    .mark_basic();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::create(common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs)
+{
+  boost::shared_ptr<VariablesDescriptor> single_var_descriptor = common::allocate_component<VariablesDescriptor>("SingleVariableDescriptor");
+  single_var_descriptor->options().set(common::Tags::dimension(), neq);
+  single_var_descriptor->push_back("LSSvars", VariablesDescriptor::Dimensionalities::VECTOR);
+  create_blocked(cp, *single_var_descriptor, node_connectivity, starting_indices, solution, rhs);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, Vector& solution, Vector& rhs)
+{
+  if(m_is_created)
+    destroy();
+
+  m_neq = vars.size();
+  m_updatable = cp.isUpdatable();
+  m_rhs = rhs.handle<LSS::Vector>();
+  m_rhs_backup.resize(boost::extents[m_updatable.size()][m_neq]);
+  m_symmetric_rows.assign(m_updatable.size()*m_neq, false);
+  m_is_created = true;
+
+  CFdebug << "Rank " << common::PE::Comm::instance().rank() << ": Created a matrix-free operator with " << m_updatable.size() << " block rows of " << m_neq << " equations" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::destroy()
+{
+  m_is_created = false;
+  m_neq = 0;
+  m_updatable.clear();
+  m_rhs.reset();
+  m_rhs_backup.resize(boost::extents[0][0]);
+  m_dirichlet_rows.clear();
+  m_symmetric_rows.clear();
+  m_pending_rhs_values.clear();
+  m_extra_diagonal.clear();
+  m_x_work.clear();
+  m_y_work.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::set_value(const Uint icol, const Uint irow, const Real value)
+{
+  not_supported("set_value");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::add_value(const Uint icol, const Uint irow, const Real value)
+{
+  if(m_mode == APPLY)
+    (*m_result)[irow] += value * (*m_x)[icol];
+  else if(m_mode == DIAGONAL && icol == irow)
+    (*m_result)[irow] += value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::get_value(const Uint icol, const Uint irow, Real& value)
+{
+  not_supported("get_value");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::set_values(const BlockAccumulator& values)
+{
+  not_supported("set_values");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::add_values(const BlockAccumulator& values)
+{
+  if(m_mode == ASSEMBLE)
+    return;
+
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  cf3_assert(values.mat.rows() == nb_nodes*m_neq);
+  std::vector<Real>& result = *m_result;
+
+  if(m_mode == DIAGONAL)
+  {
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      const Uint row_start = values.indices[i]*m_neq;
+      for(Uint j = 0; j != m_neq; ++j)
+        result[row_start+j] += values.mat(i*m_neq+j, i*m_neq+j);
+    }
+    return;
+  }
+
+  const std::vector<Real>& x = *m_x;
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint row_start = values.indices[i]*m_neq;
+    for(Uint j = 0; j != m_neq; ++j)
+    {
+      Real row_sum = 0.;
+      for(Uint k = 0; k != nb_nodes; ++k)
+      {
+        const Uint col_start = values.indices[k]*m_neq;
+        for(Uint l = 0; l != m_neq; ++l)
+          row_sum += values.mat(i*m_neq+j, k*m_neq+l) * x[col_start+l];
+      }
+      result[row_start+j] += row_sum;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::get_values(BlockAccumulator& values)
+{
+  not_supported("get_values");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval)
+{
+  cf3_assert(m_is_created);
+  if(offdiagval != 0.)
+    not_supported("set_row with non-zero off-diagonal values");
+
+  const Uint row = iblockrow*m_neq+ieq;
+  m_dirichlet_rows[row] = diagval;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values)
+{
+  not_supported("get_column_and_replace_to_zero");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs)
+{
+  cf3_assert(m_is_created);
+  const Uint row = blockrow*m_neq+ieq;
+
+  // As for the assembled matrices, the column is only moved to the RHS the first time
+  if(!m_symmetric_rows[row])
+  {
+    m_symmetric_rows[row] = true;
+    m_pending_rhs_values[row] = value;
+  }
+
+  m_dirichlet_rows[row] = 1.;
+  rhs.set_value(blockrow, ieq, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::tie_blockrow_pairs(const Uint iblockrow_to, const Uint iblockrow_from)
+{
+  not_supported("tie_blockrow_pairs");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::set_diagonal(const std::vector<Real>& diag)
+{
+  not_supported("set_diagonal");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::add_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(diag.size() == m_updatable.size()*m_neq);
+  if(m_extra_diagonal.empty())
+  {
+    m_extra_diagonal = diag;
+    return;
+  }
+
+  const Uint nb_rows = diag.size();
+  for(Uint i = 0; i != nb_rows; ++i)
+    m_extra_diagonal[i] += diag[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::get_diagonal(std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  run_operator(DIAGONAL, diag);
+
+  const Uint nb_rows = diag.size();
+  if(!m_extra_diagonal.empty())
+  {
+    for(Uint i = 0; i != nb_rows; ++i)
+      diag[i] += m_extra_diagonal[i];
+  }
+
+  for(DirichletRowsT::const_iterator it = m_dirichlet_rows.begin(); it != m_dirichlet_rows.end(); ++it)
+    diag[it->first] = it->second;
+
+  for(Uint i = 0; i != nb_rows; ++i)
+  {
+    if(!is_updatable(i / m_neq))
+      diag[i] = 0.;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  if(reset_to != 0.)
+    not_supported("reset to a non-zero value");
+
+  m_dirichlet_rows.clear();
+  m_symmetric_rows.assign(m_symmetric_rows.size(), false);
+  m_pending_rhs_values.clear();
+  m_extra_diagonal.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::prepare_solve(Vector& solution, Vector& rhs)
+{
+  if(m_pending_rhs_values.empty())
+    return;
+
+  // Subtract the eliminated columns times the prescribed values from the rows without a condition
+  std::vector<Real> bc_values(m_updatable.size()*m_neq, 0.);
+  for(DirichletRowsT::const_iterator it = m_pending_rhs_values.begin(); it != m_pending_rhs_values.end(); ++it)
+    bc_values[it->first] = it->second;
+
+  apply_operator(bc_values, m_y_work);
+
+  const Uint nb_rows = m_y_work.size();
+  for(Uint i = 0; i != nb_rows; ++i)
+  {
+    if(m_y_work[i] != 0. && is_updatable(i / m_neq) && m_dirichlet_rows.find(i) == m_dirichlet_rows.end())
+      rhs.add_value(i / m_neq, i % m_neq, -m_y_work[i]);
+  }
+
+  m_pending_rhs_values.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::apply(const std::vector<Real>& x, std::vector<Real>& y)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(x.size() == m_updatable.size()*m_neq);
+
+  // Columns of symmetric Dirichlet rows were moved to the RHS
+  m_x_work = x;
+  for(DirichletRowsT::const_iterator it = m_dirichlet_rows.begin(); it != m_dirichlet_rows.end(); ++it)
+  {
+    if(m_symmetric_rows[it->first])
+      m_x_work[it->first] = 0.;
+  }
+
+  apply_operator(m_x_work, y);
+
+  if(!m_extra_diagonal.empty())
+  {
+    const Uint nb_rows = y.size();
+    for(Uint i = 0; i != nb_rows; ++i)
+      y[i] += m_extra_diagonal[i] * x[i];
+  }
+
+  for(DirichletRowsT::const_iterator it = m_dirichlet_rows.begin(); it != m_dirichlet_rows.end(); ++it)
+    y[it->first] = it->second * x[it->first];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::apply_operator(const std::vector<Real>& x, std::vector<Real>& y)
+{
+  m_x = &x;
+  run_operator(APPLY, y);
+  m_x = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::run_operator(const Mode mode, std::vector<Real>& result)
+{
+  if(is_null(m_operator_action))
+    throw common::SetupError(FromHere(), "No operator_action set for matrix-free matrix " + uri().path());
+
+  result.assign(m_updatable.size()*m_neq, 0.);
+
+  // The action also assembles the RHS, which must not change
+  m_rhs->get(m_rhs_backup);
+
+  m_result = &result;
+  m_mode = mode;
+  try
+  {
+    m_operator_action->execute();
+  }
+  catch(...)
+  {
+    m_mode = ASSEMBLE;
+    m_result = 0;
+    m_rhs->set(m_rhs_backup);
+    throw;
+  }
+  m_mode = ASSEMBLE;
+  m_result = 0;
+
+  m_rhs->set(m_rhs_backup);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::not_supported(const std::string& operation)
+{
+  throw common::NotSupported(FromHere(), "Operation " + operation + " is not supported by matrix-free matrix " + uri().path());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::print(common::LogStream& stream)
+{
+  std::stringstream output;
+  print(output);
+  stream << output.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::print(std::ostream& stream)
+{
+  stream << "# matrix-free operator with " << m_updatable.size() << " block rows of " << m_neq << " equations, "
+         << m_dirichlet_rows.size() << " Dirichlet rows, applied by ";
+  if(is_null(m_operator_action))
+    stream << "no action";
+  else
+    stream << m_operator_action->uri().path();
+  stream << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::print(const std::string& filename, std::ios_base::openmode mode)
+{
+  std::ofstream stream(filename.c_str(), mode);
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::print_native(std::ostream& stream)
+{
+  print(stream);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void MatrixFreeMatrix::debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values)
+{
+  not_supported("debug_data");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
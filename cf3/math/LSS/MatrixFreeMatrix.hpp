@@ -0,0 +1,240 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_MatrixFreeMatrix_hpp
+#define cf3_Math_LSS_MatrixFreeMatrix_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+#include <vector>
+
+#include <boost/multi_array.hpp>
+
+#include "common/Action.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/Matrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file MatrixFreeMatrix.hpp definition of LSS::MatrixFreeMatrix
+
+  Base class for matrices that are never stored. The matrix-vector product is computed by running
+  the assembly action again, with add_values multiplying each element matrix with the vector instead of storing it.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Matrix that is applied by re-executing the action that assembles it, set using the operator_action option.
+/// Outside of apply and get_diagonal, add_values does nothing, so assembling the system only fills the RHS.
+/// Element matrices must be added through add_values or add_value. set_values and the operations that read or
+/// modify individual entries throw NotSupported. Dirichlet conditions and add_diagonal are recorded and applied
+/// on the fly. The RHS contributions of the element loops that run during apply are discarded.
+/// All vectors used here are in LSS local numbering (blockrow*neq+eq), including ghosts.
+/// Derived classes connect apply to a solver library.
+class LSS_API MatrixFreeMatrix : public LSS::Matrix {
+public:
+
+  /// What add_values does with the element matrices
+  enum Mode
+  {
+    /// Ignore them, the operator is not stored
+    ASSEMBLE,
+    /// Add the product of the element matrix and the input vector to the output vector
+    APPLY,
+    /// Add the diagonal of the element matrix to the output vector
+    DIAGONAL
+  };
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "MatrixFreeMatrix"; }
+
+  /// The RHS is referenced for the duration of the solve, so the vectors can't be swapped
+  const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) { return false; }
+
+  /// Default constructor
+  MatrixFreeMatrix(const std::string& name);
+
+  /// Store the sizes, no matrix memory is allocated
+  void create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs);
+
+  /// Same as create with the total number of equations, the blocking only matters for the distributed storage of derived classes
+  virtual void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs);
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  //@{
+
+  /// Not supported
+  void set_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Handled according to the mode, like add_values
+  void add_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Not supported
+  void get_value(const Uint icol, const Uint irow, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Not supported
+  void set_values(const BlockAccumulator& values);
+
+  /// Handled according to the current mode. Threads may call this concurrently for element blocks that don't share any row.
+  void add_values(const BlockAccumulator& values);
+
+  /// Not supported
+  void get_values(BlockAccumulator& values);
+
+  /// Turn the row into a diagonal row. Only a zero offdiagval is supported.
+  void set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval);
+
+  /// Not supported
+  void get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values);
+
+  /// Record the condition and set the RHS of the row. Moving the column to the RHS needs an operator application,
+  /// so it is done once for all recorded conditions in prepare_solve.
+  void symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, LSS::Vector& rhs);
+
+  /// Not supported
+  void tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from);
+
+  /// Not supported
+  void set_diagonal(const std::vector<Real>& diag);
+
+  /// Add to the diagonal of the rows that don't have a Dirichlet condition
+  void add_diagonal(const std::vector<Real>& diag);
+
+  /// Compute the diagonal by running the operator action once. Ghost rows are zero.
+  void get_diagonal(std::vector<Real>& diag);
+
+  /// Forget the Dirichlet conditions and the values added to the diagonal. Only resetting to zero is supported.
+  void reset(Real reset_to=0.);
+
+  /// Move the pending symmetric Dirichlet columns to the RHS
+  void prepare_solve(LSS::Vector& solution, LSS::Vector& rhs);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name MATRIX-FREE OPERATIONS
+  //@{
+
+  /// Compute y = A x. Both vectors are in LSS local numbering. The ghost entries of x must be up to date, those of y are meaningless.
+  void apply(const std::vector<Real>& x, std::vector<Real>& y);
+
+  /// Current mode of add_values
+  Mode mode() const { return m_mode; }
+
+  //@} END MATRIX-FREE OPERATIONS
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  /// Prints the same summary as print
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; }
+
+  /// Accessor to the number of equations
+  const Uint neq() { return m_neq; }
+
+  /// Accessor to the number of block rows
+  const Uint blockrow_size() { return m_updatable.size(); }
+
+  /// Accessor to the number of block columns
+  const Uint blockcol_size() { return m_updatable.size(); }
+
+  //@} END MISCELLANEOUS
+
+  /// @name TEST ONLY
+  //@{
+
+  /// Not supported
+  void debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+protected:
+  /// True if the block row is owned by this rank
+  bool is_updatable(const Uint iblockrow) const { return m_updatable[iblockrow]; }
+
+private:
+  /// Run the operator action in the given mode, accumulating into result, which is first set to zero
+  void run_operator(const Mode mode, std::vector<Real>& result);
+
+  /// Product of the assembled operator without boundary conditions and x
+  void apply_operator(const std::vector<Real>& x, std::vector<Real>& y);
+
+  /// Unsupported operation
+  void not_supported(const std::string& operation);
+
+  /// Action that assembles the matrix
+  Handle<common::Action> m_operator_action;
+
+  bool m_is_created;
+  Uint m_neq;
+  /// Owned flag for each block row
+  std::vector<bool> m_updatable;
+  /// RHS, to restore the values added while applying the operator
+  Handle<LSS::Vector> m_rhs;
+  boost::multi_array<Real, 2> m_rhs_backup;
+
+  Mode m_mode;
+  /// Vector multiplied with the element matrices in APPLY mode
+  const std::vector<Real>* m_x;
+  /// Accumulated result in APPLY and DIAGONAL mode
+  std::vector<Real>* m_result;
+
+  /// Diagonal value of each row with a Dirichlet condition
+  typedef std::map<Uint, Real> DirichletRowsT;
+  DirichletRowsT m_dirichlet_rows;
+  /// Rows with a symmetric Dirichlet condition, their column is eliminated in apply
+  std::vector<bool> m_symmetric_rows;
+  /// Symmetric Dirichlet values for which the column still needs to be moved to the RHS
+  DirichletRowsT m_pending_rhs_values;
+  /// Values added to the diagonal, empty if there are none
+  std::vector<Real> m_extra_diagonal;
+
+  /// Work vectors
+  std::vector<Real> m_x_work;
+  std::vector<Real> m_y_work;
+
+}; // end of class MatrixFreeMatrix
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_MatrixFreeMatrix_hpp
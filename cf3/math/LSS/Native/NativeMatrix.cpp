@@ -0,0 +1,644 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
+#include "common/Assertions.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/PropertyList.hpp"
+#include "common/StringConversion.hpp"
+#include "common/ThreadPool.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/PE/CommWrapper.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Vector.hpp"
+#include "math/LSS/Native/NativeMatrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+  /// Number of block rows summed together in a partial sum of the dot product.
+  /// Fixing this independently of the number of threads keeps the order of the additions the same.
+  const Uint dot_chunk_size = 256;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::NativeMatrix, LSS::Matrix, LSS::LibLSS > NativeMatrix_Builder;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+NativeMatrix::NativeMatrix(const std::string& name) :
+  LSS::Matrix(name),
+  m_is_created(false),
+  m_neq(0),
+  m_block_size(0),
+  m_nb_owned_rows(0)
+{
+  properties().add("vector_type", std::string("cf3.math.LSS.NativeVector"));
+}
+
+NativeMatrix::~NativeMatrix()
+{
+  if(m_is_created)
+    destroy();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::create(common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs)
+{
+  if(m_is_created)
+    destroy();
+
+  const Uint nb_nodes = cp.isUpdatable().size();
+  cf3_assert(starting_indices.size() == nb_nodes+1);
+
+  m_neq = neq;
+  m_block_size = neq*neq;
+  m_updatable = cp.isUpdatable();
+  m_starting_indices = starting_indices;
+  m_columns = node_connectivity;
+  m_diagonal_positions.resize(nb_nodes);
+
+  m_nb_owned_rows = 0;
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    const Uint row_begin = m_starting_indices[row];
+    const Uint row_end = m_starting_indices[row+1];
+    std::sort(m_columns.begin() + row_begin, m_columns.begin() + row_end);
+    m_diagonal_positions[row] = block_position(row, row);
+
+    if(!m_updatable[row])
+      continue;
+
+    ++m_nb_owned_rows;
+    if(m_diagonal_positions[row] == row_end)
+      throw common::BadValue(FromHere(), "Block row " + common::to_str(row) + " of " + uri().string() + " has no diagonal block");
+
+    bool has_ghost_column = false;
+    for(Uint pos = row_begin; pos != row_end; ++pos)
+    {
+      if(!m_updatable[m_columns[pos]])
+      {
+        has_ghost_column = true;
+        break;
+      }
+    }
+    if(has_ghost_column)
+      m_interface_rows.push_back(row);
+    else
+      m_interior_rows.push_back(row);
+  }
+
+  m_values.assign(m_columns.size()*m_block_size, 0.);
+
+  // The halo buffer is registered under a name that is unique in the commpattern, so several systems can share it
+  m_halo_values.assign(nb_nodes*m_neq, 0.);
+  std::string halo_name = "NativeMatrixHalo";
+  for(Uint i = 1; is_not_null(cp.get_child(halo_name)); ++i)
+    halo_name = "NativeMatrixHalo_" + common::to_str(i);
+  cp.insert(halo_name, m_halo_values, m_neq, true);
+  m_halo_wrapper = Handle<common::PE::CommWrapper>(cp.get_child(halo_name));
+  m_comm_pattern = cp.handle<common::PE::CommPattern>();
+
+  m_is_created = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs)
+{
+  create(cp, vars.size(), node_connectivity, starting_indices, solution, rhs);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::destroy()
+{
+  if(is_not_null(m_comm_pattern) && is_not_null(m_halo_wrapper))
+    m_comm_pattern->clear(m_halo_wrapper->name());
+  m_halo_wrapper = Handle<common::PE::CommWrapper>();
+  m_comm_pattern = Handle<common::PE::CommPattern>();
+
+  m_updatable.clear();
+  m_starting_indices.clear();
+  m_columns.clear();
+  m_diagonal_positions.clear();
+  m_values.clear();
+  m_interior_rows.clear();
+  m_interface_rows.clear();
+  m_halo_values.clear();
+  m_partial_sums.clear();
+
+  m_neq = 0;
+  m_block_size = 0;
+  m_nb_owned_rows = 0;
+  m_is_created = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::set_value(const Uint icol, const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  const Uint blockrow = irow / m_neq;
+  if(m_updatable[blockrow])
+    m_values[value_position(blockrow, icol / m_neq) + (irow % m_neq)*m_neq + icol % m_neq] = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::add_value(const Uint icol, const Uint irow, const Real value)
+{
+  cf3_assert(m_is_created);
+  const Uint blockrow = irow / m_neq;
+  if(m_updatable[blockrow])
+    m_values[value_position(blockrow, icol / m_neq) + (irow % m_neq)*m_neq + icol % m_neq] += value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::get_value(const Uint icol, const Uint irow, Real& value)
+{
+  cf3_assert(m_is_created);
+  value = m_values[value_position(irow / m_neq, icol / m_neq) + (irow % m_neq)*m_neq + icol % m_neq];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::set_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint blockrow = values.indices[i];
+    if(!m_updatable[blockrow])
+      continue;
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      Real* block = &m_values[value_position(blockrow, values.indices[j])];
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          block[a*m_neq+b] = values.mat(i*m_neq+a, j*m_neq+b);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::add_values(const BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint blockrow = values.indices[i];
+    if(!m_updatable[blockrow])
+      continue;
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      Real* block = &m_values[value_position(blockrow, values.indices[j])];
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          block[a*m_neq+b] += values.mat(i*m_neq+a, j*m_neq+b);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::get_values(BlockAccumulator& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = values.indices.size();
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    const Uint blockrow = values.indices[i];
+    for(Uint j = 0; j != nb_nodes; ++j)
+    {
+      const Uint pos = block_position(blockrow, values.indices[j]);
+      const bool found = pos != m_starting_indices[blockrow+1];
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint b = 0; b != m_neq; ++b)
+          values.mat(i*m_neq+a, j*m_neq+b) = found ? m_values[pos*m_block_size + a*m_neq+b] : 0.;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval)
+{
+  cf3_assert(m_is_created);
+  if(!m_updatable[iblockrow])
+    return;
+
+  const Uint row_end = m_starting_indices[iblockrow+1];
+  for(Uint pos = m_starting_indices[iblockrow]; pos != row_end; ++pos)
+  {
+    Real* row_values = &m_values[pos*m_block_size + ieq*m_neq];
+    std::fill(row_values, row_values + m_neq, offdiagval);
+  }
+  m_values[m_diagonal_positions[iblockrow]*m_block_size + ieq*m_neq + ieq] = diagval;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_updatable.size();
+  values.assign(nb_nodes*m_neq, 0.);
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    if(!m_updatable[row])
+      continue;
+    const Uint pos = block_position(row, iblockcol);
+    if(pos == m_starting_indices[row+1])
+      continue;
+    Real* block = &m_values[pos*m_block_size];
+    for(Uint j = 0; j != m_neq; ++j)
+    {
+      values[row*m_neq+j] = block[j*m_neq+ieq];
+      block[j*m_neq+ieq] = 0.;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, Vector& rhs)
+{
+  cf3_assert(m_is_created);
+
+  // Move the column to the RHS, using the structural symmetry to find the rows that have it
+  const Uint row_end = m_starting_indices[blockrow+1];
+  for(Uint pos = m_starting_indices[blockrow]; pos != row_end; ++pos)
+  {
+    const Uint other_row = m_columns[pos];
+    if(!m_updatable[other_row])
+      continue;
+
+    Real* block = &m_values[value_position(other_row, blockrow)];
+    for(Uint j = 0; j != m_neq; ++j)
+    {
+      if(other_row == blockrow && j == ieq)
+        continue;
+      rhs.add_value(other_row, j, -block[j*m_neq+ieq] * value);
+      block[j*m_neq+ieq] = 0.;
+    }
+  }
+
+  set_row(blockrow, ieq, 1., 0.);
+  rhs.set_value(blockrow, ieq, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(m_updatable[iblockrow_to] == m_updatable[iblockrow_from]);
+  if(!m_updatable[iblockrow_to] || !m_updatable[iblockrow_from])
+    return;
+
+  const Uint to_begin = m_starting_indices[iblockrow_to];
+  const Uint from_begin = m_starting_indices[iblockrow_from];
+  const Uint nb_blocks = m_starting_indices[iblockrow_to+1] - to_begin;
+  if(nb_blocks != m_starting_indices[iblockrow_from+1] - from_begin)
+    throw common::BadValue(FromHere(),"Number of blocks do not match for the two block rows to be tied together.");
+
+  for(Uint i = 0; i != nb_blocks; ++i)
+  {
+    cf3_assert(m_columns[to_begin+i] == m_columns[from_begin+i]);
+    Real* to_block = &m_values[(to_begin+i)*m_block_size];
+    Real* from_block = &m_values[(from_begin+i)*m_block_size];
+    for(Uint k = 0; k != m_block_size; ++k)
+    {
+      to_block[k] += from_block[k];
+      from_block[k] = 0.;
+    }
+  }
+
+  // The from row now states that both rows have the same unknowns
+  Real* from_diagonal = &m_values[value_position(iblockrow_from, iblockrow_from)];
+  Real* from_pair = &m_values[value_position(iblockrow_from, iblockrow_to)];
+  for(Uint i = 0; i != m_neq; ++i)
+  {
+    from_diagonal[i*m_neq+i] = 1.;
+    from_pair[i*m_neq+i] = -1.;
+  }
+
+  // ... so in the to row the from unknowns are replaced by the to unknowns
+  Real* to_diagonal = &m_values[value_position(iblockrow_to, iblockrow_to)];
+  Real* to_pair = &m_values[value_position(iblockrow_to, iblockrow_from)];
+  for(Uint k = 0; k != m_block_size; ++k)
+  {
+    to_diagonal[k] += to_pair[k];
+    to_pair[k] = 0.;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::set_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(diag.size() == m_updatable.size()*m_neq);
+  const Uint nb_nodes = m_updatable.size();
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    if(!m_updatable[row])
+      continue;
+    Real* block = &m_values[m_diagonal_positions[row]*m_block_size];
+    for(Uint i = 0; i != m_neq; ++i)
+      block[i*m_neq+i] = diag[row*m_neq+i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::add_diagonal(const std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(diag.size() == m_updatable.size()*m_neq);
+  const Uint nb_nodes = m_updatable.size();
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    if(!m_updatable[row])
+      continue;
+    Real* block = &m_values[m_diagonal_positions[row]*m_block_size];
+    for(Uint i = 0; i != m_neq; ++i)
+      block[i*m_neq+i] += diag[row*m_neq+i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::get_diagonal(std::vector<Real>& diag)
+{
+  cf3_assert(m_is_created);
+  const Uint nb_nodes = m_updatable.size();
+  diag.assign(nb_nodes*m_neq, 0.);
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    if(!m_updatable[row])
+      continue;
+    const Real* block = &m_values[m_diagonal_positions[row]*m_block_size];
+    for(Uint i = 0; i != m_neq; ++i)
+      diag[row*m_neq+i] = block[i*m_neq+i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::reset(Real reset_to)
+{
+  cf3_assert(m_is_created);
+  std::fill(m_values.begin(), m_values.end(), reset_to);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::multiply(const std::vector<Real>& x, std::vector<Real>& y)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(x.size() == m_halo_values.size());
+  y.assign(x.size(), 0.);
+
+  common::ThreadPool& pool = common::ThreadPool::instance();
+  const Uint nb_threads = pool.nb_threads();
+  const bool distributed = is_distributed();
+
+  if(distributed)
+  {
+    std::copy(x.begin(), x.end(), m_halo_values.begin());
+    m_comm_pattern->begin_synchronize(*m_halo_wrapper);
+  }
+
+  // The interior rows only use owned entries, so they are computed while the ghost values are on their way
+  pool.run(boost::bind(&NativeMatrix::multiply_rows, this, _1, nb_threads, boost::cref(m_interior_rows), boost::cref(x), boost::ref(y)));
+
+  if(distributed)
+    m_comm_pattern->end_synchronize();
+
+  pool.run(boost::bind(&NativeMatrix::multiply_rows, this, _1, nb_threads, boost::cref(m_interface_rows), boost::cref(distributed ? m_halo_values : x), boost::ref(y)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::multiply_rows(const Uint thread_idx, const Uint nb_threads, const std::vector<Uint>& rows, const std::vector<Real>& x, std::vector<Real>& y) const
+{
+  Uint begin, end;
+  common::split_range(rows.size(), nb_threads, thread_idx, begin, end);
+  for(Uint i = begin; i != end; ++i)
+  {
+    const Uint row = rows[i];
+    Real* y_row = &y[row*m_neq];
+    const Uint row_end = m_starting_indices[row+1];
+    for(Uint pos = m_starting_indices[row]; pos != row_end; ++pos)
+    {
+      const Real* block = &m_values[pos*m_block_size];
+      const Real* x_col = &x[m_columns[pos]*m_neq];
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        Real sum = 0.;
+        for(Uint b = 0; b != m_neq; ++b)
+          sum += block[a*m_neq+b]*x_col[b];
+        y_row[a] += sum;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Real NativeMatrix::dot(const std::vector<Real>& a, const std::vector<Real>& b)
+{
+  cf3_assert(m_is_created);
+  cf3_assert(a.size() == m_updatable.size()*m_neq);
+  cf3_assert(b.size() == a.size());
+
+  const Uint nb_chunks = (m_updatable.size() + dot_chunk_size - 1) / dot_chunk_size;
+  m_partial_sums.assign(nb_chunks, 0.);
+
+  common::ThreadPool& pool = common::ThreadPool::instance();
+  pool.run(boost::bind(&NativeMatrix::dot_chunks, this, _1, pool.nb_threads(), boost::cref(a), boost::cref(b), boost::ref(m_partial_sums)));
+
+  Real local_sum = 0.;
+  for(Uint i = 0; i != nb_chunks; ++i)
+    local_sum += m_partial_sums[i];
+
+  if(!is_distributed())
+    return local_sum;
+
+  Real global_sum = 0.;
+  common::PE::Comm::instance().all_reduce(common::PE::plus(), &local_sum, 1, &global_sum);
+  return global_sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::dot_chunks(const Uint thread_idx, const Uint nb_threads, const std::vector<Real>& a, const std::vector<Real>& b, std::vector<Real>& partial_sums) const
+{
+  const Uint nb_nodes = m_updatable.size();
+  Uint begin, end;
+  common::split_range(partial_sums.size(), nb_threads, thread_idx, begin, end);
+  for(Uint chunk = begin; chunk != end; ++chunk)
+  {
+    const Uint rows_end = std::min(nb_nodes, (chunk+1)*dot_chunk_size);
+    Real sum = 0.;
+    for(Uint row = chunk*dot_chunk_size; row != rows_end; ++row)
+    {
+      if(!m_updatable[row])
+        continue;
+      for(Uint i = row*m_neq; i != (row+1)*m_neq; ++i)
+        sum += a[i]*b[i];
+    }
+    partial_sums[chunk] = sum;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+bool NativeMatrix::is_distributed() const
+{
+  return common::PE::Comm::instance().is_active() && common::PE::Comm::instance().size() > 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeMatrix::block_position(const Uint blockrow, const Uint blockcol) const
+{
+  const std::vector<Uint>::const_iterator row_begin = m_columns.begin() + m_starting_indices[blockrow];
+  const std::vector<Uint>::const_iterator row_end = m_columns.begin() + m_starting_indices[blockrow+1];
+  const std::vector<Uint>::const_iterator found = std::lower_bound(row_begin, row_end, blockcol);
+  if(found == row_end || *found != blockcol)
+    return m_starting_indices[blockrow+1];
+  return found - m_columns.begin();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Uint NativeMatrix::value_position(const Uint blockrow, const Uint blockcol) const
+{
+  const Uint pos = block_position(blockrow, blockcol);
+  if(pos == m_starting_indices[blockrow+1])
+    throw common::BadValue(FromHere(), "Block (" + common::to_str(blockrow) + ", " + common::to_str(blockcol) + ") is not in the sparsity pattern of " + uri().string());
+  return pos*m_block_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::print(common::LogStream& stream)
+{
+  std::stringstream output;
+  print(output);
+  stream << output.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::print(std::ostream& stream)
+{
+  if (m_is_created)
+  {
+    const Uint nb_nodes = m_updatable.size();
+    for(Uint row = 0; row != nb_nodes; ++row)
+    {
+      if(!m_updatable[row])
+        continue;
+      const Uint row_end = m_starting_indices[row+1];
+      for(Uint a = 0; a != m_neq; ++a)
+        for(Uint pos = m_starting_indices[row]; pos != row_end; ++pos)
+          for(Uint b = 0; b != m_neq; ++b)
+            stream << m_columns[pos]*m_neq+b << " " << -(int)(row*m_neq+a) << " " << m_values[pos*m_block_size + a*m_neq+b] << "\n";
+    }
+    stream << "# name:                 " << name() << "\n";
+    stream << "# type_name:            " << type_name() << "\n";
+    stream << "# process:              " << (common::PE::Comm::instance().is_active() ? common::PE::Comm::instance().rank() : 0) << "\n";
+    stream << "# number of equations:  " << m_neq << "\n";
+    stream << "# number of rows:       " << m_nb_owned_rows*m_neq << "\n";
+    stream << "# number of cols:       " << nb_nodes*m_neq << "\n";
+    stream << "# number of block rows: " << m_nb_owned_rows << "\n";
+    stream << "# number of block cols: " << nb_nodes << "\n";
+    stream << "# number of blocks:     " << m_columns.size() << "\n" << std::flush;
+  } else {
+    stream << name() << " of type " << type_name() << "::is_created() is false, nothing is printed.";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::print(const std::string& filename, std::ios_base::openmode mode )
+{
+  std::ofstream stream(filename.c_str(),mode);
+  stream << "VARIABLES=COL,ROW,VAL\n" << std::flush;
+  stream << "ZONE T=\"" << type_name() << "::" << name() <<  "\"\n" << std::flush;
+  print(stream);
+  stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::print_native(std::ostream& stream)
+{
+  print(stream);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void NativeMatrix::debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values)
+{
+  cf3_assert(m_is_created);
+  row_indices.clear(); col_indices.clear(); values.clear();
+  const Uint nb_nodes = m_updatable.size();
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    if(!m_updatable[row])
+      continue;
+    const Uint row_end = m_starting_indices[row+1];
+    for(Uint a = 0; a != m_neq; ++a)
+    {
+      for(Uint pos = m_starting_indices[row]; pos != row_end; ++pos)
+      {
+        for(Uint b = 0; b != m_neq; ++b)
+        {
+          row_indices.push_back(row*m_neq+a);
+          col_indices.push_back(m_columns[pos]*m_neq+b);
+          values.push_back(m_values[pos*m_block_size + a*m_neq+b]);
+        }
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
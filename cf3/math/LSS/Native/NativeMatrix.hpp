@@ -0,0 +1,236 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeMatrix_hpp
+#define cf3_Math_LSS_NativeMatrix_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/Matrix.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativeMatrix.hpp definition of LSS::NativeMatrix
+
+  Block compressed row storage matrix of the native backend, which doesn't depend on an external solver library.
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+
+namespace common { namespace PE { class CommWrapper; } }
+
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Matrix in block compressed row storage, with one neq x neq block per pair of connected nodes.
+/// The block rows and columns follow the local node numbering of the commpattern, and the columns of each
+/// block row are sorted. Only the owned block rows are assembled: writes to ghost rows are ignored.
+/// The product with a vector exchanges the ghost entries through the commpattern, overlapping the communication
+/// with the product of the block rows that have no ghost columns, and is spread over the threads of the ThreadPool.
+class LSS_API NativeMatrix : public LSS::Matrix {
+public:
+
+  /// @name CREATION, DESTRUCTION AND COMPONENT SYSTEM
+  //@{
+
+  /// name of the type
+  static std::string type_name () { return "NativeMatrix"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Native"; }
+
+  /// The vectors are only accessed through the solution strategy, so they can be swapped
+  const bool is_swappable(const LSS::Vector& solution, const LSS::Vector& rhs) { return true; }
+
+  /// Default constructor
+  NativeMatrix(const std::string& name);
+
+  ~NativeMatrix();
+
+  /// Setup sparsity structure
+  void create(cf3::common::PE::CommPattern& cp, const Uint neq, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, LSS::Vector& solution, LSS::Vector& rhs);
+
+  /// Same as create with the total number of equations, the blocks always hold all variables of a node
+  void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs);
+
+  /// Deallocate underlying data
+  void destroy();
+
+  //@} END CREATION, DESTRUCTION AND COMPONENT SYSTEM
+
+  /// @name INDIVIDUAL ACCESS
+  //@{
+
+  /// Set value at given location in the matrix
+  void set_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Add value at given location in the matrix
+  void add_value(const Uint icol, const Uint irow, const Real value);
+
+  /// Get value at given location in the matrix
+  void get_value(const Uint icol, const Uint irow, Real& value);
+
+  //@} END INDIVIDUAL ACCESS
+
+  /// @name EFFICCIENT ACCESS
+  //@{
+
+  /// Set a list of values
+  void set_values(const BlockAccumulator& values);
+
+  /// Add a list of values. Threads may call this concurrently for element blocks that don't share any row.
+  void add_values(const BlockAccumulator& values);
+
+  /// Get a list of values
+  void get_values(BlockAccumulator& values);
+
+  /// Set a row, diagonal and off-diagonals values separately (dirichlet-type boundaries)
+  void set_row(const Uint iblockrow, const Uint ieq, Real diagval, Real offdiagval);
+
+  /// Get a column and replace it to zero (dirichlet-type boundaries, when trying to preserve symmetry)
+  void get_column_and_replace_to_zero(const Uint iblockcol, Uint ieq, std::vector<Real>& values);
+
+  /// Apply a dirichlet boundary condition, preserving symmetry by moving the column to the RHS
+  void symmetric_dirichlet(const Uint blockrow, const Uint ieq, const Real value, LSS::Vector& rhs);
+
+  /// Tie the from row to the to row (periodic boundaries). Both rows must have the same column pattern.
+  void tie_blockrow_pairs (const Uint iblockrow_to, const Uint iblockrow_from);
+
+  /// Set the diagonal, ghost rows are skipped
+  void set_diagonal(const std::vector<Real>& diag);
+
+  /// Add to the diagonal, ghost rows are skipped
+  void add_diagonal(const std::vector<Real>& diag);
+
+  /// Get the diagonal, the entries of the ghost rows are zero
+  void get_diagonal(std::vector<Real>& diag);
+
+  /// Reset Matrix
+  void reset(Real reset_to=0.);
+
+  //@} END EFFICCIENT ACCESS
+
+  /// @name SOLVER KERNELS
+  //@{
+
+  /// Compute y = A x. Both vectors are in LSS local numbering, the ghost entries of x are not used and those of y are set to zero.
+  /// Communicates when running in parallel, so it must be called on all ranks.
+  void multiply(const std::vector<Real>& x, std::vector<Real>& y);
+
+  /// Dot product over the owned rows of all ranks. The result doesn't depend on the number of threads.
+  Real dot(const std::vector<Real>& a, const std::vector<Real>& b);
+
+  /// First entry of each block row in columns(), with one extra entry holding the number of blocks
+  const std::vector<Uint>& starting_indices() const { return m_starting_indices; }
+
+  /// Block column of each block, sorted within each block row
+  const std::vector<Uint>& columns() const { return m_columns; }
+
+  /// Index of the diagonal block of each block row, or the end of the row if there is none
+  const std::vector<Uint>& diagonal_positions() const { return m_diagonal_positions; }
+
+  /// Values of the blocks, each block stored row by row
+  const std::vector<Real>& values() const { return m_values; }
+
+  /// True if the block row is owned by this rank
+  bool is_updatable(const Uint iblockrow) const { return m_updatable[iblockrow]; }
+
+  //@} END SOLVER KERNELS
+
+  /// @name MISCELLANEOUS
+  //@{
+
+  /// Print to wherever
+  void print(common::LogStream& stream);
+
+  /// Print to wherever
+  void print(std::ostream& stream);
+
+  /// Print to file given by filename
+  void print(const std::string& filename, std::ios_base::openmode mode = std::ios_base::out );
+
+  /// Prints the same as print
+  void print_native(std::ostream& stream);
+
+  /// Accessor to the state of create
+  const bool is_created() { return m_is_created; }
+
+  /// Accessor to the number of equations
+  const Uint neq() { return m_neq; }
+
+  /// Accessor to the number of owned block rows
+  const Uint blockrow_size() { return m_nb_owned_rows; }
+
+  /// Accessor to the number of block columns
+  const Uint blockcol_size() { return m_updatable.size(); }
+
+  //@} END MISCELLANEOUS
+
+  /// @name TEST ONLY
+  //@{
+
+  /// Exports the owned rows into three linear arrays, in LSS local numbering
+  void debug_data(std::vector<Uint>& row_indices, std::vector<Uint>& col_indices, std::vector<Real>& values);
+
+  //@} END TEST ONLY
+
+private:
+  /// Position of block (blockrow, blockcol) in the block list, or the end of the row if it is not in the pattern
+  Uint block_position(const Uint blockrow, const Uint blockcol) const;
+
+  /// Position of the first value of block (blockrow, blockcol), throwing if it is not in the pattern
+  Uint value_position(const Uint blockrow, const Uint blockcol) const;
+
+  /// Multiply the rows in the part of the list handled by the given thread
+  void multiply_rows(const Uint thread_idx, const Uint nb_threads, const std::vector<Uint>& rows, const std::vector<Real>& x, std::vector<Real>& y) const;
+
+  /// Sum the owned entries of a*b, for the chunks of rows handled by the given thread
+  void dot_chunks(const Uint thread_idx, const Uint nb_threads, const std::vector<Real>& a, const std::vector<Real>& b, std::vector<Real>& partial_sums) const;
+
+  /// True if the system is distributed over more than one rank, so ghosts and sums must be communicated
+  bool is_distributed() const;
+
+  bool m_is_created;
+  Uint m_neq;
+  /// Number of values in a block
+  Uint m_block_size;
+  Uint m_nb_owned_rows;
+
+  /// Owned flag for each block row
+  std::vector<bool> m_updatable;
+  std::vector<Uint> m_starting_indices;
+  std::vector<Uint> m_columns;
+  std::vector<Uint> m_diagonal_positions;
+  std::vector<Real> m_values;
+
+  /// Owned rows without and with ghost columns
+  std::vector<Uint> m_interior_rows;
+  std::vector<Uint> m_interface_rows;
+
+  /// Commpattern and the wrapper that exchanges m_halo_values
+  Handle<common::PE::CommPattern> m_comm_pattern;
+  Handle<common::PE::CommWrapper> m_halo_wrapper;
+  /// Copy of the vector being multiplied, with its ghost entries filled in
+  std::vector<Real> m_halo_values;
+  /// Partial sums of the dot product
+  std::vector<Real> m_partial_sums;
+}; // end of class NativeMatrix
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeMatrix_hpp
@@ -0,0 +1,312 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+
+#include "common/Assertions.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "math/MatrixTypes.hpp"
+#include "math/LSS/Native/NativeMatrix.hpp"
+#include "math/LSS/Native/NativePreconditioner.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+typedef Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> BlockT;
+
+/// Store the inverse of the neq x neq block, throwing if it is singular
+void invert_block(const Real* block, const Uint neq, const Uint blockrow, Real* inverse)
+{
+  Eigen::Map<const BlockT> a(block, neq, neq);
+  Eigen::FullPivLU<BlockT> lu(a);
+  if(!lu.isInvertible())
+    throw common::BadValue(FromHere(), "Singular diagonal block in block row " + common::to_str(blockrow));
+  Eigen::Map<BlockT>(inverse, neq, neq) = lu.inverse();
+}
+
+/// Compute y -= B x for a block B
+inline void subtract_product(const Real* block, const Real* x, const Uint neq, Real* y)
+{
+  for(Uint a = 0; a != neq; ++a)
+  {
+    Real sum = 0.;
+    for(Uint b = 0; b != neq; ++b)
+      sum += block[a*neq+b]*x[b];
+    y[a] -= sum;
+  }
+}
+
+/// Copies the vector
+class IdentityPreconditioner : public NativePreconditioner
+{
+public:
+  void setup(NativeMatrix& matrix)
+  {
+    m_updatable.resize(matrix.blockcol_size());
+    for(Uint row = 0; row != m_updatable.size(); ++row)
+      m_updatable[row] = matrix.is_updatable(row);
+    m_neq = matrix.neq();
+  }
+
+  void apply(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    z.assign(r.size(), 0.);
+    for(Uint row = 0; row != m_updatable.size(); ++row)
+    {
+      if(m_updatable[row])
+        std::copy(r.begin() + row*m_neq, r.begin() + (row+1)*m_neq, z.begin() + row*m_neq);
+    }
+  }
+
+private:
+  std::vector<bool> m_updatable;
+  Uint m_neq;
+};
+
+/// Multiplies with the inverse of the diagonal. Zero diagonal entries are treated as one.
+class JacobiPreconditioner : public NativePreconditioner
+{
+public:
+  void setup(NativeMatrix& matrix)
+  {
+    matrix.get_diagonal(m_inverse_diagonal);
+    const Uint nb_rows = m_inverse_diagonal.size();
+    const Uint neq = matrix.neq();
+    for(Uint i = 0; i != nb_rows; ++i)
+    {
+      if(matrix.is_updatable(i / neq))
+        m_inverse_diagonal[i] = m_inverse_diagonal[i] != 0. ? 1. / m_inverse_diagonal[i] : 1.;
+    }
+  }
+
+  void apply(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    cf3_assert(r.size() == m_inverse_diagonal.size());
+    z.resize(r.size());
+    common::ThreadPool& pool = common::ThreadPool::instance();
+    pool.run(boost::bind(&JacobiPreconditioner::apply_range, this, _1, pool.nb_threads(), boost::cref(r), boost::ref(z)));
+  }
+
+private:
+  void apply_range(const Uint thread_idx, const Uint nb_threads, const std::vector<Real>& r, std::vector<Real>& z) const
+  {
+    Uint begin, end;
+    common::split_range(r.size(), nb_threads, thread_idx, begin, end);
+    for(Uint i = begin; i != end; ++i)
+      z[i] = m_inverse_diagonal[i]*r[i];
+  }
+
+  /// Zero for the ghost rows
+  std::vector<Real> m_inverse_diagonal;
+};
+
+/// Multiplies with the inverse of the diagonal blocks
+class BlockJacobiPreconditioner : public NativePreconditioner
+{
+public:
+  void setup(NativeMatrix& matrix)
+  {
+    m_neq = matrix.neq();
+    const Uint block_size = m_neq*m_neq;
+    const Uint nb_nodes = matrix.blockcol_size();
+    const std::vector<Uint>& diagonal_positions = matrix.diagonal_positions();
+    const std::vector<Real>& values = matrix.values();
+    m_inverse_blocks.assign(nb_nodes*block_size, 0.);
+    for(Uint row = 0; row != nb_nodes; ++row)
+    {
+      if(matrix.is_updatable(row))
+        invert_block(&values[diagonal_positions[row]*block_size], m_neq, row, &m_inverse_blocks[row*block_size]);
+    }
+  }
+
+  void apply(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    cf3_assert(r.size()*m_neq == m_inverse_blocks.size());
+    z.resize(r.size());
+    common::ThreadPool& pool = common::ThreadPool::instance();
+    pool.run(boost::bind(&BlockJacobiPreconditioner::apply_range, this, _1, pool.nb_threads(), boost::cref(r), boost::ref(z)));
+  }
+
+private:
+  void apply_range(const Uint thread_idx, const Uint nb_threads, const std::vector<Real>& r, std::vector<Real>& z) const
+  {
+    const Uint block_size = m_neq*m_neq;
+    Uint begin, end;
+    common::split_range(r.size() / m_neq, nb_threads, thread_idx, begin, end);
+    for(Uint row = begin; row != end; ++row)
+    {
+      const Real* block = &m_inverse_blocks[row*block_size];
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        Real sum = 0.;
+        for(Uint b = 0; b != m_neq; ++b)
+          sum += block[a*m_neq+b]*r[row*m_neq+b];
+        z[row*m_neq+a] = sum;
+      }
+    }
+  }
+
+  Uint m_neq;
+  /// Zero for the ghost rows
+  std::vector<Real> m_inverse_blocks;
+};
+
+/// Block ILU(0) on the owned rows, ignoring the ghost columns. The strictly lower blocks hold L (with an implicit
+/// identity diagonal), the diagonal and upper blocks hold U, of which only the inverse of the diagonal is used.
+class ILU0Preconditioner : public NativePreconditioner
+{
+public:
+  ILU0Preconditioner() : m_matrix(0), m_neq(0) {}
+
+  void setup(NativeMatrix& matrix)
+  {
+    m_matrix = &matrix;
+    m_neq = matrix.neq();
+    const Uint block_size = m_neq*m_neq;
+    const Uint nb_nodes = matrix.blockcol_size();
+    const std::vector<Uint>& starting_indices = matrix.starting_indices();
+    const std::vector<Uint>& columns = matrix.columns();
+    const std::vector<Uint>& diagonal_positions = matrix.diagonal_positions();
+
+    m_factors = matrix.values();
+    m_inverse_diagonal.assign(nb_nodes*block_size, 0.);
+    std::vector<Real> lower(block_size);
+
+    for(Uint row = 0; row != nb_nodes; ++row)
+    {
+      if(!matrix.is_updatable(row))
+        continue;
+
+      const Uint row_end = starting_indices[row+1];
+      for(Uint pos = starting_indices[row]; pos != diagonal_positions[row]; ++pos)
+      {
+        const Uint k = columns[pos];
+        if(!matrix.is_updatable(k))
+          continue;
+
+        // L_ik = A_ik D_k^-1
+        Eigen::Map<BlockT> lower_block(&lower[0], m_neq, m_neq);
+        lower_block = Eigen::Map<const BlockT>(&m_factors[pos*block_size], m_neq, m_neq) * Eigen::Map<const BlockT>(&m_inverse_diagonal[k*block_size], m_neq, m_neq);
+        std::copy(lower.begin(), lower.end(), m_factors.begin() + pos*block_size);
+
+        // A_ij -= L_ik U_kj, for the blocks j > k that are in the pattern of both rows
+        Uint row_pos = pos+1;
+        const Uint k_end = starting_indices[k+1];
+        for(Uint k_pos = diagonal_positions[k]+1; k_pos != k_end; ++k_pos)
+        {
+          const Uint j = columns[k_pos];
+          while(row_pos != row_end && columns[row_pos] < j)
+            ++row_pos;
+          if(row_pos == row_end)
+            break;
+          if(columns[row_pos] != j || !matrix.is_updatable(j))
+            continue;
+          Eigen::Map<BlockT>(&m_factors[row_pos*block_size], m_neq, m_neq) -= lower_block * Eigen::Map<const BlockT>(&m_factors[k_pos*block_size], m_neq, m_neq);
+        }
+      }
+
+      invert_block(&m_factors[diagonal_positions[row]*block_size], m_neq, row, &m_inverse_diagonal[row*block_size]);
+    }
+  }
+
+  void apply(const std::vector<Real>& r, std::vector<Real>& z)
+  {
+    cf3_assert(is_not_null(m_matrix));
+    const Uint block_size = m_neq*m_neq;
+    const Uint nb_nodes = m_matrix->blockcol_size();
+    const std::vector<Uint>& starting_indices = m_matrix->starting_indices();
+    const std::vector<Uint>& columns = m_matrix->columns();
+    const std::vector<Uint>& diagonal_positions = m_matrix->diagonal_positions();
+
+    z.assign(r.size(), 0.);
+    m_work.resize(m_neq);
+
+    // Forward substitution with L
+    for(Uint row = 0; row != nb_nodes; ++row)
+    {
+      if(!m_matrix->is_updatable(row))
+        continue;
+      Real* z_row = &z[row*m_neq];
+      std::copy(r.begin() + row*m_neq, r.begin() + (row+1)*m_neq, z_row);
+      for(Uint pos = starting_indices[row]; pos != diagonal_positions[row]; ++pos)
+      {
+        if(m_matrix->is_updatable(columns[pos]))
+          subtract_product(&m_factors[pos*block_size], &z[columns[pos]*m_neq], m_neq, z_row);
+      }
+    }
+
+    // Backward substitution with U
+    for(Uint row = nb_nodes; row-- != 0; )
+    {
+      if(!m_matrix->is_updatable(row))
+        continue;
+      Real* z_row = &z[row*m_neq];
+      const Uint row_end = starting_indices[row+1];
+      for(Uint pos = diagonal_positions[row]+1; pos != row_end; ++pos)
+      {
+        if(m_matrix->is_updatable(columns[pos]))
+          subtract_product(&m_factors[pos*block_size], &z[columns[pos]*m_neq], m_neq, z_row);
+      }
+      std::copy(z_row, z_row + m_neq, m_work.begin());
+      const Real* inverse = &m_inverse_diagonal[row*block_size];
+      for(Uint a = 0; a != m_neq; ++a)
+      {
+        Real sum = 0.;
+        for(Uint b = 0; b != m_neq; ++b)
+          sum += inverse[a*m_neq+b]*m_work[b];
+        z_row[a] = sum;
+      }
+    }
+  }
+
+private:
+  /// Matrix that provides the sparsity pattern
+  NativeMatrix* m_matrix;
+  Uint m_neq;
+  std::vector<Real> m_factors;
+  std::vector<Real> m_inverse_diagonal;
+  std::vector<Real> m_work;
+};
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr<NativePreconditioner> NativePreconditioner::create(const std::string& name)
+{
+  if(name == "None")
+    return boost::shared_ptr<NativePreconditioner>(new detail::IdentityPreconditioner());
+  if(name == "Jacobi")
+    return boost::shared_ptr<NativePreconditioner>(new detail::JacobiPreconditioner());
+  if(name == "BlockJacobi")
+    return boost::shared_ptr<NativePreconditioner>(new detail::BlockJacobiPreconditioner());
+  if(name == "ILU0")
+    return boost::shared_ptr<NativePreconditioner>(new detail::ILU0Preconditioner());
+
+  throw common::ValueNotFound(FromHere(), "Unknown native preconditioner: " + name);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
@@ -0,0 +1,64 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativePreconditioner_hpp
+#define cf3_Math_LSS_NativePreconditioner_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common/CF.hpp"
+
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file NativePreconditioner.hpp Preconditioners used by LSS::NativeStrategy
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+class NativeMatrix;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Approximate inverse of a NativeMatrix. All preconditioners only couple owned rows,
+/// so across ranks they act as a block-Jacobi method, with one block per rank.
+class LSS_API NativePreconditioner
+{
+public:
+  virtual ~NativePreconditioner() {}
+
+  /// Compute the preconditioner from the current values of the matrix
+  virtual void setup(NativeMatrix& matrix) = 0;
+
+  /// Compute z = M^-1 r on the owned rows. Both vectors are in LSS local numbering, the ghost entries of z are set to zero.
+  virtual void apply(const std::vector<Real>& r, std::vector<Real>& z) = 0;
+
+  /// Create the preconditioner with the given name, which is one of None, Jacobi, BlockJacobi or ILU0:
+  ///  - None copies r into z
+  ///  - Jacobi divides by the diagonal
+  ///  - BlockJacobi multiplies with the inverse of the neq x neq diagonal blocks
+  ///  - ILU0 is the block incomplete LU factorization with the sparsity pattern of the matrix. Its triangular solves are sequential.
+  static boost::shared_ptr<NativePreconditioner> create(const std::string& name);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativePreconditioner_hpp
@@ -0,0 +1,392 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/any.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/Profiler.hpp"
+
+#include "math/MatrixTypes.hpp"
+#include "math/LSS/Native/NativeMatrix.hpp"
+#include "math/LSS/Native/NativePreconditioner.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+common::ComponentBuilder<NativeStrategy, SolutionStrategy, LibLSS> NativeStrategy_builder;
+
+namespace
+{
+  /// y += alpha*x
+  void axpy(const Real alpha, const std::vector<Real>& x, std::vector<Real>& y)
+  {
+    const Uint size = x.size();
+    for(Uint i = 0; i != size; ++i)
+      y[i] += alpha*x[i];
+  }
+
+  /// y = x + beta*y
+  void xpby(const std::vector<Real>& x, const Real beta, std::vector<Real>& y)
+  {
+    const Uint size = x.size();
+    for(Uint i = 0; i != size; ++i)
+      y[i] = x[i] + beta*y[i];
+  }
+}
+
+NativeStrategy::NativeStrategy(const std::string& name) :
+  SolutionStrategy(name),
+  m_iterations(0),
+  m_relative_residual(0.)
+{
+  std::vector<boost::any> solvers;
+  solvers.push_back(std::string("CG"));
+  solvers.push_back(std::string("BiCGStab"));
+  solvers.push_back(std::string("GMRES"));
+  options().add("solver", std::string("GMRES"))
+    .pretty_name("Solver")
+    .description("Krylov method: CG for symmetric positive definite systems, BiCGStab or restarted GMRES otherwise")
+    .mark_basic()
+    .restricted_list() = solvers;
+
+  std::vector<boost::any> preconditioners;
+  preconditioners.push_back(std::string("None"));
+  preconditioners.push_back(std::string("Jacobi"));
+  preconditioners.push_back(std::string("BlockJacobi"));
+  preconditioners.push_back(std::string("ILU0"));
+  options().add("preconditioner", std::string("ILU0"))
+    .pretty_name("Preconditioner")
+    .description("Jacobi uses the diagonal, BlockJacobi the diagonal blocks of all variables of a node, ILU0 the incomplete factorization of the owned rows")
+    .mark_basic()
+    .restricted_list() = preconditioners;
+
+  options().add("max_iterations", 1000u)
+    .pretty_name("Maximum Iterations")
+    .description("Maximum number of iterations for each solve")
+    .mark_basic();
+
+  options().add("tolerance", 1e-8)
+    .pretty_name("Tolerance")
+    .description("Convergence criterion for the norm of the residual, relative to the norm of the RHS")
+    .mark_basic();
+
+  options().add("gmres_restart", 30u)
+    .pretty_name("GMRES Restart")
+    .description("Number of GMRES iterations before restarting");
+}
+
+NativeStrategy::~NativeStrategy()
+{
+}
+
+void NativeStrategy::set_matrix(const Handle< Matrix >& matrix)
+{
+  m_matrix = Handle<NativeMatrix>(matrix);
+}
+
+void NativeStrategy::set_rhs(const Handle< Vector >& rhs)
+{
+  m_rhs = Handle<NativeVector>(rhs);
+}
+
+void NativeStrategy::set_solution(const Handle< Vector >& solution)
+{
+  m_solution = Handle<NativeVector>(solution);
+}
+
+void NativeStrategy::solve()
+{
+  check_setup();
+
+  const std::string solver = options().value<std::string>("solver");
+  const std::string preconditioner = options().value<std::string>("preconditioner");
+  if(!m_preconditioner || preconditioner != m_preconditioner_name)
+  {
+    m_preconditioner = NativePreconditioner::create(preconditioner);
+    m_preconditioner_name = preconditioner;
+  }
+
+  common::ScopedTimer preconditioner_timer("LSS::initialize_preconditioner");
+  m_preconditioner->setup(*m_matrix);
+  preconditioner_timer.stop();
+
+  m_iterations = 0;
+  m_relative_residual = 0.;
+  const Real tolerance = options().value<Real>("tolerance");
+  const Uint max_iterations = options().value<Uint>("max_iterations");
+  const Real rhs_norm = norm(m_rhs->data());
+  if(rhs_norm == 0.)
+  {
+    m_solution->reset(0.);
+    CFinfo << "NativeStrategy: zero RHS, the solution is zero" << CFendl;
+    return;
+  }
+
+  common::ScopedTimer iteration_timer("LSS::iterate");
+  bool converged = false;
+  if(solver == "CG")
+    converged = solve_cg(tolerance*rhs_norm, max_iterations);
+  else if(solver == "BiCGStab")
+    converged = solve_bicgstab(tolerance*rhs_norm, max_iterations);
+  else
+    converged = solve_gmres(tolerance*rhs_norm, max_iterations);
+  iteration_timer.stop();
+
+  m_relative_residual = compute_residual() / rhs_norm;
+  if(converged)
+    CFinfo << "NativeStrategy: " << solver << " with " << preconditioner << " preconditioner converged in " << m_iterations << " iterations, relative residual " << m_relative_residual << CFendl;
+  else
+    CFwarn << "NativeStrategy: " << solver << " with " << preconditioner << " preconditioner did not converge in " << m_iterations << " iterations, relative residual " << m_relative_residual << CFendl;
+}
+
+Real NativeStrategy::compute_residual()
+{
+  check_setup();
+  std::vector<Real> r;
+  return residual(r);
+}
+
+bool NativeStrategy::solve_cg(const Real target_residual, const Uint max_iterations)
+{
+  m_work.resize(4);
+  std::vector<Real>& x = m_solution->data();
+  std::vector<Real>& r = m_work[0];
+  std::vector<Real>& z = m_work[1];
+  std::vector<Real>& p = m_work[2];
+  std::vector<Real>& q = m_work[3];
+
+  if(residual(r) <= target_residual)
+    return true;
+
+  m_preconditioner->apply(r, z);
+  p = z;
+  Real rz = m_matrix->dot(r, z);
+  while(m_iterations != max_iterations)
+  {
+    m_matrix->multiply(p, q);
+    const Real pq = m_matrix->dot(p, q);
+    if(pq == 0.)
+      return false;
+    const Real alpha = rz / pq;
+    axpy(alpha, p, x);
+    axpy(-alpha, q, r);
+    ++m_iterations;
+
+    if(norm(r) <= target_residual)
+      return true;
+
+    m_preconditioner->apply(r, z);
+    const Real rz_new = m_matrix->dot(r, z);
+    xpby(z, rz_new / rz, p);
+    rz = rz_new;
+  }
+
+  return false;
+}
+
+bool NativeStrategy::solve_bicgstab(const Real target_residual, const Uint max_iterations)
+{
+  m_work.resize(8);
+  std::vector<Real>& x = m_solution->data();
+  std::vector<Real>& r = m_work[0];
+  std::vector<Real>& r0 = m_work[1];
+  std::vector<Real>& p = m_work[2];
+  std::vector<Real>& v = m_work[3];
+  std::vector<Real>& p_hat = m_work[4];
+  std::vector<Real>& s = m_work[5];
+  std::vector<Real>& s_hat = m_work[6];
+  std::vector<Real>& t = m_work[7];
+
+  if(residual(r) <= target_residual)
+    return true;
+
+  const Uint size = r.size();
+  r0 = r;
+  p.assign(size, 0.);
+  v.assign(size, 0.);
+  s.resize(size);
+  Real rho = 1.;
+  Real alpha = 1.;
+  Real omega = 1.;
+  while(m_iterations != max_iterations)
+  {
+    const Real rho_new = m_matrix->dot(r0, r);
+    if(rho_new == 0.)
+      return false;
+
+    const Real beta = (rho_new / rho) * (alpha / omega);
+    for(Uint i = 0; i != size; ++i)
+      p[i] = r[i] + beta*(p[i] - omega*v[i]);
+
+    m_preconditioner->apply(p, p_hat);
+    m_matrix->multiply(p_hat, v);
+    const Real r0v = m_matrix->dot(r0, v);
+    if(r0v == 0.)
+      return false;
+    alpha = rho_new / r0v;
+    for(Uint i = 0; i != size; ++i)
+      s[i] = r[i] - alpha*v[i];
+    ++m_iterations;
+
+    if(norm(s) <= target_residual)
+    {
+      axpy(alpha, p_hat, x);
+      return true;
+    }
+
+    m_preconditioner->apply(s, s_hat);
+    m_matrix->multiply(s_hat, t);
+    const Real tt = m_matrix->dot(t, t);
+    omega = tt == 0. ? 0. : m_matrix->dot(t, s) / tt;
+    for(Uint i = 0; i != size; ++i)
+    {
+      x[i] += alpha*p_hat[i] + omega*s_hat[i];
+      r[i] = s[i] - omega*t[i];
+    }
+
+    if(norm(r) <= target_residual)
+      return true;
+    if(omega == 0.)
+      return false;
+
+    rho = rho_new;
+  }
+
+  return false;
+}
+
+bool NativeStrategy::solve_gmres(const Real target_residual, const Uint max_iterations)
+{
+  const Uint restart = std::max(options().value<Uint>("gmres_restart"), 1u);
+  m_work.resize(restart+3);
+  std::vector<Real>& x = m_solution->data();
+  std::vector<Real>& w = m_work[restart+1];
+  std::vector<Real>& z = m_work[restart+2];
+
+  // Hessenberg matrix, reduced to upper triangular form by Givens rotations as the iterations proceed
+  RealMatrix hessenberg(restart+1, restart);
+  RealVector g(restart+1);
+  RealVector cosines(restart);
+  RealVector sines(restart);
+  RealVector y(restart);
+
+  Real beta = residual(m_work[0]);
+  while(beta > target_residual && m_iterations != max_iterations)
+  {
+    const Uint size = m_work[0].size();
+    for(Uint i = 0; i != size; ++i)
+      m_work[0][i] /= beta;
+    g.setZero();
+    g[0] = beta;
+
+    Uint k = 0;
+    Real residual_estimate = beta;
+    bool breakdown = false;
+    while(k != restart && m_iterations != max_iterations && residual_estimate > target_residual && !breakdown)
+    {
+      // Arnoldi step with modified Gram-Schmidt
+      m_preconditioner->apply(m_work[k], z);
+      m_matrix->multiply(z, w);
+      for(Uint i = 0; i <= k; ++i)
+      {
+        hessenberg(i, k) = m_matrix->dot(w, m_work[i]);
+        axpy(-hessenberg(i, k), m_work[i], w);
+      }
+      hessenberg(k+1, k) = norm(w);
+      breakdown = hessenberg(k+1, k) == 0.;
+      if(!breakdown)
+      {
+        std::vector<Real>& v_next = m_work[k+1];
+        v_next.resize(size);
+        const Real inverse_norm = 1. / hessenberg(k+1, k);
+        for(Uint i = 0; i != size; ++i)
+          v_next[i] = w[i]*inverse_norm;
+      }
+
+      // Apply the previous rotations to the new column and eliminate its subdiagonal entry
+      for(Uint i = 0; i != k; ++i)
+      {
+        const Real h_i = hessenberg(i, k);
+        hessenberg(i, k) = cosines[i]*h_i + sines[i]*hessenberg(i+1, k);
+        hessenberg(i+1, k) = -sines[i]*h_i + cosines[i]*hessenberg(i+1, k);
+      }
+      const Real denominator = std::sqrt(hessenberg(k, k)*hessenberg(k, k) + hessenberg(k+1, k)*hessenberg(k+1, k));
+      cosines[k] = denominator == 0. ? 1. : hessenberg(k, k) / denominator;
+      sines[k] = denominator == 0. ? 0. : hessenberg(k+1, k) / denominator;
+      hessenberg(k, k) = denominator;
+      hessenberg(k+1, k) = 0.;
+      g[k+1] = -sines[k]*g[k];
+      g[k] *= cosines[k];
+
+      residual_estimate = std::abs(g[k+1]);
+      ++k;
+      ++m_iterations;
+    }
+
+    // Solve the triangular system and add the preconditioned combination of the basis vectors to the solution
+    for(Uint i = k; i-- != 0; )
+    {
+      Real sum = g[i];
+      for(Uint j = i+1; j != k; ++j)
+        sum -= hessenberg(i, j)*y[j];
+      y[i] = hessenberg(i, i) == 0. ? 0. : sum / hessenberg(i, i);
+    }
+    w.assign(size, 0.);
+    for(Uint i = 0; i != k; ++i)
+      axpy(y[i], m_work[i], w);
+    m_preconditioner->apply(w, z);
+    axpy(1., z, x);
+
+    beta = residual(m_work[0]);
+  }
+
+  return beta <= target_residual;
+}
+
+void NativeStrategy::check_setup()
+{
+  if(is_null(m_matrix))
+    throw common::SetupError(FromHere(), "Null matrix for " + uri().path() + ", it must be a NativeMatrix");
+
+  if(is_null(m_rhs))
+    throw common::SetupError(FromHere(), "Null RHS for " + uri().path() + ", it must be a NativeVector");
+
+  if(is_null(m_solution))
+    throw common::SetupError(FromHere(), "Null solution vector for " + uri().path() + ", it must be a NativeVector");
+}
+
+Real NativeStrategy::residual(std::vector<Real>& r)
+{
+  m_matrix->multiply(m_solution->data(), r);
+  const std::vector<Real>& b = m_rhs->data();
+  const Uint neq = m_matrix->neq();
+  const Uint nb_nodes = m_matrix->blockcol_size();
+  for(Uint row = 0; row != nb_nodes; ++row)
+  {
+    const bool updatable = m_matrix->is_updatable(row);
+    for(Uint i = row*neq; i != (row+1)*neq; ++i)
+      r[i] = updatable ? b[i] - r[i] : 0.;
+  }
+  return norm(r);
+}
+
+Real NativeStrategy::norm(const std::vector<Real>& v)
+{
+  return std::sqrt(m_matrix->dot(v, v));
+}
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
@@ -0,0 +1,101 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_NativeStrategy_hpp
+#define cf3_Math_LSS_NativeStrategy_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "math/LSS/SolutionStrategy.hpp"
+#include "math/LSS/LibLSS.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ *  @file NativeStrategy.hpp Krylov solvers for the native backend
+ **/
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+class NativeMatrix;
+class NativePreconditioner;
+class NativeVector;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Solves a system made of a NativeMatrix and NativeVectors, using CG, BiCGStab or restarted GMRES.
+/// BiCGStab and GMRES are right-preconditioned, so the convergence test uses the true residual norm,
+/// relative to the norm of the RHS. The current solution is used as initial guess.
+/// The preconditioner is recomputed for each solve, see NativePreconditioner for the choices.
+class LSS_API NativeStrategy : public SolutionStrategy
+{
+public:
+
+  /// Default constructor
+  NativeStrategy(const std::string& name);
+
+  ~NativeStrategy();
+
+  /// name of the type
+  static std::string type_name () { return "NativeStrategy"; }
+
+  void set_matrix(const Handle<LSS::Matrix>& matrix);
+  void set_rhs(const Handle<LSS::Vector>& rhs);
+  void set_solution(const Handle<LSS::Vector>& solution);
+  void solve();
+
+  /// Norm of b - A x
+  Real compute_residual();
+
+  /// Number of iterations of the last solve
+  Uint iterations() const { return m_iterations; }
+
+  /// Residual norm relative to the norm of the RHS at the end of the last solve
+  Real relative_residual() const { return m_relative_residual; }
+
+private:
+  bool solve_cg(const Real target_residual, const Uint max_iterations);
+  bool solve_bicgstab(const Real target_residual, const Uint max_iterations);
+  bool solve_gmres(const Real target_residual, const Uint max_iterations);
+
+  /// Throw if the matrix or the vectors are missing
+  void check_setup();
+
+  /// Compute r = b - A x and return its norm
+  Real residual(std::vector<Real>& r);
+
+  /// Norm over the owned rows of all ranks
+  Real norm(const std::vector<Real>& v);
+
+  Handle<NativeMatrix> m_matrix;
+  Handle<NativeVector> m_rhs;
+  Handle<NativeVector> m_solution;
+
+  boost::shared_ptr<NativePreconditioner> m_preconditioner;
+  /// Preconditioner type of m_preconditioner
+  std::string m_preconditioner_name;
+
+  Uint m_iterations;
+  Real m_relative_residual;
+
+  /// Work vectors
+  std::vector< std::vector<Real> > m_work;
+}; // end of class NativeStrategy
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_NativeStrategy_hpp
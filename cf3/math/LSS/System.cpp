@@ -14,6 +14,7 @@
 #include "common/Builder.hpp"
 #include "common/Component.hpp"
 #include "common/OptionT.hpp"
+#include "common/Profiler.hpp"
 #include "common/PE/CommPattern.hpp"
 #include "common/Signal.hpp"
 
@@ -50,7 +51,7 @@ common::ComponentBuilder < LSS::System, LSS::System, LSS::LibLSS > System_Builde
 LSS::System::System(const std::string& name) :
   Component(name)
 {
-  options().add( "matrix_builder" , "cf3.math.LSS.TrilinosFEVbrMatrix")
+  options().add( "matrix_builder" , default_matrix_builder())
     .pretty_name("Matrix Builder")
     .description("Name for the builder used to create the LSS matrix")
     .mark_basic();
@@ -60,7 +61,7 @@ LSS::System::System(const std::string& name) :
     .description("Name for the builder used for the vectors. If left empty, this is obtained from the vector_type property of the matrix")
     .mark_basic();
 
-  options().add("solution_strategy", "cf3.math.LSS.TrilinosStratimikosStrategy")
+  options().add("solution_strategy", default_solution_strategy())
     .pretty_name("Solution Strategy")
     .description("Name of the builder that will be used to create the solution strategy")
     .mark_basic();
@@ -74,8 +75,29 @@ LSS::System::System(const std::string& name) :
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+std::string LSS::System::default_matrix_builder()
+{
+#ifdef CF3_HAVE_TRILINOS
+  return "cf3.math.LSS.TrilinosFEVbrMatrix";
+#else
+  return "cf3.math.LSS.NativeMatrix";
+#endif
+}
+
+std::string LSS::System::default_solution_strategy()
+{
+#ifdef CF3_HAVE_TRILINOS
+  return "cf3.math.LSS.TrilinosStratimikosStrategy";
+#else
+  return "cf3.math.LSS.NativeStrategy";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 void LSS::System::create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector<Uint>& node_connectivity, std::vector<Uint>& starting_indices)
 {
+  common::ScopedTimer timer("LSS::create");
   if (is_created())
     destroy();
 
@@ -108,6 +130,7 @@ void LSS::System::create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector
 
 void LSS::System::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, std::vector< Uint >& node_connectivity, std::vector< Uint >& starting_indices)
 {
+  common::ScopedTimer timer("LSS::create");
   if (is_created())
     destroy();
 
@@ -197,6 +220,8 @@ void LSS::System::destroy()
 void LSS::System::solve()
 {
   cf3_assert(is_created());
+  common::ScopedTimer timer("LSS::solve");
+  m_mat->prepare_solve(*m_sol, *m_rhs);
   m_solution_strategy->solve();
 }
 
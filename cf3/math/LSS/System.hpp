@@ -68,6 +68,12 @@ public:
   /// Default constructor
   System(const std::string& name);
 
+  /// Default matrix builder: TrilinosFEVbrMatrix if Trilinos is available, NativeMatrix otherwise
+  static std::string default_matrix_builder();
+
+  /// Default solution strategy: TrilinosStratimikosStrategy if Trilinos is available, NativeStrategy otherwise
+  static std::string default_solution_strategy();
+
   /// Setup sparsity structure
   /// @todo action for it
   void create(cf3::common::PE::CommPattern& cp, Uint neq, std::vector<Uint>& node_connectivity, std::vector<Uint>& starting_indices);
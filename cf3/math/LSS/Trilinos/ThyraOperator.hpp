@@ -25,6 +25,10 @@ public:
   
   /// Writable access to the matrix
   virtual Teuchos::RCP<Thyra::LinearOpBase<Real> > thyra_operator() = 0;
+
+  /// Operator approximating the inverse of the matrix, used instead of the preconditioner from the solver parameters.
+  /// The default is null, so the configured preconditioner is built from the matrix.
+  virtual Teuchos::RCP<const Thyra::LinearOpBase<Real> > thyra_preconditioner() { return Teuchos::null; }
 };
 
 } // namespace LSS
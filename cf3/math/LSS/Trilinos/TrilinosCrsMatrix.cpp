@@ -58,36 +58,6 @@ using namespace cf3::math::LSS;
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
-void create_nb_indices_per_row(cf3::common::PE::CommPattern& cp,
-                     const VariablesDescriptor& variables,
-                     const std::vector<Uint>& starting_indices,
-                     std::vector<int>& num_indices_per_row
-                    )
-{
-  const Uint nb_vars = variables.nb_vars();
-  const Uint total_nb_eq = variables.size();
-
-  const Uint nb_nodes_for_rank = cp.isUpdatable().size();
-  cf3_assert(nb_nodes_for_rank+1 == starting_indices.size());
-  num_indices_per_row.reserve(nb_nodes_for_rank*total_nb_eq);
-
-  for(Uint var_idx = 0; var_idx != nb_vars; ++var_idx)
-  {
-    const Uint neq = variables.var_length(var_idx);
-    const Uint var_offset = variables.offset(var_idx);
-    for (int i=0; i<nb_nodes_for_rank; i++)
-    {
-      if (cp.isUpdatable()[i])
-      {
-        for(int j = 0; j != neq; ++j)
-        {
-          num_indices_per_row.push_back(total_nb_eq*(starting_indices[i+1]-starting_indices[i]));
-        }
-      }
-    }
-  }
-}
-
 common::ComponentBuilder < LSS::TrilinosCrsMatrix, LSS::Matrix, LSS::LibLSS > TrilinosCrsMatrix_Builder;
 
 TrilinosCrsMatrix::TrilinosCrsMatrix(const std::string& name) :
@@ -97,7 +67,6 @@ TrilinosCrsMatrix::TrilinosCrsMatrix(const std::string& name) :
   m_neq(0),
   m_num_my_elements(0),
   m_p2m(0),
-  m_converted_indices(0),
   m_comm(common::PE::Comm::instance().communicator())
 {
   properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
@@ -128,60 +97,13 @@ void TrilinosCrsMatrix::create_blocked(common::PE::CommPattern& cp, const Variab
 
   const Uint total_nb_eq = vars.size();
 
-  // prepare intermediate data
-  std::vector<int> num_indices_per_row;
-  std::vector<int> my_global_elements;
-
-  create_map_data(cp, vars, m_p2m, my_global_elements, m_num_my_elements);
-  create_nb_indices_per_row(cp, vars, starting_indices, num_indices_per_row);
-
-  // rowmap, ghosts not present
-  Epetra_Map rowmap(-1,m_num_my_elements,&my_global_elements[0],0,m_comm);
-
-  // colmap, has ghosts at the end
-  const Uint nb_nodes_for_rank = cp.isUpdatable().size();
-  Epetra_Map colmap(-1,nb_nodes_for_rank*total_nb_eq,&my_global_elements[0],0,m_comm);
-  my_global_elements.clear();
-
-  // Create the graph, using static profile for performance
-  Epetra_CrsGraph graph(Copy, rowmap, colmap, &num_indices_per_row[0], true);
-
-  // Fill the graph
-  int max_nb_row_entries=0;
-  for(int i = 0; i != nb_nodes_for_rank; ++i)
-  {
-    const int nb_row_nodes = starting_indices[i+1] - starting_indices[i];
-    max_nb_row_entries = nb_row_nodes > max_nb_row_entries ? nb_row_nodes : max_nb_row_entries;
-  }
-  m_converted_indices.resize(max_nb_row_entries*total_nb_eq);
-  for(int i = 0; i != nb_nodes_for_rank; ++i)
-  {
-    if(cp.isUpdatable()[i])
-    {
-      const Uint columns_begin = starting_indices[i];
-      const Uint columns_end = starting_indices[i+1];
-      for(Uint j = columns_begin; j != columns_end; ++j)
-      {
-        const Uint column = j-columns_begin;
-        const Uint node_idx = node_connectivity[j]*total_nb_eq;
-        for(int k = 0; k != total_nb_eq; ++k)
-        {
-          m_converted_indices[column*total_nb_eq+k] = m_p2m[node_idx+k];
-        }
-      }
-      for(int k = 0; k != total_nb_eq; ++k)
-      {
-        const int row = m_p2m[i*total_nb_eq+k];
-        TRILINOS_THROW(graph.InsertMyIndices(row, static_cast<int>(total_nb_eq*(columns_end - columns_begin)), &m_converted_indices[0]));
-      }
-    }
-  }
-
-  TRILINOS_THROW(graph.FillComplete());
-  TRILINOS_THROW(graph.OptimizeStorage());
+  // Get the graph and maps, shared with any other matrix that has the same structure
+  m_graph_structure = crs_graph(cp, vars, node_connectivity, starting_indices, m_comm);
+  m_p2m = m_graph_structure->p2m;
+  m_num_my_elements = m_graph_structure->num_my_elements;
 
   // create matrix
-  m_mat=Teuchos::rcp(new Epetra_CrsMatrix(Copy, graph));
+  m_mat=Teuchos::rcp(new Epetra_CrsMatrix(Copy, *m_graph_structure->graph));
   TRILINOS_THROW(m_mat->FillComplete());
   TRILINOS_THROW(m_mat->OptimizeStorage());
 
@@ -199,6 +121,7 @@ void TrilinosCrsMatrix::destroy()
   {
     m_mat.reset();
   }
+  m_graph_structure.reset();
   m_p2m.resize(0);
   m_p2m.reserve(0);
   m_neq=0;
@@ -250,20 +173,21 @@ void TrilinosCrsMatrix::set_values(const BlockAccumulator& values)
   const Uint nb_nodes = values.indices.size();
   const int num_entries = nb_nodes*m_neq;
   cf3_assert(values.mat.rows() == num_entries);
+  int* converted_indices = thread_local_indices(num_entries);
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     const Uint local_start_idx = values.indices[i]*m_neq;
     for(int j = 0; j != m_neq; ++j)
-      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+      converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
   }
   // insert the values
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     for(int j = 0; j != m_neq; ++j)
     {
-      if(m_converted_indices[i*m_neq+j] < m_num_my_elements)
-        TRILINOS_THROW(m_mat->ReplaceMyValues(m_converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),&m_converted_indices[0]));
+      if(converted_indices[i*m_neq+j] < m_num_my_elements)
+        TRILINOS_THROW(m_mat->ReplaceMyValues(converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),converted_indices));
     }
   }
 }
@@ -276,20 +200,21 @@ void TrilinosCrsMatrix::add_values(const BlockAccumulator& values)
   const Uint nb_nodes = values.indices.size();
   const int num_entries = nb_nodes*m_neq;
   cf3_assert(values.mat.rows() == num_entries);
+  int* converted_indices = thread_local_indices(num_entries);
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     const Uint local_start_idx = values.indices[i]*m_neq;
     for(int j = 0; j != m_neq; ++j)
-      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+      converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
   }
   // insert the values
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     for(int j = 0; j != m_neq; ++j)
     {
-      if(m_converted_indices[i*m_neq+j] < m_num_my_elements)
-        TRILINOS_THROW(m_mat->SumIntoMyValues(m_converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),&m_converted_indices[0]));
+      if(converted_indices[i*m_neq+j] < m_num_my_elements)
+        TRILINOS_THROW(m_mat->SumIntoMyValues(converted_indices[i*m_neq+j], num_entries, values.mat.data()+(num_entries*(i*m_neq+j)),converted_indices));
     }
   }
 }
@@ -307,13 +232,14 @@ void TrilinosCrsMatrix::get_values(BlockAccumulator& values)
   int* extracted_indices;
   cf3_assert(values.mat.rows() == num_entries);
   std::map<int, int> reverse_idx_map;
+  int* converted_indices = thread_local_indices(num_entries);
   // Convert the index vector
   for(Uint i = 0; i != nb_nodes; ++i)
   {
     const Uint local_start_idx = values.indices[i]*m_neq;
     for(int j = 0; j != m_neq; ++j)
     {
-      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+      converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
       reverse_idx_map[m_p2m[local_start_idx+j]] = i*m_neq + j;
     }
   }
@@ -322,9 +248,9 @@ void TrilinosCrsMatrix::get_values(BlockAccumulator& values)
   {
     for(int j = 0; j != m_neq; ++j)
     {
-      if(m_converted_indices[i*m_neq+j] >= m_num_my_elements)
+      if(converted_indices[i*m_neq+j] >= m_num_my_elements)
         continue;
-      TRILINOS_THROW(m_mat->ExtractMyRowView(m_converted_indices[i*m_neq+j], extracted_num_entries, extracted_values, extracted_indices));
+      TRILINOS_THROW(m_mat->ExtractMyRowView(converted_indices[i*m_neq+j], extracted_num_entries, extracted_values, extracted_indices));
       for(int k = 0; k != extracted_num_entries; ++k)
       {
         const std::map<int,int>::const_iterator it = reverse_idx_map.find(extracted_indices[k]);
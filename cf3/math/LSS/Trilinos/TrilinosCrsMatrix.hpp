@@ -15,6 +15,7 @@
 
 #include "math/LSS/LibLSS.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Trilinos/TrilinosDetail.hpp"
 #include "math/LSS/Vector.hpp"
 #include "math/LSS/Matrix.hpp"
 
@@ -156,6 +157,13 @@ public:
     return m_mat;
   }
 
+  /// Get the graph and maps, shared with the other matrices that have the same structure
+  const CrsGraphStructure& graph_structure() const
+  {
+    cf3_assert(m_is_created);
+    return *m_graph_structure;
+  }
+
   /// Get the index for the given node and equation in matrix local format
   inline int matrix_index(const Uint inode, const Uint ieq)
   {
@@ -196,8 +204,8 @@ private:
   /// mapper array, maps from process local numbering to matrix local numbering (because ghost nodes need to be ordered to the back)
   std::vector<int> m_p2m;
 
-  /// a helper array used in set/add/get_values to avoid frequent new+free combo
-  std::vector<int> m_converted_indices;
+  /// graph and maps, possibly shared with other matrices
+  boost::shared_ptr<const CrsGraphStructure> m_graph_structure;
 
   /// Copy of the connectivity data
   std::vector<int> m_node_connectivity, m_starting_indices;
@@ -6,6 +6,16 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
+#include <boost/functional/hash.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "Epetra_CrsGraph.h"
+#include "Epetra_Map.h"
+#include "Epetra_MpiComm.h"
+
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
 #include "common/Log.hpp"
@@ -14,6 +24,7 @@
 
 
 #include "math/LSS/Trilinos/TrilinosDetail.hpp"
+#include "math/LSS/Trilinos/TrilinosVector.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -118,6 +129,269 @@ void create_map_data(common::PE::CommPattern& cp, const VariablesDescriptor& var
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////
+
+CrsGraphStructure::~CrsGraphStructure()
+{
+}
+
+namespace detail
+{
+
+/// Number of non-zeros in each row of the matrix
+void create_nb_indices_per_row(common::PE::CommPattern& cp,
+                               const VariablesDescriptor& variables,
+                               const std::vector<Uint>& starting_indices,
+                               std::vector<int>& num_indices_per_row)
+{
+  const Uint nb_vars = variables.nb_vars();
+  const Uint total_nb_eq = variables.size();
+
+  const Uint nb_nodes_for_rank = cp.isUpdatable().size();
+  cf3_assert(nb_nodes_for_rank+1 == starting_indices.size());
+  num_indices_per_row.reserve(nb_nodes_for_rank*total_nb_eq);
+
+  for(Uint var_idx = 0; var_idx != nb_vars; ++var_idx)
+  {
+    const Uint neq = variables.var_length(var_idx);
+    for (int i=0; i<nb_nodes_for_rank; i++)
+    {
+      if (cp.isUpdatable()[i])
+      {
+        for(int j = 0; j != neq; ++j)
+        {
+          num_indices_per_row.push_back(total_nb_eq*(starting_indices[i+1]-starting_indices[i]));
+        }
+      }
+    }
+  }
+}
+
+/// Build the graph and the maps
+void build_crs_graph(common::PE::CommPattern& cp,
+                     const VariablesDescriptor& vars,
+                     const std::vector<Uint>& node_connectivity,
+                     const std::vector<Uint>& starting_indices,
+                     const Epetra_MpiComm& comm,
+                     CrsGraphStructure& structure)
+{
+  const Uint total_nb_eq = vars.size();
+  std::vector<int>& p2m = structure.p2m;
+
+  // prepare intermediate data
+  std::vector<int> num_indices_per_row;
+  std::vector<int> my_global_elements;
+
+  create_map_data(cp, vars, p2m, my_global_elements, structure.num_my_elements);
+  create_nb_indices_per_row(cp, vars, starting_indices, num_indices_per_row);
+
+  // rowmap, ghosts not present
+  Epetra_Map rowmap(-1,structure.num_my_elements,&my_global_elements[0],0,comm);
+
+  // colmap, has ghosts at the end
+  const Uint nb_nodes_for_rank = cp.isUpdatable().size();
+  Epetra_Map colmap(-1,nb_nodes_for_rank*total_nb_eq,&my_global_elements[0],0,comm);
+  my_global_elements.clear();
+
+  // Create the graph, using static profile for performance
+  structure.graph.reset(new Epetra_CrsGraph(Copy, rowmap, colmap, &num_indices_per_row[0], true));
+  Epetra_CrsGraph& graph = *structure.graph;
+
+  // Fill the graph
+  int max_nb_row_entries=0;
+  for(int i = 0; i != nb_nodes_for_rank; ++i)
+  {
+    const int nb_row_nodes = starting_indices[i+1] - starting_indices[i];
+    max_nb_row_entries = nb_row_nodes > max_nb_row_entries ? nb_row_nodes : max_nb_row_entries;
+  }
+  std::vector<int> row_indices(max_nb_row_entries*total_nb_eq);
+  for(int i = 0; i != nb_nodes_for_rank; ++i)
+  {
+    if(cp.isUpdatable()[i])
+    {
+      const Uint columns_begin = starting_indices[i];
+      const Uint columns_end = starting_indices[i+1];
+      for(Uint j = columns_begin; j != columns_end; ++j)
+      {
+        const Uint column = j-columns_begin;
+        const Uint node_idx = node_connectivity[j]*total_nb_eq;
+        for(int k = 0; k != total_nb_eq; ++k)
+        {
+          row_indices[column*total_nb_eq+k] = p2m[node_idx+k];
+        }
+      }
+      for(int k = 0; k != total_nb_eq; ++k)
+      {
+        const int row = p2m[i*total_nb_eq+k];
+        TRILINOS_THROW(graph.InsertMyIndices(row, static_cast<int>(total_nb_eq*(columns_end - columns_begin)), &row_indices[0]));
+      }
+    }
+  }
+
+  TRILINOS_THROW(graph.FillComplete());
+  TRILINOS_THROW(graph.OptimizeStorage());
+}
+
+/// True if the structure was built from the given distribution, variables and connectivity,
+/// comparing the maps and the column indices of each owned row of its graph
+bool structure_matches(const CrsGraphStructure& structure,
+                       common::PE::CommPattern& cp,
+                       const VariablesDescriptor& vars,
+                       const std::vector<Uint>& node_connectivity,
+                       const std::vector<Uint>& starting_indices)
+{
+  std::vector<int> p2m;
+  std::vector<int> my_global_elements;
+  int num_my_elements;
+  create_map_data(cp, vars, p2m, my_global_elements, num_my_elements);
+  if(num_my_elements != structure.num_my_elements || p2m != structure.p2m)
+    return false;
+
+  const Epetra_CrsGraph& graph = *structure.graph;
+  if(graph.ColMap().NumMyElements() != static_cast<int>(my_global_elements.size())
+     || !std::equal(my_global_elements.begin(), my_global_elements.end(), graph.ColMap().MyGlobalElements()))
+    return false;
+
+  // The graph stores each row sorted and without duplicates
+  const Uint total_nb_eq = vars.size();
+  const Uint nb_nodes_for_rank = cp.isUpdatable().size();
+  std::vector<int> row_indices;
+  for(Uint i = 0; i != nb_nodes_for_rank; ++i)
+  {
+    if(!cp.isUpdatable()[i])
+      continue;
+
+    row_indices.clear();
+    for(Uint j = starting_indices[i]; j != starting_indices[i+1]; ++j)
+    {
+      for(Uint k = 0; k != total_nb_eq; ++k)
+        row_indices.push_back(p2m[node_connectivity[j]*total_nb_eq+k]);
+    }
+    std::sort(row_indices.begin(), row_indices.end());
+    row_indices.erase(std::unique(row_indices.begin(), row_indices.end()), row_indices.end());
+
+    for(Uint k = 0; k != total_nb_eq; ++k)
+    {
+      int nb_entries;
+      int* entries;
+      TRILINOS_THROW(graph.ExtractMyRowView(p2m[i*total_nb_eq+k], nb_entries, entries));
+      if(nb_entries != static_cast<int>(row_indices.size()))
+        return false;
+      std::vector<int> sorted_entries(entries, entries + nb_entries);
+      std::sort(sorted_entries.begin(), sorted_entries.end());
+      if(sorted_entries != row_indices)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/// Structures that are still in use
+std::vector< boost::weak_ptr<CrsGraphStructure> >& crs_graph_cache()
+{
+  static std::vector< boost::weak_ptr<CrsGraphStructure> > cache;
+  return cache;
+}
+
+} // detail
+
+boost::shared_ptr<const CrsGraphStructure> crs_graph(common::PE::CommPattern& cp,
+                                                     const VariablesDescriptor& variables,
+                                                     const std::vector<Uint>& node_connectivity,
+                                                     const std::vector<Uint>& starting_indices,
+                                                     const Epetra_MpiComm& comm)
+{
+  // Hash the data that determines the structure
+  const Uint nb_nodes_for_rank = cp.isUpdatable().size();
+  std::vector<Uint> variable_layout;
+  const Uint nb_vars = variables.nb_vars();
+  for(Uint var_idx = 0; var_idx != nb_vars; ++var_idx)
+  {
+    variable_layout.push_back(variables.offset(var_idx));
+    variable_layout.push_back(variables.var_length(var_idx));
+  }
+
+  std::size_t hash = 0;
+  int *gid=(int*)cp.gid()->pack();
+  boost::hash_range(hash, gid, gid + nb_nodes_for_rank);
+  delete[] gid;
+  boost::hash_range(hash, cp.isUpdatable().begin(), cp.isUpdatable().end());
+  boost::hash_range(hash, node_connectivity.begin(), node_connectivity.end());
+  boost::hash_range(hash, starting_indices.begin(), starting_indices.end());
+  boost::hash_range(hash, variable_layout.begin(), variable_layout.end());
+
+  // Look for a living structure with the same input, dropping the expired ones
+  std::vector< boost::weak_ptr<CrsGraphStructure> >& cache = detail::crs_graph_cache();
+  boost::shared_ptr<CrsGraphStructure> found;
+  std::vector< boost::weak_ptr<CrsGraphStructure> >::iterator it = cache.begin();
+  while(it != cache.end())
+  {
+    boost::shared_ptr<CrsGraphStructure> cached = it->lock();
+    if(is_null(cached))
+    {
+      it = cache.erase(it);
+      continue;
+    }
+    if(is_null(found)
+       && cached->hash == hash
+       && cached->nb_nodes == nb_nodes_for_rank
+       && cached->nb_connectivity_entries == node_connectivity.size()
+       && cached->variable_layout == variable_layout
+       && detail::structure_matches(*cached, cp, variables, node_connectivity, starting_indices))
+    {
+      found = cached;
+    }
+    ++it;
+  }
+
+  // Building the graph is collective, so all ranks must agree on reusing it
+  int local_found = is_not_null(found) ? 1 : 0;
+  int global_found = local_found;
+  if(common::PE::Comm::instance().is_active())
+    common::PE::Comm::instance().all_reduce(common::PE::min(), &local_found, 1, &global_found);
+
+  if(global_found == 1)
+  {
+    CFdebug << "Reusing the structure of an existing Trilinos matrix" << CFendl;
+    return found;
+  }
+
+  boost::shared_ptr<CrsGraphStructure> result(new CrsGraphStructure());
+  result->hash = hash;
+  result->nb_nodes = nb_nodes_for_rank;
+  result->nb_connectivity_entries = node_connectivity.size();
+  result->variable_layout.swap(variable_layout);
+  detail::build_crs_graph(cp, variables, node_connectivity, starting_indices, comm, *result);
+  cache.push_back(result);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Initialized before main, so before any thread can call thread_local_indices
+boost::thread_specific_ptr< std::vector<int> > converted_indices;
+
+} // namespace detail
+
+int* thread_local_indices(const Uint size)
+{
+  std::vector<int>* buffer = detail::converted_indices.get();
+  if(is_null(buffer))
+  {
+    buffer = new std::vector<int>(size);
+    detail::converted_indices.reset(buffer);
+  }
+  else if(buffer->size() < size)
+  {
+    buffer->resize(size);
+  }
+  return size == 0 ? 0 : &(*buffer)[0];
+}
+
 } // namespace LSS
 } // namespace math
 } // namespace cf3
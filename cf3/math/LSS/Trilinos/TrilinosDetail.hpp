@@ -9,6 +9,12 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
 #include "common/CF.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -21,6 +27,9 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+class Epetra_CrsGraph;
+class Epetra_MpiComm;
+
 namespace cf3 {
   namespace common { namespace PE { class CommPattern; } }
 namespace math {
@@ -39,6 +48,44 @@ void create_map_data(cf3::common::PE::CommPattern& cp,
                       std::vector<int>& my_global_elements,
                       int& num_my_elements);
 
+/// Symbolic structure of a Trilinos CRS matrix: the graph and the mapping from node index to matrix index.
+/// Matrices with the same structure share one instance, obtained through crs_graph.
+class CrsGraphStructure : public boost::noncopyable
+{
+public:
+  ~CrsGraphStructure();
+
+  /// Mapping from node index to local matrix index, as computed by create_map_data
+  std::vector<int> p2m;
+  /// The number of non-ghosts owned by this rank
+  int num_my_elements;
+  /// The filled graph
+  boost::scoped_ptr<Epetra_CrsGraph> graph;
+
+  /// Hash and sizes of the data that determines the structure, to find the candidates for reuse.
+  /// A candidate is then checked against the graph itself, so the input is not stored.
+  std::size_t hash;
+  Uint nb_nodes;
+  Uint nb_connectivity_entries;
+  std::vector<Uint> variable_layout;
+};
+
+/// Get the structure of a CRS matrix for the given distribution, variables and connectivity.
+/// A structure is built only if no living matrix uses one with the same input, otherwise that one is returned.
+/// Structures are held by the matrices that use them, and are freed when the last one releases it.
+/// Must be called on all ranks.
+boost::shared_ptr<const CrsGraphStructure> crs_graph(cf3::common::PE::CommPattern& cp,
+                                                     const VariablesDescriptor& variables,
+                                                     const std::vector<Uint>& node_connectivity,
+                                                     const std::vector<Uint>& starting_indices,
+                                                     const Epetra_MpiComm& comm);
+
+/// Scratch buffer for the index conversions in the set/add/get methods of the Trilinos matrices, holding at least size entries.
+/// Each thread gets its own buffer, so these methods can be called concurrently, provided the threads
+/// modify disjoint rows (as is the case when assembling the elements of a single mesh::ElementColoring colour).
+/// The buffer is shared by all matrices and freed when the thread exits.
+int* thread_local_indices(const Uint size);
+
 } // namespace LSS
 } // namespace math
 } // namespace cf3
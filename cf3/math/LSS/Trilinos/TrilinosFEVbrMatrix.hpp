@@ -15,6 +15,7 @@
 
 #include "math/LSS/LibLSS.hpp"
 #include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/Trilinos/TrilinosDetail.hpp"
 #include "math/LSS/Vector.hpp"
 #include "math/LSS/Matrix.hpp"
 
@@ -182,8 +183,6 @@ private:
   /// mapper array, maps from process local numbering to matrix local numbering (because ghost nodes need to be ordered to the back)
   std::vector<int> m_p2m;
 
-  /// a helper array used in set/add/get_values to avoid frequent new+free combo
-  std::vector<int> m_converted_indices;
 
   /// Copy of the connectivity data
   std::vector<int> m_node_connectivity, m_starting_indices;
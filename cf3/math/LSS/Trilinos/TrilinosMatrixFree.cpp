@@ -0,0 +1,217 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Epetra_Import.h"
+#include "Epetra_Map.h"
+#include "Epetra_MultiVector.h"
+#include "Epetra_Vector.h"
+
+#include "Thyra_DefaultDiagonalLinearOp.hpp"
+#include "Thyra_EpetraThyraWrappers.hpp"
+#include "Thyra_LinearOpDefaultBase.hpp"
+#include "Thyra_VectorBase.hpp"
+
+#include "common/Assertions.hpp"
+#include "common/Builder.hpp"
+#include "common/PE/Comm.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "math/LSS/Trilinos/TrilinosDetail.hpp"
+#include "math/LSS/Trilinos/TrilinosMatrixFree.hpp"
+#include "math/LSS/Trilinos/TrilinosVector.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Thyra interface to the product computed by TrilinosMatrixFree
+class MatrixFreeThyraOperator : public Thyra::LinearOpDefaultBase<Real>
+{
+public:
+  MatrixFreeThyraOperator(TrilinosMatrixFree& matrix, const Teuchos::RCP<const Epetra_Map>& map) :
+    m_matrix(matrix),
+    m_map(map),
+    m_space(Thyra::create_VectorSpace(map))
+  {
+  }
+
+  Teuchos::RCP< const Thyra::VectorSpaceBase<Real> > range() const
+  {
+    return m_space;
+  }
+
+  Teuchos::RCP< const Thyra::VectorSpaceBase<Real> > domain() const
+  {
+    return m_space;
+  }
+
+protected:
+  bool opSupportedImpl(Thyra::EOpTransp M_trans) const
+  {
+    return M_trans == Thyra::NOTRANS;
+  }
+
+  void applyImpl(const Thyra::EOpTransp M_trans, const Thyra::MultiVectorBase<Real>& X, const Teuchos::Ptr< Thyra::MultiVectorBase<Real> >& Y, const Real alpha, const Real beta) const
+  {
+    cf3_assert(M_trans == Thyra::NOTRANS);
+    Teuchos::RCP<const Epetra_MultiVector> x = Thyra::get_Epetra_MultiVector(*m_map, Teuchos::rcpFromRef(X));
+    Teuchos::RCP<Epetra_MultiVector> y = Thyra::get_Epetra_MultiVector(*m_map, Teuchos::rcpFromPtr(Y));
+    m_matrix.apply(*x, *y, alpha, beta);
+  }
+
+private:
+  TrilinosMatrixFree& m_matrix;
+  Teuchos::RCP<const Epetra_Map> m_map;
+  Teuchos::RCP< const Thyra::VectorSpaceBase<Real> > m_space;
+};
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < LSS::TrilinosMatrixFree, LSS::Matrix, LSS::LibLSS > TrilinosMatrixFree_Builder;
+
+TrilinosMatrixFree::TrilinosMatrixFree(const std::string& name) :
+  LSS::MatrixFreeMatrix(name),
+  m_comm(common::PE::Comm::instance().communicator()),
+  m_num_my_elements(0)
+{
+  properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
+
+  options().add("jacobi_preconditioner", true)
+    .pretty_name("Jacobi Preconditioner")
+    .description("Precondition with the inverse of the diagonal, which is computed using one extra run of the operator action for each solve. "
+                 "If false, the preconditioner in the solver parameters is used and it must not need the matrix entries.")
+    .mark_basic();
+}
+
+TrilinosMatrixFree::~TrilinosMatrixFree()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosMatrixFree::create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector<Uint>& node_connectivity, const std::vector<Uint>& starting_indices, Vector& solution, Vector& rhs)
+{
+  MatrixFreeMatrix::create_blocked(cp, vars, node_connectivity, starting_indices, solution, rhs);
+
+  // Same distribution as the TrilinosVector, with the ghosts at the end
+  std::vector<int> my_global_elements;
+  create_map_data(cp, vars, m_p2m, my_global_elements, m_num_my_elements);
+  int* global_elements = my_global_elements.empty() ? 0 : &my_global_elements[0];
+  m_domain_map = Teuchos::rcp(new Epetra_Map(-1, m_num_my_elements, global_elements, 0, m_comm));
+  m_column_map = Teuchos::rcp(new Epetra_Map(-1, my_global_elements.size(), global_elements, 0, m_comm));
+  m_importer = Teuchos::rcp(new Epetra_Import(*m_column_map, *m_domain_map));
+
+  m_thyra_operator = Teuchos::rcp(new detail::MatrixFreeThyraOperator(*this, m_domain_map));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosMatrixFree::destroy()
+{
+  m_thyra_operator.reset();
+  m_importer.reset();
+  m_column_map.reset();
+  m_domain_map.reset();
+  m_p2m.clear();
+  m_num_my_elements = 0;
+  m_x_values.clear();
+  m_y_values.clear();
+  MatrixFreeMatrix::destroy();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosMatrixFree::apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y, const Real alpha, const Real beta)
+{
+  cf3_assert(is_created());
+  cf3_assert(X.NumVectors() == Y.NumVectors());
+
+  Epetra_MultiVector x_with_ghosts(*m_column_map, X.NumVectors(), false);
+  TRILINOS_THROW(x_with_ghosts.Import(X, *m_importer, Insert));
+
+  const Uint nb_rows = m_p2m.size();
+  m_x_values.resize(nb_rows);
+  for(int v = 0; v != X.NumVectors(); ++v)
+  {
+    const Real* x_values = x_with_ghosts[v];
+    for(Uint i = 0; i != nb_rows; ++i)
+      m_x_values[i] = x_values[m_p2m[i]];
+
+    apply(m_x_values, m_y_values);
+
+    Real* y_values = Y[v];
+    for(Uint i = 0; i != nb_rows; ++i)
+    {
+      const int row = m_p2m[i];
+      if(row >= m_num_my_elements)
+        continue;
+      // Y may be uninitialized if beta is zero
+      y_values[row] = beta == 0. ? alpha*m_y_values[i] : alpha*m_y_values[i] + beta*y_values[row];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+const Epetra_Map& TrilinosMatrixFree::domain_map() const
+{
+  cf3_assert(!m_domain_map.is_null());
+  return *m_domain_map;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Teuchos::RCP< const Thyra::LinearOpBase< Real > > TrilinosMatrixFree::thyra_operator() const
+{
+  return m_thyra_operator;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Teuchos::RCP< Thyra::LinearOpBase< Real > > TrilinosMatrixFree::thyra_operator()
+{
+  return m_thyra_operator;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+Teuchos::RCP< const Thyra::LinearOpBase< Real > > TrilinosMatrixFree::thyra_preconditioner()
+{
+  if(!options().value<bool>("jacobi_preconditioner"))
+    return Teuchos::null;
+
+  std::vector<Real> diagonal;
+  get_diagonal(diagonal);
+
+  Teuchos::RCP<Epetra_Vector> inverse_diagonal = Teuchos::rcp(new Epetra_Vector(*m_domain_map));
+  const Uint nb_rows = m_p2m.size();
+  for(Uint i = 0; i != nb_rows; ++i)
+  {
+    const int row = m_p2m[i];
+    if(row < m_num_my_elements)
+      (*inverse_diagonal)[row] = diagonal[i] != 0. ? 1. / diagonal[i] : 1.;
+  }
+
+  return Thyra::diagonal<Real>(Thyra::create_Vector(inverse_diagonal, m_thyra_operator->domain()), "Jacobi");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
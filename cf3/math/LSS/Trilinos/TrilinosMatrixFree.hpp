@@ -0,0 +1,105 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_Math_LSS_TrilinosMatrixFree_hpp
+#define cf3_Math_LSS_TrilinosMatrixFree_hpp
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <Epetra_MpiComm.h>
+#include <Teuchos_RCP.hpp>
+
+#include "math/LSS/LibLSS.hpp"
+#include "math/LSS/MatrixFreeMatrix.hpp"
+
+#include "ThyraOperator.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+  @file TrilinosMatrixFree.hpp definition of LSS::TrilinosMatrixFree
+**/
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class Epetra_Import;
+class Epetra_Map;
+class Epetra_MultiVector;
+
+namespace cf3 {
+namespace math {
+namespace LSS {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Matrix-free operator for the Trilinos solvers, see MatrixFreeMatrix. The Thyra operator imports the ghost
+/// entries of its argument and then runs MatrixFreeMatrix::apply, so only Krylov methods and preconditioners
+/// that don't need the matrix entries can be used. Unless the jacobi_preconditioner option is disabled, the solution
+/// strategy is given the inverse of the diagonal as preconditioner.
+class LSS_API TrilinosMatrixFree : public LSS::MatrixFreeMatrix, public ThyraOperator {
+public:
+
+  /// name of the type
+  static std::string type_name () { return "TrilinosMatrixFree"; }
+
+  /// Accessor to solver type
+  const std::string solvertype() { return "Trilinos"; }
+
+  /// Default constructor
+  TrilinosMatrixFree(const std::string& name);
+
+  ~TrilinosMatrixFree();
+
+  /// Create the maps that distribute the vectors
+  virtual void create_blocked(common::PE::CommPattern& cp, const VariablesDescriptor& vars, const std::vector< Uint >& node_connectivity, const std::vector< Uint >& starting_indices, Vector& solution, Vector& rhs);
+
+  /// Deallocate underlying data
+  void destroy();
+
+  /// Thyra operator that runs the matrix-free product
+  virtual Teuchos::RCP< const Thyra::LinearOpBase< Real > > thyra_operator() const;
+  virtual Teuchos::RCP< Thyra::LinearOpBase< Real > > thyra_operator();
+
+  /// Inverse of the diagonal, computed on each call, or null if the jacobi_preconditioner option is false
+  virtual Teuchos::RCP< const Thyra::LinearOpBase< Real > > thyra_preconditioner();
+
+  using MatrixFreeMatrix::apply;
+
+  /// Compute Y = alpha*A*X + beta*Y for vectors on the map of the owned rows
+  void apply(const Epetra_MultiVector& X, Epetra_MultiVector& Y, const Real alpha, const Real beta);
+
+  /// Map of the owned rows, which is both the domain and range of the operator
+  const Epetra_Map& domain_map() const;
+
+private:
+  Epetra_MpiComm m_comm;
+
+  /// Mapping from LSS local index to the local index in m_column_map
+  std::vector<int> m_p2m;
+  /// Number of owned rows
+  int m_num_my_elements;
+
+  /// Owned rows
+  Teuchos::RCP<Epetra_Map> m_domain_map;
+  /// Owned and ghost rows, in the order of m_p2m
+  Teuchos::RCP<Epetra_Map> m_column_map;
+  /// Import of the ghost entries
+  Teuchos::RCP<Epetra_Import> m_importer;
+
+  Teuchos::RCP< Thyra::LinearOpBase< Real > > m_thyra_operator;
+
+  /// Work vectors in LSS local numbering
+  std::vector<Real> m_x_values;
+  std::vector<Real> m_y_values;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace LSS
+} // namespace math
+} // namespace cf3
+
+#endif // cf3_Math_LSS_TrilinosMatrixFree_hpp
@@ -16,6 +16,7 @@
 
 #include "Teko_StratimikosFactory.hpp"
 
+#include "Thyra_DefaultPreconditioner.hpp"
 #include "Thyra_EpetraLinearOp.hpp"
 #include "Thyra_EpetraThyraWrappers.hpp"
 #include "Thyra_LinearOpWithSolveBase.hpp"
@@ -27,6 +28,7 @@
 #include "common/Builder.hpp"
 #include "common/EventHandler.hpp"
 #include "common/OptionList.hpp"
+#include "common/Profiler.hpp"
 
 #include "ParameterList.hpp"
 #include "ThyraMultiVector.hpp"
@@ -141,9 +143,17 @@ struct TrilinosStratimikosStrategy::Implementation
       m_lows = m_lows_factory->createOp();
     }
 
-    Thyra::initializeOp(*m_lows_factory, m_matrix->thyra_operator(), m_lows.ptr());
+    common::ScopedTimer preconditioner_timer("LSS::initialize_preconditioner");
+    const Teuchos::RCP<const Thyra::LinearOpBase<Real> > preconditioner = m_writable_matrix->thyra_preconditioner();
+    if(preconditioner.is_null())
+      Thyra::initializeOp(*m_lows_factory, m_matrix->thyra_operator(), m_lows.ptr());
+    else
+      Thyra::initializePreconditionedOp<Real>(*m_lows_factory, m_matrix->thyra_operator(), Thyra::unspecifiedPrec<Real>(preconditioner), m_lows.ptr());
+    preconditioner_timer.stop();
 
+    common::ScopedTimer iteration_timer("LSS::iterate");
     Thyra::SolveStatus<double> status = Thyra::solve<double>(*m_lows, Thyra::NOTRANS, *m_rhs->thyra_vector(m_matrix->thyra_operator()->range()), m_solution->thyra_vector(m_matrix->thyra_operator()->domain()).ptr());
+    iteration_timer.stop();
     CFinfo << "Thyra::solve finished with status " << status.message << CFendl;
     if(m_self.options().option("compute_residual").value<bool>())
       CFinfo << "Solver residual: " << compute_residual() << CFendl;
@@ -193,6 +203,8 @@ struct TrilinosStratimikosStrategy::Implementation
   Teuchos::RCP<Thyra::LinearOpWithSolveBase<double> > m_lows;
 
   Handle<ThyraOperator const> m_matrix;
+  /// Same as m_matrix, for building the preconditioner
+  Handle<ThyraOperator> m_writable_matrix;
   Handle<ThyraMultiVector> m_rhs;
   Handle<ThyraMultiVector> m_solution;
   Teuchos::RCP< Thyra::MultiVectorBase<Real> > m_residual_vec;
@@ -218,7 +230,8 @@ TrilinosStratimikosStrategy::~TrilinosStratimikosStrategy()
 
 void TrilinosStratimikosStrategy::set_matrix(const Handle< Matrix >& matrix)
 {
-  m_implementation->m_matrix = Handle<ThyraOperator>(matrix);
+  m_implementation->m_writable_matrix = Handle<ThyraOperator>(matrix);
+  m_implementation->m_matrix = Handle<ThyraOperator const>(m_implementation->m_writable_matrix);
   m_implementation->setup_solver();
 }
 
@@ -47,7 +47,6 @@ TrilinosVector::TrilinosVector(const std::string& name) :
   m_blockrow_size(0),
   m_is_created(false),
   m_vec(0),
-  m_converted_indices(0),
   m_comm(common::PE::Comm::instance().communicator())
 {
   regist_signal( "print_native" )
@@ -159,8 +158,6 @@ void TrilinosVector::set_rhs_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.rhs[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -176,8 +173,6 @@ void TrilinosVector::add_rhs_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.rhs[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -193,8 +188,6 @@ void TrilinosVector::get_rhs_values(BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.rhs[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -210,8 +203,6 @@ void TrilinosVector::set_sol_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.sol[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -227,8 +218,6 @@ void TrilinosVector::add_sol_values(const BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.sol[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -244,8 +233,6 @@ void TrilinosVector::get_sol_values(BlockAccumulator& values)
   /// @note looked up the code and access mechanism is a mess, much less cpu to access here in a for loop and directly do whats desired
   cf3_assert(m_is_created);
   const int numblocks=values.indices.size();
-  if (m_converted_indices.size()<numblocks) m_converted_indices.resize(numblocks);
-  int *conv=&m_converted_indices[0];
   double *vals=(double*)&values.sol[0];
   for (int i=0; i<(const int)numblocks; i++)
   {
@@ -84,6 +84,8 @@ public:
   //@} END INDIVIDUAL ACCESS
 
   /// @name EFFICCIENT ACCESS
+  /// The methods using a BlockAccumulator must support concurrent calls from several threads,
+  /// as long as the block accumulators of the different threads don't share any index
   //@{
 
   /// Set a list of values to rhs
@@ -0,0 +1,394 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "common/Foreach.hpp"
+#include "common/Log.hpp"
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionT.hpp"
+#include "common/OptionComponent.hpp"
+
+#include "math/Consts.hpp"
+
+#include "mesh/BoundingVolumeHierarchy.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Connectivity.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+cf3::common::ComponentBuilder < BoundingVolumeHierarchy, Component, LibMesh > BoundingVolumeHierarchy_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy( const std::string& name )
+  : Component(name), m_dim(0), m_nb_elems_per_leaf(8u)
+{
+  options().add("mesh", m_mesh)
+      .description("Mesh to create the hierarchy from")
+      .pretty_name("Mesh")
+      .mark_basic()
+      .link_to(&m_mesh);
+
+  options().add("nb_elems_per_leaf", m_nb_elems_per_leaf)
+      .description("The maximum number of elements in a leaf of the hierarchy")
+      .pretty_name("Number of Elements per Leaf")
+      .link_to(&m_nb_elems_per_leaf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundingVolumeHierarchy::create_tree()
+{
+  if (is_null(m_mesh))
+    throw SetupError(FromHere(), "Option \"mesh\" has not been configured");
+  if (m_nb_elems_per_leaf == 0)
+    throw BadValue(FromHere(), "Option \"nb_elems_per_leaf\" must be at least 1");
+
+  m_dim = m_mesh->dimension();
+  m_nodes.clear();
+  m_elements.clear();
+
+  // Centroid and bounding box of every volume element
+  std::vector<Entity> elements;
+  std::vector<Real> centroids;
+  std::vector<Real> boxes;
+  RealVector centroid(m_dim);
+  boost_foreach (Elements& elements_comp, find_components_recursively_with_filter<Elements>(*m_mesh,IsElementsVolume()))
+  {
+    RealMatrix coordinates;
+    elements_comp.geometry_space().allocate_coordinates(coordinates);
+    for (Uint elem_idx=0; elem_idx<elements_comp.size(); ++elem_idx)
+    {
+      elements_comp.geometry_space().put_coordinates(coordinates,elem_idx);
+      elements_comp.element_type().compute_centroid(coordinates,centroid);
+      elements.push_back(Entity(elements_comp,elem_idx));
+      for (Uint d=0; d<m_dim; ++d)
+      {
+        centroids.push_back(centroid[d]);
+        boxes.push_back(coordinates.col(d).minCoeff());
+        boxes.push_back(coordinates.col(d).maxCoeff());
+      }
+    }
+  }
+
+  const Uint nb_elems = elements.size();
+  if (nb_elems == 0)
+    return;
+
+  // Root box, to scale the Morton codes and the tolerance
+  Node root;
+  for (Uint d=0; d<3; ++d)
+  {
+    root.min[d] = 0.;
+    root.max[d] = 0.;
+  }
+  for (Uint d=0; d<m_dim; ++d)
+  {
+    root.min[d] = math::Consts::real_max();
+    root.max[d] = -math::Consts::real_max();
+    for (Uint e=0; e<nb_elems; ++e)
+    {
+      root.min[d] = std::min(root.min[d], boxes[2*(e*m_dim+d)]);
+      root.max[d] = std::max(root.max[d], boxes[2*(e*m_dim+d)+1]);
+    }
+  }
+  Real extent = 0.;
+  for (Uint d=0; d<m_dim; ++d)
+    extent = std::max(extent, root.max[d]-root.min[d]);
+  const Real tolerance = 1e-10*extent;
+  m_nodes.push_back(root);
+
+  // Sort the elements along the Morton curve
+  std::vector< std::pair<boost::uint64_t,Uint> > codes(nb_elems);
+  for (Uint e=0; e<nb_elems; ++e)
+    codes[e] = std::make_pair(morton_code(&centroids[e*m_dim]), e);
+  std::sort(codes.begin(), codes.end());
+
+  m_elements.resize(nb_elems);
+  m_centroids.resize(nb_elems*m_dim);
+  std::vector<Real> sorted_boxes(2*nb_elems*m_dim);
+  for (Uint i=0; i<nb_elems; ++i)
+  {
+    const Uint e = codes[i].second;
+    m_elements[i] = elements[e];
+    for (Uint d=0; d<m_dim; ++d)
+    {
+      m_centroids[i*m_dim+d] = centroids[e*m_dim+d];
+      sorted_boxes[2*(i*m_dim+d)]   = boxes[2*(e*m_dim+d)] - tolerance;
+      sorted_boxes[2*(i*m_dim+d)+1] = boxes[2*(e*m_dim+d)+1] + tolerance;
+    }
+  }
+
+  m_nodes.clear();
+  m_nodes.reserve(2*(nb_elems/m_nb_elems_per_leaf+1));
+  build_node(0, nb_elems, sorted_boxes);
+
+  CFdebug << "BoundingVolumeHierarchy: " << nb_elems << " elements in " << m_nodes.size() << " nodes" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint BoundingVolumeHierarchy::build_node(const Uint begin, const Uint end, const std::vector<Real>& element_boxes)
+{
+  const Uint node_idx = m_nodes.size();
+  m_nodes.push_back(Node());
+  Node node;
+  node.begin = begin;
+  node.nb_elems = end-begin;
+  node.second_child = 0;
+  for (Uint d=0; d<3; ++d)
+  {
+    node.min[d] = 0.;
+    node.max[d] = 0.;
+  }
+
+  if (end-begin <= m_nb_elems_per_leaf)
+  {
+    for (Uint d=0; d<m_dim; ++d)
+    {
+      node.min[d] = math::Consts::real_max();
+      node.max[d] = -math::Consts::real_max();
+      for (Uint e=begin; e<end; ++e)
+      {
+        node.min[d] = std::min(node.min[d], element_boxes[2*(e*m_dim+d)]);
+        node.max[d] = std::max(node.max[d], element_boxes[2*(e*m_dim+d)+1]);
+      }
+    }
+  }
+  else
+  {
+    // The elements are in Morton order, so both halves are compact
+    const Uint mid = begin + (end-begin)/2;
+    const Uint first_child = build_node(begin, mid, element_boxes);
+    node.second_child = build_node(mid, end, element_boxes);
+    for (Uint d=0; d<m_dim; ++d)
+    {
+      node.min[d] = std::min(m_nodes[first_child].min[d], m_nodes[node.second_child].min[d]);
+      node.max[d] = std::max(m_nodes[first_child].max[d], m_nodes[node.second_child].max[d]);
+    }
+  }
+
+  m_nodes[node_idx] = node;
+  return node_idx;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+boost::uint64_t BoundingVolumeHierarchy::morton_code(const Real* coordinate) const
+{
+  const Uint bits = m_dim == 3 ? 21u : 31u;
+  const boost::uint64_t max_int = (boost::uint64_t(1) << bits) - 1;
+
+  boost::uint64_t quantized[3] = {0, 0, 0};
+  for (Uint d=0; d<m_dim; ++d)
+  {
+    const Real length = m_nodes[0].max[d] - m_nodes[0].min[d];
+    Real x = length > 0. ? (coordinate[d] - m_nodes[0].min[d]) / length : 0.;
+    x = std::min(std::max(x, 0.), 1.);
+    quantized[d] = static_cast<boost::uint64_t>(x * static_cast<Real>(max_int));
+  }
+
+  boost::uint64_t code = 0;
+  for (int b=bits-1; b>=0; --b)
+  {
+    for (Uint d=0; d<m_dim; ++d)
+      code = (code << 1) | ((quantized[d] >> b) & 1u);
+  }
+  return code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool BoundingVolumeHierarchy::box_contains(const Node& node, const RealVector& coordinate) const
+{
+  for (Uint d=0; d<m_dim; ++d)
+  {
+    if (coordinate[d] < node.min[d] || coordinate[d] > node.max[d])
+      return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Real BoundingVolumeHierarchy::box_distance2(const Node& node, const RealVector& coordinate) const
+{
+  Real distance2 = 0.;
+  for (Uint d=0; d<m_dim; ++d)
+  {
+    const Real outside = std::max(std::max(node.min[d] - coordinate[d], coordinate[d] - node.max[d]), 0.);
+    distance2 += outside*outside;
+  }
+  return distance2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Real BoundingVolumeHierarchy::centroid_distance2(const Uint element, const RealVector& coordinate) const
+{
+  Real distance2 = 0.;
+  for (Uint d=0; d<m_dim; ++d)
+  {
+    const Real delta = m_centroids[element*m_dim+d] - coordinate[d];
+    distance2 += delta*delta;
+  }
+  return distance2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool BoundingVolumeHierarchy::find_element(const RealVector& coordinate, Entity& element)
+{
+  if (!is_created())
+    create_tree();
+  if (m_nodes.empty())
+    return false;
+  cf3_assert(coordinate.size() >= static_cast<int>(m_dim));
+
+  m_stack.assign(1, 0u);
+  while (!m_stack.empty())
+  {
+    const Node& node = m_nodes[m_stack.back()];
+    const Uint node_idx = m_stack.back();
+    m_stack.pop_back();
+    if (!box_contains(node, coordinate))
+      continue;
+
+    if (node.second_child == 0)
+    {
+      for (Uint e=node.begin; e<node.begin+node.nb_elems; ++e)
+      {
+        m_elements[e].allocate_coordinates(m_element_coordinates);
+        m_elements[e].put_coordinates(m_element_coordinates);
+        if (m_elements[e].element_type().is_coord_in_element(coordinate, m_element_coordinates))
+        {
+          element = m_elements[e];
+          return true;
+        }
+      }
+    }
+    else
+    {
+      m_stack.push_back(node.second_child);
+      m_stack.push_back(node_idx+1);
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint BoundingVolumeHierarchy::find_elements(const common::Table<Real>& coordinates, std::vector<Entity>& elements)
+{
+  if (!is_created())
+    create_tree();
+
+  elements.assign(coordinates.size(), Entity());
+  if (m_nodes.empty())
+    return 0;
+
+  cf3_assert(coordinates.row_size() >= m_dim);
+  std::vector< std::pair<boost::uint64_t,Uint> > order(coordinates.size());
+  std::vector<Real> coord(m_dim);
+  for (Uint i=0; i<coordinates.size(); ++i)
+  {
+    for (Uint d=0; d<m_dim; ++d)
+      coord[d] = coordinates[i][d];
+    order[i] = std::make_pair(morton_code(&coord[0]), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  Uint nb_found = 0;
+  RealVector coordinate(m_dim);
+  for (Uint i=0; i<order.size(); ++i)
+  {
+    const Uint row = order[i].second;
+    for (Uint d=0; d<m_dim; ++d)
+      coordinate[d] = coordinates[row][d];
+    if (find_element(coordinate, elements[row]))
+      ++nb_found;
+  }
+  return nb_found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BoundingVolumeHierarchy::find_nearest(const RealVector& coordinate, const Uint k, std::vector<Entity>& nearest)
+{
+  if (!is_created())
+    create_tree();
+
+  nearest.clear();
+  if (m_nodes.empty() || k == 0)
+    return;
+
+  typedef std::pair<Real,Uint> DistanceIdx;
+
+  // Nodes to visit, closest box first
+  std::priority_queue< DistanceIdx, std::vector<DistanceIdx>, std::greater<DistanceIdx> > nodes;
+  // The k best elements so far, the farthest on top
+  std::priority_queue< DistanceIdx > best;
+
+  nodes.push(DistanceIdx(box_distance2(m_nodes[0], coordinate), 0u));
+  while (!nodes.empty())
+  {
+    const DistanceIdx top = nodes.top();
+    nodes.pop();
+    if (best.size() == k && top.first > best.top().first)
+      break;
+
+    const Node& node = m_nodes[top.second];
+    if (node.second_child == 0)
+    {
+      for (Uint e=node.begin; e<node.begin+node.nb_elems; ++e)
+      {
+        const Real distance2 = centroid_distance2(e, coordinate);
+        if (best.size() < k)
+        {
+          best.push(DistanceIdx(distance2, e));
+        }
+        else if (distance2 < best.top().first)
+        {
+          best.pop();
+          best.push(DistanceIdx(distance2, e));
+        }
+      }
+    }
+    else
+    {
+      nodes.push(DistanceIdx(box_distance2(m_nodes[top.second+1], coordinate), top.second+1));
+      nodes.push(DistanceIdx(box_distance2(m_nodes[node.second_child], coordinate), node.second_child));
+    }
+  }
+
+  nearest.resize(best.size());
+  for (Uint i=nearest.size(); i>0; --i)
+  {
+    nearest[i-1] = m_elements[best.top().second];
+    best.pop();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
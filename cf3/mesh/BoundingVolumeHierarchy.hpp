@@ -0,0 +1,126 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_BoundingVolumeHierarchy_hpp
+#define cf3_mesh_BoundingVolumeHierarchy_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/cstdint.hpp>
+
+#include "common/Component.hpp"
+#include "common/Table.hpp"
+
+#include "math/MatrixTypes.hpp"
+
+#include "mesh/Entities.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class Mesh;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// @brief Spatial index of the volume elements of a mesh, as a bounding volume hierarchy in flat arrays
+///
+/// The elements are sorted along a Morton (Z-order) curve through their centroids, and the sorted range is split
+/// in halves recursively. Every node of the tree covers a contiguous range of elements, and is stored
+/// in depth-first order so the first child directly follows its parent. Contrary to the Octtree there are no
+/// buckets, so graded meshes don't leave cells empty or overflowing.
+class Mesh_API BoundingVolumeHierarchy : public common::Component
+{
+public: // functions
+
+  /// constructor
+  BoundingVolumeHierarchy( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "BoundingVolumeHierarchy"; }
+
+  /// Build the hierarchy from the volume elements of the mesh
+  void create_tree();
+
+  bool is_created() const { return !m_nodes.empty(); }
+
+  Uint dimension() const { return m_dim; }
+
+  /// @brief Find which element contains a given coordinate
+  /// @return if element was found
+  bool find_element(const RealVector& coordinate, Entity& element);
+
+  /// @brief Find which element contains each row of a table of coordinates
+  /// The coordinates are processed in Morton order, so consecutive queries traverse the same branches.
+  /// @param [out] elements  element for each coordinate, with a null comp if it was not found
+  /// @return the number of coordinates that were found
+  Uint find_elements(const common::Table<Real>& coordinates, std::vector<Entity>& elements);
+
+  /// @brief Find the k elements with the centroid closest to a given coordinate
+  /// @param [out] nearest   at most k elements, the nearest first
+  void find_nearest(const RealVector& coordinate, const Uint k, std::vector<Entity>& nearest);
+
+private: // functions
+
+  /// Node of the hierarchy, covering the elements [begin, begin+nb_elems)
+  struct Node
+  {
+    Real min[3];
+    Real max[3];
+    Uint begin;
+    Uint nb_elems;
+    /// Index of the second child, or 0 for a leaf. The first child is the next node.
+    Uint second_child;
+  };
+
+  /// Build the subtree of the sorted elements [begin,end), returning the index of its root
+  Uint build_node(const Uint begin, const Uint end, const std::vector<Real>& element_boxes);
+
+  /// Morton code of a coordinate, relative to the bounding box of the root
+  boost::uint64_t morton_code(const Real* coordinate) const;
+
+  bool box_contains(const Node& node, const RealVector& coordinate) const;
+
+  /// Squared distance from a coordinate to the bounding box of a node, zero inside
+  Real box_distance2(const Node& node, const RealVector& coordinate) const;
+
+  /// Squared distance from a coordinate to the centroid of a sorted element
+  Real centroid_distance2(const Uint element, const RealVector& coordinate) const;
+
+private: // data
+
+  Handle<Mesh> m_mesh;
+
+  Uint m_dim;
+
+  /// Maximum number of elements in a leaf
+  Uint m_nb_elems_per_leaf;
+
+  /// Nodes in depth-first order, the root first
+  std::vector<Node> m_nodes;
+
+  /// Elements in Morton order
+  std::vector<Entity> m_elements;
+
+  /// Centroids of the elements in Morton order, m_dim values per element
+  std::vector<Real> m_centroids;
+
+  /// Stack of node indices, reused by the traversals
+  std::vector<Uint> m_stack;
+
+  RealMatrix m_element_coordinates;
+
+}; // end BoundingVolumeHierarchy
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_BoundingVolumeHierarchy_hpp
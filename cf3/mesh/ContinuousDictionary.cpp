@@ -4,7 +4,7 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
-#include <set>
+#include <algorithm>
 
 #include <boost/assign/list_of.hpp>
 #include <boost/assign/std/vector.hpp>
@@ -19,6 +19,7 @@
 #include "common/DynTable.hpp"
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
+#include "common/PE/directory.hpp"
 
 #include "mesh/ContinuousDictionary.hpp"
 #include "mesh/Field.hpp"
@@ -64,7 +65,7 @@ ContinuousDictionary::~ContinuousDictionary()
 
 void ContinuousDictionary::rebuild_spaces_from_geometry()
 {
-  std::set<boost::uint64_t> points;
+  std::vector<boost::uint64_t> points;
   RealMatrix elem_coordinates;
   Uint dim = DIM_0D;
 
@@ -93,7 +94,8 @@ void ContinuousDictionary::rebuild_spaces_from_geometry()
   }
   bounding_box.make_global();
 
-  // (b) Create unique indices for every coordinate
+  // (b) Create unique indices for every coordinate.
+  //     The sorted vector of hashes gives the local index of each node by binary search
   math::Hilbert compute_glb_idx(bounding_box, 20);  // functor
   boost_foreach(const Handle<Entities>& entities_handle, entities_range())
   {
@@ -105,11 +107,12 @@ void ContinuousDictionary::rebuild_spaces_from_geometry()
       for (Uint node=0; node<shape_function.nb_nodes(); ++node)
       {
         RealVector space_coordinates = entities.element_type().shape_function().value(shape_function.local_coordinates().row(node)) * elem_coordinates ;
-        boost::uint64_t hash = compute_glb_idx(space_coordinates);
-        points.insert( hash );
+        points.push_back( compute_glb_idx(space_coordinates) );
       }
     }
   }
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
 
   // (c) Create the coordinates field
   Field& coordinates = create_field(mesh::Tags::coordinates(),"coords[vector]");
@@ -126,9 +129,6 @@ void ContinuousDictionary::rebuild_spaces_from_geometry()
   boost_foreach(const Handle<Entities>& entities_handle, entities_range())
   {
     Entities& entities = *entities_handle;
-    Dictionary& geometry = entities.geometry_fields();
-    Connectivity& geometry_node_connectivity = entities.geometry_space().connectivity();
-    common::List<Uint>& geometry_rank = entities.geometry_fields().rank();
     const ShapeFunction& shape_function = space(entities).shape_function();
     Connectivity& connectivity = const_cast<Space&>(space(entities)).connectivity();
     connectivity.resize(entities.size());
@@ -139,7 +139,7 @@ void ContinuousDictionary::rebuild_spaces_from_geometry()
       {
         RealVector space_coordinates = entities.element_type().shape_function().value(shape_function.local_coordinates().row(node)) * elem_coordinates ;
         boost::uint64_t hash = compute_glb_idx(space_coordinates);
-        Uint idx = std::distance(points.begin(), points.find(hash));
+        Uint idx = std::lower_bound(points.begin(), points.end(), hash) - points.begin();
         connectivity[elem][node] = idx;
         coordinates.set_row(idx, space_coordinates);
         rank()[idx] = UNKNOWN;
@@ -165,85 +165,30 @@ void ContinuousDictionary::rebuild_spaces_from_geometry()
     }
   }
 
-  std::map<boost::uint64_t,Uint> hash_to_idx;
-  std::map<boost::uint64_t,Uint>::iterator hash_to_idx_iter;
-  std::map<boost::uint64_t,Uint>::iterator hash_not_found = hash_to_idx.end();
-
-  std::vector<boost::uint64_t> coord_hash(size());
-  RealVector dummy(coordinates.row_size());
-  Uint c(0);
-  for (Uint i=0; i<size(); ++i)
-  {
-    math::copy(coordinates[i],dummy);
-    boost::uint64_t hash = compute_glb_idx(dummy);
-    hash_to_idx[hash] = i;
-    coord_hash[c++]=hash;
-  }
-
-  // - Communicate unknown ranks to all processes
-  std::vector< std::vector<boost::uint64_t> > recv_hash(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_gather(coord_hash,recv_hash);
-  else
-    recv_hash[0] = coord_hash;
-
-  // - Search this process contains the missing ranks of other processes
-  std::vector< std::vector<Uint> > send_found_on_rank(Comm::instance().size());
-  for (Uint p=0; p<Comm::instance().size(); ++p)
+  // - Set the rank to the lowest one found by any process that has the node.
+  //   The hashes are gathered in a distributed directory, so no process needs all the hashes
+  const bool parallel = Comm::instance().is_active() && Comm::instance().size() > 1;
+  if (parallel)
   {
-    send_found_on_rank[p].resize(recv_hash[p].size(),UNKNOWN);
-    {
-      for (Uint h=0; h<recv_hash[p].size(); ++h)
-      {
-        hash_to_idx_iter = hash_to_idx.find(recv_hash[p][h]);
-        if ( hash_to_idx_iter != hash_not_found )
-        {
-          send_found_on_rank[p][h] = rank()[ hash_to_idx_iter->second ];
-        }
-      }
-    }
-
+    std::vector<Uint> local_ranks(rank().array().begin(), rank().array().end());
+    std::vector<Uint> min_ranks, found_on_rank;
+    directory_min(points, local_ranks, std::vector<bool>(size(), true), true, min_ranks, found_on_rank);
+    for (Uint n=0; n<size(); ++n)
+      rank()[n] = min_ranks[n];
   }
-
-  // - Communicate which processes found the missing ranks
-  std::vector< std::vector<Uint> > recv_found_on_rank(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_to_all(send_found_on_rank,recv_found_on_rank);
-  else
-    recv_found_on_rank[0] = send_found_on_rank[0];
-
-
-  // - Set the missing rank to the lowest process number that found it
   for (Uint n=0; n<size(); ++n)
   {
-    Uint rank_that_owns = UNKNOWN;
-
-    for (Uint p=0; p<Comm::instance().size(); ++p)
-    {
-      rank_that_owns = std::min(recv_found_on_rank[p][n], rank_that_owns);
-    }
-    rank()[n] = rank_that_owns;
-
     cf3_assert(rank()[n] != UNKNOWN);
   }
 
   // step 5: fix unknown glb_idx
   // ---------------------------
   Uint nb_owned = 0;
-  std::vector<Uint> ghosts; ghosts.reserve(size());
   for (Uint i=0; i<size(); ++i)
   {
-    if (is_ghost(i))
-      ghosts.push_back(i);
-    else
+    if (!is_ghost(i))
       ++nb_owned;
   }
-  std::vector<boost::uint64_t> ghosts_hashed(ghosts.size());
-  for (Uint g=0; g<ghosts.size(); ++g)
-  {
-    math::copy(coordinates[ghosts[g]], dummy);
-    ghosts_hashed[g] = compute_glb_idx(dummy);
-  }
   std::vector<Uint> nb_owned_per_proc(Comm::instance().size(),nb_owned);
   if( Comm::instance().is_active() )
     Comm::instance().all_gather(nb_owned, nb_owned_per_proc);
@@ -257,50 +202,23 @@ void ContinuousDictionary::rebuild_spaces_from_geometry()
     start_id += nb_owned_per_proc[p];
   }
   start_id = start_id_per_proc[Comm::instance().rank()];
+  std::vector<bool> owned(size());
+  std::vector<Uint> node_glb_idx(size());
+  std::vector<Uint> node_rank(rank().array().begin(), rank().array().end());
   for (Uint i=0; i<size(); ++i)
   {
-    if (! is_ghost(i))
-      glb_idx()[i] = start_id++;
-    else
-      glb_idx()[i] = UNKNOWN;
+    owned[i] = !is_ghost(i);
+    node_glb_idx[i] = owned[i] ? start_id++ : UNKNOWN;
   }
 
-  std::vector< std::vector<boost::uint64_t> > recv_ghosts_hashed(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_gather(ghosts_hashed,recv_ghosts_hashed);
-  else
-    recv_ghosts_hashed[0] = ghosts_hashed;
-
-  // - Search this process contains the missing ranks of other processes
-  std::vector< std::vector<Uint> > send_glb_idx_on_rank(Comm::instance().size());
-  for (Uint p=0; p<Comm::instance().size(); ++p)
+  // - The owner of each node registers its global index, the ghosts look it up
+  if (parallel)
   {
-    send_glb_idx_on_rank[p].resize(recv_ghosts_hashed[p].size(),UNKNOWN);
-    if (p!=Comm::instance().rank())
-    {
-      for (Uint h=0; h<recv_ghosts_hashed[p].size(); ++h)
-      {
-        hash_to_idx_iter = hash_to_idx.find(recv_ghosts_hashed[p][h]);
-        if ( hash_to_idx_iter != hash_not_found )
-        {
-          send_glb_idx_on_rank[p][h] = glb_idx()[hash_to_idx_iter->second];
-        }
-      }
-    }
+    directory_lookup(points, owned, node_glb_idx, node_rank);
   }
-
-  // - Communicate which processes found the missing ghosts
-  std::vector< std::vector<Uint> > recv_glb_idx_on_rank(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_to_all(send_glb_idx_on_rank,recv_glb_idx_on_rank);
-  else
-    recv_glb_idx_on_rank[0] = send_glb_idx_on_rank[0];
-
-  // - Set the missing rank to the lowest process number that found it
-  for (Uint g=0; g<ghosts.size(); ++g)
+  for (Uint i=0; i<size(); ++i)
   {
-    cf3_assert(rank()[ghosts[g]] < Comm::instance().size());
-    glb_idx()[ghosts[g]] = recv_glb_idx_on_rank[rank()[ghosts[g]]][g];
+    glb_idx()[i] = node_glb_idx[i];
   }
 }
 
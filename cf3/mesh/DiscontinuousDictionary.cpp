@@ -4,7 +4,7 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
-#include <set>
+#include <algorithm>
 
 #include <boost/assign/list_of.hpp>
 #include <boost/assign/std/vector.hpp>
@@ -17,6 +17,7 @@
 #include "common/DynTable.hpp"
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
+#include "common/PE/directory.hpp"
 
 #include "math/BoundingBox.hpp"
 #include "math/Hilbert.hpp"
@@ -157,127 +158,71 @@ void DiscontinuousDictionary::rebuild_spaces_from_geometry()
     }
   }
 
-  // (3)
-  std::map<boost::uint64_t,Entity> hash_to_elements;
-  std::deque<Entity> unknown_rank_elements;
-  std::deque<boost::uint64_t> unknown_rank_elements_hash_deque;
+  // (3) Hash the centroid of every element. The hashes of all processes are gathered in a
+  //     distributed directory, so no process needs to store the hashes of the others
+  std::vector<Entity> elements;
+  std::vector<boost::uint64_t> elements_hashed;
+  std::vector< std::pair<boost::uint64_t,Uint> > sorted_hashes;
 
   math::Hilbert compute_glb_idx(bounding_box,20);
 
   boost_foreach(const Handle<Entities>& entities_handle, entities_range())
   {
     Entities& entities = *entities_handle;
-    const Space& entities_space = space(entities);
-    Uint nb_states_per_elem = entities_space.shape_function().nb_nodes();
-    RealMatrix elem_coords(entities.geometry_space().shape_function().nb_nodes(),entities.element_type().dimension());
     detail::ComputeCentroid compute_centroid(entities);
     for (Uint e=0; e<entities.size(); ++e)
     {
-      boost::uint64_t hash = compute_glb_idx(compute_centroid(e));
-      //CFinfo << "["<<PE::Comm::instance().rank() << "]  hashed "<< entities.uri().path() << "["<<e<<"]) at centroid " << compute_centroid.centroid.transpose() <<  " to " << hash << CFendl;
-      bool inserted = hash_to_elements.insert( std::make_pair(hash, Entity(entities,e)) ).second;
-      if (! inserted)
-      {
-        std::stringstream msg;
-        msg <<"Duplicate hash " << hash << " detected for element " << entities.uri() << " with centroid (" << compute_centroid.centroid.transpose() << ") and coords:\n" << compute_centroid.elem_coords;
-        throw ValueExists(FromHere(), msg.str());
-      }
-      if(entities.rank()[e] == UNKNOWN)
-      {
-        unknown_rank_elements.push_back(Entity(entities,e));
-        unknown_rank_elements_hash_deque.push_back(hash);
-      }
-      //        std::cout << std::endl;
+      const boost::uint64_t hash = compute_glb_idx(compute_centroid(e));
+      sorted_hashes.push_back(std::make_pair(hash, static_cast<Uint>(elements.size())));
+      elements.push_back(Entity(entities,e));
+      elements_hashed.push_back(hash);
     }
   }
 
-  // copy deque in vector, delete deque
-  std::vector<boost::uint64_t> unknown_rank_elements_hashed(unknown_rank_elements_hash_deque.size());
-  for (Uint g=0; g<unknown_rank_elements_hash_deque.size(); ++g)
+  std::sort(sorted_hashes.begin(), sorted_hashes.end());
+  for (Uint i=1; i<sorted_hashes.size(); ++i)
   {
-    unknown_rank_elements_hashed[g] = unknown_rank_elements_hash_deque[g];
-  }
-  unknown_rank_elements_hash_deque.clear();
-
-
-  // (4)
-  std::vector< std::vector<boost::uint64_t> > recv_unknown_rank_elements_hashed(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_gather(unknown_rank_elements_hashed,recv_unknown_rank_elements_hashed);
-  else
-    recv_unknown_rank_elements_hashed[0] = unknown_rank_elements_hashed;
-
-  // (5) Search if this process contains the elements with unknown ranks of other processes
-  std::map<boost::uint64_t,Entity>::iterator hash_to_elements_iter;
-  std::map<boost::uint64_t,Entity>::iterator hash_not_found = hash_to_elements.end();
-  std::vector< std::vector<Uint> > send_found_on_rank(Comm::instance().size());
-  for (Uint p=0; p<Comm::instance().size(); ++p)
-  {
-    send_found_on_rank[p].resize(recv_unknown_rank_elements_hashed[p].size(),UNKNOWN);
-    if (p!=Comm::instance().rank())
-    {
-      for (Uint h=0; h<recv_unknown_rank_elements_hashed[p].size(); ++h)
-      {
-        //          std::cout << PERank << "looking for hash " << recv_unknown_rank_elements_hashed[p][h] << " for proc " << p ;
-        hash_to_elements_iter = hash_to_elements.find(recv_unknown_rank_elements_hashed[p][h]);
-        if ( hash_to_elements_iter != hash_not_found )
-        {
-          const Space& entities_space = space(*hash_to_elements_iter->second.comp);
-          const Uint elem_idx = hash_to_elements_iter->second.idx;
-          if (rank()[entities_space.connectivity()[elem_idx][0]] == PE::Comm::instance().rank())
-          {
-            send_found_on_rank[p][h] = PE::Comm::instance().rank();
-            //              std::cout << " ---> found " ;
-          }
-          else
-          {
-            send_found_on_rank[p][h] = UNKNOWN-1;
-            //              std::cout << " ---> found but unknown" ;
-          }
-        }
-        //          std::cout << std::endl;
-      }
-    }
-    else
+    if (sorted_hashes[i].first == sorted_hashes[i-1].first)
     {
-      for (Uint h=0; h<recv_unknown_rank_elements_hashed[p].size(); ++h)
-        send_found_on_rank[p][h] = UNKNOWN-1;
+      const Entity& duplicate = elements[std::max(sorted_hashes[i].second, sorted_hashes[i-1].second)];
+      detail::ComputeCentroid compute_centroid(*duplicate.comp);
+      compute_centroid(duplicate.idx);
+      std::stringstream msg;
+      msg <<"Duplicate hash " << sorted_hashes[i].first << " detected for element " << duplicate.comp->uri() << " with centroid (" << compute_centroid.centroid.transpose() << ") and coords:\n" << compute_centroid.elem_coords;
+      throw ValueExists(FromHere(), msg.str());
     }
   }
+  sorted_hashes.clear();
+
+  // (4) Every process offers its own rank for the elements it owns, and UNKNOWN-1 for the other elements it has.
+  //     Elements with unknown rank take the lowest rank that owns them, or else the lowest rank that has them
+  const Uint my_rank = PE::Comm::instance().rank();
+  const bool parallel = Comm::instance().is_active() && Comm::instance().size() > 1;
+  std::vector<Uint> offered_rank(elements.size());
+  std::vector<bool> unknown_rank(elements.size());
+  for (Uint i=0; i<elements.size(); ++i)
+  {
+    const Space& entities_space = space(*elements[i].comp);
+    offered_rank[i] = rank()[entities_space.connectivity()[elements[i].idx][0]] == my_rank ? my_rank : UNKNOWN-1;
+    unknown_rank[i] = elements[i].comp->rank()[elements[i].idx] == UNKNOWN;
+  }
 
-  // (6)
-  std::vector< std::vector<Uint> > recv_found_on_rank(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_to_all(send_found_on_rank,recv_found_on_rank);
-  else
-    recv_found_on_rank[0] = send_found_on_rank[0];
+  std::vector<Uint> min_offered_rank, found_on_rank(elements.size(), my_rank);
+  if (parallel)
+    directory_min(elements_hashed, offered_rank, unknown_rank, true, min_offered_rank, found_on_rank);
 
-  for (Uint g=0; g<unknown_rank_elements.size(); ++g)
+  for (Uint g=0; g<elements.size(); ++g)
   {
-    const Space& entities_space = space(*unknown_rank_elements[g].comp);
-    const Uint elem_idx = unknown_rank_elements[g].idx;
+    if (!unknown_rank[g])
+      continue;
+
+    const Space& entities_space = space(*elements[g].comp);
+    const Uint elem_idx = elements[g].idx;
     cf3_assert(elem_idx<entities_space.connectivity().size());
     cf3_assert(elem_idx<entities_space.support().rank().size());
 
     const Uint first_loc_idx = entities_space.connectivity()[elem_idx][0];
-    Uint recv_rank = UNKNOWN;
-    Uint found_rank = UNKNOWN;
-    //      std::cout << PERank << "checking hash " << unknown_rank_elements_hashed[g] << ": ";
-    for (Uint p=0; p<Comm::instance().size(); ++p)
-    {
-      //        std::cout << recv_found_on_rank[p][g] << "   ";
-      if ( recv_found_on_rank[p][g] < recv_rank )
-      {
-        recv_rank = recv_found_on_rank[p][g];
-        found_rank = p;
-      }
-    }
-    //      std::cout << std::endl;
-    if (found_rank == UNKNOWN) // ---> Nobody owns this. This is because it is notfound in
-      found_rank = PE::Comm::instance().rank();
-    //        throw ValueNotFound(FromHere(), "Could not find rank for element "+entities_space.uri().path()+"["+to_str(elem_idx)+"] with hash "+to_str(unknown_rank_elements_hashed[g]));
-
-    //      std::cout << PERank << "set unknown element rank: " << unknown_rank_elements_hashed[g] << " --> " << found_rank << std::endl;
+    const Uint found_rank = found_on_rank[g] == UNKNOWN ? my_rank : found_on_rank[g];
 
     for (Uint s=0; s<entities_space.shape_function().nb_nodes(); ++s)
     {
@@ -291,10 +236,8 @@ void DiscontinuousDictionary::rebuild_spaces_from_geometry()
   // ---------------------------
   //  (1) Count the number of owned entries per process (owned when element it belongs to is owned)
   //  (2) glb_idx is filled in, ghost-entries are marked by a value "UNKNOWN" (=uint_max)
-  //  (3) Create map< hash-value , element > of all elements. It will be used to match different cpu-elems
-  //  (4) hash-values of ghost elements entries are communicated for lookup
-  //  (5) lookup of received hash-values from other processes are translated into owned glb_idx of space-entries
-  //  (6) glb_idx of ghost entries are received back
+  //  (3) owned elements register the glb_idx of their first entry under their hash in the distributed directory,
+  //      ghost elements look up their hash
 
 
   // (1)
@@ -344,118 +287,42 @@ void DiscontinuousDictionary::rebuild_spaces_from_geometry()
   }
 
   // (3)
-  std::deque<Entity> ghosts;
-  std::deque<boost::uint64_t> ghosts_hashed_deque;
-
-  boost_foreach(const Handle<Entities>& entities_handle, entities_range())
+  std::vector<bool> owned(elements.size());
+  std::vector<Uint> first_glb_idx(elements.size());
+  std::vector<Uint> owner_rank(elements.size());
+  for (Uint i=0; i<elements.size(); ++i)
   {
-    Entities& entities = *entities_handle;
-    const Space& entities_space = space(entities);
-    Uint nb_states_per_elem = entities_space.shape_function().nb_nodes();
-    detail::ComputeCentroid compute_centroid(entities);
-    for (Uint e=0; e<entities.size(); ++e)
-    {
-      boost::uint64_t hash = compute_glb_idx(compute_centroid(e));
-      //        std::cout << "["<<PE::Comm::instance().rank() << "]  hashed "<< entities.uri().path() << "["<<e<<"]) to " << hash;
-      if (rank()[entities_space.connectivity()[e][0]] != PE::Comm::instance().rank()) // if is ghost
-      {
-        cf3_assert(rank()[entities_space.connectivity()[e][0]] != UNKNOWN);
-        //          std::cout << "    --> is ghost, owned by " << entities.rank()[e] ;
-        ghosts.push_back(Entity(entities,e));
-        ghosts_hashed_deque.push_back(hash);
-      }
-      //        std::cout << std::endl;
-    }
-  }
-
-  // copy deque in vector, delete deque
-  std::vector<boost::uint64_t> ghosts_hashed(ghosts.size());
-  for (Uint g=0; g<ghosts.size(); ++g)
-  {
-    ghosts_hashed[g] = ghosts_hashed_deque[g];
+    const Uint first_loc_idx = space(*elements[i].comp).connectivity()[elements[i].idx][0];
+    cf3_assert(first_loc_idx < glb_idx().size());
+    owned[i] = rank()[first_loc_idx] == my_rank;
+    first_glb_idx[i] = glb_idx()[first_loc_idx];
+    owner_rank[i] = owned[i] ? my_rank : UNKNOWN;
   }
-  ghosts_hashed_deque.clear();
 
-  // (4)
-  std::vector< std::vector<boost::uint64_t> > recv_ghosts_hashed(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_gather(ghosts_hashed,recv_ghosts_hashed);
-  else
-    recv_ghosts_hashed[0] = ghosts_hashed;
+  if (parallel)
+    directory_lookup(elements_hashed, owned, first_glb_idx, owner_rank);
 
-  // (5) Search if this process contains the unknown ghosts of other processes
-  std::vector< std::vector<Uint> > send_glb_idx_on_rank(Comm::instance().size());
-  for (Uint p=0; p<Comm::instance().size(); ++p)
+  for (Uint g=0; g<elements.size(); ++g)
   {
-    send_glb_idx_on_rank[p].resize(recv_ghosts_hashed[p].size(),UNKNOWN);
-    if (p!=Comm::instance().rank())
-    {
-      for (Uint h=0; h<recv_ghosts_hashed[p].size(); ++h)
-      {
-        //          std::cout << PERank << "looking for hash " << recv_ghosts_hashed[p][h] << " for proc " << p ;
-        hash_to_elements_iter = hash_to_elements.find(recv_ghosts_hashed[p][h]);
-        if ( hash_to_elements_iter != hash_not_found )
-        {
-          //            std::cout << " ---> found " ;
-          const Space& entities_space = space(*hash_to_elements_iter->second.comp);
-          const Uint elem_idx = hash_to_elements_iter->second.idx;
-
-          if (rank()[entities_space.connectivity()[elem_idx][0]] == PE::Comm::instance().rank()) // if owned
-          {
-            cf3_assert_desc(to_str(hash_to_elements_iter->second.idx)+" < "+to_str(entities_space.connectivity().size()),
-                            hash_to_elements_iter->second.idx < entities_space.connectivity().size());
-            cf3_assert(entities_space.connectivity()[ elem_idx ][0] < glb_idx().size());
-            Uint first_glb_idx = glb_idx()[ entities_space.connectivity()[ elem_idx ][0] ];
-            send_glb_idx_on_rank[p][h] = first_glb_idx;
-          }
-        }
-        //          std::cout << std::endl;
-        //          else    // This check only works with 2 processes, as it MUST be found on the other process
-        //          {
-        //            std::cout << PERank << "hash["<<p<<"]["<<h<<"] = " << recv_ghosts_hashed[p][h] << " not found " << std::endl;
-        //            std::cout << "      possible hashes:" << std::endl;
-        //            for(hash_to_elem_idx_iter=hash_to_elem_idx.begin(); hash_to_elem_idx_iter!=hash_not_found; ++hash_to_elem_idx_iter)
-        //            {
-        //              std::cout << " -- " << hash_to_elem_idx_iter->first << std::endl;
-        //            }
-        //          }
-      }
-    }
-  }
+    if (owned[g])
+      continue;
 
-  // (6)
-  std::vector< std::vector<Uint> > recv_glb_idx_on_rank(Comm::instance().size());
-  if (Comm::instance().is_active())
-    Comm::instance().all_to_all(send_glb_idx_on_rank,recv_glb_idx_on_rank);
-  else
-    recv_glb_idx_on_rank[0] = send_glb_idx_on_rank[0];
-
-
-  for (Uint g=0; g<ghosts.size(); ++g)
-  {
-    const Space& entities_space = space(*ghosts[g].comp);
-    const Uint elem_idx = ghosts[g].idx;
+    const Space& entities_space = space(*elements[g].comp);
+    const Uint elem_idx = elements[g].idx;
     cf3_assert(elem_idx<entities_space.connectivity().size());
     cf3_assert(elem_idx<entities_space.support().rank().size());
 
-    // 2 cases:
-    // (1) rank = UNKNOWN
-    // ---> search for the non-UNKNOWN ghost index
-    // (2) rank = KNOWN
-    // ---> get the ghost idx from the known rank
-
     const Uint first_loc_idx = entities_space.connectivity()[elem_idx][0];
 
+    // The glb_idx must come from the rank that was found to own the ghost
     const Uint ghost_rank = rank()[first_loc_idx];
-    const Uint first_glb_idx = recv_glb_idx_on_rank[ ghost_rank ][g];
-
-    cf3_assert(ghost_rank < Comm::instance().size());
-    if (first_glb_idx == UNKNOWN)
-      throw ValueNotFound(FromHere(), "Could  not find ghost element "+entities_space.uri().path()+"["+to_str(elem_idx)+"] with hash "+to_str(ghosts_hashed[g])+" on rank "+to_str(ghost_rank));
+    cf3_assert(ghost_rank != UNKNOWN);
+    if (owner_rank[g] != ghost_rank)
+      throw ValueNotFound(FromHere(), "Could  not find ghost element "+entities_space.uri().path()+"["+to_str(elem_idx)+"] with hash "+to_str(elements_hashed[g])+" on rank "+to_str(ghost_rank));
     for (Uint s=0; s<entities_space.shape_function().nb_nodes(); ++s)
     {
       cf3_assert(first_loc_idx+s<glb_idx().size());
-      glb_idx()[first_loc_idx+s] = first_glb_idx+s;
+      glb_idx()[first_loc_idx+s] = first_glb_idx[g]+s;
       rank()[first_loc_idx+s] = ghost_rank;
     }
   }
@@ -0,0 +1,154 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "common/Builder.hpp"
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/PropertyList.hpp"
+#include "common/Signal.hpp"
+
+#include "common/XML/SignalOptions.hpp"
+
+#include "math/Consts.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ComponentBuilder< ElementColoring, Component, LibMesh > ElementColoring_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementColoring::ElementColoring ( const std::string& name ) :
+  Component(name),
+  m_valid(false)
+{
+  properties()["brief"] = std::string("Colouring of elements for conflict-free concurrent assembly");
+  m_color_starts.push_back(0);
+
+  Core::instance().event_handler().connect_to_event(Tags::event_mesh_changed(), this, &ElementColoring::on_mesh_changed_event);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementColoring::~ElementColoring()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementColoring::build(const Entities& entities)
+{
+  const Connectivity& connectivity = entities.geometry_space().connectivity();
+  const Uint nb_elems = connectivity.size();
+  const Uint nb_nodes = entities.geometry_fields().size();
+
+  m_elements.clear();
+  m_elements.reserve(nb_elems);
+  m_color_starts.assign(1, 0);
+
+  // Colour of the last element that was assigned to each node
+  std::vector<Uint> node_color(nb_nodes, math::Consts::uint_max());
+
+  std::vector<Uint> remaining(nb_elems);
+  for(Uint i = 0; i != nb_elems; ++i)
+    remaining[i] = i;
+  std::vector<Uint> next_remaining;
+  next_remaining.reserve(nb_elems);
+
+  // Each sweep takes all remaining elements that don't touch a node already used by the current colour
+  Uint color = 0;
+  while(!remaining.empty())
+  {
+    next_remaining.clear();
+    boost_foreach(const Uint elem, remaining)
+    {
+      const Connectivity::ConstRow row = connectivity[elem];
+      bool conflict = false;
+      boost_foreach(const Uint node, row)
+      {
+        if(node_color[node] == color)
+        {
+          conflict = true;
+          break;
+        }
+      }
+
+      if(conflict)
+      {
+        next_remaining.push_back(elem);
+        continue;
+      }
+
+      boost_foreach(const Uint node, row)
+      {
+        node_color[node] = color;
+      }
+      m_elements.push_back(elem);
+    }
+
+    m_color_starts.push_back(m_elements.size());
+    remaining.swap(next_remaining);
+    ++color;
+  }
+
+  properties()["nb_colors"] = nb_colors();
+  m_valid = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementColoring::on_mesh_changed_event(SignalArgs& args)
+{
+  Handle<Entities> entities(parent());
+  if(is_null(entities))
+    return;
+
+  XML::SignalOptions options(args);
+  const URI mesh_uri = options.value<URI>("mesh_uri");
+  if(mesh_uri != find_parent_component<Mesh>(*entities).uri())
+    return;
+
+  m_elements.clear();
+  m_color_starts.assign(1, 0);
+  m_valid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const ElementColoring& element_coloring(Entities& entities, const bool rebuild)
+{
+  Handle<ElementColoring> coloring(entities.get_child("element_coloring"));
+  if(is_null(coloring))
+  {
+    coloring = entities.create_component<ElementColoring>("element_coloring");
+    coloring->build(entities);
+  }
+  else if(rebuild || !coloring->is_valid() || coloring->nb_elements() != entities.size())
+  {
+    coloring->build(entities);
+  }
+
+  return *coloring;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,91 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementColoring_hpp
+#define cf3_mesh_ElementColoring_hpp
+
+#include "common/Component.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class Entities;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Splits the elements of an Entities component into colours, so that no two elements
+/// of the same colour share a node of the geometry connectivity.
+/// Elements of the same colour can then be processed concurrently, adding contributions to
+/// node-based data without any locking. Since each node receives at most one contribution per colour,
+/// the order of the additions for a given node only depends on the colouring and not on the threads used.
+/// The colouring is dropped when the mesh_changed event is raised for the parent mesh, since the connectivity may have changed.
+class Mesh_API ElementColoring : public common::Component
+{
+public:
+
+  /// Contructor
+  /// @param name of the component
+  ElementColoring ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ElementColoring();
+
+  /// Get the class name
+  static std::string type_name () { return "ElementColoring"; }
+
+  /// Compute the colouring, using a greedy algorithm on the geometry connectivity
+  void build(const Entities& entities);
+
+  /// Number of colours
+  Uint nb_colors() const { return m_color_starts.size() - 1; }
+
+  /// Number of elements that were coloured
+  Uint nb_elements() const { return m_elements.size(); }
+
+  /// Number of elements with the given colour
+  Uint color_size(const Uint color) const { return m_color_starts[color+1] - m_color_starts[color]; }
+
+  /// Index of the i-th element of the given colour
+  Uint element(const Uint color, const Uint i) const { return m_elements[m_color_starts[color]+i]; }
+
+  /// True if the colouring was built and the mesh did not change since
+  bool is_valid() const { return m_valid; }
+
+  /// Element indices, sorted by colour
+  const std::vector<Uint>& elements() const { return m_elements; }
+
+  /// Position of the first element of each colour in elements(), with an extra entry at the end
+  const std::vector<Uint>& color_starts() const { return m_color_starts; }
+
+private:
+  /// Drops the colouring if the parent mesh changed
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+  std::vector<Uint> m_elements;
+  std::vector<Uint> m_color_starts;
+  bool m_valid;
+}; // ElementColoring
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Get the colouring of the given entities. It is built and stored as a child of the entities on first use,
+/// and rebuilt automatically if the number of elements or the mesh changed.
+/// @param [in] entities  The entities to colour
+/// @param [in] rebuild   Force recomputing the colouring, e.g. after the connectivity was modified
+const ElementColoring& element_coloring(Entities& entities, const bool rebuild = false);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementColoring_hpp
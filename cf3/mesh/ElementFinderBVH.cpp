@@ -0,0 +1,101 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionT.hpp"
+#include "common/OptionComponent.hpp"
+
+#include "mesh/BoundingVolumeHierarchy.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/ElementFinderBVH.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+cf3::common::ComponentBuilder < ElementFinderBVH, ElementFinder, LibMesh > ElementFinderBVH_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementFinderBVH::ElementFinderBVH(const std::string &name) :
+  ElementFinder(name),
+  m_closest(true)
+{
+  options().option("dict").attach_trigger( boost::bind( &ElementFinderBVH::configure_tree, this ) );
+
+  options().add("find_closest",m_closest)
+    .description("If true, an inexact match is allowed, finding the element with the closest centroid")
+    .link_to(&m_closest);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementFinderBVH::configure_tree()
+{
+  Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(*m_dict);
+
+  if (is_null(mesh))
+    throw SetupError(FromHere(),"Mesh was not found as parent of "+m_dict->uri().string());
+
+  if (Handle<Component> found = mesh->get_child("bvh"))
+    m_tree = Handle<BoundingVolumeHierarchy>(found);
+  else
+  {
+    m_tree = mesh->create_component<BoundingVolumeHierarchy>("bvh");
+    m_tree->options().set("mesh",mesh);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementFinderBVH::find_element(const RealVector& target_coord, SpaceElem& element)
+{
+  cf3_assert(m_tree);
+
+  if (m_tree->is_created() == false)
+    m_tree->create_tree();
+
+  m_coord.resize(m_tree->dimension());
+  for (Uint d=0; d<m_coord.size(); ++d)
+    m_coord[d] = target_coord[d];
+
+  Entity found;
+  if (m_tree->find_element(m_coord,found))
+  {
+    element = SpaceElem(*const_cast<Space*>(&m_dict->space(*found.comp)),found.idx);
+    return true;
+  }
+
+  if (m_closest)
+  {
+    m_tree->find_nearest(m_coord,1u,m_nearest);
+    if (!m_nearest.empty())
+    {
+      element = SpaceElem(*const_cast<Space*>(&m_dict->space(*m_nearest[0].comp)),m_nearest[0].idx);
+      return true;
+    }
+  }
+
+  CFdebug << "coord " << m_coord.transpose() << " has not been found in the bounding volume hierarchy" << CFendl;
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
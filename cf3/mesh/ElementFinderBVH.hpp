@@ -0,0 +1,59 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementFinderBVH_hpp
+#define cf3_mesh_ElementFinderBVH_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/ElementFinder.hpp"
+#include "mesh/Entities.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class BoundingVolumeHierarchy;
+
+/// @brief Find elements using a bounding volume hierarchy
+class Mesh_API ElementFinderBVH : public ElementFinder
+{
+public:
+
+  /// @brief type name
+  static std::string type_name() {return "ElementFinderBVH"; }
+
+  /// @brief Constructor
+  ElementFinderBVH(const std::string& name);
+
+  virtual bool find_element(const RealVector& target_coord, SpaceElem& element);
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+
+  void configure_tree();
+
+private:
+
+  Handle<BoundingVolumeHierarchy> m_tree;
+  bool m_closest;
+
+  std::vector<Entity> m_nearest;
+
+  RealVector m_coord;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementFinderBVH_hpp
@@ -4,6 +4,8 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+
 #include "common/Log.hpp"
 #include "common/OptionList.hpp"
 #include "common/OptionT.hpp"
@@ -17,6 +19,7 @@
 #include "math/Consts.hpp"
 
 #include "mesh/FaceCellConnectivity.hpp"
+#include "mesh/FaceNodeMap.hpp"
 #include "mesh/NodeElementConnectivity.hpp"
 #include "mesh/Dictionary.hpp"
 #include "mesh/Mesh.hpp"
@@ -35,6 +38,33 @@ namespace mesh {
 
 using namespace common;
 
+namespace detail
+{
+  /// Nodes of the faces of all elements, where face number f of element e has index e*nb_faces+f
+  struct ElementFaceNodes
+  {
+    ElementFaceNodes(const Elements& elements) :
+      connectivity(elements.geometry_space().connectivity()),
+      element_type(elements.element_type()),
+      nb_faces(elements.element_type().nb_faces())
+    {
+    }
+
+    Uint operator()(const Uint face, Uint* nodes) const
+    {
+      Connectivity::ConstRow elem_nodes = connectivity[face / nb_faces];
+      Uint i(0);
+      boost_foreach(const Uint face_node_idx, element_type.faces().nodes_range(face % nb_faces))
+        nodes[i++] = elem_nodes[face_node_idx];
+      return i;
+    }
+
+    const Connectivity& connectivity;
+    const ElementType& element_type;
+    const Uint nb_faces;
+  };
+}
+
 common::ComponentBuilder < FaceCellConnectivity , Component, LibMesh > FaceCellConnectivity_Builder;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -125,9 +155,6 @@ void FaceCellConnectivity::build_connectivity()
   common::Table<Uint>::Buffer cell_rotation = m_cell_rotation->create_buffer();
   common::Table<bool>::Buffer cell_orientation = m_cell_orientation->create_buffer();
 
-  Dictionary& geometry_fields = find_parent_component<Mesh>(*used()[0]).geometry_fields();
-  Uint tot_nb_nodes = geometry_fields.size();
-  std::vector < std::vector<Uint> > mapNodeFace(tot_nb_nodes);
   std::vector<Uint> face_nodes;  face_nodes.reserve(100);
   std::vector<Entity> dummy_element_row(2);
   std::vector<Uint> tmp_row(2);
@@ -165,18 +192,24 @@ void FaceCellConnectivity::build_connectivity()
     }
   }
 
-  // Declarations to save frequent allocations in the loop algorithm
+  // Faces are matched by their sorted nodes in a hash table. The keys are computed in parallel,
+  // in blocks of elements to bound the memory they take.
+  Uint max_nb_face_nodes = 1;
+  boost_foreach (Handle< Component > elements_comp, used() )
+  {
+    const ElementType& element_type = dynamic_cast<Elements&>(*elements_comp).element_type();
+    for (Uint face_idx=0; face_idx!=element_type.nb_faces(); ++face_idx)
+      max_nb_face_nodes = std::max(max_nb_face_nodes, element_type.face_type(face_idx).nb_nodes());
+  }
+  FaceNodeMap face_map(max_nb_face_nodes);
+  face_map.reserve(max_nb_faces/2+1);
+  std::vector<Uint> keys;
+  std::vector<std::size_t> hashes;
+  const Uint block_size = 65536;
+
   Uint nb_inner_faces = 0;
-  Uint nb_matched_nodes = 1;
-  Uint face_node_idx;
-  Uint face_node;
   Uint face;
-  Uint connected_face;
-  Uint node;
   Uint nb_nodes;
-  bool found_face = false;
-  Handle< Component > elem_location_comp;
-  Uint elem_location_idx;
 
   // loop over the element types
   m_nb_faces=0;
@@ -184,6 +217,7 @@ void FaceCellConnectivity::build_connectivity()
   {
     Elements& elements = dynamic_cast<Elements&>(*elements_comp);
     const Uint nb_faces_in_elem = elements.element_type().nb_faces();
+    const detail::ElementFaceNodes element_face_nodes(elements);
 
     Handle< common::List<bool> > is_bdry_elem;
 
@@ -191,133 +225,86 @@ void FaceCellConnectivity::build_connectivity()
       is_bdry_elem = Handle< common::List<bool> >(elements.get_child("is_bdry"));
 
     // loop over the elements of this type
-    Uint loc_elem_idx=0;
-    boost_foreach(Connectivity::ConstRow elem_nodes, elements.geometry_space().connectivity().array() )
+    const Uint nb_elems = elements.size();
+    for (Uint block_begin=0; block_begin<nb_elems; block_begin+=block_size)
     {
-      if ( is_not_null(is_bdry_elem) )
-        if ( (*is_bdry_elem)[loc_elem_idx] == false )
-          continue;
-
-      Entity element(elements,loc_elem_idx);
+      const Uint block_end = std::min(nb_elems, block_begin+block_size);
+      face_map.make_keys(element_face_nodes, block_begin*nb_faces_in_elem, block_end*nb_faces_in_elem, keys, hashes);
 
-      // loop over the faces in the current element
-      for (Uint face_idx = 0; face_idx != nb_faces_in_elem; ++face_idx)
+      for (Uint loc_elem_idx=block_begin; loc_elem_idx!=block_end; ++loc_elem_idx)
       {
-        // construct sets of nodes that make the corresponding face in this element
-        nb_nodes = elements.element_type().face_type(face_idx).nb_nodes();
-        face_nodes.resize(nb_nodes);
-
-        Uint i(0);
-        boost_foreach(const Uint face_node_idx, elements.element_type().faces().nodes_range(face_idx))
-            face_nodes[i++] = elem_nodes[face_node_idx];
+        if ( is_not_null(is_bdry_elem) )
+          if ( (*is_bdry_elem)[loc_elem_idx] == false )
+            continue;
 
+        Entity element(elements,loc_elem_idx);
 
-        // consider the first node belonging to the current face
-        // check if you find a face ID shared between all the other
-        // nodes building a face
-        node = face_nodes[0];
-        cf3_assert(node<tot_nb_nodes);
-
-        found_face = false;
-        // search for matching face if they are registered to the node yet
-        boost_foreach( face, mapNodeFace[node] )
+        // loop over the faces in the current element
+        for (Uint face_idx = 0; face_idx != nb_faces_in_elem; ++face_idx)
         {
-          nb_matched_nodes = 1;
-          if (nb_nodes > 1)
+          const Uint key_idx = (loc_elem_idx-block_begin)*nb_faces_in_elem + face_idx;
+          face = face_map.insert(&keys[key_idx*face_map.stride()], hashes[key_idx], m_nb_faces);
+
+          if (face != FaceNodeMap::not_found())
           {
-            for (face_node_idx=1; face_node_idx!=nb_nodes; ++face_node_idx)
+            // the corresponding face already exists, meaning
+            // that the face is an internal one, shared by two elements
+            // here you set the second element (==state) neighbor of the face
+            f2c.get_row(face)[1]=element;
+            face_number.get_row(face)[1]=face_idx;
+            // since it has two neighbor cells,
+            // this face is surely NOT a boundary face
+            is_bdry_face.get_row(face)=false;
+
+            face_nodes.resize(max_nb_face_nodes);
+            nb_nodes = element_face_nodes(loc_elem_idx*nb_faces_in_elem+face_idx, &face_nodes[0]);
+            if (nb_nodes > 1)
             {
-              boost_foreach (connected_face, mapNodeFace[face_nodes[face_node_idx]])
+              // First node in first face element:
+              Uint first_node_loc_idx = f2c.get_row(face)[0].get_nodes()[
+                                          f2c.get_row(face)[0].element_type().faces().nodes_range(
+                                            face_number.get_row(face)[0])[0]
+                                        ];
+
+              // Find orientation ( or find match between first face-nodes of both neighbouring elements )
+              Uint rotation;
+              for (rotation=0; rotation<nb_nodes; ++rotation)
               {
-                if (connected_face == face)
+                if (face_nodes[rotation] == first_node_loc_idx)
                 {
-                  ++nb_matched_nodes;
+                  cell_rotation.get_row(face)[1]=rotation;
                   break;
                 }
               }
-
-
-              if (nb_matched_nodes == nb_nodes) // face matches the nodes
-              {
-                // the corresponding face already exists, meaning
-                // that the face is an internal one, shared by two elements
-                // here you set the second element (==state) neighbor of the face
-                found_face = true;
-                f2c.get_row(face)[1]=element;
-                face_number.get_row(face)[1]=face_idx;
-                // since it has two neighbor cells,
-                // this face is surely NOT a boundary face
-                is_bdry_face.get_row(face)=false;
-
-                // First node in first face element:
-                Uint first_node_loc_idx = f2c.get_row(face)[0].get_nodes()[
-                                            f2c.get_row(face)[0].element_type().faces().nodes_range(
-                                              face_number.get_row(face)[0])[0]
-                                          ];
-
-                // Find orientation ( or find match between first face-nodes of both neighbouring elements )
-                Uint rotation;
-                for (rotation=0; rotation<=nb_nodes; ++rotation)
-                {
-                  if (face_nodes[rotation] == first_node_loc_idx)
-                  {
-                    cell_rotation.get_row(face)[1]=rotation;
-                    break;
-                  }
-                }
-                // Following assertion fails, it means the correct orientation was not found! This should never happen!
-                cf3_always_assert(rotation != nb_nodes);
-
-                // increment number of inner faces (they always have 2 states)
-                ++nb_inner_faces;
-                break;
-              }
+              // Following assertion fails, it means the correct orientation was not found! This should never happen!
+              cf3_always_assert(rotation != nb_nodes);
             }
-          }
-          else // this only applies to the 1D case
-          {
-            // the corresponding faceID already exists, meaning
-            // that the face is an internal one, shared by two elements
-            // here you set the second element (==state) neighbor of the face
-            found_face = true;
-            //(*elem_to_face)[elemID][iFace] = currFaceID;
-            f2c.get_row(face)[1]=element;
-            face_number.get_row(face)[1]=face_idx;
-            is_bdry_face.get_row(face)=false;
 
             // increment number of inner faces (they always have 2 states)
             ++nb_inner_faces;
-            break;
           }
-        }
-        if (found_face == false)
-        {
-          // a new face has been found
-          // add the ID of the new face in the corresponding nodes
-          // referencing it
-          boost_foreach (face_node, face_nodes)
+          else
           {
-            mapNodeFace[face_node].push_back(m_nb_faces);
+            // a new face has been found
+
+            // increment the number of faces
+            dummy_element_row[0]=element;
+            f2c.add_row(dummy_element_row);
+
+            tmp_row[0]=face_idx;
+            face_number.add_row(tmp_row);
+            tmp_row[0] = MATCHED;
+            tmp_row[1] = INVERTED;
+            cell_orientation.add_row(tmp_row);
+            tmp_row[0] = 0;
+            tmp_row[1] = 0;
+            cell_rotation.add_row(tmp_row);
+            is_bdry_face.add_row(true);
+            ++m_nb_faces;
           }
-
-          // increment the number of faces
-          dummy_element_row[0]=element;
-          f2c.add_row(dummy_element_row);
-
-          tmp_row[0]=face_idx;
-          face_number.add_row(tmp_row);
-          tmp_row[0] = MATCHED;
-          tmp_row[1] = INVERTED;
-          cell_orientation.add_row(tmp_row);
-          tmp_row[0] = 0;
-          tmp_row[1] = 0;
-          cell_rotation.add_row(tmp_row);
-          is_bdry_face.add_row(true);
-          ++m_nb_faces;
         }
-      }
-      ++loc_elem_idx;
-    } // end foreach element
+      } // end foreach element
+    } // end foreach block
   } // end foreach elements component
 
   f2c.flush();
@@ -0,0 +1,131 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+
+#include "mesh/FaceNodeMap.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+FaceNodeMap::FaceNodeMap(const Uint max_nb_nodes) :
+  m_stride(std::max(max_nb_nodes, Uint(1)))
+{
+  rehash(16);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FaceNodeMap::reserve(const Uint nb_faces)
+{
+  m_keys.reserve(nb_faces*m_stride);
+  m_hashes.reserve(nb_faces);
+  m_values.reserve(nb_faces);
+  if (2*nb_faces > m_slots.size())
+  {
+    Uint nb_slots = m_slots.size();
+    while (nb_slots < 2*nb_faces)
+      nb_slots *= 2;
+    rehash(nb_slots);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FaceNodeMap::make_key(const Uint* nodes, const Uint nb_nodes, Uint* key) const
+{
+  cf3_assert(nb_nodes <= m_stride);
+
+  // Insertion sort, faces have few nodes
+  for (Uint i=0; i!=nb_nodes; ++i)
+  {
+    Uint j = i;
+    for ( ; j!=0 && key[j-1] > nodes[i]; --j)
+      key[j] = key[j-1];
+    key[j] = nodes[i];
+  }
+  for (Uint i=nb_nodes; i!=m_stride; ++i)
+    key[i] = not_found();
+
+  boost::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (Uint i=0; i!=m_stride; ++i)
+  {
+    hash ^= static_cast<boost::uint64_t>(key[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return static_cast<std::size_t>(hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint FaceNodeMap::find_slot(const Uint* key, const std::size_t hash) const
+{
+  const Uint mask = m_slots.size()-1;
+  for (Uint slot = hash & mask; ; slot = (slot+1) & mask)
+  {
+    const Uint face = m_slots[slot];
+    if (face == not_found())
+      return slot;
+    if (m_hashes[face] == hash && std::equal(key, key+m_stride, m_keys.begin()+face*m_stride))
+      return slot;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint FaceNodeMap::insert(const Uint* key, const std::size_t hash, const Uint value)
+{
+  // Keep the load factor below one half
+  if (2*(m_values.size()+1) > m_slots.size())
+    rehash(2*m_slots.size());
+
+  const Uint slot = find_slot(key, hash);
+  if (m_slots[slot] != not_found())
+    return m_values[m_slots[slot]];
+
+  m_slots[slot] = m_values.size();
+  m_keys.insert(m_keys.end(), key, key+m_stride);
+  m_hashes.push_back(hash);
+  m_values.push_back(value);
+  return not_found();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint FaceNodeMap::find(const Uint* key, const std::size_t hash) const
+{
+  const Uint face = m_slots[find_slot(key, hash)];
+  return face == not_found() ? not_found() : m_values[face];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FaceNodeMap::rehash(const Uint nb_slots)
+{
+  m_slots.assign(nb_slots, not_found());
+  const Uint mask = nb_slots-1;
+  for (Uint face=0; face!=m_values.size(); ++face)
+  {
+    Uint slot = m_hashes[face] & mask;
+    while (m_slots[slot] != not_found())
+      slot = (slot+1) & mask;
+    m_slots[slot] = face;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,142 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_FaceNodeMap_hpp
+#define cf3_mesh_FaceNodeMap_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <limits>
+#include <vector>
+
+#include "common/Assertions.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Hash table from the nodes of a face, in any order, to a Uint value such as a face index.
+/// The key of a face is its sorted node list, padded to a fixed stride, so faces with the same nodes
+/// match regardless of their orientation and rotation. Keys and values are stored in flat arrays with
+/// open addressing, so building the table for n faces takes O(n) time and a few allocations.
+/// The keys can be computed in parallel with make_keys, while insert and find are sequential.
+class Mesh_API FaceNodeMap
+{
+public:
+  /// Returned by insert and find if no face has the key
+  static Uint not_found() { return std::numeric_limits<Uint>::max(); }
+
+  /// @param [in] max_nb_nodes  the largest number of nodes of the faces that will be stored
+  FaceNodeMap(const Uint max_nb_nodes);
+
+  /// Number of values in each key
+  Uint stride() const { return m_stride; }
+
+  /// Number of stored faces
+  Uint size() const { return m_values.size(); }
+
+  /// Make room for nb_faces faces
+  void reserve(const Uint nb_faces);
+
+  /// Compute the key of a face, sorting its nodes into key, which must have room for stride() values.
+  /// Thread safe.
+  /// @return the hash of the key
+  std::size_t make_key(const Uint* nodes, const Uint nb_nodes, Uint* key) const;
+
+  /// Compute the keys and hashes of the faces [begin,end) in parallel, using the ThreadPool.
+  /// FaceNodesT must provide Uint operator()(const Uint face, Uint* nodes) const, which writes
+  /// the nodes of a face and returns their number, at most stride().
+  template<typename FaceNodesT>
+  void make_keys(const FaceNodesT& face_nodes, const Uint begin, const Uint end, std::vector<Uint>& keys, std::vector<std::size_t>& hashes) const;
+
+  /// Insert a face, unless a face with the same key is already stored
+  /// @return the value of the stored face with the same key, or not_found() if the face was inserted
+  Uint insert(const Uint* key, const std::size_t hash, const Uint value);
+
+  /// @return the value of the face with the given key, or not_found()
+  Uint find(const Uint* key, const std::size_t hash) const;
+
+private:
+  /// Slot of the key: either the slot that holds it, or the empty slot where it belongs
+  Uint find_slot(const Uint* key, const std::size_t hash) const;
+
+  void rehash(const Uint nb_slots);
+
+  template<typename FaceNodesT>
+  struct MakeKeysTask
+  {
+    void operator()(const Uint thread_idx) const
+    {
+      Uint part_begin, part_end;
+      common::split_range(end-begin, nb_parts, thread_idx, part_begin, part_end);
+      std::vector<Uint> nodes(map->stride());
+      for (Uint i=part_begin; i!=part_end; ++i)
+      {
+        const Uint nb_nodes = (*face_nodes)(begin+i, &nodes[0]);
+        cf3_assert(nb_nodes <= map->stride());
+        hashes[i] = map->make_key(&nodes[0], nb_nodes, keys + i*map->stride());
+      }
+    }
+
+    const FaceNodeMap* map;
+    const FaceNodesT* face_nodes;
+    Uint begin;
+    Uint end;
+    Uint nb_parts;
+    Uint* keys;
+    std::size_t* hashes;
+  };
+
+  Uint m_stride;
+
+  /// Keys of the stored faces, stride() values per face
+  std::vector<Uint> m_keys;
+  /// Hash and value of the stored faces
+  std::vector<std::size_t> m_hashes;
+  std::vector<Uint> m_values;
+  /// Open addressing table with linear probing. Holds the index of a stored face, or not_found()
+  std::vector<Uint> m_slots;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename FaceNodesT>
+void FaceNodeMap::make_keys(const FaceNodesT& face_nodes, const Uint begin, const Uint end, std::vector<Uint>& keys, std::vector<std::size_t>& hashes) const
+{
+  cf3_assert(begin <= end);
+  keys.resize((end-begin)*m_stride);
+  hashes.resize(end-begin);
+  if (begin == end)
+    return;
+
+  MakeKeysTask<FaceNodesT> task;
+  task.map = this;
+  task.face_nodes = &face_nodes;
+  task.begin = begin;
+  task.end = end;
+  task.nb_parts = common::ThreadPool::instance().in_parallel_region() ? 1u : common::ThreadPool::instance().nb_threads();
+  task.keys = &keys[0];
+  task.hashes = &hashes[0];
+  if (task.nb_parts == 1)
+    task(0);
+  else
+    common::ThreadPool::instance().run(task);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_FaceNodeMap_hpp
@@ -4,6 +4,8 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+
 #include <boost/date_time/gregorian/gregorian.hpp>
 
 #include "common/Signal.hpp"
@@ -38,7 +40,7 @@ common::ComponentBuilder < Field, Component, LibMesh >  Field_Builder;
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 Field::Field ( const std::string& name  ) :
-  common::Table<Real> ( name ), m_var_type(ARRAY)
+  common::Table<Real> ( name ), m_var_type(ARRAY), m_modified(true)
 {
   mark_basic();
   properties()["date"] = boost::gregorian::to_iso_extended_string(boost::gregorian::day_clock::local_day());
@@ -165,6 +167,23 @@ void Field::synchronize()
   {
     CFdebug << "Synchronizing field " << uri().path() << CFendl;
     m_comm_pattern->synchronize( name() );
+    m_modified = false;
+  }
+  else
+  {
+    CFdebug << "Not synchronizing field " << uri().path() << " due to null comm pattern" << CFendl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Field::begin_synchronize()
+{
+  if ( is_not_null(m_comm_pattern) )
+  {
+    CFdebug << "Starting synchronization of field " << uri().path() << CFendl;
+    m_comm_pattern->begin_synchronize( name() );
+    m_modified = false;
   }
   else
   {
@@ -172,6 +191,73 @@ void Field::synchronize()
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+void Field::end_synchronize()
+{
+  if ( is_synchronizing() )
+    m_comm_pattern->end_synchronize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Field::is_synchronizing() const
+{
+  return is_not_null(m_comm_pattern) && m_comm_pattern->is_synchronizing();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Field::synchronize_fields(const std::vector< Handle<Field> >& fields, const bool only_modified)
+{
+  const Uint nb_fields = fields.size();
+
+  // All ranks must agree on the fields that take part in the exchange
+  std::vector<Uint> modified(nb_fields, 1u);
+  if(only_modified && nb_fields != 0)
+  {
+    for(Uint i = 0; i != nb_fields; ++i)
+      modified[i] = (is_not_null(fields[i]) && fields[i]->m_modified) ? 1u : 0u;
+    if(PE::Comm::instance().is_active())
+      PE::Comm::instance().all_reduce(PE::max(), std::vector<Uint>(modified), modified);
+  }
+
+  // Group the fields per comm pattern, keeping the order in which the patterns first appear
+  std::vector< Handle<CommPattern> > comm_patterns;
+  std::vector< std::vector< Handle<PE::CommWrapper const> > > wrappers;
+  for(Uint i = 0; i != nb_fields; ++i)
+  {
+    if(is_null(fields[i]) || modified[i] == 0u)
+      continue;
+
+    Field& field = *fields[i];
+    field.m_modified = false;
+    if(is_null(field.m_comm_pattern))
+    {
+      CFdebug << "Not synchronizing field " << field.uri().path() << " due to null comm pattern" << CFendl;
+      continue;
+    }
+
+    const Uint pattern_idx = std::find(comm_patterns.begin(), comm_patterns.end(), field.m_comm_pattern) - comm_patterns.begin();
+    if(pattern_idx == comm_patterns.size())
+    {
+      comm_patterns.push_back(field.m_comm_pattern);
+      wrappers.push_back(std::vector< Handle<PE::CommWrapper const> >());
+    }
+    wrappers[pattern_idx].push_back(Handle<PE::CommWrapper const>(field.m_comm_pattern->get_child(field.name())));
+  }
+
+  for(Uint i = 0; i != comm_patterns.size(); ++i)
+  {
+    CFdebug << "Synchronizing " << wrappers[i].size() << " fields using " << comm_patterns[i]->uri().path() << CFendl;
+    comm_patterns[i]->begin_synchronize(wrappers[i]);
+  }
+  for(Uint i = 0; i != comm_patterns.size(); ++i)
+  {
+    comm_patterns[i]->end_synchronize();
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 void Field::set_descriptor(math::VariablesDescriptor& descriptor)
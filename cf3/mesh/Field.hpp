@@ -124,6 +124,29 @@ public: // functions
 
   void synchronize();
 
+  /// Start a non-blocking synchronization of the ghost values.
+  /// The ghost values may only be used after end_synchronize, and the comm pattern of the
+  /// dictionary can not start another exchange in the meantime.
+  void begin_synchronize();
+
+  /// Complete the exchange started by begin_synchronize. Does nothing if no exchange is in progress.
+  void end_synchronize();
+
+  /// True if an exchange started by begin_synchronize on the comm pattern of this field is not completed
+  bool is_synchronizing() const;
+
+  /// Flag the field as modified since its last synchronization
+  void mark_modified() { m_modified = true; }
+
+  /// True if the field was marked as modified since its last synchronization. New fields count as modified.
+  bool is_modified() const { return m_modified; }
+
+  /// Synchronize a set of fields, packing all fields that share a comm pattern into a single message per neighbouring rank.
+  /// This is collective: all ranks must pass the same fields in the same order.
+  /// @param fields The fields to synchronize. Null handles and fields without comm pattern are skipped.
+  /// @param only_modified Skip the fields that are not marked as modified on any rank
+  static void synchronize_fields(const std::vector< Handle<Field> >& fields, const bool only_modified = false);
+
   math::VariablesDescriptor& descriptor() const { return *m_descriptor; }
 
   void set_descriptor(math::VariablesDescriptor& descriptor);
@@ -326,6 +349,9 @@ private:
   Handle< math::VariablesDescriptor > m_descriptor;
 
   VarType m_var_type;
+
+  /// True if the field was modified since the last synchronization
+  bool m_modified;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////
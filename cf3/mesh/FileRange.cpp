@@ -0,0 +1,186 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+
+#include "mesh/FileRange.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+  /// Offset of the first line that starts at or after pos
+  FileRange::OffsetT next_line_start(boost::filesystem::ifstream& file, const FileRange::OffsetT pos, const FileRange::OffsetT file_size)
+  {
+    if(pos == 0 || pos >= file_size)
+      return std::min(pos, file_size);
+
+    // A line starts at pos if the previous character ends a line
+    file.seekg(static_cast<std::streamoff>(pos-1), std::ios::beg);
+    char buffer[4096];
+    FileRange::OffsetT buffer_begin = pos-1;
+    while(buffer_begin < file_size)
+    {
+      const FileRange::OffsetT nb_read = std::min(static_cast<FileRange::OffsetT>(sizeof(buffer)), file_size - buffer_begin);
+      file.read(buffer, static_cast<std::streamsize>(nb_read));
+      const char* newline = std::find(buffer, buffer + nb_read, '\n');
+      if(newline != buffer + nb_read)
+        return buffer_begin + (newline - buffer) + 1;
+      buffer_begin += nb_read;
+    }
+    return file_size;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FileRange::FileRange(const boost::filesystem::path& path, const Uint part, const Uint nb_parts) :
+  m_path(path),
+  m_file_size(boost::filesystem::file_size(path)),
+  m_begin(0),
+  m_size(0)
+{
+  cf3_assert(part < nb_parts);
+
+  boost::filesystem::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  if(!file)
+    throw common::FileSystemError(FromHere(), "Could not open file " + path.string());
+
+  // Both neighbours compute the same line start for their common boundary
+  const OffsetT begin = detail::next_line_start(file, m_file_size * part / nb_parts, m_file_size);
+  const OffsetT end = detail::next_line_start(file, m_file_size * (part+1) / nb_parts, m_file_size);
+
+  m_begin = begin;
+  m_data.push_back('\0');
+  if(end > begin)
+    read(begin, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool FileRange::extend(const OffsetT nb_bytes)
+{
+  if(end() >= m_file_size)
+    return false;
+
+  boost::filesystem::ifstream file(m_path, std::ios_base::in | std::ios_base::binary);
+  const OffsetT to = detail::next_line_start(file, std::min(end() + std::max(nb_bytes, OffsetT(1)), m_file_size), m_file_size);
+  read(end(), to);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FileRange::read(const OffsetT from, const OffsetT to)
+{
+  cf3_assert(from == end());
+  cf3_assert(to >= from);
+
+  boost::filesystem::ifstream file(m_path, std::ios_base::in | std::ios_base::binary);
+  file.seekg(static_cast<std::streamoff>(from), std::ios::beg);
+
+  // Overwrite the terminating null character
+  m_data.resize(m_size + (to - from) + 1);
+  file.read(&m_data[m_size], static_cast<std::streamsize>(to - from));
+  if(static_cast<OffsetT>(file.gcount()) != to - from)
+    throw common::FileSystemError(FromHere(), "Could not read bytes " + common::to_str(from) + " to " + common::to_str(to) + " of file " + m_path.string());
+  m_size += to - from;
+  m_data[m_size] = '\0';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FileRange::find_lines(const std::vector<std::string>& keywords, std::vector< std::vector<OffsetT> >& offsets) const
+{
+  offsets.assign(keywords.size(), std::vector<OffsetT>());
+
+  const char* data_end = &m_data[m_size];
+  for(const char* line = &m_data[0]; line < data_end; )
+  {
+    const char* line_end = std::find(line, data_end, '\n');
+
+    const char* first = line;
+    while(first != line_end && (*first == ' ' || *first == '\t'))
+      ++first;
+    const bool is_numeric = first != line_end && ((*first >= '0' && *first <= '9') || *first == '-' || *first == '+' || *first == '.');
+
+    if(!is_numeric)
+    {
+      const std::string text(line, line_end);
+      for(Uint i = 0; i != keywords.size(); ++i)
+      {
+        if(text.find(keywords[i]) != std::string::npos)
+          offsets[i].push_back(offset(line));
+      }
+    }
+
+    line = line_end == data_end ? data_end : line_end + 1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool TextScanner::read(Real& value)
+{
+  skip_whitespace();
+  char* end;
+  const Real result = std::strtod(m_pos, &end);
+  if(end == m_pos)
+    return false;
+  m_pos = end;
+  value = result;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void find_lines(const FileRange& range, const std::vector<std::string>& keywords, std::vector< std::vector<FileRange::OffsetT> >& offsets)
+{
+  range.find_lines(keywords, offsets);
+
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  if(!comm.is_active())
+    return;
+
+  // Pairs of keyword index and offset
+  std::vector<FileRange::OffsetT> send;
+  for(Uint i = 0; i != keywords.size(); ++i)
+  {
+    for(Uint j = 0; j != offsets[i].size(); ++j)
+    {
+      send.push_back(i);
+      send.push_back(offsets[i][j]);
+    }
+  }
+
+  std::vector< std::vector<FileRange::OffsetT> > recv;
+  comm.all_gather(send, recv);
+
+  // The ranges are in file order, so the offsets stay sorted
+  offsets.assign(keywords.size(), std::vector<FileRange::OffsetT>());
+  for(Uint rank = 0; rank != recv.size(); ++rank)
+  {
+    for(Uint j = 0; j < recv[rank].size(); j += 2)
+      offsets[recv[rank][j]].push_back(recv[rank][j+1]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
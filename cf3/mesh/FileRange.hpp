@@ -0,0 +1,164 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_FileRange_hpp
+#define cf3_mesh_FileRange_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Part of a text file, read in one go by one process. The file is split in nb_parts byte ranges of equal size,
+/// and each line belongs to the range in which it starts, so every line of the file is in exactly one part.
+/// Mesh readers use this to let every process parse only its own share of a large file.
+class Mesh_API FileRange
+{
+public:
+  /// File offset type, since mesh files can be larger than 4 GB
+  typedef boost::uint64_t OffsetT;
+
+  /// Read the lines that start in the byte range of part out of nb_parts
+  FileRange(const boost::filesystem::path& path, const Uint part, const Uint nb_parts);
+
+  /// File offset of the first line
+  OffsetT begin() const { return m_begin; }
+
+  /// File offset past the last line
+  OffsetT end() const { return m_begin + m_size; }
+
+  /// Size of the whole file
+  OffsetT file_size() const { return m_file_size; }
+
+  /// Pointer to the data at the given file offset, which must be in [begin(), end()].
+  /// The data past end() is always terminated by a null character.
+  const char* data(const OffsetT offset) const { return &m_data[offset - m_begin]; }
+
+  /// File offset of a pointer returned by data()
+  OffsetT offset(const char* ptr) const { return m_begin + (ptr - &m_data[0]); }
+
+  /// Read more of the file past end(), for records that continue after the last line of the range.
+  /// At least nb_bytes are added, up to the next end of line, unless the end of the file is reached.
+  /// Pointers returned by data() before the call are invalidated, offsets stay valid.
+  /// @return false if there was nothing left to read
+  bool extend(const OffsetT nb_bytes);
+
+  /// Offsets of the lines that contain one of the keywords, for each keyword. Lines that start with a number are skipped,
+  /// since keywords mark sections and the data lines of large sections are numeric.
+  void find_lines(const std::vector<std::string>& keywords, std::vector< std::vector<OffsetT> >& offsets) const;
+
+private:
+  /// Read [from, to) from the file into the buffer, past the current data
+  void read(const OffsetT from, const OffsetT to);
+
+  boost::filesystem::path m_path;
+  OffsetT m_file_size;
+  OffsetT m_begin;
+  OffsetT m_size;
+  /// Data of the range, followed by a null character
+  std::vector<char> m_data;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Fast scanner for whitespace separated numbers, without the locale and stream state overhead of iostreams
+class Mesh_API TextScanner
+{
+public:
+  /// Scan the null terminated data starting at begin
+  TextScanner(const char* begin) : m_pos(begin) {}
+
+  const char* position() const { return m_pos; }
+
+  void seek(const char* pos) { m_pos = pos; }
+
+  /// Skip spaces and line ends, and parse an unsigned integer
+  /// @return false if there was no number
+  bool read(Uint& value)
+  {
+    skip_whitespace();
+    if(*m_pos == '+')
+      ++m_pos;
+    if(*m_pos < '0' || *m_pos > '9')
+      return false;
+    Uint result = 0;
+    for( ; *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+      result = 10*result + static_cast<Uint>(*m_pos - '0');
+    value = result;
+    return true;
+  }
+
+  /// Skip spaces and line ends, and parse a real number
+  /// @return false if there was no number
+  bool read(Real& value);
+
+  /// Move past the next line end
+  void skip_line()
+  {
+    while(*m_pos != '\0' && *m_pos != '\n')
+      ++m_pos;
+    if(*m_pos == '\n')
+      ++m_pos;
+  }
+
+  /// Skip the next word
+  void skip_token()
+  {
+    skip_whitespace();
+    while(*m_pos != '\0' && !is_space(*m_pos))
+      ++m_pos;
+  }
+
+  /// Skip spaces and line ends
+  void skip_whitespace()
+  {
+    while(is_space(*m_pos))
+      ++m_pos;
+  }
+
+private:
+  static bool is_space(const char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+  const char* m_pos;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Offsets of the lines that contain the keywords in the whole file, gathered from the FileRange of every process. Collective.
+Mesh_API void find_lines(const FileRange& range, const std::vector<std::string>& keywords, std::vector< std::vector<FileRange::OffsetT> >& offsets);
+
+/// Personalised all to all exchange of items read by FileRange, which also works in a serial run without MPI. Collective.
+template<typename T>
+void exchange_parts(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& recv)
+{
+  if(common::PE::Comm::instance().is_active())
+    common::PE::Comm::instance().all_to_all(send, recv);
+  else
+    recv = send;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_FileRange_hpp
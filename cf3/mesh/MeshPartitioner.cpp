@@ -6,6 +6,7 @@
 
 #include <set>
 
+#include "common/EventHandler.hpp"
 #include "common/Foreach.hpp"
 #include "common/Log.hpp"
 #include "common/Signal.hpp"
@@ -66,6 +67,7 @@ MeshPartitioner::MeshPartitioner ( const std::string& name ) :
 void MeshPartitioner::execute()
 {
   Mesh& mesh = *m_mesh;
+  TreeUpdateBatch tree_update_batch(mesh);
   initialize(mesh);
   Comm::instance().barrier();
   CFdebug << "    -partitioning" << CFendl;
@@ -74,6 +76,7 @@ void MeshPartitioner::execute()
   Comm::instance().barrier();
   CFdebug << "    -migrating" << CFendl;
   migrate();
+  tree_update_batch.commit();
 }
 
 //////////////////////////////////////////////////////////////////////////////
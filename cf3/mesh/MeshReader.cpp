@@ -14,6 +14,7 @@
 #include "common/OptionArray.hpp"
 #include "common/OptionURI.hpp"
 #include "common/FindComponents.hpp"
+#include "common/Profiler.hpp"
 
 
 #include "common/PE/Comm.hpp"
@@ -82,8 +83,14 @@ void MeshReader::execute()
   if (is_null(m_mesh))
     throw SetupError(FromHere(), "Mesh is not configured");
 
+  ScopedTimer timer(derived_type_name());
+
+  // Notify the new mesh structure once, after reading
+  TreeUpdateBatch tree_update_batch(*m_mesh);
+
   // Call the concrete implementation
   do_read_mesh_into(m_file_path, *m_mesh);
+  tree_update_batch.commit();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -119,7 +126,12 @@ void MeshReader::signal_read( SignalArgs& node  )
     {
       // Call the concrete implementation
       mesh->block_mesh_changed(true);
-      do_read_mesh_into(file, *mesh);
+      {
+        ScopedTimer timer(derived_type_name());
+        TreeUpdateBatch tree_update_batch(*mesh);
+        do_read_mesh_into(file, *mesh);
+        tree_update_batch.commit();
+      }
       mesh->block_mesh_changed(false);
 
       // Raise an event to indicate that a mesh was loaded happened
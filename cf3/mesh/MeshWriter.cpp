@@ -14,6 +14,7 @@
 #include "common/Environment.hpp"
 #include "common/Core.hpp"
 #include "common/FindComponents.hpp"
+#include "common/Profiler.hpp"
 
 #include "mesh/MeshWriter.hpp"
 #include "mesh/MeshMetadata.hpp"
@@ -156,6 +157,8 @@ void MeshWriter::execute()
 
   CFinfo << "Writing mesh " << m_file_path << CFendl;
 
+  common::ScopedTimer timer(derived_type_name());
+
   // Configure the fields to write
   config_fields();
 
@@ -186,13 +186,24 @@ void Octtree::create_octtree()
 
 void Octtree::find_cell_ranks( const boost::multi_array<Real,2>& coordinates, std::vector<Uint>& ranks )
 {
+  if (!is_created())
+    create_octtree();
+  if (!is_partition_index_created())
+    create_partition_index();
+
   ranks.resize(coordinates.size());
 
   Entity dummy;
-  std::deque<Uint> missing_cells;
-
   RealVector coord(m_dim);
 
+  const bool parallel = Comm::instance().is_active() && Comm::instance().size() > 1;
+  const Uint nb_procs = parallel ? Comm::instance().size() : 1;
+
+  // Coordinates not found on this rank are sent to the candidate ranks only
+  std::vector< std::vector<Real> > send_coords(nb_procs);
+  std::vector< std::vector<Uint> > sent_cells(nb_procs);
+  std::vector<Uint> candidates;
+
   for(Uint i=0; i<coordinates.size(); ++i)
   {
     for (Uint d=0; d<m_dim; ++d)
@@ -204,73 +215,192 @@ void Octtree::find_cell_ranks( const boost::multi_array<Real,2>& coordinates, st
     else
     {
       ranks[i] = math::Consts::uint_max();
-      missing_cells.push_back(i);
+      if (!parallel)
+        continue;
+      find_candidate_ranks(coord, candidates);
+      boost_foreach(const Uint candidate, candidates)
+      {
+        for (Uint d=0; d<m_dim; ++d)
+          send_coords[candidate].push_back(coord[d]);
+        sent_cells[candidate].push_back(i);
+      }
     }
   }
 
-  std::vector<Real> send_coords(m_dim*missing_cells.size());
-  std::vector<Real> recv_coords;
+  if (!parallel)
+    return;
+
+  std::vector< std::vector<Real> > recv_coords;
+  Comm::instance().all_to_all(send_coords, recv_coords);
 
-  Uint c(0);
-  boost_foreach(const Uint i, missing_cells)
+  std::vector< std::vector<Uint> > send_found(nb_procs);
+  for (Uint p=0; p<nb_procs; ++p)
   {
-    for(Uint d=0; d<m_dim; ++d)
-      send_coords[c++]=coordinates[i][d];
+    send_found[p].resize(recv_coords[p].size()/m_dim);
+    for (Uint i=0; i<send_found[p].size(); ++i)
+    {
+      for (Uint d=0; d<m_dim; ++d)
+        coord[d] = recv_coords[p][i*m_dim+d];
+      send_found[p][i] = find_element(coord,dummy) ? 1u : 0u;
+    }
   }
 
-  for (Uint root=0; root<PE::Comm::instance().size(); ++root)
+  std::vector< std::vector<Uint> > recv_found;
+  Comm::instance().all_to_all(send_found, recv_found);
+
+  // The lowest other rank that found the coordinate wins
+  for (Uint p=0; p<nb_procs; ++p)
   {
+    cf3_assert(recv_found[p].size() == sent_cells[p].size());
+    for (Uint i=0; i<sent_cells[p].size(); ++i)
+    {
+      if (recv_found[p][i])
+        ranks[sent_cells[p][i]] = std::min(p, ranks[sent_cells[p][i]]);
+    }
+  }
+}
 
-    recv_coords.resize(0);
-    PE::Comm::instance().broadcast(send_coords,recv_coords,root,m_dim);
+//////////////////////////////////////////////////////////////////////////////
 
-    // size is only because it doesn't get resized for this rank
-    std::vector<Uint> send_found(missing_cells.size(),math::Consts::uint_max());
+void Octtree::create_partition_index()
+{
+  if (is_null(m_mesh))
+    throw SetupError(FromHere(), "Option \"mesh\" has not been configured");
 
-    if (root!=Comm::instance().rank())
-    {
-      std::vector<RealVector> recv_coordinates(recv_coords.size()/m_dim) ;
-      boost_foreach(RealVector& realvec, recv_coordinates)
-          realvec.resize(m_dim);
+  const Uint dim = m_mesh->dimension();
+  const bool parallel = Comm::instance().is_active() && Comm::instance().size() > 1;
+  const Uint nb_procs = parallel ? Comm::instance().size() : 1;
+  static const Real tolerance = 100*math::Consts::eps();
 
-      c=0;
-      for (Uint i=0; i<recv_coordinates.size(); ++i)
-      {
-        for(Uint d=0; d<m_dim; ++d)
-          recv_coordinates[i][d]=recv_coords[c++];
-      }
+  std::vector<Real> local_box(2*dim);
+  const math::BoundingBox& local_bounding_box = *m_mesh->local_bounding_box();
+  for (Uint d=0; d<dim; ++d)
+  {
+    local_box[d]     = local_bounding_box.min()[d];
+    local_box[dim+d] = local_bounding_box.max()[d];
+  }
+  if (parallel)
+    Comm::instance().all_gather(local_box, m_partition_boxes);
+  else
+    m_partition_boxes = local_box;
 
-      send_found.resize(recv_coordinates.size());
-      for (Uint i=0; i<recv_coordinates.size(); ++i)
-      {
-        if( find_element(recv_coordinates[i],dummy) ) // if element found on this rank
-        {
-          send_found[i] = Comm::instance().rank();
-        }
-        else
-          send_found[i] = math::Consts::uint_max();
-      }
+  // Partitions without elements have an inverted bounding box and are left out
+  std::vector<bool> is_empty(nb_procs, false);
+  m_partition_min.assign(3, 0.);
+  std::vector<Real> global_max(3, 0.);
+  for (Uint d=0; d<dim; ++d)
+  {
+    m_partition_min[d] = math::Consts::real_max();
+    global_max[d] = -math::Consts::real_max();
+  }
+  for (Uint p=0; p<nb_procs; ++p)
+  {
+    for (Uint d=0; d<dim; ++d)
+      is_empty[p] = is_empty[p] || m_partition_boxes[2*dim*p+d] > m_partition_boxes[2*dim*p+dim+d];
+    if (is_empty[p])
+      continue;
+    for (Uint d=0; d<dim; ++d)
+    {
+      m_partition_min[d] = std::min(m_partition_min[d], m_partition_boxes[2*dim*p+d]);
+      global_max[d] = std::max(global_max[d], m_partition_boxes[2*dim*p+dim+d]);
     }
+  }
 
-    std::vector<Uint> recv_found(missing_cells.size()*Comm::instance().size());
-    PE::Comm::instance().gather(send_found,recv_found,root);
+  // About two cells per partition in each direction
+  const Uint nb_cells_per_direction = 2*static_cast<Uint>(std::ceil(std::pow(static_cast<Real>(nb_procs), 1./static_cast<Real>(dim))));
+  m_partition_N.assign(3, 1u);
+  m_partition_D.assign(3, 1.);
+  for (Uint d=0; d<dim; ++d)
+  {
+    m_partition_N[d] = nb_cells_per_direction;
+    const Real L = global_max[d] - m_partition_min[d];
+    if (L > 0.)
+      m_partition_D[d] = L/static_cast<Real>(m_partition_N[d]);
+  }
 
-    if( root==Comm::instance().rank())
+  // Range of cells overlapped by the bounding box of each partition
+  std::vector<Uint> cell_min(nb_procs*3, 0u), cell_max(nb_procs*3, 0u);
+  for (Uint p=0; p<nb_procs; ++p)
+  {
+    if (is_empty[p])
+      continue;
+    for (Uint d=0; d<dim; ++d)
     {
-      const Uint stride = missing_cells.size();
-      for (Uint i=0; i<missing_cells.size(); ++i)
-      {
-        for(Uint p=0; p<Comm::instance().size(); ++p)
-        {
-          ranks[missing_cells[i]] = std::min(recv_found[i+p*stride] , ranks[missing_cells[i]]);
-        }
-      }
+      const Real lo = (m_partition_boxes[2*dim*p+d] - tolerance - m_partition_min[d])/m_partition_D[d];
+      const Real hi = (m_partition_boxes[2*dim*p+dim+d] + tolerance - m_partition_min[d])/m_partition_D[d];
+      cell_min[3*p+d] = static_cast<Uint>(std::max(0., std::floor(lo)));
+      cell_max[3*p+d] = std::min(static_cast<Uint>(std::max(0., std::floor(hi))), m_partition_N[d]-1);
+    }
+  }
+
+  // Two passes: count the ranks per cell, then fill them in increasing rank order
+  const Uint nb_cells = m_partition_N[XX]*m_partition_N[YY]*m_partition_N[ZZ];
+  m_partition_cell_start.assign(nb_cells+1, 0u);
+  for (Uint pass=0; pass<2; ++pass)
+  {
+    std::vector<Uint> fill_position(m_partition_cell_start.begin(), m_partition_cell_start.end()-1);
+    for (Uint p=0; p<nb_procs; ++p)
+    {
+      if (is_empty[p])
+        continue;
+      for (Uint i=cell_min[3*p+XX]; i<=cell_max[3*p+XX]; ++i)
+        for (Uint j=cell_min[3*p+YY]; j<=cell_max[3*p+YY]; ++j)
+          for (Uint k=cell_min[3*p+ZZ]; k<=cell_max[3*p+ZZ]; ++k)
+          {
+            const Uint cell = (i*m_partition_N[YY]+j)*m_partition_N[ZZ]+k;
+            if (pass == 0)
+              ++m_partition_cell_start[cell+1];
+            else
+              m_partition_cell_ranks[fill_position[cell]++] = p;
+          }
+    }
+    if (pass == 0)
+    {
+      for (Uint c=0; c<nb_cells; ++c)
+        m_partition_cell_start[c+1] += m_partition_cell_start[c];
+      m_partition_cell_ranks.resize(m_partition_cell_start.back());
     }
   }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+void Octtree::find_candidate_ranks(const RealVector& coordinate, std::vector<Uint>& ranks) const
+{
+  cf3_assert(is_partition_index_created());
+  static const Real tolerance = 100*math::Consts::eps();
+  const Uint dim = coordinate.size();
+  const Uint my_rank = Comm::instance().rank();
+
+  ranks.clear();
+  std::vector<Uint> cell_idx(3, 0u);
+  for (Uint d=0; d<dim; ++d)
+  {
+    const Real x = (coordinate[d] - m_partition_min[d])/m_partition_D[d];
+    if (x < -tolerance/m_partition_D[d] || x > static_cast<Real>(m_partition_N[d]) + tolerance/m_partition_D[d])
+      return; // outside of the global bounding box
+    cell_idx[d] = std::min(static_cast<Uint>(std::max(0., std::floor(x))), m_partition_N[d]-1);
+  }
+
+  const Uint cell = (cell_idx[XX]*m_partition_N[YY]+cell_idx[YY])*m_partition_N[ZZ]+cell_idx[ZZ];
+  for (Uint r=m_partition_cell_start[cell]; r<m_partition_cell_start[cell+1]; ++r)
+  {
+    const Uint p = m_partition_cell_ranks[r];
+    if (p == my_rank)
+      continue;
+    bool inside = true;
+    for (Uint d=0; d<dim && inside; ++d)
+    {
+      inside = coordinate[d] >= m_partition_boxes[2*dim*p+d] - tolerance
+            && coordinate[d] <= m_partition_boxes[2*dim*p+dim+d] + tolerance;
+    }
+    if (inside)
+      ranks.push_back(p);
+  }
+}
+
+//////////////
+
 bool Octtree::find_octtree_cell(const RealVector& coordinate, std::vector<Uint>& octtree_idx)
 {
   if (m_octtree.num_elements() == 0)
@@ -69,10 +69,23 @@ public: // functions
   /// @note subsequent calls with increasing value for ring starting from 0, will assemble everything within the last passed ring value.
   void gather_elements_around_idx(const std::vector<Uint>& octtree_idx, const Uint ring, std::vector<Entity>& element_pool);
 
+  /// Find a rank that contains each coordinate, or uint_max if no rank does. Collective.
+  /// Coordinates found on this rank get this rank. The others are only sent to the candidate ranks from the
+  /// partition index, and get the lowest of the ranks that contain them.
   void find_cell_ranks( const boost::multi_array<Real,2>& coordinates, std::vector<Uint>& ranks );
 
+  /// Gather the bounding boxes of the partitions of all ranks in a coarse grid over the global bounding box,
+  /// so that coordinates that are not found on this rank can be sent only to the ranks that may contain them. Collective.
+  void create_partition_index();
+
+  /// Ranks other than this one whose partition bounding box contains the coordinate, in increasing order
+  /// @pre create_partition_index() was called
+  void find_candidate_ranks(const RealVector& coordinate, std::vector<Uint>& ranks) const;
+
   bool is_created() const { return m_octtree.num_elements()!=0; }
 
+  bool is_partition_index_created() const { return !m_partition_cell_start.empty(); }
+
   const Uint dimension() { return m_dim; }
 
 private: // data
@@ -91,6 +104,18 @@ private: // data
 
   math::BoundingBox m_bounding_box;
 
+  /// Bounding box of the partition of every rank, as the minimum followed by the maximum coordinates
+  std::vector<Real> m_partition_boxes;
+
+  /// Coarse grid over the global bounding box: origin, number of cells and cell size in each direction
+  std::vector<Real> m_partition_min;
+  std::vector<Uint> m_partition_N;
+  std::vector<Real> m_partition_D;
+
+  /// Ranks whose partition bounding box overlaps each cell of the coarse grid, in compressed row storage
+  std::vector<Uint> m_partition_cell_start;
+  std::vector<Uint> m_partition_cell_ranks;
+
 }; // end Octtree
 
 ////////////////////////////////////////////////////////////////////////////////
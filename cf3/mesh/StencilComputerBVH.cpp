@@ -0,0 +1,77 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/StencilComputerBVH.hpp"
+#include "mesh/BoundingVolumeHierarchy.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Space.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+cf3::common::ComponentBuilder < StencilComputerBVH, StencilComputer, LibMesh > StencilComputerBVH_Builder;
+
+//////////////////////////////////////////////////////////////////////////////
+
+StencilComputerBVH::StencilComputerBVH( const std::string& name )
+  : StencilComputer(name)
+{
+  options().option("dict").attach_trigger( boost::bind( &StencilComputerBVH::configure_tree, this ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void StencilComputerBVH::configure_tree()
+{
+  Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(*m_dict);
+  if (is_null(mesh))
+    throw SetupError(FromHere(),"Mesh was not found as parent of "+m_dict->uri().string());
+
+  m_centroid.resize(m_dict->coordinates().row_size());
+
+  if (Handle<Component> found = mesh->get_child("bvh"))
+    m_tree = Handle<BoundingVolumeHierarchy>(found);
+  else
+  {
+    m_tree = mesh->create_component<BoundingVolumeHierarchy>("bvh");
+    m_tree->options().set("mesh",mesh);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void StencilComputerBVH::compute_stencil(const SpaceElem& element, std::vector<SpaceElem>& stencil)
+{
+  cf3_assert(m_tree);
+  RealMatrix coordinates = element.comp->support().geometry_space().get_coordinates(element.idx);
+  element.comp->support().element_type().compute_centroid(coordinates,m_centroid);
+  m_tree->find_nearest(m_centroid,m_min_stencil_size,m_stencil);
+  stencil.resize(m_stencil.size());
+  for (Uint e=0; e<stencil.size(); ++e)
+  {
+    stencil[e]=SpaceElem(*const_cast<Space*>(&m_dict->space(*m_stencil[e].comp)),m_stencil[e].idx);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
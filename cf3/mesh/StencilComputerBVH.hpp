@@ -0,0 +1,61 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_StencilComputerBVH_hpp
+#define cf3_mesh_StencilComputerBVH_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "math/MatrixTypes.hpp"
+#include "mesh/StencilComputer.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class Entity;
+  class BoundingVolumeHierarchy;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// @brief Stencil of the elements with the centroids closest to the centroid of the given element
+///
+/// The stencil contains exactly "stencil_size" elements, the given element first,
+/// or all elements if the mesh has fewer.
+class Mesh_API StencilComputerBVH : public StencilComputer {
+
+public: // functions
+  /// constructor
+  StencilComputerBVH( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "StencilComputerBVH"; }
+
+  virtual void compute_stencil(const SpaceElem& element, std::vector<SpaceElem>& stencil);
+
+private: // functions
+
+  void configure_tree();
+
+private: // data
+
+  Handle<BoundingVolumeHierarchy> m_tree;
+
+  RealVector m_centroid;
+
+  std::vector<Entity> m_stencil;
+
+}; // end StencilComputerBVH
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_StencilComputerBVH_hpp
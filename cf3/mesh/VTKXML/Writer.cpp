@@ -4,17 +4,22 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <cstring>
 #include <iostream>
 #include <set>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/bind.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "rapidxml/rapidxml.hpp"
 
+#include "common/BasicExceptions.hpp"
 #include "common/BoostFilesystem.hpp"
 #include "common/Foreach.hpp"
 #include "common/Log.hpp"
@@ -24,6 +29,7 @@
 #include "common/Builder.hpp"
 #include "common/FindComponents.hpp"
 #include "common/StringConversion.hpp"
+#include "common/ThreadPool.hpp"
 
 #include "common/XML/FileOperations.hpp"
 #include "common/XML/XmlDoc.hpp"
@@ -49,130 +55,226 @@ namespace VTKXML {
 
 namespace detail
 {
-  struct CompressedStreamHeader
-  {
-    CompressedStreamHeader() :
-      nb_blocks(1),
-      blocksize(32768), // Same as in ParaView
-      last_blocksize(0)
-    {
-    }
+  /// Size of the uncompressed blocks, same as in ParaView
+  const Uint blocksize = 32768;
 
-    boost::uint32_t nb_blocks;
-    const boost::uint32_t blocksize;
-    boost::uint32_t last_blocksize;
-    std::vector<boost::uint32_t> compressed_blocksizes;
+  /// Compression applied to the appended data
+  enum CompressionMode { ZLIB, ZLIB_FAST, RAW };
+
+  /// Part of an array that is compressed as a unit
+  struct Block
+  {
+    Block(const Uint array_idx, const Uint begin, const Uint size) : array_idx(array_idx), begin(begin), size(size) {}
+    Uint array_idx;
+    Uint begin;
+    Uint size;
   };
 
-  struct CompressedStream
+  /// Compresses a contiguous range of the blocks for each thread
+  struct CompressBlocks
   {
-    CompressedStream() :
-      data_stream(std::ios_base::in | std::ios_base::out | std::ios_base::binary),
-      m_current_block(std::ios_base::in | std::ios_base::out | std::ios_base::binary)
+    CompressBlocks(const std::vector< std::vector<char> >& arrays, const std::vector<Block>& blocks, std::vector<std::string>& compressed_blocks, const int level, const Uint nb_parts) :
+      m_arrays(arrays),
+      m_blocks(blocks),
+      m_compressed_blocks(compressed_blocks),
+      m_level(level),
+      m_nb_parts(nb_parts)
     {
-      // VTK data starts with a _
-      data_stream.write("_", 1);
     }
 
-    /// Start writing a new array
-    void start_array(const Uint nb_elems, const Uint wordsize)
+    void operator()(const Uint thread_idx) const
     {
-      m_wordsize = wordsize;
-
-      const Uint nb_bytes = nb_elems * wordsize;
-      m_header.last_blocksize = nb_bytes % m_header.blocksize;
-      if(m_header.last_blocksize)
-      {
-        m_header.nb_blocks = nb_bytes / m_header.blocksize + 1;
-      }
-      else
+      Uint begin, end;
+      split_range(m_blocks.size(), m_nb_parts, thread_idx, begin, end);
+      for(Uint i = begin; i != end; ++i)
       {
-        m_header.last_blocksize = m_header.blocksize;
-        m_header.nb_blocks = nb_bytes / m_header.blocksize;
+        const Block& block = m_blocks[i];
+        boost::iostreams::filtering_ostream compressed_stream;
+        compressed_stream.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib_params(m_level)));
+        compressed_stream.push(boost::iostreams::back_inserter(m_compressed_blocks[i]));
+        compressed_stream.write(&m_arrays[block.array_idx][block.begin], block.size);
+        boost::iostreams::close(compressed_stream);
       }
+    }
 
-      m_header.compressed_blocksizes.clear();
-      m_header.compressed_blocksizes.reserve(m_header.nb_blocks);
-
-      // Write known header info
-      data_stream.write(reinterpret_cast<const char*>(&m_header.nb_blocks), 4);
-      data_stream.write(reinterpret_cast<const char*>(&m_header.blocksize), 4);
-      data_stream.write(reinterpret_cast<const char*>(&m_header.last_blocksize), 4);
+    const std::vector< std::vector<char> >& m_arrays;
+    const std::vector<Block>& m_blocks;
+    std::vector<std::string>& m_compressed_blocks;
+    const int m_level;
+    const Uint m_nb_parts;
+  };
 
-      // save filepointer
-      m_compressed_sizes_start = data_stream.tellp();
+  /// Appended data of a piece. Arrays are first copied into uncompressed buffers, which are compressed
+  /// all at once by compress(). The copy serves as a snapshot of the mesh and field data, so the compression and
+  /// the writing can happen while the data itself is modified again.
+  struct AppendedData
+  {
+    AppendedData() :
+      m_wordsize(0),
+      m_position(0)
+    {
+    }
 
-      // Reserve space for compressed block sizes
-      for(Uint i = 0; i != m_header.nb_blocks; ++i)
-        data_stream.write(reinterpret_cast<const char*>(&m_header.nb_blocks), 4);
+    /// Start writing a new array, described by the given DataArray node
+    void start_array(const XmlNode& node, const Uint nb_elems, const Uint wordsize)
+    {
+      m_nodes.push_back(node);
+      m_arrays.push_back(std::vector<char>(nb_elems * wordsize));
+      m_wordsize = wordsize;
+      m_position = 0;
     }
 
     /// Finish writing the current array
     void finish_array()
     {
-      // Write the last block
-      cf3_assert(static_cast<Uint>(m_current_block.tellp()) == static_cast<Uint>(m_header.last_blocksize));
-      compress_block();
-
-      // go back to the header
-      const Uint stream_end = data_stream.tellp();
-      data_stream.seekp(m_compressed_sizes_start);
-
-      // Write actual compressed block sizes
-      for(Uint i = 0; i != m_header.nb_blocks; ++i)
-        data_stream.write(reinterpret_cast<const char*>(&m_header.compressed_blocksizes[i]), 4);
-
-      // go back to the stream end
-      data_stream.seekp(stream_end);
+      cf3_assert(m_position == m_arrays.back().size());
     }
 
-    /// Append a value to the stream
+    /// Append a value to the current array
     template<typename ValueT>
     void push_back(const ValueT& value)
     {
-      // Block is full, write it to the compressed stream
-      if(m_current_block.tellp() == static_cast<std::streampos>(m_header.blocksize))
-        compress_block();
-
-      m_current_block.write(reinterpret_cast<const char*>(&value), m_wordsize);
+      cf3_assert(m_wordsize <= sizeof(ValueT));
+      cf3_assert(m_position + m_wordsize <= m_arrays.back().size());
+      std::memcpy(&m_arrays.back()[m_position], &value, m_wordsize);
+      m_position += m_wordsize;
     }
 
-    // Offset to put in the VTK XML (= offset after the _)
-    Uint offset()
+    /// Compress all arrays, set the offset attribute of each DataArray node and build the data string.
+    /// If threaded is true, the blocks are distributed over the threads of the ThreadPool.
+    void compress(const CompressionMode mode, const bool threaded)
     {
-      return static_cast<Uint>(data_stream.tellp()) - 1u;
+      // VTK data starts with a _
+      data = "_";
+
+      if(mode == RAW)
+      {
+        for(Uint i = 0; i != m_arrays.size(); ++i)
+        {
+          m_nodes[i].set_attribute("offset", to_str(data.size() - 1));
+          const boost::uint32_t nb_bytes = m_arrays[i].size();
+          data.append(reinterpret_cast<const char*>(&nb_bytes), 4);
+          data.append(m_arrays[i].begin(), m_arrays[i].end());
+          std::vector<char>().swap(m_arrays[i]);
+        }
+        return;
+      }
+
+      std::vector<Block> blocks;
+      for(Uint i = 0; i != m_arrays.size(); ++i)
+      {
+        const Uint nb_bytes = m_arrays[i].size();
+        for(Uint begin = 0; begin < nb_bytes; begin += blocksize)
+          blocks.push_back(Block(i, begin, std::min(blocksize, nb_bytes - begin)));
+      }
+
+      std::vector<std::string> compressed_blocks(blocks.size());
+      const CompressBlocks task(m_arrays, blocks, compressed_blocks,
+                                mode == ZLIB_FAST ? boost::iostreams::zlib::best_speed : boost::iostreams::zlib::default_compression,
+                                threaded ? ThreadPool::instance().nb_threads() : 1u);
+      if(threaded)
+        ThreadPool::instance().run(task);
+      else
+        task(0);
+
+      // Assemble the arrays in order, each one preceded by its header
+      Uint block_idx = 0;
+      for(Uint i = 0; i != m_arrays.size(); ++i)
+      {
+        m_nodes[i].set_attribute("offset", to_str(data.size() - 1));
+
+        const Uint nb_bytes = m_arrays[i].size();
+        const boost::uint32_t nb_blocks = (nb_bytes + blocksize - 1) / blocksize;
+        const boost::uint32_t block_size = blocksize;
+        const boost::uint32_t last_blocksize = (nb_bytes % blocksize == 0 && nb_bytes != 0) ? blocksize : nb_bytes % blocksize;
+        data.append(reinterpret_cast<const char*>(&nb_blocks), 4);
+        data.append(reinterpret_cast<const char*>(&block_size), 4);
+        data.append(reinterpret_cast<const char*>(&last_blocksize), 4);
+        for(Uint j = 0; j != nb_blocks; ++j)
+        {
+          const boost::uint32_t compressed_size = compressed_blocks[block_idx + j].size();
+          data.append(reinterpret_cast<const char*>(&compressed_size), 4);
+        }
+        for(Uint j = 0; j != nb_blocks; ++j)
+        {
+          data.append(compressed_blocks[block_idx + j]);
+          std::string().swap(compressed_blocks[block_idx + j]);
+        }
+        block_idx += nb_blocks;
+        std::vector<char>().swap(m_arrays[i]);
+      }
     }
 
-    // Compress the current block and append it to the data stream
-    void compress_block()
+    /// Compressed data, including the leading _
+    std::string data;
+
+  private:
+    Uint m_wordsize;
+    Uint m_position;
+    std::vector<XmlNode> m_nodes;
+    std::vector< std::vector<char> > m_arrays;
+  };
+
+  /// Holds everything needed to finish writing the .vtu file of a piece, once the data has been collected
+  struct PieceWriter
+  {
+    PieceWriter(const CompressionMode compression_mode) :
+      doc(new XmlDoc("1.0", "ISO-8859-1")),
+      mode(compression_mode)
     {
-      // set up zlib compressor
-      boost::iostreams::filtering_stream<boost::iostreams::input> compressed_stream;
-      compressed_stream.push(boost::iostreams::zlib_compressor());
-      compressed_stream.push(m_current_block);
-
-      // write data and store compressed size
-      const Uint before = data_stream.tellp();
-      data_stream << compressed_stream.rdbuf();
-      m_header.compressed_blocksizes.push_back(static_cast<Uint>(data_stream.tellp()) - before);
-
-      // clear current block
-      m_current_block.str(std::string());
     }
 
-    CompressedStreamHeader m_header;
+    /// Compress the data and write the file
+    void write(const bool threaded)
+    {
+      appended_data.compress(mode, threaded);
 
-    /// File pointer where the compressed sizes start
-    Uint m_compressed_sizes_start;
+      boost::filesystem::fstream fout(path.path(), std::ios_base::out | std::ios_base::binary);
 
-    Uint m_wordsize;
+      // Remove the closing tag
+      std::string xml_string;
+      to_string(*doc, xml_string);
+      boost::algorithm::erase_last(xml_string, "</VTKFile>");
+      boost::algorithm::trim_right(xml_string);
+
+      // Write XML meta data
+      fout << xml_string;
+
+      // Append  compressed data
+      fout << "\n<AppendedData encoding=\"raw\">\n";
+      fout.write(appended_data.data.data(), appended_data.data.size());
+      fout << "\n</AppendedData>\n</VTKFile>\n";
 
-    // Uncompressed data for the block that is being appended to
-    std::stringstream m_current_block;
+      fout.close();
+    }
+
+    boost::shared_ptr<XmlDoc> doc;
+    AppendedData appended_data;
+    URI path;
+    const CompressionMode mode;
 
-    std::stringstream data_stream;
+    /// Error that occured while writing in the background
+    std::string error;
   };
 
+  /// Entry point for the background thread. Only this thread is used for the compression,
+  /// since the ThreadPool is needed by the solver in the mean time. Errors are stored and reported by Writer::wait().
+  void write_piece_in_background(const boost::shared_ptr<PieceWriter>& piece_writer)
+  {
+    try
+    {
+      piece_writer->write(false);
+    }
+    catch(std::exception& e)
+    {
+      piece_writer->error = e.what();
+    }
+    catch(...)
+    {
+      piece_writer->error = "unknown exception";
+    }
+  }
+
   // Recursively transform nodes to their parallel counterparts
   void make_pvtu(XmlNode& node)
   {
@@ -206,6 +308,34 @@ Writer::Writer( const std::string& name )
     options().add("distributed_files", false)
     .pretty_name("Distributed Files")
     .description("Indicate if the filesystem is local to each note. When true, the pvtu file is written on each node.");
+
+    std::vector<boost::any> compression_modes;
+    compression_modes.push_back(std::string("zlib"));
+    compression_modes.push_back(std::string("fast"));
+    compression_modes.push_back(std::string("none"));
+    options().add("compression", std::string("zlib"))
+    .pretty_name("Compression")
+    .description("Compression of the appended data: zlib (default level), fast (zlib level 1) or none (raw binary)")
+    .restricted_list() = compression_modes;
+
+    options().add("asynchronous", false)
+    .pretty_name("Asynchronous")
+    .description("Compress and write the data in a background thread, after taking a copy of the mesh and fields. "
+                 "A write that is still in progress is finished at the start of the next write.");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+Writer::~Writer()
+{
+  try
+  {
+    wait();
+  }
+  catch(std::exception& e)
+  {
+    CFerror << e.what() << CFendl;
+  }
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -220,22 +350,47 @@ std::vector<std::string> Writer::get_extensions()
 
 /////////////////////////////////////////////////////////////////////////////
 
+void Writer::wait()
+{
+  if(is_null(m_write_thread))
+    return;
+
+  m_write_thread->join();
+  m_write_thread.reset();
+
+  const std::string error = m_piece_writer->error;
+  const std::string path = m_piece_writer->path.path();
+  m_piece_writer.reset();
+  if(!error.empty())
+    throw FileSystemError(FromHere(), "Error writing " + path + ": " + error);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 void Writer::write()
 {
+  // Finish the previous write before starting a new one
+  wait();
+
+  const std::string compression = options().value<std::string>("compression");
+  const detail::CompressionMode compression_mode = compression == "none" ? detail::RAW : (compression == "fast" ? detail::ZLIB_FAST : detail::ZLIB);
+  boost::shared_ptr<detail::PieceWriter> piece_writer(new detail::PieceWriter(compression_mode));
+
   // Path for the file written by the current node
   URI my_path(m_file_path.path());
   const URI my_dir = my_path.base_path();
   const std::string basename = my_path.base_name();
   my_path = my_dir / (basename + "_P" + to_str(PE::Comm::instance().rank()) + ".vtu");
 
-  XmlDoc doc("1.0", "ISO-8859-1");
+  piece_writer->path = my_path;
 
   // Root node
-  XmlNode vtkfile = doc.add_node("VTKFile");
+  XmlNode vtkfile = piece_writer->doc->add_node("VTKFile");
   vtkfile.set_attribute("type", "UnstructuredGrid");
   vtkfile.set_attribute("version", "0.1");
   vtkfile.set_attribute("byte_order", "LittleEndian");
-  vtkfile.set_attribute("compressor", "vtkZLibDataCompressor");
+  if(compression_mode != detail::RAW)
+    vtkfile.set_attribute("compressor", "vtkZLibDataCompressor");
 
   XmlNode unstructured_grid = vtkfile.add_node("UnstructuredGrid");
 
@@ -268,15 +423,14 @@ void Writer::write()
   piece.set_attribute("NumberOfCells", to_str(nb_elems));
 
   // Points output
-  detail::CompressedStream appended_data;
+  detail::AppendedData& appended_data = piece_writer->appended_data;
 
   XmlNode points_data = piece.add_node("Points").add_node("DataArray");
   points_data.set_attribute("type", sizeof(Real) == 4 ? "Float32" : "Float64");
   points_data.set_attribute("NumberOfComponents", "3");
   points_data.set_attribute("format", "appended");
-  points_data.set_attribute("offset", to_str(appended_data.offset()));
 
-  appended_data.start_array(3*npoints, sizeof(Real));
+  appended_data.start_array(points_data, 3*npoints, sizeof(Real));
   for(Uint i = 0; i != npoints; ++i)
   {
     const Field::ConstRow row = coords[i];
@@ -293,8 +447,7 @@ void Writer::write()
   connectivity.set_attribute("type", "UInt32");
   connectivity.set_attribute("Name", "connectivity");
   connectivity.set_attribute("format", "appended");
-  connectivity.set_attribute("offset", to_str(appended_data.offset()));
-  appended_data.start_array(nb_conn_nodes, 4);
+  appended_data.start_array(connectivity, nb_conn_nodes, 4);
   boost_foreach(const Elements& elements, find_components_recursively<Elements>(m_mesh->topology()) )
   {
     if(elements.element_type().dimensionality() == dim && elements.element_type().order() == 1 && etype_map.count(elements.element_type().shape()))
@@ -317,9 +470,8 @@ void Writer::write()
   offsets.set_attribute("type", "UInt32");
   offsets.set_attribute("Name", "offsets");
   offsets.set_attribute("format", "appended");
-  offsets.set_attribute("offset", to_str(appended_data.offset()));
   boost::uint32_t offset = 0;
-  appended_data.start_array(nb_elems, 4);
+  appended_data.start_array(offsets, nb_elems, 4);
   boost_foreach(const Elements& elements, find_components_recursively<Elements>(m_mesh->topology()) )
   {
     if(elements.element_type().dimensionality() == dim && elements.element_type().order() == 1 && etype_map.count(elements.element_type().shape()))
@@ -339,8 +491,7 @@ void Writer::write()
   types.set_attribute("type", "UInt8");
   types.set_attribute("Name", "types");
   types.set_attribute("format", "appended");
-  types.set_attribute("offset", to_str(appended_data.offset()));
-  appended_data.start_array(nb_elems, 1);
+  appended_data.start_array(types, nb_elems, 1);
   boost_foreach(const Elements& elements, find_components_recursively<Elements>(m_mesh->topology()) )
   {
     if(elements.element_type().dimensionality() == dim && elements.element_type().order() == 1 && etype_map.count(elements.element_type().shape()))
@@ -385,9 +536,8 @@ void Writer::write()
       data_array.set_attribute("NumberOfComponents", to_str(var_size == 2 && dim == 2 ? 3 : var_size));
       data_array.set_attribute("Name", var_name);
       data_array.set_attribute("format", "appended");
-      data_array.set_attribute("offset", to_str(appended_data.offset()));
-
-      appended_data.start_array(field_size*(var_size == 2 && dim == 2 ? 3 : var_size), sizeof(Real));
+    
+      appended_data.start_array(data_array, field_size*(var_size == 2 && dim == 2 ? 3 : var_size), sizeof(Real));
 
       if(field.continuous())
       {
@@ -448,27 +598,8 @@ void Writer::write()
     }
   }
 
-  // Write to file, inserting the binary data at the end
-  std::cout << "writing file " << my_path.path() << std::endl;
-  boost::filesystem::fstream fout(my_path.path(), std::ios_base::out | std::ios_base::binary);
-
-  // Remove the closing tag
-  std::string xml_string;
-  to_string(doc, xml_string);
-  boost::algorithm::erase_last(xml_string, "</VTKFile>");
-  boost::algorithm::trim_right(xml_string);
-
-  // Write XML meta data
-  fout << xml_string;
-
-  // Append  compressed data
-  fout << "\n<AppendedData encoding=\"raw\">\n";
-  fout << appended_data.data_stream.rdbuf();
-  fout << "\n</AppendedData>\n</VTKFile>\n";
-
-  fout.close();
-
-  // Write the parallel header, if needed
+  // Write the parallel header, if needed. This is done before the compression, since the background thread
+  // sets the offsets in the XML of the piece, which is copied here
   if(PE::Comm::instance().rank() == 0 || options().value<bool>("distributed_files"))
   {
     URI pvtu_path = my_dir / (basename + ".pvtu");
@@ -496,6 +627,18 @@ void Writer::write()
 
     to_file(pvtu_doc, pvtu_path);
   }
+
+  // Compress and write the data, distributing the blocks over the threads of the ThreadPool
+  std::cout << "writing file " << my_path.path() << std::endl;
+  if(options().value<bool>("asynchronous"))
+  {
+    m_piece_writer = piece_writer;
+    m_write_thread.reset(new boost::thread(boost::bind(detail::write_piece_in_background, piece_writer)));
+  }
+  else
+  {
+    piece_writer->write(true);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -9,6 +9,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <boost/shared_ptr.hpp>
+
 #include "mesh/MeshWriter.hpp"
 #include "mesh/GeoShape.hpp"
 
@@ -16,11 +18,15 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace boost { class thread; }
+
 namespace cf3 {
 namespace mesh {
   class ElementType;
 namespace VTKXML {
 
+namespace detail { struct PieceWriter; }
+
 //////////////////////////////////////////////////////////////////////////////
 
 /// This class defines VTKXML mesh format writer
@@ -37,6 +43,9 @@ public: // functions
   /// constructor
   Writer( const std::string& name );
 
+  /// Finishes any write that is still running in the background
+  virtual ~Writer();
+
   /// Gets the Class name
   static std::string type_name() { return "Writer"; }
 
@@ -45,6 +54,16 @@ public: // functions
   virtual std::string get_format() { return "VTKXML"; }
 
   virtual std::vector<std::string> get_extensions();
+
+  /// Wait until the asynchronous write started by the last call to write() is finished.
+  /// @throws FileSystemError if the background write failed
+  void wait();
+
+private:
+  /// Thread that executes the asynchronous write
+  boost::shared_ptr<boost::thread> m_write_thread;
+  /// Data for the asynchronous write
+  boost::shared_ptr<detail::PieceWriter> m_piece_writer;
 }; // end Writer
 
 
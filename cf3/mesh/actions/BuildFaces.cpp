@@ -4,10 +4,10 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <set>
 
 #include <boost/foreach.hpp>
-#include <boost/functional/hash.hpp>
 
 #include "common/Log.hpp"
 #include "common/Builder.hpp"
@@ -32,7 +32,7 @@
 #include "mesh/MeshElements.hpp"
 #include "mesh/FaceCellConnectivity.hpp"
 #include "mesh/NodeElementConnectivity.hpp"
-#include "mesh/Node2FaceCellConnectivity.hpp"
+#include "mesh/FaceNodeMap.hpp"
 #include "mesh/Cells.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Connectivity.hpp"
@@ -50,20 +50,82 @@ namespace actions {
   using namespace common;
   using namespace math::Functions;
 
-struct FaceCompare
+namespace detail
 {
-  bool operator()(const Face2Cell& face1, const Face2Cell& face2) const
+  /// Nodes of the faces in a FaceCellConnectivity, as seen from the first cell
+  struct FaceCellNodes
   {
-    std::size_t seed1=0;
-    std::size_t seed2=0;
-
-    boost::hash_combine(seed1,face1.comp->uri().string());
-    boost::hash_combine(seed2,face2.comp->uri().string());
-    boost::hash_combine(seed1,face1.idx);
-    boost::hash_combine(seed2,face2.idx);
-    return seed1 < seed2;
+    FaceCellNodes(const FaceCellConnectivity& f2c) :
+      connectivity(f2c.connectivity()),
+      face_number(f2c.face_number())
+    {
+    }
+
+    Uint operator()(const Uint face, Uint* nodes) const
+    {
+      const Entity& element = connectivity[face][0];
+      Connectivity::ConstRow element_nodes = element.get_nodes();
+      Uint i(0);
+      boost_foreach(const Uint node_in_face, element.element_type().faces().nodes_range(face_number[face][0]))
+        nodes[i++] = element_nodes[node_in_face];
+      return i;
+    }
+
+    const ElementConnectivity& connectivity;
+    const common::Table<Uint>& face_number;
+  };
+
+  /// Nodes of face elements
+  struct ElementNodes
+  {
+    ElementNodes(const Elements& elements) :
+      connectivity(elements.geometry_space().connectivity())
+    {
+    }
+
+    Uint operator()(const Uint face, Uint* nodes) const
+    {
+      Connectivity::ConstRow face_nodes = connectivity[face];
+      std::copy(face_nodes.begin(), face_nodes.end(), nodes);
+      return face_nodes.size();
+    }
+
+    const Connectivity& connectivity;
+  };
+
+  /// Largest number of nodes of a face in the mesh, either of a cell or a face element
+  Uint max_nb_face_nodes(Mesh& mesh)
+  {
+    Uint result = 1;
+    boost_foreach(const Elements& elements, find_components_recursively<Elements>(mesh))
+    {
+      const ElementType& etype = elements.element_type();
+      if (etype.dimensionality() < mesh.dimension())
+        result = std::max(result, etype.nb_nodes());
+      else
+        for (Uint f=0; f!=etype.nb_faces(); ++f)
+          result = std::max(result, etype.face_type(f).nb_nodes());
+    }
+    return result;
+  }
+
+  /// Store the inner faces of a region in a FaceNodeMap, the value of each face being its index in faces
+  void map_inner_faces(Region& region, FaceNodeMap& face_map, std::vector<Face2Cell>& faces)
+  {
+    std::vector<Uint> keys;
+    std::vector<std::size_t> hashes;
+    boost_foreach(FaceCellConnectivity& f2c, find_components_recursively_with_tag<FaceCellConnectivity>(region,mesh::Tags::inner_faces()))
+    {
+      face_map.make_keys(FaceCellNodes(f2c), 0, f2c.size(), keys, hashes);
+      face_map.reserve(face_map.size()+f2c.size());
+      for (Uint idx=0; idx!=f2c.size(); ++idx)
+      {
+        if (face_map.insert(&keys[idx*face_map.stride()], hashes[idx], faces.size()) == FaceNodeMap::not_found())
+          faces.push_back(Face2Cell(f2c,idx));
+      }
+    }
   }
-};
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -462,9 +524,6 @@ boost::shared_ptr< FaceCellConnectivity > BuildFaces::match_faces(Region& region
   std::map<FaceCellConnectivity*,boost::shared_ptr<common::Table<bool>::Buffer> > buf_cell_orientation;
   std::map<FaceCellConnectivity*,boost::shared_ptr<common::Table<Uint>::Buffer> > buf_cell_rotation;
 
-  // Build a node to face connectivity matching faces2
-  boost::shared_ptr<Node2FaceCellConnectivity> node2faces2_ptr = allocate_component<Node2FaceCellConnectivity>("node2faces");
-  Node2FaceCellConnectivity& node2faces2 = *node2faces2_ptr;
   boost_foreach(FaceCellConnectivity& faces2, find_components_recursively_with_tag<FaceCellConnectivity>(region2,mesh::Tags::inner_faces()))
   {
     buf_fnb [&faces2] = boost::shared_ptr<common::Table<Uint>::Buffer> ( new common::Table<Uint>::Buffer(faces2.face_number().create_buffer()));
@@ -472,13 +531,23 @@ boost::shared_ptr< FaceCellConnectivity > BuildFaces::match_faces(Region& region
     buf_f2c [&faces2] = boost::shared_ptr<ElementConnectivity::Buffer> ( new ElementConnectivity::Buffer(faces2.connectivity().create_buffer()));
     buf_cell_rotation [&faces2] = boost::shared_ptr<common::Table<Uint>::Buffer> ( new common::Table<Uint>::Buffer(faces2.cell_rotation().create_buffer()));
     buf_cell_orientation [&faces2] = boost::shared_ptr<common::Table<bool>::Buffer> ( new common::Table<bool>::Buffer(faces2.cell_orientation().create_buffer()));
-    node2faces2.add_used(faces2); // it is assumed this is only face types
   }
-  node2faces2.set_nodes(mesh.geometry_fields());
-  node2faces2.build_connectivity();
 
-  Uint f1(0);
-  Uint faces1_idx(0);
+  // Hash the faces2 by their sorted nodes
+  FaceNodeMap faces2_map(detail::max_nb_face_nodes(mesh));
+  std::vector<Face2Cell> faces2_list;
+  detail::map_inner_faces(region2, faces2_map, faces2_list);
+
+  std::vector<Uint> keys;
+  std::vector<std::size_t> hashes;
+  std::vector<Uint> face1_nodes;
+  std::vector<Uint> face2_nodes;
+  std::vector<Entity> elems(2);
+  std::vector<Uint> face_nb(2);
+  std::vector<Uint> rotation(2);
+  std::vector<bool> orientation(2);
+  enum {LEFT=0,RIGHT=1};
+
   boost_foreach(FaceCellConnectivity& faces1, find_components_recursively_with_tag<FaceCellConnectivity>(region1,mesh::Tags::inner_faces()))
   {
     buf_fnb [&faces1] = boost::shared_ptr<common::Table<Uint>::Buffer> ( new common::Table<Uint>::Buffer(faces1.face_number().create_buffer()));
@@ -487,96 +556,62 @@ boost::shared_ptr< FaceCellConnectivity > BuildFaces::match_faces(Region& region
     buf_cell_rotation [&faces1] = boost::shared_ptr<common::Table<Uint>::Buffer> ( new common::Table<Uint>::Buffer(faces1.cell_rotation().create_buffer()));
     buf_cell_orientation [&faces1] = boost::shared_ptr<common::Table<bool>::Buffer> ( new common::Table<bool>::Buffer(faces1.cell_orientation().create_buffer()));
 
-
-    std::vector<Uint> face1_nodes;
-    std::vector<Uint> face2_nodes;
-    std::vector<Entity> elems(2);
-    std::vector<Uint> face_nb(2);
-    std::vector<Uint> rotation(2);
-    std::vector<bool> orientation(2);
-    enum {LEFT=0,RIGHT=1};
-    Uint nb_matches(0);
-
+    faces2_map.make_keys(detail::FaceCellNodes(faces1), 0, faces1.size(), keys, hashes);
 
     for (Uint idx=0; idx<faces1.size(); ++idx)
     {
+      const Uint match = faces2_map.find(&keys[idx*faces2_map.stride()], hashes[idx]);
+      if (match == FaceNodeMap::not_found())
+        continue;
+
       Face2Cell face1(faces1,idx);
+      Face2Cell& face2 = faces2_list[match];
       face1_nodes = face1.nodes();
       const Uint nb_nodes_per_face = face1_nodes.size();
 
-      std::map<Face2Cell,Uint,FaceCompare> found_faces;
-      std::map<Face2Cell,Uint,FaceCompare>::iterator not_found = found_faces.end();
+      elems[LEFT]  = face1.cells()[0];
+      elems[RIGHT] = face2.cells()[0];
+      face_nb[LEFT] = face1.face_nb_in_cells()[0];
+      face_nb[RIGHT] = face2.face_nb_in_cells()[0];
+      orientation[LEFT] = FaceCellConnectivity::MATCHED;
+      orientation[RIGHT] = FaceCellConnectivity::INVERTED;
+      rotation[LEFT] = 0;
+
+      // NOW find the rotation and orientation of this new face to the RIGHT cell
+
+      // Find orientation ( or find match between first face-nodes of both neighbouring elements )
+      face2_nodes = face2.nodes();
 
-      bool match_found = false;
-      boost_foreach(const Uint face1_node, face1_nodes)
+      Uint rot;
+      for (rot=0; rot<nb_nodes_per_face; ++rot)
       {
-        boost_foreach(Face2Cell face2, node2faces2.connectivity()[face1_node])
+        if (face2_nodes[rot] == face1_nodes[0])
         {
-          std::map<Face2Cell,Uint,FaceCompare>::iterator it = found_faces.find(face2);
-          if ( it == not_found)
-          {
-            found_faces[face2]=1;
-          }
-          else
-          {
-            Uint& nb_faces = it->second;
-            ++nb_faces;
-            if (nb_faces == nb_nodes_per_face)
-            {
-              match_found = true;
-              elems[LEFT]  = face1.cells()[0];
-              elems[RIGHT] = face2.cells()[0];
-              face_nb[LEFT] = face1.face_nb_in_cells()[0];
-              face_nb[RIGHT] = face2.face_nb_in_cells()[0];
-              orientation[LEFT] = FaceCellConnectivity::MATCHED;
-              orientation[RIGHT] = FaceCellConnectivity::INVERTED;
-              rotation[LEFT] = 0;
-
-              // NOW find the rotation and orientation of this new face to the RIGHT cell
-
-              // Find orientation ( or find match between first face-nodes of both neighbouring elements )
-              face2_nodes = face2.nodes();
-
-              Uint rot;
-              for (rot=0; rot<=nb_nodes_per_face; ++rot)
-              {
-                if (face2_nodes[rot] == face1_nodes[0])
-                {
-                  rotation[RIGHT] = rot;
-                  break;
-                }
-              }
-              cf3_assert(rot != nb_nodes_per_face); // means that the break worked and the rotation was found
-
-
-              // Remove matches from the 2 connectivity tables and add to the interface
-              i2c.add_row(elems);
-              fnb.add_row(face_nb);
-              bdry.add_row(false);
-              cell_rotation.add_row(rotation);
-              cell_orientation.add_row(orientation);
-
-              buf_f2c [face1.comp]->rm_row(face1.idx);
-              buf_f2c [face2.comp]->rm_row(face2.idx);
-              buf_fnb [face1.comp]->rm_row(face1.idx);
-              buf_fnb [face2.comp]->rm_row(face2.idx);
-              buf_bdry[face1.comp]->rm_row(face1.idx);
-              buf_bdry[face2.comp]->rm_row(face2.idx);
-              buf_cell_orientation[face1.comp]->rm_row(face1.idx);
-              buf_cell_orientation[face2.comp]->rm_row(face2.idx);
-              buf_cell_rotation[face1.comp]->rm_row(face1.idx);
-              buf_cell_rotation[face2.comp]->rm_row(face2.idx);
-              ++nb_matches;
-              break;
-            }
-          }
-        }
-        if (match_found)
+          rotation[RIGHT] = rot;
           break;
+        }
       }
-      ++f1;
+      cf3_assert(rot != nb_nodes_per_face); // means that the break worked and the rotation was found
+
+
+      // Remove matches from the 2 connectivity tables and add to the interface
+      i2c.add_row(elems);
+      fnb.add_row(face_nb);
+      bdry.add_row(false);
+      cell_rotation.add_row(rotation);
+      cell_orientation.add_row(orientation);
+
+      buf_f2c [face1.comp]->rm_row(face1.idx);
+      buf_f2c [face2.comp]->rm_row(face2.idx);
+      buf_fnb [face1.comp]->rm_row(face1.idx);
+      buf_fnb [face2.comp]->rm_row(face2.idx);
+      buf_bdry[face1.comp]->rm_row(face1.idx);
+      buf_bdry[face2.comp]->rm_row(face2.idx);
+      buf_cell_orientation[face1.comp]->rm_row(face1.idx);
+      buf_cell_orientation[face2.comp]->rm_row(face2.idx);
+      buf_cell_rotation[face1.comp]->rm_row(face1.idx);
+      buf_cell_rotation[face2.comp]->rm_row(face2.idx);
     }
-    ++faces1_idx;
   }
 
   return interface;
@@ -596,9 +631,6 @@ void BuildFaces::match_boundary(Region& bdry_region, Region& inner_region)
   std::map<FaceCellConnectivity*,boost::shared_ptr<common::Table<bool>::Buffer> >  buf_inner_orientation;
   std::map<FaceCellConnectivity*,boost::shared_ptr<common::Table<Uint>::Buffer> >  buf_inner_rotation;
 
-  // Build a node to face connectivity matching faces2
-  boost::shared_ptr<Node2FaceCellConnectivity> nodes_to_inner_faces_ptr = allocate_component<Node2FaceCellConnectivity>("node2faces");
-  Node2FaceCellConnectivity& nodes_to_inner_faces = *nodes_to_inner_faces_ptr;
   boost_foreach(FaceCellConnectivity& f2c, find_components_recursively_with_tag<FaceCellConnectivity>(inner_region,mesh::Tags::inner_faces()))
   {
     buf_inner_face_nb          [&f2c] = boost::shared_ptr<common::Table<Uint>::Buffer> ( new common::Table<Uint>::Buffer(f2c.face_number().create_buffer()));
@@ -606,11 +638,15 @@ void BuildFaces::match_boundary(Region& bdry_region, Region& inner_region)
     buf_inner_face_connectivity[&f2c] = boost::shared_ptr<ElementConnectivity::Buffer> ( new ElementConnectivity::Buffer(f2c.connectivity().create_buffer()));
     buf_inner_rotation          [&f2c] = boost::shared_ptr<common::Table<Uint>::Buffer> ( new common::Table<Uint>::Buffer(f2c.cell_rotation().create_buffer()));
     buf_inner_orientation       [&f2c] = boost::shared_ptr<common::Table<bool>::Buffer> ( new common::Table<bool>::Buffer(f2c.cell_orientation().create_buffer()));
-
-    nodes_to_inner_faces.add_used(f2c);
   }
-  nodes_to_inner_faces.set_nodes(mesh.geometry_fields());
-  nodes_to_inner_faces.build_connectivity();
+
+  // Hash the inner faces by their sorted nodes
+  FaceNodeMap inner_faces_map(detail::max_nb_face_nodes(mesh));
+  std::vector<Face2Cell> inner_faces_list;
+  detail::map_inner_faces(inner_region, inner_faces_map, inner_faces_list);
+
+  std::vector<Uint> keys;
+  std::vector<std::size_t> hashes;
 
   boost_foreach(Elements& bdry_faces, find_components<Elements>(bdry_region))
   {
@@ -640,101 +676,60 @@ void BuildFaces::match_boundary(Region& bdry_region, Region& inner_region)
     // the bdry_face_connectivity table
     std::vector<Entity> elems(1);
 
-    // initialize a counter for see if matches are found.
-    // A match is found if every node of a boundary face is also found in an inner_face
-    Uint nb_matches(0);
+    // A match is found if an inner face has the same nodes as the boundary face
+    inner_faces_map.make_keys(detail::ElementNodes(bdry_faces), 0, bdry_faces.size(), keys, hashes);
     for (Uint idx=0; idx<bdry_faces.size(); ++idx)
     {
+      const Uint match = inner_faces_map.find(&keys[idx*inner_faces_map.stride()], hashes[idx]);
+      if (match == FaceNodeMap::not_found())
+        continue;
+
       Entity bdry_entity(bdry_faces,idx);
       Connectivity::ConstRow bdry_face_nodes = bdry_entity.get_nodes();
       const Uint nb_nodes_per_face = bdry_face_nodes.size();
+      Face2Cell& inner_face = inner_faces_list[match];
 
-      std::map<Face2Cell,Uint,FaceCompare> found_faces;
-      std::map<Face2Cell,Uint,FaceCompare>::iterator not_found = found_faces.end();
+      elems[INNER] = inner_face.cells()[INNER];
 
-      bool match_found = false;
-      boost_foreach(const Uint bdry_face_node, bdry_face_nodes)
+      // Remove matches from the inner_faces_connectivity tables and add to the boundary
+      bdry_face_connectivity.set_row(bdry_entity.idx,elems);
+      bdry_face_nb[bdry_entity.idx][INNER] = inner_face.face_nb_in_cells()[INNER];
+      bdry_face_is_bdry[bdry_entity.idx] = true;
+
+      if (nb_nodes_per_face == 1)
       {
-        boost_foreach( Face2Cell& inner_face, nodes_to_inner_faces.connectivity()[bdry_face_node])
+        bdry_rotation[bdry_entity.idx][INNER] = 0;
+        bdry_orientation[bdry_entity.idx][INNER] = FaceCellConnectivity::MATCHED;
+      }
+      else
+      {
+        std::vector<Uint> inner_face_nodes = inner_face.nodes();
+        Uint rot;
+        for (rot=0; rot<nb_nodes_per_face; ++rot)
         {
-          std::map<Face2Cell,Uint,FaceCompare>::iterator it = found_faces.find(inner_face);
-          if ( it == not_found)
-          {
-            found_faces[inner_face]=1;
-
-            it = found_faces.find(inner_face);
-
-            if (nb_nodes_per_face == 1)
-            {
-              match_found = true;
-              elems[INNER] = inner_face.cells()[INNER];
-
-              // Remove matches from the inner_faces_connectivity tables and add to the boundary
-              bdry_face_connectivity.set_row(bdry_entity.idx,elems);
-              bdry_face_nb[bdry_entity.idx][INNER] = inner_face.face_nb_in_cells()[INNER];
-              bdry_face_is_bdry[bdry_entity.idx] = true;
-              bdry_rotation[bdry_entity.idx][INNER] = 0;
-              bdry_orientation[bdry_entity.idx][INNER] = FaceCellConnectivity::MATCHED;
-
-              buf_inner_face_connectivity[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_face_nb[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_face_is_bdry[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_orientation[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_rotation[inner_face.comp]->rm_row(inner_face.idx);
-
-              ++nb_matches;
-              break;
-            }
-          }
-          else
+          if (inner_face_nodes[rot] == bdry_face_nodes[0])
           {
-            Uint& nb_faces = it->second;
-            ++nb_faces;
-
-            if (nb_faces == nb_nodes_per_face)
-            {
-              match_found = true;
-              elems[0] = inner_face.cells()[INNER];
-
-              // Remove matches from the inner_faces_connectivity tables and add to the boundary
-              bdry_face_connectivity.set_row(bdry_entity.idx,elems);
-              bdry_face_nb[bdry_entity.idx][INNER] = inner_face.face_nb_in_cells()[INNER];
-              bdry_face_is_bdry[bdry_entity.idx] = true;
-
-              std::vector<Uint> inner_face_nodes = inner_face.nodes();
-              Uint rot;
-              for (rot=0; rot<=nb_nodes_per_face; ++rot)
-              {
-                if (inner_face_nodes[rot] == bdry_face_nodes[0])
-                {
-                  bdry_rotation[bdry_entity.idx][INNER] = rot;
-                  break;
-                }
-              }
-
-              // Now find the orientation (outward or inward)
-              Uint next_node = rot+1;
-              if (next_node == nb_nodes_per_face)
-                next_node = 0;
-              if (inner_face_nodes[next_node]==bdry_face_nodes[1])
-                bdry_orientation[bdry_entity.idx][INNER] = FaceCellConnectivity::MATCHED;
-              else
-                bdry_orientation[bdry_entity.idx][INNER] = FaceCellConnectivity::INVERTED;
-
-              buf_inner_face_connectivity[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_face_nb[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_face_is_bdry[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_orientation[inner_face.comp]->rm_row(inner_face.idx);
-              buf_inner_rotation[inner_face.comp]->rm_row(inner_face.idx);
-
-              ++nb_matches;
-              break;
-            }
+            bdry_rotation[bdry_entity.idx][INNER] = rot;
+            break;
           }
         }
-        if (match_found)
-          break;
+        cf3_assert(rot != nb_nodes_per_face);
+
+        // Now find the orientation (outward or inward)
+        Uint next_node = rot+1;
+        if (next_node == nb_nodes_per_face)
+          next_node = 0;
+        if (inner_face_nodes[next_node]==bdry_face_nodes[1])
+          bdry_orientation[bdry_entity.idx][INNER] = FaceCellConnectivity::MATCHED;
+        else
+          bdry_orientation[bdry_entity.idx][INNER] = FaceCellConnectivity::INVERTED;
       }
+
+      buf_inner_face_connectivity[inner_face.comp]->rm_row(inner_face.idx);
+      buf_inner_face_nb[inner_face.comp]->rm_row(inner_face.idx);
+      buf_inner_face_is_bdry[inner_face.comp]->rm_row(inner_face.idx);
+      buf_inner_orientation[inner_face.comp]->rm_row(inner_face.idx);
+      buf_inner_rotation[inner_face.comp]->rm_row(inner_face.idx);
     }
   }
 
@@ -4,8 +4,12 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+
 #include <boost/foreach.hpp>
 #include <boost/static_assert.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
 
 #include "common/Log.hpp"
 #include "common/Builder.hpp"
@@ -20,6 +24,7 @@
 
 #include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
+#include "common/PE/directory.hpp"
 
 #include "mesh/actions/GlobalConnectivity.hpp"
 #include "mesh/Region.hpp"
@@ -81,21 +86,13 @@ void GlobalConnectivity::execute()
   // Assert at compile time
   //BOOST_STATIC_ASSERT(sizeof(std::size_t) == sizeof(Uint));
 
-  // 1) make std::map<glb_node_idx,loc_node_idx>
-  // 2) Make node2elem connectivity (does not contain elements from other partitions)
-  // 3) foreach ghostnode, store connected owned elements
-  // 4) broadcast (3) to all, and store the map node to ghost elements
-  // 5) create the node to glb_elem_connectivity, as the combination of (2) and (4)
-
-
+  // 1) Make node2elem connectivity (does not contain elements from other partitions)
+  // 2) foreach node, send its glb_idx to the directory rank of that glb_idx,
+  //    together with the connected elements if it is a ghost node
+  // 3) the directory sends back to each rank holding a node the elements that the other ranks connected to it
+  // 4) create the node to glb_elem_connectivity, as the combination of (1) and (3)
 
   //1)
-  std::map<Uint,Uint> node_glb2loc;
-  Uint loc_node_idx(0);
-  boost_foreach(Uint glb_node_idx, nodes_glb_idx.array())
-    node_glb2loc[glb_node_idx]=loc_node_idx++;
-
-  //2)
   Handle<Component> node2elem_handle = mesh.geometry_fields().get_child("node2elem");
   if (node2elem_handle)
     mesh.geometry_fields().remove_component("node2elem");
@@ -105,76 +102,102 @@ void GlobalConnectivity::execute()
   node2elem.setup(mesh.topology());
 
 
-  // 3)
-  Uint nb_ghost(0);
+  // 2)
+  // Each record is: glb_idx, number of elements, glb_idx of the elements.
+  // The records for each rank are sorted by glb_idx, which is also the order of the answers
+  const Uint nb_procs = PE::Comm::instance().size();
+  std::vector< std::vector< std::pair<Uint,Uint> > > sent_nodes(nb_procs);
   for (Uint i=0; i<nodes.size(); ++i)
-    if (nodes.is_ghost(i))
-      ++nb_ghost;
+    sent_nodes[PE::directory_rank(nodes_glb_idx[i], nb_procs)].push_back(std::make_pair(nodes_glb_idx[i], i));
 
-  std::vector<Uint> ghostnode_glb_idx(nb_ghost);
-  std::vector<Uint> ghostnode_glb_elem_connectivity;
-  std::vector<Uint> ghostnode_glb_elem_connectivity_start(nb_ghost+1);
-  ghostnode_glb_elem_connectivity_start[0]=0;
+  std::vector< std::vector<Uint> > send(nb_procs);
   Handle< Component > elem_comp;
   Uint elem_idx;
-
   Uint cnt(0);
-  for (Uint i=0; i<mesh.geometry_fields().size(); ++i)
+  for (Uint rank=0; rank<nb_procs; ++rank)
   {
-    if (mesh.geometry_fields().is_ghost(i))
+    std::sort(sent_nodes[rank].begin(), sent_nodes[rank].end());
+    std::vector<Uint>& record = send[rank];
+    for (Uint n=0; n<sent_nodes[rank].size(); ++n)
     {
-      ghostnode_glb_idx[cnt] = nodes_glb_idx[i];
-
-      DynTable<Uint>::ConstRow elems = node2elem.connectivity()[i];
-      boost_foreach(const Uint e, elems)
+      const Uint i = sent_nodes[rank][n].second;
+      record.push_back(nodes_glb_idx[i]);
+      if (nodes.is_ghost(i))
       {
-        boost::tie(elem_comp,elem_idx) = node2elem.elements().location(e);
-        ghostnode_glb_elem_connectivity.push_back(dynamic_cast<Elements&>(*elem_comp).glb_idx()[elem_idx]);
+        DynTable<Uint>::ConstRow elems = node2elem.connectivity()[i];
+        record.push_back(elems.size());
+        boost_foreach(const Uint e, elems)
+        {
+          boost::tie(elem_comp,elem_idx) = node2elem.elements().location(e);
+          record.push_back(dynamic_cast<Elements&>(*elem_comp).glb_idx()[elem_idx]);
+        }
+      }
+      else
+      {
+        record.push_back(0u);
       }
-      ghostnode_glb_elem_connectivity_start[cnt+1] = ghostnode_glb_elem_connectivity_start[cnt] + elems.size();
-
-      ++cnt;
     }
   }
 
-  // 4)
-  std::vector<std::vector<Uint> > glb_elem_connectivity(nodes.size());
-  nodes_glb_idx.resize(mesh.geometry_fields().size());
+  std::vector< std::vector<Uint> > recv;
+  PE::Comm::instance().all_to_all(send, recv);
 
-  for (Uint root=0; root<PE::Comm::instance().size(); ++root)
+  // 3)
+  // Directory entry for each received record: glb_idx, rank, position of the elements in recv
+  std::vector< boost::tuple<Uint,Uint,Uint> > directory;
+  for (Uint rank=0; rank<nb_procs; ++rank)
+  {
+    for (Uint j=0; j<recv[rank].size(); j += 2 + recv[rank][j+1])
+      directory.push_back(boost::make_tuple(recv[rank][j], rank, j));
+  }
+  std::sort(directory.begin(), directory.end());
+
+  for (Uint rank=0; rank<nb_procs; ++rank)
+    send[rank].clear();
+  for (Uint begin=0; begin<directory.size(); )
   {
-    std::vector<Uint> rcv_glb_node_idx(0);//ghostnode_glb_idx.size());
-    PE::Comm::instance().broadcast(ghostnode_glb_idx,rcv_glb_node_idx,root);
-    std::vector<Uint> rcv_glb_elem_connectivity(0);//ghostnode_glb_elem_connectivity.size());
-    PE::Comm::instance().broadcast(ghostnode_glb_elem_connectivity,rcv_glb_elem_connectivity,root);
-    std::vector<Uint> rcv_glb_elem_connectivity_start(0);//ghostnode_glb_elem_connectivity_start.size());
-    PE::Comm::instance().broadcast(ghostnode_glb_elem_connectivity_start,rcv_glb_elem_connectivity_start,root);
-
-    if (PE::Comm::instance().rank() != root)
+    Uint end=begin;
+    while (end < directory.size() && boost::get<0>(directory[end]) == boost::get<0>(directory[begin]))
+      ++end;
+
+    // Answer each rank holding this node with the elements connected by the other ranks.
+    // The entries are sorted by glb_idx, which is the order of the records received from each rank
+    for (Uint to=begin; to<end; ++to)
     {
-      for (Uint p=0; p<PE::Comm::instance().size(); ++p)
+      const Uint to_rank = boost::get<1>(directory[to]);
+      std::vector<Uint>& answer = send[to_rank];
+      const Uint size_idx = answer.size();
+      answer.push_back(0u);
+      for (Uint from=begin; from<end; ++from)
       {
-        if (p == PE::Comm::instance().rank())
-        {
-          Uint rcv_idx(0);
-          boost_foreach(const std::size_t glb_node, rcv_glb_node_idx)
-          {
-            if (node_glb2loc.find(glb_node) != node_glb2loc.end())
-            {
-              //std::cout << "["<<PE::Comm::instance().rank() << "] owns ghostnode " << glb_node << " of [" << root << "]" << std::endl;
-              Uint loc_node_idx = node_glb2loc[glb_node];
-              for(Uint l=rcv_glb_elem_connectivity_start[rcv_idx]; l<rcv_glb_elem_connectivity_start[rcv_idx+1]; ++l)
-                glb_elem_connectivity[loc_node_idx].push_back(rcv_glb_elem_connectivity[l]);
-            }
-            ++rcv_idx;
-          }
-          break;
-        }
+        const Uint from_rank = boost::get<1>(directory[from]);
+        if (from_rank == to_rank)
+          continue;
+        const Uint pos = boost::get<2>(directory[from]);
+        const Uint nb_elems = recv[from_rank][pos+1];
+        answer.insert(answer.end(), recv[from_rank].begin()+pos+2, recv[from_rank].begin()+pos+2+nb_elems);
+        answer[size_idx] += nb_elems;
       }
     }
+    begin=end;
   }
 
+  PE::Comm::instance().all_to_all(send, recv);
 
+  std::vector<std::vector<Uint> > glb_elem_connectivity(nodes.size());
+  for (Uint rank=0; rank<nb_procs; ++rank)
+  {
+    Uint pos=0;
+    for (Uint n=0; n<sent_nodes[rank].size(); ++n)
+    {
+      const Uint loc_node_idx = sent_nodes[rank][n].second;
+      const Uint nb_elems = recv[rank][pos];
+      glb_elem_connectivity[loc_node_idx].assign(recv[rank].begin()+pos+1, recv[rank].begin()+pos+1+nb_elems);
+      pos += 1 + nb_elems;
+    }
+  }
+
+  // 4)
   DynTable<Uint>& nodes_glb_elem_connectivity = mesh.geometry_fields().glb_elem_connectivity();
 //  CFinfo << "nodes_glb_elem_connectivity = " << nodes_glb_elem_connectivity.uri() << CFendl;
   nodes_glb_elem_connectivity.resize(glb_elem_connectivity.size());
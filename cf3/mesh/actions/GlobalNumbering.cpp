@@ -21,6 +21,7 @@
 
 #include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
+#include "common/PE/directory.hpp"
 
 #include "math/MatrixTypesConversion.hpp"
 #include "math/Hilbert.hpp"
@@ -186,20 +187,10 @@ void GlobalNumbering::execute()
 
   // now renumber
 
-  //------------------------------------------------------------------------------
-  // create node_hilbert2loc mapping
-  Dictionary& nodes = mesh.geometry_fields();
-  std::map<boost::uint64_t,Uint> node_hilbert2loc;
-  Uint loc_node_idx(0);
-  boost_foreach(boost::uint64_t hilbert_idx, hilbert_indices.data())
-    node_hilbert2loc[hilbert_idx]=loc_node_idx++;
-
-  // Check if all nodes have been added to the map
-  cf3_assert(loc_node_idx==nodes.size());
-
   //------------------------------------------------------------------------------
   // get tot nb of owned indexes and communicate
 
+  Dictionary& nodes = mesh.geometry_fields();
   Uint nb_owned_nodes(0);
   common::List<Uint>& nodes_rank = mesh.geometry_fields().rank();
   nodes_rank.resize(nodes.size());
@@ -245,76 +236,36 @@ void GlobalNumbering::execute()
 
 
   //------------------------------------------------------------------------------
-  // add glb_idx to owned nodes, broadcast/receive glb_idx for ghost nodes
-
-  std::vector<boost::uint64_t> node_from(nb_owned_nodes);
-  std::vector<boost::uint64_t> node_to(nb_owned_nodes);
+  // add glb_idx to owned nodes, look up glb_idx of ghost nodes in the directory,
+  // which is distributed over the processes by hilbert index
 
   common::List<Uint>& nodes_glb_idx = mesh.geometry_fields().glb_idx();
   nodes_glb_idx.resize(nodes.size());
 
-  Uint cnt=0;
+  std::vector<bool> node_is_owned(nodes.size());
+  std::vector<Uint> node_glb_idx(nodes.size(), uint_max());
+  std::vector<Uint> node_owner(nodes.size());
   Uint glb_id = start_id_per_proc[PE::Comm::instance().rank()];
   for (Uint i=0; i<nodes.size(); ++i)
   {
     cf3_assert(nodes.rank()[i] < PE::Comm::instance().size());
-    if ( ! nodes.is_ghost(i) )
-    {
-      nodes_glb_idx[i] = glb_id++;
-      node_from[cnt] = hilbert_indices.data()[i];
-      node_to[cnt]   = nodes_glb_idx[i];
-      ++cnt;
-    }
-    else
-    {
-      nodes_glb_idx[i] = uint_max();
-    }
+    node_is_owned[i] = !nodes.is_ghost(i);
+    node_owner[i] = nodes_rank[i];
+    if ( node_is_owned[i] )
+      node_glb_idx[i] = glb_id++;
   }
 
-  for (Uint root=0; root<PE::Comm::instance().size(); ++root)
-  {
-
-    std::vector<boost::uint64_t> rcv_node_from(0);
-    PE::Comm::instance().broadcast(node_from,rcv_node_from,root);
-    std::vector<boost::uint64_t>        rcv_node_to(0);
-    PE::Comm::instance().broadcast(node_to,rcv_node_to,root);
+  PE::directory_lookup(hilbert_indices.data(), node_is_owned, node_glb_idx, node_owner);
 
-    if (m_debug)
-    {
-      std::cout << "["<<PE::Comm::instance().rank() << "]  received nodes from " << root << std::endl;
-    }
-
-    if (PE::Comm::instance().rank() != root)
-    {
-      for (Uint p=0; p<PE::Comm::instance().size(); ++p)
-      {
-        if (p == PE::Comm::instance().rank())
-        {
-          Uint rcv_idx(0);
-          boost_foreach(const boost::uint64_t hilbert_idx, rcv_node_from)
-          {
-            if ( node_hilbert2loc.count(hilbert_idx) )
-            {
-              const Uint loc_idx = node_hilbert2loc[hilbert_idx];
-              if (m_debug)
-                std::cout << "["<<PE::Comm::instance().rank() << "]  will change node "<< hilbert_idx << " (" << loc_idx<< ") to " << rcv_node_to[rcv_idx] << std::endl;
-              cf3_assert(rcv_idx < rcv_node_to.size());
-              nodes_glb_idx[loc_idx]=rcv_node_to[rcv_idx];
-              cf3_assert(loc_idx < nodes_rank.size());
-              cf3_assert_desc("node "+to_str(loc_idx)+ " with hilbert_idx " +to_str(hilbert_idx) +" must be a ghost, but is owned by "+to_str(nodes_rank[loc_idx]),nodes.is_ghost(loc_idx));
-              nodes_rank[loc_idx]=std::min(root,nodes_rank[loc_idx]);
-            }
-            ++rcv_idx;
-          }
-          break;
-        }
-      }
-    }
-    if (m_debug)
+  for (Uint i=0; i<nodes.size(); ++i)
+  {
+    nodes_glb_idx[i] = node_glb_idx[i];
+    if ( !node_is_owned[i] && node_glb_idx[i] != uint_max() )
     {
-      std::cout << "["<<PE::Comm::instance().rank() << "]  changed nodes based on " << root << std::endl;
+      if (m_debug)
+        std::cout << "["<<PE::Comm::instance().rank() << "]  changed node "<< hilbert_indices.data()[i] << " (" << i << ") to " << node_glb_idx[i] << std::endl;
+      nodes_rank[i]=std::min(node_owner[i],nodes_rank[i]);
     }
-
   }
 
   if (m_debug)
@@ -332,7 +283,7 @@ void GlobalNumbering::execute()
   }
 
   //------------------------------------------------------------------------------
-  // give glb idx to elements
+  // give glb idx to elements, each Entities has its own directory lookup
 
   boost_foreach( Entities& elements, find_components_recursively<Entities>(mesh) )
   {
@@ -342,83 +293,37 @@ void GlobalNumbering::execute()
     common::List<Uint>& elem_rank = elements.rank();
     elem_rank.resize(elements.size());
 
-    //------------------------------------------------------------------------------
-    // create elem_glb2loc mapping
-    Uint nb_owned_elems=0;
-    std::map<boost::uint64_t,Uint> elem_glb2loc;
-    std::map<boost::uint64_t,Uint>::iterator elem_glb2loc_it;
-    std::map<boost::uint64_t,Uint>::iterator hash_not_found = elem_glb2loc.end();
-
-    for (Uint e=0; e<elements.size(); ++e)
-    {
-      elem_glb2loc [ hilbert_indices[e] ] = e;
-      if ( ! elements.is_ghost(e) )
-        ++nb_owned_elems;
-    }
-
-
-    std::vector<boost::uint64_t> send_hash(nb_owned_elems);
-    std::vector<boost::uint64_t>   send_id(nb_owned_elems);
-
     common::List<Uint>& elements_glb_idx = elements.glb_idx();
     elements_glb_idx.resize(elements.size());
     cf3_assert(hilbert_indices.size() == elements.size());
 
-    Uint cnt(0);
+    std::vector<bool> elem_is_owned(elements.size());
+    std::vector<Uint> elem_glb_idx(elements.size(), uint_max());
+    std::vector<Uint> elem_owner(elements.size());
     for (Uint e=0; e<elements.size(); ++e)
     {
-
-      if ( ! elements.is_ghost(e) )
+      elem_is_owned[e] = !elements.is_ghost(e);
+      elem_owner[e] = elem_rank[e];
+      if ( elem_is_owned[e] )
       {
         if (m_debug)
           std::cout << "["<<PE::Comm::instance().rank() << "]  will change owned elem "<< hilbert_indices[e] << " (" << elements.uri().path() << "["<<e<<"]) to " << glb_id << std::endl;
-
-        elements_glb_idx[e] = glb_id++;
-        send_hash[cnt] = hilbert_indices[e];
-        send_id[cnt]   = elements_glb_idx[e];
-        ++cnt;
-      }
-      else
-      {
-        elements_glb_idx[e] = uint_max();
+        elem_glb_idx[e] = glb_id++;
       }
-    } // end foreach elem_idx
-    cf3_assert(cnt == nb_owned_elems);
+    }
+
+    PE::directory_lookup(hilbert_indices, elem_is_owned, elem_glb_idx, elem_owner);
 
-    for (Uint root=0; root<PE::Comm::instance().size(); ++root)
+    for (Uint e=0; e<elements.size(); ++e)
     {
-      std::vector<boost::uint64_t> recv_hash(0);
-      PE::Comm::instance().broadcast(send_hash,recv_hash,root);
-      std::vector<boost::uint64_t>        recv_id(0);
-      PE::Comm::instance().broadcast(send_id,recv_id,root);
-      if (PE::Comm::instance().rank() != root)
+      elements_glb_idx[e] = elem_glb_idx[e];
+      if ( !elem_is_owned[e] && elem_glb_idx[e] != uint_max() )
       {
-        for (Uint p=0; p<PE::Comm::instance().size(); ++p)
-        {
-          if (p == PE::Comm::instance().rank())
-          {
-            Uint recv_idx(0);
-            boost_foreach(const boost::uint64_t hash, recv_hash)
-            {
-              elem_glb2loc_it = elem_glb2loc.find(hash);
-              if ( elem_glb2loc_it != hash_not_found )
-              {
-                if (m_debug)
-                  std::cout << "["<<PE::Comm::instance().rank() << "]  will change ghost elem "<< elem_glb2loc_it->first << " (" << elements.uri() << "[" << elem_glb2loc_it->second << "]) to " << recv_id[recv_idx] << std::endl;
-                elements_glb_idx[elem_glb2loc_it->second]=recv_id[recv_idx];
-                cf3_assert(elements.is_ghost(elem_glb2loc_it->second));
-                elem_rank[elem_glb2loc_it->second]=root;
-              }
-              ++recv_idx;
-            }
-            break;
-          }
-        }
+        if (m_debug)
+          std::cout << "["<<PE::Comm::instance().rank() << "]  changed ghost elem "<< hilbert_indices[e] << " (" << elements.uri() << "[" << e << "]) to " << elem_glb_idx[e] << std::endl;
+        elem_rank[e]=elem_owner[e];
       }
-    } // end foreach broadcasting process
-
-
-
+    }
   } // end foreach elements
 
 
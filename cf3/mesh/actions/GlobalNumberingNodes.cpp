@@ -26,6 +26,7 @@
 #include "common/OptionT.hpp"
 #include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
+#include "common/PE/directory.hpp"
 
 #include "mesh/actions/GlobalNumberingNodes.hpp"
 #include "mesh/Region.hpp"
@@ -121,16 +122,6 @@ void GlobalNumberingNodes::execute()
 
   // now renumber
 
-  //------------------------------------------------------------------------------
-  // create node_glb2loc mapping
-  std::map<std::size_t,Uint> node_glb2loc;
-  Uint loc_node_idx(0);
-  boost_foreach(std::size_t hash, glb_node_hash.data())
-    node_glb2loc[hash]=loc_node_idx++;
-  std::map<std::size_t,Uint>::iterator node_glb2loc_it;
-  std::map<std::size_t,Uint>::iterator hash_not_found = node_glb2loc.end();
-
-
   //------------------------------------------------------------------------------
   // get tot nb of owned indexes and communicate
 
@@ -171,63 +162,37 @@ void GlobalNumberingNodes::execute()
 
 
   //------------------------------------------------------------------------------
-  // add glb_idx to owned nodes, broadcast/receive glb_idx for ghost nodes
-
-  std::vector<size_t> node_from(nodes.size()-nb_ghost);
-  std::vector<Uint>   node_to(nodes.size()-nb_ghost);
+  // add glb_idx to owned nodes, look up glb_idx of ghost nodes in the directory,
+  // which is distributed over the processes by node hash
 
   common::List<Uint>& nodes_glb_idx = mesh.geometry_fields().glb_idx();
   nodes_glb_idx.resize(nodes.size());
 
-  Uint cnt=0;
+  std::vector<bool> node_is_owned(nodes.size());
   Uint glb_id = start_id_per_proc[PE::Comm::instance().rank()];
   for (Uint i=0; i<nodes.size(); ++i)
   {
-    if ( ! nodes.is_ghost(i) )
-    {
+    node_is_owned[i] = !nodes.is_ghost(i);
+    if ( node_is_owned[i] )
       nodes_glb_idx[i] = glb_id++;
-      node_from[cnt] = glb_node_hash.data()[i];
-      node_to[cnt]   = nodes_glb_idx[i];
-      ++cnt;
-    }
   }
 
-  for (Uint root=0; root<PE::Comm::instance().size(); ++root)
+  if (PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1)
   {
-    //std::vector<std::size_t> rcv_node_from = MPI::broadcast(node_from, root);
-    //std::vector<Uint>        rcv_node_to   = MPI::broadcast(node_to, root);
-    // PECheckPoint(100,"001");
-    std::vector<std::size_t> rcv_node_from(0);//node_from.size());
-    PE::Comm::instance().broadcast(node_from,rcv_node_from,root);
-    //PECheckPoint(100,"002");
-    std::vector<Uint>        rcv_node_to(0);//node_to.size());
-    PE::Comm::instance().broadcast(node_to,rcv_node_to,root);
-    //PECheckPoint(100,"003");
-    if (PE::Comm::instance().rank() != root)
+    std::vector<Uint> node_glb_idx(nodes_glb_idx.array().begin(), nodes_glb_idx.array().end());
+    std::vector<Uint> node_owner(nodes_rank.array().begin(), nodes_rank.array().end());
+    PE::directory_lookup(glb_node_hash.data(), node_is_owned, node_glb_idx, node_owner);
+
+    for (Uint i=0; i<nodes.size(); ++i)
     {
-      for (Uint p=0; p<PE::Comm::instance().size(); ++p)
-      {
-        if (p == PE::Comm::instance().rank())
-        {
-          Uint rcv_idx(0);
-          boost_foreach(const std::size_t node_hash, rcv_node_from)
-          {
-            node_glb2loc_it = node_glb2loc.find(node_hash);
-            if ( node_glb2loc_it != hash_not_found )
-            {
-              if (m_debug)
-                std::cout << "["<<PE::Comm::instance().rank() << "]  will change node "<< node_glb2loc_it->first << " (" << node_glb2loc_it->second << ") to " << rcv_node_to[rcv_idx] << std::endl;
-              nodes_glb_idx[node_glb2loc_it->second]=rcv_node_to[rcv_idx];
-              nodes_rank[node_glb2loc_it->second]=root;
-            }
-            ++rcv_idx;
-          }
-          break;
-        }
-      }
+      if ( node_is_owned[i] )
+        continue;
+      if (m_debug)
+        std::cout << "["<<PE::Comm::instance().rank() << "]  will change node "<< glb_node_hash.data()[i] << " (" << i << ") to " << node_glb_idx[i] << std::endl;
+      nodes_glb_idx[i]=node_glb_idx[i];
+      nodes_rank[i]=node_owner[i];
     }
   }
-
 }
 
 ////////////////////////////////////////////////////////////////////////////////
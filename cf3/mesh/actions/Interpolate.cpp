@@ -173,11 +173,21 @@ void Interpolate::interpolate(const Field& source, const common::Table<Real>& co
   m_source = Handle<Field const>(source.handle<Component>());
 
   Entity element;
-  std::deque<Uint> missing_cells;
+  std::vector<bool> found(coordinates.size(), false);
 
   RealVector coord(dimension); coord.setZero();
   const Uint target_dim = coordinates.row_size();
 
+  const bool parallel = PE::Comm::instance().is_active() && PE::Comm::instance().size() > 1;
+  const Uint nb_procs = parallel ? PE::Comm::instance().size() : 1;
+  if (parallel && !m_octtree->is_partition_index_created())
+    m_octtree->create_partition_index();
+
+  // Coordinates not found on this rank are sent only to the ranks whose partition may contain them
+  std::vector< std::vector<Real> > send_coords(nb_procs);
+  std::vector< std::vector<Uint> > sent_cells(nb_procs);
+  std::vector<Uint> candidates;
+
   for(Uint i=0; i<coordinates.size(); ++i)
   {
     for (Uint d=0; d<target_dim; ++d)
@@ -185,120 +195,76 @@ void Interpolate::interpolate(const Field& source, const common::Table<Real>& co
     if( m_octtree->find_element(coord,element) )
     {
       interpolate_coordinate( coord, *element.comp, element.idx, target[i] );
-//      std::cout<< PERank << "interpolate for coord (" << coord.transpose() << ") in " << element_component->uri().path() << "["<<element_idx<<"] ... done" << std::endl;
+      found[i] = true;
     }
-    else
+    else if (parallel)
     {
-//      std::cout << PERank<< "coord " << coord.transpose() << " not found " << std::endl;
-      for (Uint v=0; v<nb_vars; ++v)
-        target[i][v] = math::Consts::real_max();
-      missing_cells.push_back(i);
+      m_octtree->find_candidate_ranks(coord, candidates);
+      boost_foreach(const Uint candidate, candidates)
+      {
+        for (Uint d=0; d<target_dim; ++d)
+          send_coords[candidate].push_back(coord[d]);
+        sent_cells[candidate].push_back(i);
+      }
     }
   }
 
-  std::vector<Real> send_coords(target_dim*missing_cells.size());
-  std::vector<Real> recv_coords;
-
-  Uint c(0);
-  boost_foreach(const Uint i, missing_cells)
-  {
-    for(Uint d=0; d<target_dim; ++d)
-      send_coords[c++]=coordinates[i][d];
-  }
-
-  for (Uint root=0; root<PE::Comm::instance().size(); ++root)
+  if (parallel)
   {
-
-//    if (root == PE::Comm::instance().rank())
-//    {
-//      std::cout << PERank << "send coords = ";
-//      for(Uint i=0; i<send_coords.size(); ++i)
-//         std::cout << send_coords[i] << " ";
-//      std::cout << std::endl;
-//    }
-    recv_coords.resize(0);
-    PE::Comm::instance().broadcast(send_coords,recv_coords,root,target_dim);
-
-//    if (root != PE::Comm::instance().rank())
-//    {
-//      std::cout << PERank << "recv coords = ";
-//      for(Uint i=0; i<recv_coords.size(); ++i)
-//         std::cout << recv_coords[i] << " ";
-//      std::cout << std::endl;
-//    }
-
-
-    // size is only because it doesn't get resized for this rank
-    std::vector<Real> send_target_rows(nb_vars*missing_cells.size(),math::Consts::uint_max());
-
-    if (root!=Comm::instance().rank())
+    std::vector< std::vector<Real> > recv_coords;
+    PE::Comm::instance().all_to_all(send_coords, recv_coords);
+
+    // For every received coordinate: a found flag followed by the interpolated values
+    const Uint stride = nb_vars+1;
+    std::vector< std::vector<Real> > send_target_rows(nb_procs);
+    boost::multi_array<Real,2> target_row(boost::extents[1][nb_vars]);
+    for (Uint p=0; p<nb_procs; ++p)
     {
-      std::vector<RealVector> recv_coordinates(recv_coords.size()/target_dim) ;
-      boost_foreach(RealVector& realvec, recv_coordinates)
-          realvec.resize(target_dim);
-
-      c=0;
-      for (Uint i=0; i<recv_coordinates.size(); ++i)
-      {
-        for(Uint d=0; d<target_dim; ++d)
-          recv_coordinates[i][d]=recv_coords[c++];
-      }
-
-      send_target_rows.resize(recv_coordinates.size()*nb_vars);
-      for (Uint i=0; i<recv_coordinates.size(); ++i)
+      const Uint nb_recv = recv_coords[p].size()/target_dim;
+      send_target_rows[p].assign(nb_recv*stride, 0.);
+      for (Uint i=0; i<nb_recv; ++i)
       {
         for (Uint d=0; d<target_dim; ++d)
-          coord[d] = recv_coordinates[i][d];
+          coord[d] = recv_coords[p][i*target_dim+d];
 
         if( m_octtree->find_element(coord,element) )
         {
-//          std::cout<< PERank << " send to " << root << ": interpolate for coord (" << coord.transpose() << ") in " << element_component->uri().path() << "["<<element_idx<<"]" << std::endl;
-          boost::multi_array<Real,2> target_row(boost::extents[1][nb_vars]);
           interpolate_coordinate( coord, *element.comp, element.idx, target_row[0] );
+          send_target_rows[p][i*stride] = 1.;
           for (Uint v=0; v<nb_vars; ++v)
-            send_target_rows[i*nb_vars+v] = target_row[0][v];
-        }
-        else
-        {
-//          std::cout << PERank<< " send to " << root << ": coord " << coord.transpose() << " not found " << std::endl;
-          for (Uint v=0; v<nb_vars; ++v)
-            send_target_rows[i*nb_vars+v] = math::Consts::real_max();
+            send_target_rows[p][i*stride+1+v] = target_row[0][v];
         }
       }
     }
 
-    std::vector<Real> recv_target_rows(nb_vars*missing_cells.size()*Comm::instance().size());
-    PE::Comm::instance().gather(send_target_rows,recv_target_rows,root);
+    std::vector< std::vector<Real> > recv_target_rows;
+    PE::Comm::instance().all_to_all(send_target_rows, recv_target_rows);
 
-    if( root==Comm::instance().rank())
+    // The lowest rank that found the coordinate provides the value
+    for (Uint p=0; p<nb_procs; ++p)
     {
-      const Uint nb_cells = missing_cells.size();
-      for (Uint i=0; i<missing_cells.size(); ++i)
+      cf3_assert(recv_target_rows[p].size() == sent_cells[p].size()*stride);
+      for (Uint i=0; i<sent_cells[p].size(); ++i)
       {
-        for(Uint p=0; p<Comm::instance().size(); ++p)
-        {
-          for(Uint v=0; v<nb_vars;  ++v)
-            target[missing_cells[i]][v] = std::min(recv_target_rows[v+nb_vars*(i+p*nb_cells)] , target[missing_cells[i]][v]);
-        }
+        const Uint cell = sent_cells[p][i];
+        if (found[cell] || recv_target_rows[p][i*stride] == 0.)
+          continue;
+        for (Uint v=0; v<nb_vars; ++v)
+          target[cell][v] = recv_target_rows[p][i*stride+1+v];
+        found[cell] = true;
       }
-    } // endif root==rank
-  } // end foreach root
-
+    }
+  }
 
-  missing_cells.clear();
+  std::vector<Uint> missing_cells;
   for (Uint i=0; i<target.size(); ++i)
   {
-    bool found = true;
-    for (Uint v=0; v<target.row_size(); ++v)
+    if (!found[i])
     {
-      if (target[i][v] == math::Consts::uint_max())
-      {
+      for (Uint v=0; v<target.row_size(); ++v)
         target[i][v] = 0.;
-        found &= false;
-      }
-    }
-    if (!found)
       missing_cells.push_back(i);
+    }
   }
   if(missing_cells.size())
   {
@@ -49,8 +49,8 @@ public: // functions
   /// @param [in]  coordinates  interpolate at these coordinates (rows are coordinates)
   /// @param [out] target       Table of interpolated values at the given coordinates
   /// @post target is resized: row-size from source, nb_rows from coordinates
-  /// @note MPI communication is used if coordinates are not found on this rank. Other ranks
-  ///       then interpolate and send result back
+  /// @note MPI communication is used if coordinates are not found on this rank. They are sent only to the
+  ///       ranks whose partition bounding box contains them, which interpolate and send the result back
   void interpolate(const Field& source, const common::Table<Real>& coordinates, common::Table<Real>& target);
 
   void signal_interpolate ( common::SignalArgs& node);
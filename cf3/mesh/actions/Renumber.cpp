@@ -0,0 +1,487 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <numeric>
+
+#include <boost/cstdint.hpp>
+
+#include "common/Builder.hpp"
+#include "common/DynTable.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+#include "common/Table.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/BoundingBox.hpp"
+#include "math/Hilbert.hpp"
+
+#include "mesh/actions/Renumber.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/FaceCellConnectivity.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/NodeElementConnectivity.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace actions {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < Renumber, MeshTransformer, mesh::actions::LibActions> Renumber_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Node to node graph in compressed row storage
+struct NodeGraph
+{
+  /// Build the graph, two nodes are connected if they are used by the same element in any space of the dictionary
+  NodeGraph(const Dictionary& dict)
+  {
+    const Uint nb_nodes = dict.size();
+
+    // Upper bound for the number of neighbours of each node
+    row_start.assign(nb_nodes+1, 0);
+    boost_foreach(const Handle<Space>& space, dict.spaces())
+    {
+      const Connectivity& connectivity = space->connectivity();
+      const Uint nb_elem_nodes = connectivity.row_size();
+      boost_foreach(Connectivity::ConstRow row, connectivity.array())
+      {
+        boost_foreach(const Uint node, row)
+          row_start[node+1] += nb_elem_nodes - 1;
+      }
+    }
+    std::partial_sum(row_start.begin(), row_start.end(), row_start.begin());
+
+    columns.resize(row_start.back());
+    std::vector<Uint> row_end(row_start.begin(), row_start.end()-1);
+    boost_foreach(const Handle<Space>& space, dict.spaces())
+    {
+      boost_foreach(Connectivity::ConstRow row, space->connectivity().array())
+      {
+        boost_foreach(const Uint a, row)
+        {
+          boost_foreach(const Uint b, row)
+          {
+            if(a != b)
+              columns[row_end[a]++] = b;
+          }
+        }
+      }
+    }
+
+    // Remove duplicates and compress
+    Uint nb_columns = 0;
+    for(Uint node = 0; node != nb_nodes; ++node)
+    {
+      std::vector<Uint>::iterator begin = columns.begin() + row_start[node];
+      std::vector<Uint>::iterator end = columns.begin() + row_end[node];
+      std::sort(begin, end);
+      end = std::unique(begin, end);
+      row_start[node] = nb_columns;
+      nb_columns = std::copy(begin, end, columns.begin() + nb_columns) - columns.begin();
+    }
+    row_start[nb_nodes] = nb_columns;
+    columns.resize(nb_columns);
+  }
+
+  Uint size() const { return row_start.size() - 1; }
+
+  Uint degree(const Uint node) const { return row_start[node+1] - row_start[node]; }
+
+  std::vector<Uint> row_start;
+  std::vector<Uint> columns;
+};
+
+/// Sorts nodes by increasing degree
+struct LessDegree
+{
+  LessDegree(const NodeGraph& g) : graph(g) {}
+  bool operator()(const Uint a, const Uint b) const { return graph.degree(a) < graph.degree(b); }
+  const NodeGraph& graph;
+};
+
+/// Sorts indices by increasing key
+struct LessKey
+{
+  LessKey(const std::vector<boost::uint64_t>& k) : keys(k) {}
+  bool operator()(const Uint a, const Uint b) const { return keys[a] < keys[b]; }
+  const std::vector<boost::uint64_t>& keys;
+};
+
+/// True for the rows that are owned by this rank
+struct IsOwned
+{
+  IsOwned(const List<Uint>& r) : rank(r), my_rank(PE::Comm::instance().rank()) {}
+  bool operator()(const Uint i) const { return rank[i] == my_rank; }
+  const List<Uint>& rank;
+  const Uint my_rank;
+};
+
+/// Breadth-first traversal from root, returning the depth of the level structure.
+/// The nodes of the last level are put in last_level.
+Uint level_structure(const NodeGraph& graph, const Uint root, std::vector<Uint>& distance, std::vector<Uint>& queue, std::vector<Uint>& last_level)
+{
+  queue.clear();
+  queue.push_back(root);
+  distance[root] = 0;
+  for(Uint head = 0; head != queue.size(); ++head)
+  {
+    const Uint node = queue[head];
+    for(Uint j = graph.row_start[node]; j != graph.row_start[node+1]; ++j)
+    {
+      const Uint neighbour = graph.columns[j];
+      if(distance[neighbour] == std::numeric_limits<Uint>::max())
+      {
+        distance[neighbour] = distance[node] + 1;
+        queue.push_back(neighbour);
+      }
+    }
+  }
+
+  const Uint depth = distance[queue.back()];
+  last_level.clear();
+  boost_foreach(const Uint node, queue)
+  {
+    if(distance[node] == depth)
+      last_level.push_back(node);
+    distance[node] = std::numeric_limits<Uint>::max();
+  }
+  return depth;
+}
+
+/// Reverse Cuthill-McKee ordering, each connected component starting from a pseudo-peripheral node (George-Liu)
+void rcm_order(const Dictionary& dict, std::vector<Uint>& order)
+{
+  const NodeGraph graph(dict);
+  const Uint nb_nodes = graph.size();
+  const LessDegree less_degree(graph);
+
+  std::vector<Uint> by_degree(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+    by_degree[i] = i;
+  std::stable_sort(by_degree.begin(), by_degree.end(), less_degree);
+
+  std::vector<Uint> distance(nb_nodes, std::numeric_limits<Uint>::max());
+  std::vector<Uint> queue, last_level, neighbours;
+  std::vector<bool> visited(nb_nodes, false);
+  order.clear();
+  order.reserve(nb_nodes);
+
+  boost_foreach(Uint start, by_degree)
+  {
+    if(visited[start])
+      continue;
+
+    // Find a pseudo-peripheral node of this component
+    Uint depth = level_structure(graph, start, distance, queue, last_level);
+    while(true)
+    {
+      const Uint candidate = *std::min_element(last_level.begin(), last_level.end(), less_degree);
+      std::vector<Uint> candidate_last_level;
+      const Uint candidate_depth = level_structure(graph, candidate, distance, queue, candidate_last_level);
+      if(candidate_depth <= depth)
+        break;
+      start = candidate;
+      depth = candidate_depth;
+      last_level.swap(candidate_last_level);
+    }
+
+    // Cuthill-McKee
+    Uint head = order.size();
+    order.push_back(start);
+    visited[start] = true;
+    for(; head != order.size(); ++head)
+    {
+      const Uint node = order[head];
+      neighbours.clear();
+      for(Uint j = graph.row_start[node]; j != graph.row_start[node+1]; ++j)
+      {
+        const Uint neighbour = graph.columns[j];
+        if(!visited[neighbour])
+        {
+          visited[neighbour] = true;
+          neighbours.push_back(neighbour);
+        }
+      }
+      std::stable_sort(neighbours.begin(), neighbours.end(), less_degree);
+      order.insert(order.end(), neighbours.begin(), neighbours.end());
+    }
+  }
+
+  std::reverse(order.begin(), order.end());
+}
+
+/// Order by increasing key, keeping the original order for equal keys
+void order_by_keys(const std::vector<boost::uint64_t>& keys, std::vector<Uint>& order)
+{
+  order.resize(keys.size());
+  for(Uint i = 0; i != keys.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), LessKey(keys));
+}
+
+/// Order along a Hilbert curve through the coordinates
+void hilbert_order(const Field& coordinates, std::vector<Uint>& order)
+{
+  RealVector point(coordinates.row_size());
+  math::BoundingBox bounding_box;
+  boost_foreach(Field::ConstRow row, coordinates.array())
+  {
+    for(Uint d = 0; d != point.size(); ++d)
+      point[d] = row[d];
+    bounding_box.extend(point);
+  }
+
+  math::Hilbert compute_key(bounding_box, 20);
+  std::vector<boost::uint64_t> keys(coordinates.size());
+  for(Uint i = 0; i != coordinates.size(); ++i)
+  {
+    for(Uint d = 0; d != point.size(); ++d)
+      point[d] = coordinates[i][d];
+    keys[i] = compute_key(point);
+  }
+  order_by_keys(keys, order);
+}
+
+/// Order following the first use of each node by the elements
+void first_touch_order(const Dictionary& dict, std::vector<Uint>& order)
+{
+  const Uint nb_nodes = dict.size();
+  std::vector<bool> touched(nb_nodes, false);
+  order.clear();
+  order.reserve(nb_nodes);
+  boost_foreach(const Handle<Space>& space, dict.spaces())
+  {
+    boost_foreach(Connectivity::ConstRow row, space->connectivity().array())
+    {
+      boost_foreach(const Uint node, row)
+      {
+        if(!touched[node])
+        {
+          touched[node] = true;
+          order.push_back(node);
+        }
+      }
+    }
+  }
+  for(Uint node = 0; node != nb_nodes; ++node)
+  {
+    if(!touched[node])
+      order.push_back(node);
+  }
+}
+
+/// Move row order[i] to row i
+template<typename ValueT>
+void permute_rows(Table<ValueT>& table, const std::vector<Uint>& order)
+{
+  const typename Table<ValueT>::ArrayT old_array(table.array());
+  for(Uint i = 0; i != order.size(); ++i)
+    table.array()[i] = old_array[order[i]];
+}
+
+/// Move entry order[i] to entry i
+template<typename ValueT>
+void permute_rows(List<ValueT>& list, const std::vector<Uint>& order)
+{
+  const typename List<ValueT>::ListT old_array(list.array());
+  for(Uint i = 0; i != order.size(); ++i)
+    list.array()[i] = old_array[order[i]];
+}
+
+/// Move row order[i] to row i
+template<typename ValueT>
+void permute_rows(DynTable<ValueT>& table, const std::vector<Uint>& order)
+{
+  typename DynTable<ValueT>::ArrayT old_array;
+  old_array.swap(table.array());
+  table.array().resize(order.size());
+  for(Uint i = 0; i != order.size(); ++i)
+    table.array()[i].swap(old_array[order[i]]);
+}
+
+/// Apply a new node order to a dictionary and everything referring to its nodes
+void renumber_nodes(Dictionary& dict, std::vector<Uint>& order)
+{
+  std::stable_partition(order.begin(), order.end(), IsOwned(dict.rank()));
+
+  std::vector<Uint> new_idx(order.size());
+  for(Uint i = 0; i != order.size(); ++i)
+    new_idx[order[i]] = i;
+
+  boost_foreach(Field& field, find_components<Field>(dict))
+  {
+    permute_rows(field, order);
+  }
+  permute_rows(dict.glb_idx(), order);
+  permute_rows(dict.rank(), order);
+
+  Handle< DynTable<Uint> > glb_elem_connectivity(dict.get_child("glb_elem_connectivity"));
+  if(is_not_null(glb_elem_connectivity) && glb_elem_connectivity->size() == order.size())
+    permute_rows(*glb_elem_connectivity, order);
+
+  boost_foreach(const Handle<Space>& space, dict.spaces())
+  {
+    boost_foreach(Connectivity::Row row, space->connectivity().array())
+    {
+      boost_foreach(Uint& node, row)
+        node = new_idx[node];
+    }
+  }
+
+  boost_foreach(PE::CommPattern& comm_pattern, find_components<PE::CommPattern>(dict))
+  {
+    comm_pattern.renumber(new_idx);
+  }
+}
+
+/// Apply a new element order to the entities and all of their spaces
+void renumber_elements(Entities& entities, std::vector<Uint>& order)
+{
+  std::stable_partition(order.begin(), order.end(), IsOwned(entities.rank()));
+
+  permute_rows(entities.glb_idx(), order);
+  permute_rows(entities.rank(), order);
+  boost_foreach(const Handle<Space>& space, entities.spaces())
+  {
+    permute_rows(space->connectivity(), order);
+  }
+}
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+Renumber::Renumber( const std::string& name )
+: MeshTransformer(name)
+{
+  properties()["brief"] = std::string("Reorder nodes and elements for memory locality");
+  properties()["description"] = std::string("Renumbers the local nodes of every dictionary and the elements of every Entities, "
+                                            "so that neighbours are close together in memory. Must be executed before building faces.");
+
+  std::vector<boost::any> algorithms;
+  algorithms.push_back(std::string("RCM"));
+  algorithms.push_back(std::string("Hilbert"));
+  options().add("algorithm", std::string("RCM"))
+      .pretty_name("Algorithm")
+      .description("Ordering of the geometry nodes: RCM for Reverse Cuthill-McKee on the node graph, Hilbert for a Hilbert curve through the coordinates")
+      .restricted_list() = algorithms;
+
+  options().add("elements", true)
+      .pretty_name("Elements")
+      .description("Also reorder the elements within each Entities");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Renumber::execute()
+{
+  Mesh& mesh = *m_mesh;
+
+  if(!find_components_recursively<FaceCellConnectivity>(mesh).empty() || !find_components_recursively<NodeElementConnectivity>(mesh).empty())
+    throw SetupError(FromHere(), "Mesh " + mesh.uri().string() + " already has face connectivity, " + uri().string() + " must be executed before building the faces");
+
+  const std::string algorithm = options().value<std::string>("algorithm");
+  Dictionary& geometry = mesh.geometry_fields();
+
+  CFdebug << "Renumbering " << geometry.size() << " nodes of " << mesh.uri().string() << " using " << algorithm << CFendl;
+  std::vector<Uint> order;
+  if(algorithm == "Hilbert")
+    detail::hilbert_order(geometry.coordinates(), order);
+  else
+    detail::rcm_order(geometry, order);
+  detail::renumber_nodes(geometry, order);
+
+  if(options().value<bool>("elements"))
+  {
+    const Field& coordinates = geometry.coordinates();
+    RealVector centroid(coordinates.row_size());
+    math::BoundingBox bounding_box;
+    boost_foreach(Field::ConstRow row, coordinates.array())
+    {
+      for(Uint d = 0; d != centroid.size(); ++d)
+        centroid[d] = row[d];
+      bounding_box.extend(centroid);
+    }
+    math::Hilbert compute_key(bounding_box, 20);
+
+    boost_foreach(Entities& entities, find_components_recursively<Entities>(mesh.topology()))
+    {
+      const Connectivity& connectivity = entities.geometry_space().connectivity();
+      std::vector<boost::uint64_t> keys(entities.size());
+      if(algorithm == "Hilbert")
+      {
+        for(Uint e = 0; e != entities.size(); ++e)
+        {
+          centroid.setZero();
+          boost_foreach(const Uint node, connectivity[e])
+          {
+            for(Uint d = 0; d != centroid.size(); ++d)
+              centroid[d] += coordinates[node][d];
+          }
+          centroid /= static_cast<Real>(connectivity.row_size());
+          keys[e] = compute_key(centroid);
+        }
+      }
+      else
+      {
+        for(Uint e = 0; e != entities.size(); ++e)
+          keys[e] = *std::min_element(connectivity[e].begin(), connectivity[e].end());
+      }
+      detail::order_by_keys(keys, order);
+      detail::renumber_elements(entities, order);
+    }
+  }
+
+  // The other dictionaries follow the elements
+  boost_foreach(const Handle<Dictionary>& dict, mesh.dictionaries())
+  {
+    if(dict.get() == &geometry)
+      continue;
+    detail::first_touch_order(*dict, order);
+    detail::renumber_nodes(*dict, order);
+  }
+
+  // Cached lists of used nodes are rebuilt on demand
+  std::vector< Handle<Component> > used_nodes;
+  boost_foreach(List<Uint>& list, find_components_recursively_with_tag< List<Uint> >(mesh, mesh::Tags::nodes_used()))
+  {
+    used_nodes.push_back(list.handle());
+  }
+  boost_foreach(const Handle<Component>& list, used_nodes)
+  {
+    list->parent()->remove_component(*list);
+  }
+
+  mesh.raise_mesh_changed();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
@@ -0,0 +1,53 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_actions_Renumber_hpp
+#define cf3_mesh_actions_Renumber_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/MeshTransformer.hpp"
+#include "mesh/actions/LibActions.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace actions {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Reorders the local nodes and elements of a mesh for memory locality.
+/// The geometry nodes are ordered using Reverse Cuthill-McKee on the node graph
+/// or along a Hilbert curve through the node coordinates. The elements of each Entities
+/// are then sorted by their lowest node index (RCM) or by the Hilbert index of their centroid,
+/// and the nodes of the other dictionaries follow the order in which the elements use them.
+/// On each rank the owned nodes and elements stay in front of the ghosts.
+/// All fields, connectivity tables and comm patterns are updated, global indices are not changed.
+/// This must be executed before the faces are built.
+class mesh_actions_API Renumber : public MeshTransformer
+{
+public: // functions
+
+  /// constructor
+  Renumber( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "Renumber"; }
+
+  virtual void execute();
+
+}; // end Renumber
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_actions_Renumber_hpp
@@ -0,0 +1,73 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_LibCF3Mesh_hpp
+#define cf3_LibCF3Mesh_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Library.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Define the macro cf3mesh_API
+/// @note build system defines COOLFLUID_CF3MESH_EXPORTS when compiling cf3mesh files
+#ifdef COOLFLUID_CF3MESH_EXPORTS
+#   define cf3mesh_API      CF3_EXPORT_API
+#   define cf3mesh_TEMPLATE
+#else
+#   define cf3mesh_API      CF3_IMPORT_API
+#   define cf3mesh_TEMPLATE CF3_TEMPLATE_EXTERN
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+/// @brief Library for the native binary checkpoint format
+namespace cf3mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Class defines the native binary mesh format operations, used for checkpointing
+class cf3mesh_API LibCF3Mesh :
+    public common::Library
+{
+public:
+
+  /// Constructor
+  LibCF3Mesh ( const std::string& name) : common::Library(name) {   }
+
+  /// @return string of the library namespace
+  static std::string library_namespace() { return "cf3.mesh.cf3mesh"; }
+
+  /// Static function that returns the library name.
+  /// Must be implemented for Library registration
+  /// @return name of the library
+  static std::string library_name() { return "cf3mesh"; }
+
+  /// Static function that returns the description of the library.
+  /// Must be implemented for Library registration
+  /// @return description of the library
+  static std::string library_description()
+  {
+    return "This library implements a native binary mesh format, to checkpoint and restart simulations.";
+  }
+
+  /// Gets the Class name
+  static std::string type_name() { return "LibCF3Mesh"; }
+}; // end LibCF3Mesh
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_LibCF3Mesh_hpp
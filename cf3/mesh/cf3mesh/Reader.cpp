@@ -0,0 +1,285 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionArray.hpp"
+#include "common/PropertyList.hpp"
+#include "common/StringConversion.hpp"
+#include "common/Table.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshMetadata.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+
+#include "mesh/cf3mesh/Reader.hpp"
+#include "mesh/cf3mesh/Shared.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace cf3mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < cf3mesh::Reader, MeshReader, LibCF3Mesh > aCF3MeshReader_Builder;
+
+//////////////////////////////////////////////////////////////////////////////
+
+Reader::Reader( const std::string& name )
+: MeshReader(name)
+{
+  options().add("state", std::vector<URI>())
+      .pretty_name("State")
+      .description("Components whose state is restored from the file, in the same order as they were written")
+      .mark_basic();
+
+  options().add("state_options", default_state_options())
+      .pretty_name("State Options")
+      .description("Names of the options of the state components that are restored. Other options stored in the file are ignored");
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> Reader::get_extensions()
+{
+  std::vector<std::string> extensions;
+  extensions.push_back(".cf3mesh");
+  return extensions;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::do_read_mesh_into(const URI& file_path, Mesh& mesh)
+{
+  BinaryInput file(rank_file_path(file_path));
+
+  if(file.nb_ranks() != PE::Comm::instance().size())
+    throw FileFormatError(FromHere(), file_path.string() + " was written by " + to_str(file.nb_ranks()) + " processes, but "
+                          + to_str(PE::Comm::instance().size()) + " are running");
+  if(file.rank() != PE::Comm::instance().rank())
+    throw FileFormatError(FromHere(), "Rank mismatch reading " + file_path.string());
+
+  mesh.metadata()["time"] = file.read_value<Real>("time");
+  mesh.metadata()["iter"] = file.read_value<Uint>("iter");
+  const Uint dimension = file.read_value<Uint>("dimension");
+
+  read_entities(file, mesh);
+
+  const Uint nb_dictionaries = file.read_value<Uint>("nb_dictionaries");
+  for(Uint i = 0; i != nb_dictionaries; ++i)
+  {
+    read_dictionary(file, mesh, dimension);
+  }
+
+  const std::vector<URI> state_uris = options().value< std::vector<URI> >("state");
+  const Uint nb_components = file.read_value<Uint>("nb_components");
+  if(!state_uris.empty() && state_uris.size() != nb_components)
+    throw SetupError(FromHere(), "File " + file_path.string() + " holds the state of " + to_str(nb_components) + " components, but "
+                     + to_str(state_uris.size()) + " were configured in " + uri().string());
+  for(Uint i = 0; i != state_uris.size(); ++i)
+  {
+    read_state(file, *access_component_checked(state_uris[i]));
+  }
+
+  mesh.update_structures();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_entities(BinaryInput& file, Mesh& mesh)
+{
+  const Uint nb_entities = file.read_value<Uint>("nb_entities");
+  for(Uint i = 0; i != nb_entities; ++i)
+  {
+    const std::string path = file.read_string("entities");
+    const std::string entities_type = file.read_string("entities_type");
+    const std::string element_type = file.read_string("element_type");
+
+    // Create the parent regions
+    std::vector<std::string> names;
+    boost::algorithm::split(names, path, boost::algorithm::is_any_of("/"));
+    Handle<Region> region(mesh.topology().handle<Region>());
+    for(Uint j = 0; j + 1 < names.size(); ++j)
+    {
+      Handle<Region> child(region->get_child(names[j]));
+      region = is_null(child) ? region->create_region(names[j]).handle<Region>() : child;
+    }
+
+    Handle<Entities> entities(region->create_component(names.back(), entities_type));
+    if(is_null(entities))
+      throw FileFormatError(FromHere(), entities_type + " is not an Entities type");
+    entities->initialize(element_type, mesh.geometry_fields());
+
+    const Uint nb_elements = file.next_block("glb_idx").rows;
+    entities->resize(nb_elements);
+    file.read_values(entities->glb_idx().array().data());
+    file.next_block("rank");
+    file.read_values(entities->rank().array().data());
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_dictionary(BinaryInput& file, Mesh& mesh, const Uint dimension)
+{
+  const std::string name = file.read_string("dictionary");
+  const std::string dictionary_type = file.read_string("dictionary_type");
+  const Uint size = file.next_block("glb_idx").rows;
+
+  Handle<Dictionary> dict;
+  if(name == mesh.geometry_fields().name())
+  {
+    mesh.initialize_nodes(size, dimension);
+    dict = mesh.geometry_fields().handle<Dictionary>();
+  }
+  else
+  {
+    dict = Handle<Dictionary>(mesh.create_component(name, dictionary_type));
+    if(is_null(dict))
+      throw FileFormatError(FromHere(), dictionary_type + " is not a Dictionary type");
+    dict->resize(size);
+  }
+
+  file.read_values(dict->glb_idx().array().data());
+  file.next_block("rank");
+  file.read_values(dict->rank().array().data());
+
+  const Uint nb_spaces = file.read_value<Uint>("nb_spaces");
+  for(Uint i = 0; i != nb_spaces; ++i)
+  {
+    Entities& entities = find_entities(mesh, file.read_string("support"));
+    const std::string shape_function = file.read_string("shape_function");
+
+    // The geometry spaces were created together with the entities
+    Handle<Space> space;
+    boost_foreach(const Handle<Space>& entities_space, entities.spaces())
+    {
+      if(&entities_space->dict() == dict.get())
+        space = entities_space;
+    }
+    if(is_null(space))
+      space = entities.create_space(shape_function, *dict).handle<Space>();
+
+    Connectivity& connectivity = space->connectivity();
+    const BlockHeader& block = file.next_block("connectivity");
+    if(block.rows != connectivity.size() || block.cols != connectivity.row_size())
+      throw FileFormatError(FromHere(), "Connectivity size mismatch for " + space->uri().string());
+    file.read_values(connectivity.array().data());
+  }
+
+  dict->update_structures();
+
+  const Uint nb_fields = file.read_value<Uint>("nb_fields");
+  for(Uint i = 0; i != nb_fields; ++i)
+  {
+    const std::string field_name = file.read_string("field");
+    const std::string description = file.read_string("description");
+
+    Handle<Field> field(dict->get_child(field_name));
+    if(is_null(field))
+      field = dict->create_field(field_name, description).handle<Field>();
+
+    const BlockHeader& block = file.next_block("data");
+    if(block.rows != field->size() || block.cols != field->row_size())
+      throw FileFormatError(FromHere(), "Size mismatch for field " + field->uri().string());
+    file.read_values(field->array().data());
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_state(BinaryInput& file, Component& component)
+{
+  file.read_string("component");
+
+  const std::vector<std::string> state_options = options().value< std::vector<std::string> >("state_options");
+  const Uint nb_options = file.read_value<Uint>("nb_options");
+  for(Uint i = 0; i != nb_options; ++i)
+  {
+    const std::string option_name = file.read_string("option");
+    const BlockHeader& block = file.next_block("value");
+    boost::any value;
+    switch(block.type)
+    {
+      case REAL_VALUES: { Real v; file.read_values(&v); value = v; break; }
+      case UINT_VALUES: { Uint v; file.read_values(&v); value = v; break; }
+      case INT_VALUES:  { int v;  file.read_values(&v); value = v; break; }
+      case BOOL_VALUES: { bool v; file.read_values(&v); value = v; break; }
+      default:
+        throw FileFormatError(FromHere(), "Unsupported type for option " + option_name);
+    }
+    if(component.options().check(option_name) && std::count(state_options.begin(), state_options.end(), option_name))
+      component.options().set(option_name, value);
+  }
+
+  const Uint nb_properties = file.read_value<Uint>("nb_properties");
+  for(Uint i = 0; i != nb_properties; ++i)
+  {
+    const std::string property_name = file.read_string("property");
+    component.properties()[property_name] = file.read_value<Real>("value");
+  }
+
+  const Uint nb_tables = file.read_value<Uint>("nb_tables");
+  for(Uint i = 0; i != nb_tables; ++i)
+  {
+    const std::string table_name = file.read_string("table");
+    Handle< Table<Real> > table(component.get_child(table_name));
+    if(is_null(table))
+      throw ValueNotFound(FromHere(), "No table " + table_name + " in " + component.uri().string());
+
+    const BlockHeader& block = file.next_block("data");
+    table->set_row_size(block.cols);
+    table->resize(block.rows);
+    file.read_values(table->array().data());
+  }
+
+  const Uint nb_descriptors = file.read_value<Uint>("nb_descriptors");
+  for(Uint i = 0; i != nb_descriptors; ++i)
+  {
+    const std::string descriptor_name = file.read_string("descriptor");
+    const Uint dimension = file.read_value<Uint>("dimension");
+    const std::string description = file.read_string("description");
+    Handle<math::VariablesDescriptor> descriptor(component.get_child(descriptor_name));
+    if(is_null(descriptor))
+      throw ValueNotFound(FromHere(), "No variables descriptor " + descriptor_name + " in " + component.uri().string());
+    descriptor->set_variables(description, dimension);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+Entities& Reader::find_entities(Mesh& mesh, const std::string& path)
+{
+  Handle<Entities> entities(mesh.topology().access_component(URI(path, URI::Scheme::CPATH)));
+  if(is_null(entities))
+    throw FileFormatError(FromHere(), "No entities at " + path + " in " + mesh.topology().uri().string());
+  return *entities;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
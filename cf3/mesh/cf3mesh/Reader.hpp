@@ -0,0 +1,73 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_cf3mesh_Reader_hpp
+#define cf3_mesh_cf3mesh_Reader_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/MeshReader.hpp"
+
+#include "mesh/cf3mesh/LibCF3Mesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+class Dictionary;
+class Entities;
+class Mesh;
+
+namespace cf3mesh {
+
+  class BinaryInput;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Reads a checkpoint written by cf3mesh::Writer.
+/// Each rank reads the file it wrote, so the number of ranks must be the same as when writing.
+/// All data is copied into the mesh as stored, so the global numbering and the spaces are not recomputed.
+/// If the "state" option is set, it must list the components matching the "state" option of the writer,
+/// in the same order. Their saved properties, tables and variable descriptors are then restored, together with
+/// the saved options that are named in "state_options" (by default current_time and iteration).
+class cf3mesh_API Reader : public MeshReader
+{
+public: // functions
+  /// constructor
+  Reader( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "Reader"; }
+
+  virtual std::string get_format() { return "CF3Mesh"; }
+
+  virtual std::vector<std::string> get_extensions();
+
+private: // functions
+
+  virtual void do_read_mesh_into(const common::URI& fp, Mesh& mesh);
+
+  void read_entities(BinaryInput& file, Mesh& mesh);
+
+  void read_dictionary(BinaryInput& file, Mesh& mesh, const Uint dimension);
+
+  void read_state(BinaryInput& file, common::Component& component);
+
+  /// Get the entities at the given path relative to the topology
+  Entities& find_entities(Mesh& mesh, const std::string& path);
+
+}; // end Reader
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_cf3mesh_Reader_hpp
@@ -0,0 +1,209 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <cstring>
+#include <vector>
+
+#include "common/PE/Comm.hpp"
+#include "common/StringConversion.hpp"
+#include "common/URI.hpp"
+
+#include "mesh/Entities.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+
+#include "mesh/cf3mesh/Shared.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace cf3mesh {
+
+using namespace common;
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+  const char magic[8] = { 'C', 'F', '3', 'M', 'E', 'S', 'H', '\0' };
+  const boost::uint32_t version = 1;
+  const boost::uint32_t endian_marker = 0x01020304;
+
+  /// Number of padding bytes needed to reach the next multiple of 8
+  inline std::size_t padding(const std::size_t nb_bytes)
+  {
+    return (8 - nb_bytes % 8) % 8;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+boost::filesystem::path rank_file_path(const URI& file)
+{
+  const boost::filesystem::path path(file.path());
+  return path.parent_path() / boost::filesystem::path(boost::filesystem::basename(path) + "_P" + to_str(PE::Comm::instance().rank()) + boost::filesystem::extension(path));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::string topology_path(const Mesh& mesh, const Entities& entities)
+{
+  const std::string topology = mesh.topology().uri().path() + "/";
+  const std::string path = entities.uri().path();
+  if(path.compare(0, topology.size(), topology) != 0)
+    throw BadValue(FromHere(), "Entities " + path + " are not part of the topology of mesh " + mesh.uri().path());
+  return path.substr(topology.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> default_state_options()
+{
+  std::vector<std::string> result;
+  result.push_back("current_time");
+  result.push_back("iteration");
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BinaryOutput::BinaryOutput(const boost::filesystem::path& path) :
+  m_path(path)
+{
+  m_file.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  if(!m_file)
+    throw FileSystemError(FromHere(), "Failed to open " + path.string() + " for writing");
+
+  const boost::uint64_t nb_ranks = PE::Comm::instance().size();
+  const boost::uint64_t rank = PE::Comm::instance().rank();
+  m_file.write(detail::magic, sizeof(detail::magic));
+  m_file.write(reinterpret_cast<const char*>(&detail::version), sizeof(detail::version));
+  m_file.write(reinterpret_cast<const char*>(&detail::endian_marker), sizeof(detail::endian_marker));
+  m_file.write(reinterpret_cast<const char*>(&nb_ranks), sizeof(nb_ranks));
+  m_file.write(reinterpret_cast<const char*>(&rank), sizeof(rank));
+}
+
+BinaryOutput::~BinaryOutput()
+{
+  if(m_file.is_open())
+    m_file.close();
+}
+
+void BinaryOutput::write_string(const std::string& name, const std::string& value)
+{
+  write_header(name, CHAR_VALUES, 1, value.size(), 1);
+  write_data(value.data(), value.size());
+}
+
+void BinaryOutput::close()
+{
+  m_file.close();
+  if(m_file.fail())
+    throw FileSystemError(FromHere(), "Error writing " + m_path.string());
+}
+
+void BinaryOutput::write_header(const std::string& name, const Uint type, const Uint value_size, const Uint rows, const Uint cols)
+{
+  const boost::uint64_t name_length = name.size();
+  m_file.write(reinterpret_cast<const char*>(&name_length), sizeof(name_length));
+  write_data(name.data(), name.size());
+
+  const boost::uint64_t header[4] = { type, value_size, rows, cols };
+  m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+void BinaryOutput::write_data(const void* data, const std::size_t nb_bytes)
+{
+  static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  if(nb_bytes != 0)
+    m_file.write(static_cast<const char*>(data), nb_bytes);
+  m_file.write(zeros, detail::padding(nb_bytes));
+  if(m_file.fail())
+    throw FileSystemError(FromHere(), "Error writing " + m_path.string());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BinaryInput::BinaryInput(const boost::filesystem::path& path) :
+  m_path(path)
+{
+  m_file.open(path, std::ios_base::in | std::ios_base::binary);
+  if(!m_file)
+    throw FileSystemError(FromHere(), "Failed to open " + path.string() + " for reading");
+
+  char magic[8];
+  boost::uint32_t version, endian_marker;
+  read_data(magic, sizeof(magic));
+  m_file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  m_file.read(reinterpret_cast<char*>(&endian_marker), sizeof(endian_marker));
+  if(m_file.fail() || std::memcmp(magic, detail::magic, sizeof(magic)) != 0)
+    throw FileFormatError(FromHere(), path.string() + " is not a cf3mesh file");
+  if(endian_marker != detail::endian_marker)
+    throw FileFormatError(FromHere(), path.string() + " was written on a machine with a different byte order");
+  if(version != detail::version)
+    throw FileFormatError(FromHere(), path.string() + " has unsupported format version " + to_str(version));
+
+  m_nb_ranks = read_integer();
+  m_rank = read_integer();
+}
+
+BinaryInput::~BinaryInput()
+{
+  if(m_file.is_open())
+    m_file.close();
+}
+
+const BlockHeader& BinaryInput::next_block(const std::string& name)
+{
+  const std::size_t name_length = read_integer();
+  std::vector<char> block_name(name_length + detail::padding(name_length));
+  if(!block_name.empty())
+    read_data(&block_name[0], block_name.size());
+  m_header.name.assign(block_name.begin(), block_name.begin() + name_length);
+  if(m_header.name != name)
+    throw FileFormatError(FromHere(), "Expected block " + name + " in " + m_path.string() + ", but found " + m_header.name);
+
+  m_header.type = read_integer();
+  m_header.value_size = read_integer();
+  m_header.rows = read_integer();
+  m_header.cols = read_integer();
+
+  return m_header;
+}
+
+std::string BinaryInput::read_string(const std::string& name)
+{
+  next_block(name);
+  std::string result(m_header.rows, ' ');
+  if(!result.empty())
+    read_values(&result[0]);
+  else
+    read_data(0, 0);
+  return result;
+}
+
+void BinaryInput::read_data(void* data, const std::size_t nb_bytes)
+{
+  if(nb_bytes != 0)
+    m_file.read(static_cast<char*>(data), nb_bytes);
+  m_file.seekg(detail::padding(nb_bytes), std::ios_base::cur);
+  if(m_file.fail())
+    throw FileFormatError(FromHere(), "Unexpected end of file while reading " + m_path.string());
+}
+
+boost::uint64_t BinaryInput::read_integer()
+{
+  boost::uint64_t result;
+  read_data(&result, sizeof(result));
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
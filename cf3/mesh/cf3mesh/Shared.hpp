@@ -0,0 +1,180 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_cf3mesh_Shared_hpp
+#define cf3_mesh_cf3mesh_Shared_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/BoostFilesystem.hpp"
+
+#include "mesh/cf3mesh/LibCF3Mesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common { class URI; }
+namespace mesh {
+  class Entities;
+  class Mesh;
+namespace cf3mesh {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Layout of a cf3mesh file:
+///   - File header (32 bytes): the magic string "CF3MESH", the format version, an endianness marker,
+///     the number of ranks that wrote the checkpoint and the rank of this file
+///   - A sequence of blocks, each consisting of:
+///       - the length of the block name, followed by the name padded to a multiple of 8 bytes
+///       - the value type code, the size of a value in bytes, the number of rows and the number of columns
+///       - the raw values in row-major order, padded to a multiple of 8 bytes
+/// All integers in the headers are 64 bit. Every block starts on an 8-byte boundary, so the data can be
+/// copied into the mesh arrays with a single read (or used directly from a memory map) without any parsing.
+/// Files are written in the byte order of the machine and are rejected when read on a machine with a different order.
+
+/// Type codes for the values stored in a block
+enum ValueTypeCode { UINT_VALUES = 1, INT_VALUES = 2, REAL_VALUES = 3, CHAR_VALUES = 4, BOOL_VALUES = 5 };
+
+/// Maps a C++ type to its type code
+template<typename T> struct ValueType;
+template<> struct ValueType<Uint> { static const Uint code = UINT_VALUES; };
+template<> struct ValueType<int>  { static const Uint code = INT_VALUES; };
+template<> struct ValueType<Real> { static const Uint code = REAL_VALUES; };
+template<> struct ValueType<char> { static const Uint code = CHAR_VALUES; };
+template<> struct ValueType<bool> { static const Uint code = BOOL_VALUES; };
+
+/// Header data of a block
+struct BlockHeader
+{
+  std::string name;
+  Uint type;
+  Uint value_size;
+  Uint rows;
+  Uint cols;
+};
+
+/// Path of the file for the current rank, i.e. "base_P<rank>.ext" for "base.ext"
+cf3mesh_API boost::filesystem::path rank_file_path(const common::URI& file);
+
+/// Path of the entities, relative to the topology of the mesh
+cf3mesh_API std::string topology_path(const Mesh& mesh, const Entities& entities);
+
+/// Default value for the "state_options" option of the reader and writer: the options of solver::Time
+/// that change during a simulation. Settings such as the end time or the time step are left out,
+/// so a restart keeps the values configured for the new run.
+cf3mesh_API std::vector<std::string> default_state_options();
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Writes blocks to a cf3mesh file
+class cf3mesh_API BinaryOutput
+{
+public:
+  /// Open the file and write the file header
+  BinaryOutput(const boost::filesystem::path& path);
+
+  ~BinaryOutput();
+
+  /// Write a block of rows x cols values
+  template<typename T>
+  void write_values(const std::string& name, const T* data, const Uint rows, const Uint cols)
+  {
+    write_header(name, ValueType<T>::code, sizeof(T), rows, cols);
+    write_data(data, static_cast<std::size_t>(rows)*cols*sizeof(T));
+  }
+
+  /// Write a block with a single value
+  template<typename T>
+  void write_value(const std::string& name, const T& value)
+  {
+    write_values(name, &value, 1, 1);
+  }
+
+  /// Write a string as a block of characters
+  void write_string(const std::string& name, const std::string& value);
+
+  /// Flush and close the file
+  void close();
+
+private:
+  void write_header(const std::string& name, const Uint type, const Uint value_size, const Uint rows, const Uint cols);
+  void write_data(const void* data, const std::size_t nb_bytes);
+
+  boost::filesystem::fstream m_file;
+  boost::filesystem::path m_path;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Reads blocks from a cf3mesh file. Blocks are read in the order they were written,
+/// and the name of each block is checked against the expected name.
+class cf3mesh_API BinaryInput
+{
+public:
+  /// Open the file and check the file header
+  BinaryInput(const boost::filesystem::path& path);
+
+  ~BinaryInput();
+
+  /// Number of ranks that wrote the checkpoint
+  Uint nb_ranks() const { return m_nb_ranks; }
+
+  /// Rank that wrote this file
+  Uint rank() const { return m_rank; }
+
+  /// Read the header of the next block, which must have the given name
+  const BlockHeader& next_block(const std::string& name);
+
+  /// Read the data of the block returned by next_block into the given buffer, which must hold rows x cols values
+  template<typename T>
+  void read_values(T* data)
+  {
+    if(m_header.type != ValueType<T>::code || m_header.value_size != sizeof(T))
+      throw common::FileFormatError(FromHere(), "Block " + m_header.name + " in " + m_path.string() + " has an unexpected value type");
+    read_data(data, static_cast<std::size_t>(m_header.rows)*m_header.cols*sizeof(T));
+  }
+
+  /// Read a block with a single value
+  template<typename T>
+  T read_value(const std::string& name)
+  {
+    next_block(name);
+    if(m_header.rows != 1 || m_header.cols != 1)
+      throw common::FileFormatError(FromHere(), "Block " + name + " in " + m_path.string() + " does not hold a single value");
+    T result;
+    read_values(&result);
+    return result;
+  }
+
+  /// Read a string block
+  std::string read_string(const std::string& name);
+
+private:
+  void read_data(void* data, const std::size_t nb_bytes);
+  boost::uint64_t read_integer();
+
+  boost::filesystem::fstream m_file;
+  boost::filesystem::path m_path;
+  BlockHeader m_header;
+  Uint m_nb_ranks;
+  Uint m_rank;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_cf3mesh_Shared_hpp
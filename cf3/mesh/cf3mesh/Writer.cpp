@@ -0,0 +1,232 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <typeinfo>
+
+#include <boost/any.hpp>
+
+#include "common/Builder.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionArray.hpp"
+#include "common/PropertyList.hpp"
+#include "common/Table.hpp"
+#include "common/Tags.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshMetadata.hpp"
+#include "mesh/Space.hpp"
+
+#include "mesh/cf3mesh/Shared.hpp"
+#include "mesh/cf3mesh/Writer.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace cf3mesh {
+
+using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < cf3mesh::Writer, MeshWriter, LibCF3Mesh> aCF3MeshWriter_Builder;
+
+//////////////////////////////////////////////////////////////////////////////
+
+Writer::Writer( const std::string& name )
+: MeshWriter(name)
+{
+  options().add("state", std::vector<URI>())
+      .pretty_name("State")
+      .description("Components whose state is saved together with the mesh, e.g. the Time and History of a solver")
+      .mark_basic();
+
+  options().add("state_options", default_state_options())
+      .pretty_name("State Options")
+      .description("Names of the options of the state components that are saved. Options that are missing or not scalar are skipped");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> Writer::get_extensions()
+{
+  std::vector<std::string> extensions;
+  extensions.push_back(".cf3mesh");
+  return extensions;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Writer::write()
+{
+  const Mesh& mesh = *m_mesh;
+
+  BinaryOutput file(rank_file_path(m_file_path));
+
+  file.write_value("time", boost::any_cast<Real>(mesh.metadata()["time"]));
+  file.write_value("iter", boost::any_cast<Uint>(mesh.metadata()["iter"]));
+  file.write_value("dimension", mesh.dimension());
+
+  write_entities(file);
+
+  file.write_value("nb_dictionaries", static_cast<Uint>(mesh.dictionaries().size()));
+  boost_foreach(const Handle<Dictionary>& dict, mesh.dictionaries())
+  {
+    write_dictionary(file, *dict);
+  }
+
+  const std::vector<URI> state_uris = options().value< std::vector<URI> >("state");
+  file.write_value("nb_components", static_cast<Uint>(state_uris.size()));
+  boost_foreach(const URI& state_uri, state_uris)
+  {
+    write_state(file, *access_component_checked(state_uri));
+  }
+
+  file.close();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Writer::write_entities(BinaryOutput& file)
+{
+  const Mesh& mesh = *m_mesh;
+
+  file.write_value("nb_entities", static_cast<Uint>(mesh.elements().size()));
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    file.write_string("entities", topology_path(mesh, *entities));
+    file.write_string("entities_type", entities->derived_type_name());
+    file.write_string("element_type", entities->element_type().derived_type_name());
+    file.write_values("glb_idx", entities->glb_idx().array().data(), entities->size(), 1);
+    file.write_values("rank", entities->rank().array().data(), entities->size(), 1);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Writer::write_dictionary(BinaryOutput& file, const Dictionary& dict)
+{
+  const Mesh& mesh = *m_mesh;
+
+  file.write_string("dictionary", dict.name());
+  file.write_string("dictionary_type", dict.derived_type_name());
+  file.write_values("glb_idx", dict.glb_idx().array().data(), dict.size(), 1);
+  file.write_values("rank", dict.rank().array().data(), dict.size(), 1);
+
+  file.write_value("nb_spaces", static_cast<Uint>(dict.spaces().size()));
+  boost_foreach(const Handle<Space>& space, dict.spaces())
+  {
+    const Connectivity& connectivity = space->connectivity();
+    file.write_string("support", topology_path(mesh, space->support()));
+    file.write_string("shape_function", space->options().value<std::string>("shape_function"));
+    file.write_values("connectivity", connectivity.array().data(), connectivity.size(), connectivity.row_size());
+  }
+
+  std::vector< Handle<Field const> > fields;
+  boost_foreach(const Field& field, find_components<Field>(dict))
+  {
+    fields.push_back(field.handle<Field>());
+  }
+
+  file.write_value("nb_fields", static_cast<Uint>(fields.size()));
+  boost_foreach(const Handle<Field const>& field, fields)
+  {
+    file.write_string("field", field->name());
+    file.write_string("description", field->descriptor().description());
+    file.write_values("data", field->array().data(), field->size(), field->row_size());
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void Writer::write_state(BinaryOutput& file, const Component& component)
+{
+  file.write_string("component", component.uri().path());
+
+  // Only the listed options with a scalar value are part of the state
+  std::vector<const Option*> options_to_write;
+  boost_foreach(const std::string& option_name, options().value< std::vector<std::string> >("state_options"))
+  {
+    if(!component.options().check(option_name))
+      continue;
+    const Option& option = component.options().option(option_name);
+    const std::type_info& type = option.value().type();
+    if(type == typeid(Real) || type == typeid(Uint) || type == typeid(int) || type == typeid(bool))
+      options_to_write.push_back(&option);
+  }
+
+  file.write_value("nb_options", static_cast<Uint>(options_to_write.size()));
+  boost_foreach(const Option* option, options_to_write)
+  {
+    file.write_string("option", option->name());
+    const boost::any value = option->value();
+    if(value.type() == typeid(Real))
+      file.write_value("value", boost::any_cast<Real>(value));
+    else if(value.type() == typeid(Uint))
+      file.write_value("value", boost::any_cast<Uint>(value));
+    else if(value.type() == typeid(int))
+      file.write_value("value", boost::any_cast<int>(value));
+    else
+      file.write_value("value", boost::any_cast<bool>(value));
+  }
+
+  std::vector<std::string> property_names;
+  for(PropertyList::const_iterator it = component.properties().begin(); it != component.properties().end(); ++it)
+  {
+    if(it->second.type() == typeid(Real))
+      property_names.push_back(it->first);
+  }
+
+  file.write_value("nb_properties", static_cast<Uint>(property_names.size()));
+  boost_foreach(const std::string& property_name, property_names)
+  {
+    file.write_string("property", property_name);
+    file.write_value("value", component.properties().value<Real>(property_name));
+  }
+
+  std::vector< Handle<Table<Real> const> > tables;
+  boost_foreach(const Table<Real>& table, find_components< Table<Real> >(component))
+  {
+    tables.push_back(table.handle< Table<Real> >());
+  }
+
+  file.write_value("nb_tables", static_cast<Uint>(tables.size()));
+  boost_foreach(const Handle<Table<Real> const>& table, tables)
+  {
+    file.write_string("table", table->name());
+    file.write_values("data", table->array().data(), table->size(), table->row_size());
+  }
+
+  std::vector< Handle<math::VariablesDescriptor const> > descriptors;
+  boost_foreach(const math::VariablesDescriptor& descriptor, find_components<math::VariablesDescriptor>(component))
+  {
+    if(descriptor.nb_vars() != 0)
+      descriptors.push_back(descriptor.handle<math::VariablesDescriptor>());
+  }
+
+  file.write_value("nb_descriptors", static_cast<Uint>(descriptors.size()));
+  boost_foreach(const Handle<math::VariablesDescriptor const>& descriptor, descriptors)
+  {
+    file.write_string("descriptor", descriptor->name());
+    file.write_value("dimension", descriptor->options().value<Uint>(common::Tags::dimension()));
+    file.write_string("description", descriptor->description());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
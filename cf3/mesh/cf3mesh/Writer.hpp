@@ -0,0 +1,69 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_cf3mesh_Writer_hpp
+#define cf3_mesh_cf3mesh_Writer_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/MeshWriter.hpp"
+
+#include "mesh/cf3mesh/LibCF3Mesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+  class Dictionary;
+namespace cf3mesh {
+
+  class BinaryOutput;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// Writes a checkpoint of a mesh in the native cf3mesh binary format.
+/// Each rank writes its own file "base_P<rank>.cf3mesh", containing the complete local mesh
+/// including ghost elements: all entities, the global indices and ranks, the connectivity of every space
+/// and all fields of all dictionaries. The region, field and filter options of MeshWriter are ignored,
+/// since a restart needs the full state.
+/// For the components listed in the "state" option, the real properties, the child tables of reals,
+/// the child variable descriptors and the options named in "state_options" (by default current_time and iteration)
+/// are saved as well. This is meant for the Time and History components of a solver.
+class cf3mesh_API Writer : public MeshWriter
+{
+public: // functions
+
+  /// constructor
+  Writer( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "Writer"; }
+
+  virtual std::string get_format() { return "CF3Mesh"; }
+
+  virtual std::vector<std::string> get_extensions();
+
+private: // functions
+
+  virtual void write();
+
+  void write_entities(BinaryOutput& file);
+
+  void write_dictionary(BinaryOutput& file, const Dictionary& dict);
+
+  void write_state(BinaryOutput& file, const common::Component& component);
+
+}; // end Writer
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // cf3mesh
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_cf3mesh_Writer_hpp
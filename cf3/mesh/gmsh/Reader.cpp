@@ -4,8 +4,12 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "common/Log.hpp"
 #include "common/Builder.hpp"
@@ -20,6 +24,7 @@
 #include "common/DynTable.hpp"
 
 #include "common/PE/debug.hpp"
+#include "common/PE/directory.hpp"
 
 #include "mesh/Region.hpp"
 #include "mesh/Mesh.hpp"
@@ -33,6 +38,8 @@
 #include "mesh/Space.hpp"
 #include "mesh/Cells.hpp"
 
+#include "mesh/FileRange.hpp"
+
 #include "mesh/gmsh/Reader.hpp"
 
 
@@ -70,6 +77,12 @@ Reader::Reader( const std::string& name )
       .pretty_name("Read Fields")
       .mark_basic();
 
+  options().add("partitioned_read", false)
+      .description("Let every process parse only its own byte range of the file, and redistribute the nodes and elements"
+                   " with a sparse all to all. Requires part and nb_parts to be the rank and number of processes. Fields are not read, the file must have a $PhysicalNames section"
+                   " and its nodes and elements must be numbered contiguously from 1.")
+      .pretty_name("Partitioned Read");
+
   // properties
 
   properties()["brief"] = std::string("Gmsh file reader component");
@@ -83,6 +96,11 @@ Reader::Reader( const std::string& name )
   properties()["description"] = desc;
 
   IO_rank = 0;
+
+  m_binary = false;
+  m_swap_bytes = false;
+  m_data_size = sizeof(double);
+  m_nb_elements_left_in_block = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -104,7 +122,8 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   if( boost::filesystem::exists(fp) )
   {
     CFinfo <<  "Opening file " <<  fp.string() << CFendl;
-    m_file.open(fp,std::ios_base::in); // exists so open it
+    // binary mode, so the offsets are the same in ASCII and binary files on all platforms
+    m_file.open(fp,std::ios_base::in | std::ios_base::binary); // exists so open it
   }
   else // doesnt exist so throw exception
   {
@@ -120,22 +139,35 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   // NOTE: since gmsh contains several 'physical entities' in one mesh, we create one region per physical entity
   m_region = Handle<Region>(m_mesh->topology().handle<Component>());
 
-  // Read file once and store positions
-  get_file_positions();
-  cf3_assert(m_hash);
+  read_mesh_format();
 
-  m_mesh->initialize_nodes(0, m_mesh_dimension);
+  if (options().value<bool>("partitioned_read"))
+  {
+    if (m_binary)
+      throw NotSupported(FromHere(),"partitioned_read only supports ASCII gmsh files");
+    read_partitioned(fp);
+
+    fix_negative_volumes(*m_mesh);
+  }
+  else
+  {
+    // Read file once and store positions
+    get_file_positions();
+    cf3_assert(m_hash);
 
-  find_used_nodes();
-  read_coordinates();
-  read_connectivity();
+    m_mesh->initialize_nodes(0, m_mesh_dimension);
 
-  fix_negative_volumes(*m_mesh);
+    find_used_nodes();
+    read_coordinates();
+    read_connectivity();
 
-  if (options().value<bool>("read_fields"))
-  {
-    read_element_node_data();
-    read_node_data();
+    fix_negative_volumes(*m_mesh);
+
+    if (options().value<bool>("read_fields"))
+    {
+      read_element_node_data();
+      read_node_data();
+    }
   }
 
   m_node_idx_gmsh_to_cf.clear();
@@ -156,6 +188,61 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+  /// Reverse the bytes of a value read from a binary file written on a machine of the other endianness
+  template<typename T>
+  void swap_bytes(T& value)
+  {
+    char* bytes = reinterpret_cast<char*>(&value);
+    std::reverse(bytes, bytes+sizeof(T));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_mesh_format()
+{
+  m_binary = false;
+  m_swap_bytes = false;
+  m_data_size = sizeof(double);
+
+  std::string line;
+  m_file.seekg(0,std::ios::beg);
+  getline(m_file,line);
+  if (line.find("$MeshFormat")==std::string::npos)
+  {
+    // Files without format section are ASCII
+    m_file.seekg(0,std::ios::beg);
+    return;
+  }
+
+  std::string version;
+  Uint file_type;
+  m_file >> version >> file_type >> m_data_size;
+  getline(m_file,line);
+  if (file_type == 1)
+  {
+    m_binary = true;
+    if (m_data_size != sizeof(double) && m_data_size != sizeof(float))
+      throw ParsingFailed(FromHere(),"Binary gmsh file has unsupported data size " + to_str(m_data_size));
+
+    // gmsh writes the integer 1 in the byte order of the machine that wrote the file
+    boost::int32_t one;
+    m_file.read(reinterpret_cast<char*>(&one), sizeof(one));
+    if (one != 1)
+    {
+      detail::swap_bytes(one);
+      if (one != 1)
+        throw ParsingFailed(FromHere(),"Could not detect the endianness of the binary gmsh file");
+      m_swap_bytes = true;
+    }
+    getline(m_file,line);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Reader::get_file_positions()
 {
   std::string region_names("$PhysicalNames");
@@ -177,37 +264,19 @@ void Reader::get_file_positions()
     getline(m_file,line);
     if (line.find(region_names)!=std::string::npos) {
       m_region_names_position=p;
-      m_file >> m_nb_regions;
-      m_region_list.resize(m_nb_regions);
-
-      m_nb_gmsh_elem_in_region.resize(m_nb_regions);
-      for(Uint ir = 0; ir < m_nb_regions; ++ir)
-      {
-        m_nb_gmsh_elem_in_region[ir].resize(Shared::nb_gmsh_types);
-        for(Uint type = 0; type < Shared::nb_gmsh_types; ++ type)
-           (m_nb_gmsh_elem_in_region[ir])[type] = 0;
-      }
-
-      m_mesh_dimension = options().value<Uint>("dimension");
-      for(Uint ir = 0; ir < m_nb_regions; ++ir)
-      {
-        Uint phys_group_dimensionality;
-        Uint phys_group_index;
-        std::string phys_group_name;
-        m_file >> phys_group_dimensionality >> phys_group_index >> phys_group_name;
-        m_region_list[phys_group_index-1].dim=phys_group_dimensionality;
-        m_region_list[phys_group_index-1].index=phys_group_index;
-        //The original name of the region in the mesh file has quotes, we want to strip them off
-        m_region_list[phys_group_index-1].name=phys_group_name.substr(1,phys_group_name.length()-2);
-        m_region_list[phys_group_index-1].region = create_region(m_region_list[phys_group_index-1].name);
-        m_mesh_dimension = std::max(m_region_list[phys_group_index-1].dim,m_mesh_dimension);
-      }
+      read_physical_names();
     }
     else if (line.find(nodes)!=std::string::npos) {
       m_coordinates_position=p;
       m_file >> m_total_nb_nodes;
 //      CFinfo << "The total number of nodes is " << m_total_nb_nodes << CFendl;
       if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
+      if (m_binary)
+      {
+        // Skip the node records: number and 3 coordinates
+        getline(m_file,line);
+        skip_record_values(m_total_nb_nodes, 3*m_total_nb_nodes);
+      }
     }
     else if (line.find(elements)!=std::string::npos)
     {
@@ -227,14 +296,15 @@ void Reader::get_file_positions()
       Uint elem_idx, elem_type, nb_tags, phys_tag;
 
       //Let's count how many elements of each type are present
+      getline(m_file,line);
+      m_nb_elements_left_in_block = 0;
       for(Uint ie = 0; ie < m_total_nb_elements; ++ie)
       {
-          m_file >> elem_idx;
-          m_file >> elem_type;
-          m_file >> nb_tags;
-          m_file >> phys_tag;
+          read_element_header(elem_idx, elem_type, nb_tags);
+          read_record(phys_tag);
           cf3_assert(phys_tag > 0);
-          getline(m_file,line);
+          skip_record_values(nb_tags-1 + Shared::m_nodes_in_gmsh_elem[elem_type], 0);
+          finish_record();
           if (m_hash->subhash(ELEMS).owns(ie))
             (m_nb_gmsh_elem_in_region[phys_tag-1])[elem_type]++;
           m_region_list[phys_tag-1].element_types.insert(elem_type);
@@ -243,14 +313,20 @@ void Reader::get_file_positions()
     else if (line.find(element_data)!=std::string::npos)
     {
       m_element_data_positions.push_back(p);
+      if (m_binary)
+        skip_binary_data(p, false);
     }
     else if (line.find(node_data)!=std::string::npos)
     {
       m_node_data_positions.push_back(p);
+      if (m_binary)
+        skip_binary_data(p, false);
     }
     else if (line.find(element_node_data)!=std::string::npos)
     {
       m_element_node_data_positions.push_back(p);
+      if (m_binary)
+        skip_binary_data(p, true);
     }
 
   }
@@ -261,6 +337,496 @@ void Reader::get_file_positions()
   m_file.clear();
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_record(Uint& value)
+{
+  if (!m_binary)
+  {
+    m_file >> value;
+    return;
+  }
+
+  boost::int32_t binary_value;
+  m_file.read(reinterpret_cast<char*>(&binary_value), sizeof(binary_value));
+  if (m_swap_bytes)
+    detail::swap_bytes(binary_value);
+  value = static_cast<Uint>(binary_value);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_record(Real& value)
+{
+  if (!m_binary)
+  {
+    m_file >> value;
+    return;
+  }
+
+  if (m_data_size == sizeof(double))
+  {
+    double binary_value;
+    m_file.read(reinterpret_cast<char*>(&binary_value), sizeof(binary_value));
+    if (m_swap_bytes)
+      detail::swap_bytes(binary_value);
+    value = binary_value;
+  }
+  else
+  {
+    float binary_value;
+    m_file.read(reinterpret_cast<char*>(&binary_value), sizeof(binary_value));
+    if (m_swap_bytes)
+      detail::swap_bytes(binary_value);
+    value = binary_value;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_element_header(Uint& number, Uint& type, Uint& nb_tags)
+{
+  if (!m_binary)
+  {
+    m_file >> number >> type >> nb_tags;
+    return;
+  }
+
+  if (m_nb_elements_left_in_block == 0)
+  {
+    read_record(m_block_element_type);
+    read_record(m_nb_elements_left_in_block);
+    read_record(m_block_nb_tags);
+    if (m_nb_elements_left_in_block == 0 || m_block_element_type >= Shared::nb_gmsh_types)
+      throw ParsingFailed(FromHere(),"Invalid element block in binary gmsh file");
+  }
+  --m_nb_elements_left_in_block;
+  type = m_block_element_type;
+  nb_tags = m_block_nb_tags;
+  read_record(number);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::skip_record_values(const Uint nb_ints, const Uint nb_reals)
+{
+  if (m_binary)
+    m_file.seekg(static_cast<std::streamoff>(nb_ints)*sizeof(boost::int32_t) + static_cast<std::streamoff>(nb_reals)*m_data_size, std::ios::cur);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::finish_record()
+{
+  if (!m_binary)
+  {
+    std::string line;
+    getline(m_file,line);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::skip_binary_data(const Uint position, const bool element_node_data)
+{
+  m_file.seekg(position,std::ios::beg);
+  std::map<std::string,Field> fields;
+  read_variable_header(fields);
+  const Field& field = fields.begin()->second;
+  const Uint nb_components = field.var_types.back();
+
+  if (element_node_data)
+  {
+    // Each record holds the values in all nodes of an element
+    for (Uint e=0; e<field.nb_entries; ++e)
+    {
+      Uint element_number, nb_element_nodes;
+      read_record(element_number);
+      read_record(nb_element_nodes);
+      skip_record_values(0, nb_element_nodes*nb_components);
+    }
+  }
+  else
+  {
+    skip_record_values(field.nb_entries, field.nb_entries*nb_components);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_partitioned(const boost::filesystem::path& fp)
+{
+  PE::Comm& comm = PE::Comm::instance();
+  const Uint part = comm.rank();
+  const Uint nb_parts = comm.size();
+  if (options().value<Uint>("part") != part || options().value<Uint>("nb_parts") != nb_parts)
+    throw BadValue(FromHere(), "partitioned_read requires part and nb_parts to be the rank and the number of processes");
+
+  // Every process reads its own byte range, and all of them find the sections together
+  FileRange range(fp, part, nb_parts);
+
+  enum { PHYSICAL_NAMES=0, NODES_BEGIN, NODES_END, ELEMENTS_BEGIN, ELEMENTS_END, NODE_DATA, ELEMENT_DATA, ELEMENT_NODE_DATA };
+  std::vector<std::string> keywords;
+  keywords.push_back("$PhysicalNames");
+  keywords.push_back("$Nodes");
+  keywords.push_back("$EndNodes");
+  keywords.push_back("$Elements");
+  keywords.push_back("$EndElements");
+  keywords.push_back("$NodeData");
+  keywords.push_back("$ElementData");
+  keywords.push_back("$ElementNodeData");
+  std::vector< std::vector<FileRange::OffsetT> > sections;
+  find_lines(range, keywords, sections);
+
+  // The regions are created from the physical names, before any process has seen the elements.
+  // All processes find the sections together, so they all throw here.
+  if (sections[PHYSICAL_NAMES].empty())
+    throw ParsingFailed(FromHere(),fp.string() + " has no $PhysicalNames section, which partitioned_read needs to create the regions");
+  if (sections[NODES_BEGIN].empty() || sections[NODES_END].empty())
+    throw ParsingFailed(FromHere(),"File contains no nodes");
+  if (sections[ELEMENTS_BEGIN].empty() || sections[ELEMENTS_END].empty())
+    throw ParsingFailed(FromHere(),"File does not contain any elements");
+  if (options().value<bool>("read_fields") && (sections[NODE_DATA].size() || sections[ELEMENT_DATA].size() || sections[ELEMENT_NODE_DATA].size()))
+    CFwarn << "Fields in " << fp.string() << " are not read with partitioned_read" << CFendl;
+
+  // The headers are small, every process reads them directly
+  std::string line;
+  m_file.seekg(static_cast<std::streamoff>(sections[PHYSICAL_NAMES][0]),std::ios::beg);
+  getline(m_file,line);
+  read_physical_names();
+
+  m_file.seekg(static_cast<std::streamoff>(sections[NODES_BEGIN][0]),std::ios::beg);
+  getline(m_file,line);
+  m_file >> m_total_nb_nodes;
+  getline(m_file,line);
+  const FileRange::OffsetT nodes_begin = std::max(range.begin(), static_cast<FileRange::OffsetT>(m_file.tellg()));
+  const FileRange::OffsetT nodes_end = std::min(range.end(), sections[NODES_END][0]);
+
+  m_file.seekg(static_cast<std::streamoff>(sections[ELEMENTS_BEGIN][0]),std::ios::beg);
+  getline(m_file,line);
+  m_file >> m_total_nb_elements;
+  getline(m_file,line);
+  const FileRange::OffsetT elements_begin = std::max(range.begin(), static_cast<FileRange::OffsetT>(m_file.tellg()));
+  const FileRange::OffsetT elements_end = std::min(range.end(), sections[ELEMENTS_END][0]);
+
+  if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
+  if (m_total_nb_elements == 0) throw ParsingFailed(FromHere(),"File contains no elements");
+
+  m_hash = create_component<MergedParallelDistribution>("hash");
+  std::vector<Uint> num_obj(2);
+  num_obj[0] = m_total_nb_nodes;
+  num_obj[1] = m_total_nb_elements;
+  m_hash->options().set("nb_parts",nb_parts);
+  m_hash->options().set("nb_obj",num_obj);
+
+  // Parse the nodes in the range: gmsh number and coordinates. Gmsh always stores 3 coordinates
+  std::vector<Uint> local_node_ids;
+  std::vector<Real> local_node_coords;
+  TextScanner scanner(range.data(range.begin()));
+  if (nodes_begin < nodes_end)
+    scanner.seek(range.data(nodes_begin));
+  while (nodes_begin < nodes_end && range.offset(scanner.position()) < nodes_end)
+  {
+    Uint gmsh_node_number;
+    Real coords[3];
+    if (!scanner.read(gmsh_node_number) || !scanner.read(coords[XX]) || !scanner.read(coords[YY]) || !scanner.read(coords[ZZ]))
+      throw ParsingFailed(FromHere(),"Invalid node at offset " + to_str(range.offset(scanner.position())) + " in " + fp.string());
+    local_node_ids.push_back(gmsh_node_number);
+    local_node_coords.insert(local_node_coords.end(), coords, coords + m_mesh_dimension);
+    scanner.skip_line();
+    scanner.skip_whitespace();
+  }
+
+  // Parse the elements in the range: gmsh number, type, physical tag and nodes
+  std::vector<Uint> local_elements;
+  Uint nb_local_elements = 0;
+  if (elements_begin < elements_end)
+    scanner.seek(range.data(elements_begin));
+  while (elements_begin < elements_end && range.offset(scanner.position()) < elements_end)
+  {
+    Uint element_number, gmsh_element_type, nb_tags, phys_tag, tag;
+    if (!scanner.read(element_number) || !scanner.read(gmsh_element_type) || !scanner.read(nb_tags) || nb_tags == 0 || !scanner.read(phys_tag))
+      throw ParsingFailed(FromHere(),"Invalid element at offset " + to_str(range.offset(scanner.position())) + " in " + fp.string());
+    if (gmsh_element_type >= Shared::nb_gmsh_types || phys_tag == 0 || phys_tag > m_nb_regions)
+      throw ParsingFailed(FromHere(),"Unsupported type or physical group of element " + to_str(element_number) + " in " + fp.string());
+    for (Uint itag = 1; itag < nb_tags; ++itag)
+      scanner.read(tag);
+
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
+    local_elements.push_back(element_number);
+    local_elements.push_back(gmsh_element_type);
+    local_elements.push_back(phys_tag);
+    for (Uint j=0; j<nb_element_nodes; ++j)
+    {
+      Uint gmsh_node_number;
+      if (!scanner.read(gmsh_node_number))
+        throw ParsingFailed(FromHere(),"Missing nodes for element " + to_str(element_number) + " in " + fp.string());
+      local_elements.push_back(gmsh_node_number);
+    }
+    ++nb_local_elements;
+    scanner.skip_line();
+    scanner.skip_whitespace();
+  }
+
+  // Index in the file of the first node and element of the range, from the counts of the previous ranges
+  const Uint nb_local_nodes = local_node_ids.size();
+  std::vector<Uint> nb_nodes_per_part(1, nb_local_nodes);
+  std::vector<Uint> nb_elements_per_part(1, nb_local_elements);
+  if (comm.is_active())
+  {
+    comm.all_gather(nb_local_nodes, nb_nodes_per_part);
+    comm.all_gather(nb_local_elements, nb_elements_per_part);
+  }
+  Uint first_node = 0;
+  Uint first_element = 0;
+  for (Uint p = 0; p != part; ++p)
+  {
+    first_node += nb_nodes_per_part[p];
+    first_element += nb_elements_per_part[p];
+  }
+
+  // The global index is the gmsh number minus one, as in the serial reader. The ownership follows the position
+  // in the file, so the numbers have to be contiguous. All processes check together, so they all throw.
+  Uint nb_gaps = 0;
+  for (Uint n=0; n<nb_local_nodes; ++n)
+  {
+    if (local_node_ids[n] != first_node+n+1)
+      ++nb_gaps;
+  }
+  Uint record_begin = 0;
+  for (Uint e=0; e<nb_local_elements; ++e)
+  {
+    if (local_elements[record_begin] != first_element+e+1)
+      ++nb_gaps;
+    record_begin += 3 + Shared::m_nodes_in_gmsh_elem[local_elements[record_begin+1]];
+  }
+  Uint total_nb_gaps = nb_gaps;
+  if (comm.is_active())
+    comm.all_reduce(PE::plus(), &nb_gaps, 1, &total_nb_gaps);
+  if (total_nb_gaps != 0)
+    throw ParsingFailed(FromHere(),"The nodes and elements of " + fp.string() + " are not numbered contiguously from 1, which partitioned_read requires");
+
+  // Send the nodes and elements to the process that owns them, as in the serial reader
+  std::vector< std::vector<Uint> > send_ids(nb_parts), recv_ids;
+  std::vector< std::vector<Real> > send_coords(nb_parts), recv_coords;
+  for (Uint n=0; n<nb_local_nodes; ++n)
+  {
+    const Uint dest = m_hash->subhash(NODES).part_of_obj(first_node+n);
+    send_ids[dest].push_back(local_node_ids[n]);
+    send_coords[dest].insert(send_coords[dest].end(), &local_node_coords[n*m_mesh_dimension], &local_node_coords[n*m_mesh_dimension] + m_mesh_dimension);
+  }
+  exchange_parts(send_ids, recv_ids);
+  exchange_parts(send_coords, recv_coords);
+  local_node_ids.clear();
+  local_node_coords.clear();
+
+  std::vector< std::vector<Uint> > send_elements(nb_parts), recv_elements;
+  record_begin = 0;
+  for (Uint e=0; e<nb_local_elements; ++e)
+  {
+    const Uint record_end = record_begin + 3 + Shared::m_nodes_in_gmsh_elem[local_elements[record_begin+1]];
+    const Uint dest = m_hash->subhash(ELEMS).part_of_obj(first_element+e);
+    send_elements[dest].insert(send_elements[dest].end(), local_elements.begin()+record_begin, local_elements.begin()+record_end);
+    record_begin = record_end;
+  }
+  exchange_parts(send_elements, recv_elements);
+  local_elements.clear();
+
+  // Owned nodes, in file order since the ranges are
+  boost::unordered_map<Uint,Uint> node_idx_gmsh_to_cf;
+  std::vector<Uint> node_ids;
+  std::vector<Real> node_coords;
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    for (Uint n=0; n<recv_ids[p].size(); ++n)
+    {
+      node_idx_gmsh_to_cf[recv_ids[p][n]] = node_ids.size();
+      node_ids.push_back(recv_ids[p][n]);
+    }
+    node_coords.insert(node_coords.end(), recv_coords[p].begin(), recv_coords[p].end());
+  }
+  const Uint nb_owned_nodes = node_ids.size();
+
+  // Nodes of the owned elements that are owned by other processes. Owned nodes that are not used
+  // by an owned element nor requested as ghost by another process belong to no element, and are dropped.
+  std::vector<Uint> ghost_ids;
+  std::vector<bool> node_used(nb_owned_nodes, false);
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    for (Uint i=0; i<recv_elements[p].size(); )
+    {
+      const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[recv_elements[p][i+1]];
+      for (Uint j=0; j<nb_element_nodes; ++j)
+      {
+        const Uint gmsh_node_number = recv_elements[p][i+3+j];
+        const std::pair<boost::unordered_map<Uint,Uint>::iterator, bool> inserted = node_idx_gmsh_to_cf.insert(std::make_pair(gmsh_node_number, nb_owned_nodes+ghost_ids.size()));
+        if (inserted.second)
+          ghost_ids.push_back(gmsh_node_number);
+        else if (inserted.first->second < nb_owned_nodes)
+          node_used[inserted.first->second] = true;
+      }
+      i += 3 + nb_element_nodes;
+    }
+  }
+
+  // Find the owners of the ghost nodes through the directory, and ask them for the coordinates
+  std::vector<Uint> ghost_ranks(ghost_ids.size());
+  std::vector<Real> ghost_coords(ghost_ids.size()*m_mesh_dimension);
+  if (comm.is_active())
+  {
+    std::vector<Uint> keys(node_ids);
+    keys.insert(keys.end(), ghost_ids.begin(), ghost_ids.end());
+    std::vector<bool> owned(keys.size(), false);
+    std::fill(owned.begin(), owned.begin()+nb_owned_nodes, true);
+    std::vector<Uint> values(keys.size(), 0);
+    std::vector<Uint> ranks(keys.size(), part);
+    if (PE::directory_lookup(keys, owned, values, ranks) != 0)
+      throw ParsingFailed(FromHere(),"Elements refer to nodes that are not in " + fp.string());
+
+    std::vector< std::vector<Uint> > send_requests(nb_parts), recv_requests;
+    for (Uint g=0; g<ghost_ids.size(); ++g)
+    {
+      ghost_ranks[g] = ranks[nb_owned_nodes+g];
+      send_requests[ghost_ranks[g]].push_back(ghost_ids[g]);
+    }
+    exchange_parts(send_requests, recv_requests);
+
+    std::vector< std::vector<Real> > send_answers(nb_parts), recv_answers;
+    for (Uint p=0; p<nb_parts; ++p)
+    {
+      for (Uint i=0; i<recv_requests[p].size(); ++i)
+      {
+        const Uint idx = node_idx_gmsh_to_cf[recv_requests[p][i]];
+        node_used[idx] = true;
+        send_answers[p].insert(send_answers[p].end(), &node_coords[idx*m_mesh_dimension], &node_coords[idx*m_mesh_dimension] + m_mesh_dimension);
+      }
+    }
+    exchange_parts(send_answers, recv_answers);
+
+    // Answers come back in the order of the requests
+    std::vector<Uint> answer_idx(nb_parts, 0);
+    for (Uint g=0; g<ghost_ids.size(); ++g)
+    {
+      const Uint p = ghost_ranks[g];
+      std::copy(&recv_answers[p][answer_idx[p]], &recv_answers[p][answer_idx[p]] + m_mesh_dimension, &ghost_coords[g*m_mesh_dimension]);
+      answer_idx[p] += m_mesh_dimension;
+    }
+  }
+  else if (!ghost_ids.empty())
+  {
+    throw ParsingFailed(FromHere(),"Elements refer to nodes that are not in " + fp.string());
+  }
+
+  // Fill the nodes: the used owned ones first, then the ghosts
+  m_mesh->initialize_nodes(0, m_mesh_dimension);
+  Dictionary& nodes = m_mesh->geometry_fields();
+  const Uint nb_used_nodes = std::count(node_used.begin(), node_used.end(), true);
+  nodes.resize(nb_used_nodes + ghost_ids.size());
+  Uint n = 0;
+  for (Uint i=0; i<nb_owned_nodes; ++i)
+  {
+    if (!node_used[i])
+    {
+      node_idx_gmsh_to_cf.erase(node_ids[i]);
+      continue;
+    }
+    node_idx_gmsh_to_cf[node_ids[i]] = n;
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      nodes.coordinates()[n][dim] = node_coords[i*m_mesh_dimension+dim];
+    nodes.rank()[n] = part;
+    nodes.glb_idx()[n] = node_ids[i]-1;
+    ++n;
+  }
+  for (Uint g=0; g<ghost_ids.size(); ++g, ++n)
+  {
+    node_idx_gmsh_to_cf[ghost_ids[g]] = n;
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      nodes.coordinates()[n][dim] = ghost_coords[g*m_mesh_dimension+dim];
+    nodes.rank()[n] = ghost_ranks[g];
+    nodes.glb_idx()[n] = ghost_ids[g]-1;
+  }
+
+  // Every process creates the same element tables, sized for its own elements
+  std::vector<Uint> local_types(m_nb_regions*Shared::nb_gmsh_types, 0);
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    for (Uint i=0; i<recv_elements[p].size(); i += 3 + Shared::m_nodes_in_gmsh_elem[recv_elements[p][i+1]])
+    {
+      const Uint etype = recv_elements[p][i+1];
+      const Uint ir = recv_elements[p][i+2]-1;
+      local_types[ir*Shared::nb_gmsh_types + etype] = 1;
+      m_nb_gmsh_elem_in_region[ir][etype]++;
+    }
+  }
+  std::vector<Uint> global_types(local_types);
+  if (comm.is_active())
+    comm.all_reduce(PE::max(), &local_types[0], local_types.size(), &global_types[0]);
+  for (Uint ir = 0; ir < m_nb_regions; ++ir)
+  {
+    for (Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
+    {
+      if (global_types[ir*Shared::nb_gmsh_types + etype])
+        m_region_list[ir].element_types.insert(etype);
+    }
+  }
+
+  std::vector<std::map<Uint, Entities*> > conn_table_idx;
+  create_element_tables(conn_table_idx);
+
+  std::vector<Uint> row_counts(m_nb_regions*Shared::nb_gmsh_types, 0);
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    for (Uint i=0; i<recv_elements[p].size(); )
+    {
+      const Uint element_number = recv_elements[p][i];
+      const Uint etype = recv_elements[p][i+1];
+      const Uint ir = recv_elements[p][i+2]-1;
+      const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[etype];
+
+      Entities& elements = *conn_table_idx[ir][etype];
+      const Uint row_idx = row_counts[ir*Shared::nb_gmsh_types + etype]++;
+      Connectivity::Row element_nodes = elements.geometry_space().connectivity()[row_idx];
+      for (Uint j=0; j<nb_element_nodes; ++j)
+        element_nodes[Shared::m_nodes_gmsh_to_cf[etype][j]] = node_idx_gmsh_to_cf[recv_elements[p][i+3+j]];
+      elements.rank()[row_idx] = part;
+      elements.glb_idx()[row_idx] = element_number-1;
+
+      i += 3 + nb_element_nodes;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_physical_names()
+{
+  m_file >> m_nb_regions;
+  m_region_list.resize(m_nb_regions);
+
+  m_nb_gmsh_elem_in_region.resize(m_nb_regions);
+  for(Uint ir = 0; ir < m_nb_regions; ++ir)
+  {
+    m_nb_gmsh_elem_in_region[ir].resize(Shared::nb_gmsh_types);
+    for(Uint type = 0; type < Shared::nb_gmsh_types; ++ type)
+       (m_nb_gmsh_elem_in_region[ir])[type] = 0;
+  }
+
+  m_mesh_dimension = options().value<Uint>("dimension");
+  for(Uint ir = 0; ir < m_nb_regions; ++ir)
+  {
+    Uint phys_group_dimensionality;
+    Uint phys_group_index;
+    std::string phys_group_name;
+    m_file >> phys_group_dimensionality >> phys_group_index >> phys_group_name;
+    m_region_list[phys_group_index-1].dim=phys_group_dimensionality;
+    m_region_list[phys_group_index-1].index=phys_group_index;
+    //The original name of the region in the mesh file has quotes, we want to strip them off
+    m_region_list[phys_group_index-1].name=phys_group_name.substr(1,phys_group_name.length()-2);
+    m_region_list[phys_group_index-1].region = create_region(m_region_list[phys_group_index-1].name);
+    m_mesh_dimension = std::max(m_region_list[phys_group_index-1].dim,m_mesh_dimension);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 Handle< Region > Reader::create_region(std::string const& relative_path)
@@ -303,6 +869,8 @@ void Reader::find_used_nodes()
 
   std::set<Uint>::iterator it=m_used_nodes.begin();
 
+  m_nb_elements_left_in_block = 0;
+
 //  if (PE::Comm::instance().rank()==IO_rank)
 //  {
 //    std::cout << "nb_obj = "   << m_hash->subhash(ELEMS).options()["nb_obj"].value<Uint>() << std::endl;
@@ -317,22 +885,20 @@ void Reader::find_used_nodes()
 //    }
 
     cf3_assert(m_hash);
+    // element description
+    read_element_header(elementNumber, elementType, nb_tags);
+    nbElementNodes = Shared::m_nodes_in_gmsh_elem[elementType];
     if (m_hash->subhash(ELEMS).owns(i))
     {
-      // element description
-      m_file >> elementNumber >> elementType;
-      nbElementNodes = Shared::m_nodes_in_gmsh_elem[elementType];
-
 //      if (PE::Comm::instance().rank()==IO_rank)
 //        std::cout << i << ":  elem["<<m_hash->subhash(ELEMS).part_of_obj(i)<<"] " << elementNumber << " :    ";
-      m_file >> nb_tags;
-      m_file >> phys_tag;
+      read_record(phys_tag);
       for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
+          read_record(other_tag);
 
       for (Uint j=0; j<nbElementNodes; ++j)
       {
-        m_file >> gmsh_node_number;
+        read_record(gmsh_node_number);
         it = m_used_nodes.insert(it,gmsh_node_number);
 //        if (PE::Comm::instance().rank()==IO_rank)
 //          std::cout << "  " << gmsh_node_number;
@@ -340,7 +906,11 @@ void Reader::find_used_nodes()
 //      if (PE::Comm::instance().rank()==IO_rank)
 //        std::cout << "\n";
     }
-    getline(m_file,line); // finnish the line
+    else
+    {
+      skip_record_values(nb_tags + nbElementNodes, 0);
+    }
+    finish_record(); // finnish the line
   }
 
   // Now we have all nodes, used by the elements
@@ -365,11 +935,9 @@ void Reader::find_used_nodes()
 //      if (node_idx == m_total_nb_nodes-1)
 //        CFinfo << CFendl;
 //    }
-    getline(m_file,line);
-
-    std::stringstream ss(line);
-    ss >> gmsh_node_number;
-    getline(ss,line);
+    read_record(gmsh_node_number);
+    skip_record_values(0, DIM_3D);
+    finish_record();
     if (m_hash->subhash(NODES).owns(node_idx))
     {
 //      if (PE::Comm::instance().rank()==IO_rank)
@@ -417,8 +985,6 @@ void Reader::read_coordinates()
   // declare and allocate one coordinate row
 //  std::vector<Real> rowVector(m_mesh_dimension);
 
-  std::set<Uint>::const_iterator it;
-
   Uint coord_idx=0;
   Uint gmsh_node_number;
 
@@ -431,48 +997,29 @@ void Reader::read_coordinates()
 //      if(node_idx==m_total_nb_nodes-1)
 //        CFinfo << CFendl;
 //    }
-    getline(m_file,line);
-//    CFinfo << line << CFendl;
-    if (m_hash->subhash(NODES).owns(node_idx))
+    read_record(gmsh_node_number);
+    const bool is_owned = m_hash->subhash(NODES).owns(node_idx);
+    if (is_owned || m_ghost_nodes.find(node_idx) != m_ghost_nodes.end())
     {
-      std::stringstream ss(line);
-      ss >> gmsh_node_number;
       m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
 
 //      if (PE::Comm::instance().rank()==IO_rank)
 //        std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
 
       for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-      if(m_mesh_dimension < DIM_3D) getline(ss,line); //Gmsh always stores 3 coordinates, even for 2D meshes
+        read_record(nodes.coordinates()[coord_idx][dim]);
+      skip_record_values(0, DIM_3D-m_mesh_dimension); //Gmsh always stores 3 coordinates, even for 2D meshes
 
-      nodes.rank()[coord_idx] = part;
+      nodes.rank()[coord_idx] = is_owned ? part : m_hash->subhash(NODES).part_of_obj(node_idx);
       nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
 
       coord_idx++;
     }
     else
     {
-      it = m_ghost_nodes.find(node_idx);
-      if (it != m_ghost_nodes.end())
-      {
-        std::stringstream ss(line);
-        ss >> gmsh_node_number;
-        m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
-
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
-
-        for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-        if(m_mesh_dimension < DIM_3D) getline(ss, line);
-
-        nodes.rank()[coord_idx] = m_hash->subhash(NODES).part_of_obj(node_idx);
-        nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
-
-        coord_idx++;
-      }
+      skip_record_values(0, DIM_3D);
     }
+    finish_record();
 
 
   } //loop over nodes
@@ -497,28 +1044,11 @@ void Reader::read_coordinates()
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Reader::read_connectivity()
+void Reader::create_element_tables(std::vector<std::map<Uint, Entities*> >& conn_table_idx)
 {
+ Dictionary& nodes = m_mesh->geometry_fields();
 
-  Dictionary& nodes = m_mesh->geometry_fields();
-
-
-  Uint part = options().value<Uint>("part");
-
-  //Each entry of this vector holds a map (gmsh_type_idx, pointer to connectivity table of this gmsh type).
- //Each row corresponds to one region of the mesh
- std::vector<std::map<Uint, Entities* > > conn_table_idx;
- conn_table_idx.resize(m_nb_regions);
- for(Uint ir = 0; ir < m_nb_regions; ++ir)
- {
-    conn_table_idx[ir].clear();
- }
-
- std::map<Uint, Entities*>::iterator elem_table_iter;
-
-// std::vector<std::map<std::string,Handle< Elements > > > elements(m_nb_regions);
-// std::vector<std::map<std::string,Handle< Connectivity::Buffer > > > buffer(m_nb_regions);
-
+ conn_table_idx.assign(m_nb_regions, std::map<Uint, Entities*>());
 
  m_elem_idx_gmsh_to_cf.clear();
  //Loop over all regions and allocate a connectivity table of proper size for each element type that
@@ -561,6 +1091,20 @@ void Reader::read_connectivity()
      }
    }
  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_connectivity()
+{
+  Uint part = options().value<Uint>("part");
+
+  //Each entry of this vector holds a map (gmsh_type_idx, pointer to connectivity table of this gmsh type).
+ //Each row corresponds to one region of the mesh
+ std::vector<std::map<Uint, Entities* > > conn_table_idx;
+ create_element_tables(conn_table_idx);
+
+ std::map<Uint, Entities*>::iterator elem_table_iter;
 
    std::string etype_CF;
    std::set<Uint>::const_iterator it;
@@ -582,6 +1126,8 @@ void Reader::read_connectivity()
      for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
       (m_nb_gmsh_elem_in_region[ir])[etype] = 0;
 
+   m_nb_elements_left_in_block = 0;
+
   for (Uint i=0; i<m_total_nb_elements; ++i)
   {
 //    if (m_total_nb_elements > 100000)
@@ -593,17 +1139,16 @@ void Reader::read_connectivity()
 //    }
 
     // element description
-    m_file >> element_number >> gmsh_element_type;
+    read_element_header(element_number, gmsh_element_type, nb_tags);
 
     nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
 
     // get element nodes
     if (m_hash->subhash(ELEMS).owns(i))
     {
-      m_file >> nb_tags;
-      m_file >> phys_tag;
+      read_record(phys_tag);
       for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
+          read_record(other_tag);
 
 //      CFinfo << "Reading element " << element_number << " of type " << gmsh_element_type;
 //      CFinfo << " in region " << phys_tag << " with " << nb_element_nodes << " nodes " << CFendl;
@@ -615,7 +1160,7 @@ void Reader::read_connectivity()
       for (Uint j=0; j<nb_element_nodes; ++j)
       {
         cf_idx = Shared::m_nodes_gmsh_to_cf[gmsh_element_type][j];
-        m_file >> gmsh_node_number;
+        read_record(gmsh_node_number);
         cf_node_number = m_node_idx_gmsh_to_cf[gmsh_node_number];
         cf_element[cf_idx] = cf_node_number;
 //        if (PE::Comm::instance().rank()==IO_rank)
@@ -643,9 +1188,13 @@ void Reader::read_connectivity()
       (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type]++;
 
     }
+    else
+    {
+      skip_record_values(nb_tags + nb_element_nodes, 0);
+    }
 
     // finish the line
-    getline(m_file,line);
+    finish_record();
   }
   getline(m_file,line);  // ENDOFSECTION
 }
@@ -722,7 +1271,8 @@ void Reader::read_element_node_data()
         std::map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it;
         for (Uint e=0; e<gmsh_field.nb_entries; ++e)
         {
-          m_file >> gmsh_elem_idx >> gmsh_nb_elem_nodes;
+          read_record(gmsh_elem_idx);
+          read_record(gmsh_nb_elem_nodes);
 
           it = m_elem_idx_gmsh_to_cf.find(gmsh_elem_idx);
           if (it != m_elem_idx_gmsh_to_cf.end())
@@ -736,7 +1286,7 @@ void Reader::read_element_node_data()
             {
 
               for (d=0; d<data.size(); ++d)
-                m_file >> data[d];
+                read_record(data[d]);
 
               mesh::Field::Row field_data = field[space.connectivity()[cf_idx][n]] ;
 
@@ -750,7 +1300,11 @@ void Reader::read_element_node_data()
                 field_data[v] = data[d++];
             }
           }
-          getline(m_file,line); // finish line
+          else
+          {
+            skip_record_values(0, gmsh_nb_elem_nodes*data.size());
+          }
+          finish_record(); // finish line
         }
       }
     }
@@ -813,9 +1367,9 @@ void Reader::read_element_data()
 
         for (Uint e=0; e<gmsh_field.nb_entries; ++e)
         {
-          m_file >> gmsh_elem_idx;
+          read_record(gmsh_elem_idx);
           for (d=0; d<data.size(); ++d)
-            m_file >> data[d];
+            read_record(data[d]);
 
           std::map<Uint, std::pair<Handle< Elements >,Uint> >::iterator it = m_elem_idx_gmsh_to_cf.find(gmsh_elem_idx);
           if (it != m_elem_idx_gmsh_to_cf.end())
@@ -883,9 +1437,9 @@ void Reader::read_node_data()
 
       for (Uint e=0; e<gmsh_field.nb_entries; ++e)
       {
-        m_file >> gmsh_node_idx;
+        read_record(gmsh_node_idx);
         for (d=0; d<data.size(); ++d)
-          m_file >> data[d];
+          read_record(data[d]);
 
         std::map<Uint, Uint>::iterator it = m_node_idx_gmsh_to_cf.find(gmsh_node_idx);
         if (it != m_node_idx_gmsh_to_cf.end())
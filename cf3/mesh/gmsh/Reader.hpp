@@ -23,6 +23,7 @@ namespace cf3 {
 namespace mesh {
 
 class Elements;
+class Entities;
 class Region;
 class MergedParallelDistribution;
 class Dictionary;
@@ -51,8 +52,40 @@ public: // functions
 
 private: // functions
 
+  /// Read the $MeshFormat section at the start of the file, to find out if the file is binary,
+  /// and if so, if its endianness differs from the one of this machine
+  void read_mesh_format();
+
   void get_file_positions();
 
+  /// Read a number of a nodes, elements or data record: text in ASCII files, a raw int or real in binary files
+  void read_record(Uint& value);
+  void read_record(Real& value);
+
+  /// Read the number, type and number of tags of the next element of the $Elements section.
+  /// Binary files store the elements in blocks of one type, after a header with the type, the number of elements and the number of tags
+  void read_element_header(Uint& number, Uint& type, Uint& nb_tags);
+
+  /// Skip the given number of ints and reals of the current record. Only needed in binary files,
+  /// since records of ASCII files are skipped by finish_record()
+  void skip_record_values(const Uint nb_ints, const Uint nb_reals);
+
+  /// Move to the next record: the rest of the line is skipped in ASCII files
+  void finish_record();
+
+  /// Skip the binary data of a $NodeData, $ElementData or $ElementNodeData section at position,
+  /// leaving the file at the line with the end keyword
+  void skip_binary_data(const Uint position, const bool element_node_data);
+
+  /// Read the mesh with each process parsing only its own byte range of the file
+  void read_partitioned(const boost::filesystem::path& fp);
+
+  /// Read the $PhysicalNames section from the current file position, after the section keyword
+  void read_physical_names();
+
+  /// Create the element tables of each region, sized with m_nb_gmsh_elem_in_region
+  void create_element_tables(std::vector<std::map<Uint, Entities*> >& conn_table_idx);
+
   Handle<Region> create_region(std::string const& relative_path);
 
   void find_used_nodes();
@@ -119,6 +152,16 @@ private: // data
   Uint m_total_nb_elements;
   Uint m_total_nb_nodes;
 
+  /// Format of the file, from $MeshFormat
+  bool m_binary;
+  bool m_swap_bytes;
+  Uint m_data_size;
+
+  /// Elements left in the current block of a binary $Elements section, and the type and number of tags of the block
+  Uint m_nb_elements_left_in_block;
+  Uint m_block_element_type;
+  Uint m_block_nb_tags;
+
   struct Field
   {
     std::string name;
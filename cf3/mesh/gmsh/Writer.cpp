@@ -5,6 +5,7 @@
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/thread/thread.hpp>
 
 #include "common/Log.hpp"
@@ -45,14 +46,44 @@ common::ComponentBuilder < gmsh::Writer, MeshWriter, LibGmsh> aGmshWriter_Builde
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+  /// Write the raw bytes of a value, in the byte order of this machine, as the binary format requires
+  template<typename T>
+  void write_binary(std::fstream& file, const T value)
+  {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  /// Write the values of a field in one node, as text or as raw doubles
+  void write_values(std::fstream& file, const RealVector& values, const bool binary)
+  {
+    for (Uint i=0; i<values.size(); ++i)
+    {
+      if (binary)
+        write_binary<double>(file, values[i]);
+      else
+        file << " " << values[i];
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 Writer::Writer( const std::string& name )
-: MeshWriter(name)
+: MeshWriter(name),
+  m_binary(false)
 {
   options().add("serial",false)
       .pretty_name("Serial Format")
       .description("All processors write in 1 file")
       .mark_basic();
 
+  options().add("binary",false)
+      .pretty_name("Binary Format")
+      .description("Write the binary variant of the MSH format, which is smaller and faster to read and write than ASCII")
+      .mark_basic();
+
   // gmsh types: http://www.geuz.org/gmsh/doc/texinfo/gmsh.html#MSH-ASCII-file-format
 
   m_elementTypes["cf3.mesh.LagrangeP0.Point1D"]=P0POINT;
@@ -105,7 +136,8 @@ void Writer::write()
   boost::filesystem::fstream file;
   boost::filesystem::path path (m_file_path.path());
   path = path.parent_path() / boost::filesystem::path (boost::filesystem::basename(path) + "_P" + to_str(PE::Comm::instance().rank()) + boost::filesystem::extension(path));
-  file.open(path,std::ios_base::out);
+  m_binary = options().value<bool>("binary");
+  file.open(path,m_binary ? std::ios_base::out | std::ios_base::binary : std::ios_base::out);
   if (!file) // didn't open so throw exception
   {
      throw boost::filesystem::filesystem_error( path.string() + " failed to open",
@@ -146,12 +178,18 @@ void Writer::write()
 void Writer::write_header(std::fstream& file)
 {
   std::string version = "2";
-  Uint file_type = 0; // ASCII
-  Uint data_size = 8; // double precision
+  Uint file_type = m_binary ? 1 : 0; // ASCII or binary
+  Uint data_size = sizeof(double); // double precision
 
   // format
   file << "$MeshFormat\n";
   file << version << " " << file_type << " " << data_size << "\n";
+  if (m_binary)
+  {
+    // The integer 1, from which readers detect the endianness
+    detail::write_binary<boost::int32_t>(file, 1);
+    file << "\n";
+  }
   file << "$EndMeshFormat\n";
 
   m_groupnumber.clear();
@@ -223,16 +261,27 @@ void Writer::write_coordinates(std::fstream& file)
   boost_foreach( const Uint node, used_nodes.array())
   {
     common::Table<Real>::ConstRow coord = coordinates[node];
-    file << geometry.glb_idx()[node]+1 << " ";
-    for (Uint d=0; d<3; d++)
+    if (m_binary)
     {
-      if (d<nb_dim)
-        file << coord[d] << " ";
-      else
-        file << 0 << " ";
+      detail::write_binary<boost::int32_t>(file, geometry.glb_idx()[node]+1);
+      for (Uint d=0; d<3; d++)
+        detail::write_binary<double>(file, d<nb_dim ? coord[d] : 0.);
+    }
+    else
+    {
+      file << geometry.glb_idx()[node]+1 << " ";
+      for (Uint d=0; d<3; d++)
+      {
+        if (d<nb_dim)
+          file << coord[d] << " ";
+        else
+          file << 0 << " ";
+      }
+      file << "\n";
     }
-    file << "\n";
   }
+  if (m_binary)
+    file << "\n";
 
   file << "$EndNodes\n";
   // restore precision
@@ -251,6 +300,8 @@ void Writer::write_connectivity(std::fstream& file)
   /// $EndElements
   /// @endcode
   /// @note partition number (tag3) is set to -1 for ghost elements (conforming Gmsh standard format)
+  /// @note in binary files the elements of each Entities are written as one block, with a header
+  ///       holding elem-type, number-of-elements and number-of-tags
 
   Uint nb_elems = 0;
   boost_foreach(const Handle<Region const>& region, m_regions)
@@ -273,10 +324,37 @@ void Writer::write_connectivity(std::fstream& file)
     const Connectivity& element_connectivity = elements->geometry_space().connectivity();
     const Uint nb_elem = elements->size();
     bool ghost;
+    if (m_binary)
+    {
+      Uint nb_written_elem = nb_elem;
+      if (!m_enable_overlap)
+      {
+        for (Uint e=0; e<nb_elem; ++e)
+        {
+          if (elements->is_ghost(e))
+            --nb_written_elem;
+        }
+      }
+      if (nb_written_elem != 0)
+      {
+        detail::write_binary<boost::int32_t>(file, elm_type);
+        detail::write_binary<boost::int32_t>(file, nb_written_elem);
+        detail::write_binary<boost::int32_t>(file, number_of_tags);
+      }
+    }
     for (Uint e=0; e<nb_elem; ++e)
     {
       ghost = elements->is_ghost(e);
-      if( m_enable_overlap || !ghost )
+      if( (m_enable_overlap || !ghost) && m_binary )
+      {
+        detail::write_binary<boost::int32_t>(file, elements->glb_idx()[e]+1);
+        detail::write_binary<boost::int32_t>(file, group_number);
+        detail::write_binary<boost::int32_t>(file, elementary_entity_index);
+        detail::write_binary<boost::int32_t>(file, ghost ? -1 : static_cast<int>(partition_number));
+        boost_foreach(const Uint node_idx, element_connectivity[e])
+          detail::write_binary<boost::int32_t>(file, elements->geometry_fields().glb_idx()[node_idx]+1);
+      }
+      else if( m_enable_overlap || !ghost )
       {
         file << elements->glb_idx()[e]+1 << " " << elm_type << " " << number_of_tags << " " << group_number << " " << elementary_entity_index << " " << (ghost? -1 : partition_number);
         boost_foreach(const Uint node_idx, element_connectivity[e])
@@ -288,6 +366,8 @@ void Writer::write_connectivity(std::fstream& file)
     }
     ++elementary_entity_index;
   }
+  if (m_binary)
+    file << "\n";
   file << "$EndElements\n";
 }
 
@@ -397,7 +477,15 @@ void Writer::write_elem_nodal_data(std::fstream& file)
             {
               if (m_enable_overlap || !elements.is_ghost(local_elm_idx))
               {
-                file << elements.glb_idx()[local_elm_idx]+1 << " " << nb_nodes << " ";
+                if (m_binary)
+                {
+                  detail::write_binary<boost::int32_t>(file, elements.glb_idx()[local_elm_idx]+1);
+                  detail::write_binary<boost::int32_t>(file, nb_nodes);
+                }
+                else
+                {
+                  file << elements.glb_idx()[local_elm_idx]+1 << " " << nb_nodes << " ";
+                }
                 /// set field data
                 Connectivity::ConstRow field_indexes = field_space.connectivity()[local_elm_idx];
                 for (Uint iState=0; iState<nb_states; ++iState)
@@ -421,22 +509,22 @@ void Writer::write_elem_nodal_data(std::fstream& file)
                     data[1]=node_data[1];
                     data[3]=node_data[2];
                     data[4]=node_data[3];
-                    for (Uint idx=0; idx<datasize; ++idx)
-                      file << " " << data[idx];
                   }
                   else
                   {
-                    for (Uint j=0; j<var_type; ++j)
-                      file << " " << node_data[j];
-                    if (var_type == VECTOR_2D)
-                      file << " " << 0.0;
+                    // 2D vectors are written as 3D vectors, with a zero last component
+                    data.head(static_cast<int>(var_type)) = node_data;
                   }
+                  detail::write_values(file, data, m_binary);
                 }
-                file << "\n";
+                if (!m_binary)
+                  file << "\n";
               }
             }
           }
         }
+        if (m_binary)
+          file << "\n";
         file << "$EndElementNodeData\n";
         row_idx += Uint(var_type);
       }
@@ -584,30 +672,37 @@ void Writer::write_nodal_data(std::fstream& file)
                   cf3_assert(node_data.size() == var_type);
 
                   // * write
-                  file << m_mesh->geometry_fields().glb_idx()[geom_space_node]+1 << " ";
-
                   if (var_type==TENSOR_2D)
                   {
                     data[0]=node_data[0];
                     data[1]=node_data[1];
                     data[3]=node_data[2];
                     data[4]=node_data[3];
-                    for (Uint idx=0; idx<datasize; ++idx)
-                      file << " " << data[idx];
                   }
                   else
                   {
-                    for (Uint j=0; j<var_type; ++j)
-                      file << " " << node_data[j];
-                    if (var_type == VECTOR_2D)
-                      file << " " << 0.0;
+                    // 2D vectors are written as 3D vectors, with a zero last component
+                    data.head(static_cast<int>(var_type)) = node_data;
+                  }
+
+                  if (m_binary)
+                  {
+                    detail::write_binary<boost::int32_t>(file, m_mesh->geometry_fields().glb_idx()[geom_space_node]+1);
+                    detail::write_values(file, data, true);
+                  }
+                  else
+                  {
+                    file << m_mesh->geometry_fields().glb_idx()[geom_space_node]+1 << " ";
+                    detail::write_values(file, data, false);
+                    file << "\n";
                   }
-                  file << "\n";
                 }
               }
             }
           }
         }
+        if (m_binary)
+          file << "\n";
         file << "$EndNodeData\n";
         row_idx += Uint(var_type);
       }
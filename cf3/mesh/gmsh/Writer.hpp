@@ -65,6 +65,9 @@ private: // data
   std::map<std::string,Uint> m_elementTypes;
 
   std::vector< Handle<Entities const> > m_entities_vector;
+
+  /// Write the binary variant of the format, from the "binary" option
+  bool m_binary;
 }; // end Writer
 
 
@@ -4,6 +4,7 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <set>
 
 #include "common/Log.hpp"
@@ -29,6 +30,7 @@
 #include "mesh/Connectivity.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/MeshTransformer.hpp"
+#include "mesh/FileRange.hpp"
 
 #include "mesh/neu/Reader.hpp"
 
@@ -66,6 +68,11 @@ Reader::Reader( const std::string& name )
       .description("Read the surface elements for the boundary")
       .pretty_name("Read Boundaries");
 
+  options().add("partitioned_read", false)
+      .description("Let every process parse only its own byte range of the file and redistribute the nodes and elements, "
+                   "instead of every process parsing the whole file. Requires part and nb_parts to be the rank and the number of processes.")
+      .pretty_name("Partitioned Read");
+
   properties()["brief"] = std::string("neutral file mesh reader component");
 
   std::string desc;
@@ -105,8 +112,10 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   // set the internal mesh pointer
   m_mesh = Handle<Mesh>(mesh.handle<Component>());
 
-  // Read file once and store positions
-  get_file_positions();
+  // Read file once and store positions, unless every process only reads its own part
+  const bool partitioned_read = options().value<bool>("partitioned_read");
+  if (!partitioned_read)
+    get_file_positions();
 
   // Read mesh information
   read_headerData();
@@ -128,14 +137,21 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   //else
   //  m_region = m_mesh->create_region(m_headerData.mesh_name,!option("Serial Handle<Region>(Merge").value<bool>()).handle<Component>());
 
-  find_ghost_nodes();
-  read_coordinates();
-  read_connectivity();
-  if (options().value<bool>("read_boundaries"))
-    read_boundaries();
-
-  if (options().value<bool>("read_groups"))
-    read_groups();
+  if (partitioned_read)
+  {
+    read_partitioned(fp);
+  }
+  else
+  {
+    find_ghost_nodes();
+    read_coordinates();
+    read_connectivity();
+    if (options().value<bool>("read_boundaries"))
+      read_boundaries();
+
+    if (options().value<bool>("read_groups"))
+      read_groups();
+  }
 
   // clean-up
   // --------
@@ -170,6 +186,320 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+  /// Offset of the ENDOFSECTION line that closes the section starting at begin
+  FileRange::OffsetT section_end(const std::vector<FileRange::OffsetT>& section_ends, const FileRange::OffsetT begin)
+  {
+    std::vector<FileRange::OffsetT>::const_iterator end = std::upper_bound(section_ends.begin(), section_ends.end(), begin);
+    if (end == section_ends.end())
+      throw ParsingFailed(FromHere(),"Missing ENDOFSECTION after offset " + to_str(begin));
+    return *end;
+  }
+
+  /// Element records that do not fit on one line continue with lines indented past the
+  /// element number, type and number of nodes
+  bool is_continuation_line(const char* line)
+  {
+    Uint indent = 0;
+    for ( ; line[indent] == ' '; ++indent);
+    return indent >= 15 && line[indent] != '\n' && line[indent] != '\r' && line[indent] != '\0';
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_partitioned(const boost::filesystem::path& fp)
+{
+  PE::Comm& comm = PE::Comm::instance();
+  const Uint part = comm.rank();
+  const Uint nb_parts = comm.size();
+  if (options().value<Uint>("part") != part || options().value<Uint>("nb_parts") != nb_parts)
+    throw BadValue(FromHere(), "partitioned_read requires part and nb_parts to be the rank and the number of processes");
+  m_hash->options().set("nb_parts",nb_parts);
+
+  // Every process reads its own byte range, and all of them find the sections together
+  FileRange range(fp, part, nb_parts);
+
+  enum { NODAL_COORDINATES=0, ELEMENTS_CELLS, ELEMENT_GROUP, BOUNDARY_CONDITIONS, END_OF_SECTION };
+  std::vector<std::string> keywords;
+  keywords.push_back("NODAL COORDINATES");
+  keywords.push_back("ELEMENTS/CELLS");
+  keywords.push_back("ELEMENT GROUP");
+  keywords.push_back("BOUNDARY CONDITIONS");
+  keywords.push_back("ENDOFSECTION");
+  std::vector< std::vector<FileRange::OffsetT> > sections;
+  find_lines(range, keywords, sections);
+
+  if (sections[NODAL_COORDINATES].empty())
+    throw ParsingFailed(FromHere(),"File contains no nodes");
+  if (sections[ELEMENTS_CELLS].empty())
+    throw ParsingFailed(FromHere(),"File does not contain any elements");
+  if (sections[ELEMENT_GROUP].size() != m_headerData.NGRPS || sections[BOUNDARY_CONDITIONS].size() != m_headerData.NBSETS)
+    throw ParsingFailed(FromHere(),"Number of element groups or boundary condition sets does not match the header of " + fp.string());
+
+  // Lines belong to the range they start in, so data offsets are clipped to the original range,
+  // even if the range is extended for element records that continue past its end
+  const FileRange::OffsetT range_begin = range.begin();
+  const FileRange::OffsetT range_end = range.end();
+  std::string line;
+
+  m_file.seekg(static_cast<std::streamoff>(sections[NODAL_COORDINATES][0]),std::ios::beg);
+  getline(m_file,line);
+  const FileRange::OffsetT nodes_begin = std::max(range_begin, static_cast<FileRange::OffsetT>(m_file.tellg()));
+  const FileRange::OffsetT nodes_end = std::min(range_end, detail::section_end(sections[END_OF_SECTION], sections[NODAL_COORDINATES][0]));
+
+  m_file.seekg(static_cast<std::streamoff>(sections[ELEMENTS_CELLS][0]),std::ios::beg);
+  getline(m_file,line);
+  const FileRange::OffsetT elements_section_end = detail::section_end(sections[END_OF_SECTION], sections[ELEMENTS_CELLS][0]);
+  const FileRange::OffsetT elements_begin = std::max(range_begin, static_cast<FileRange::OffsetT>(m_file.tellg()));
+  const FileRange::OffsetT elements_end = std::min(range_end, elements_section_end);
+
+  // The last element record of the range may continue on the lines of the next range
+  if (elements_begin < elements_end && elements_section_end > range_end)
+    range.extend(4096);
+
+  // Parse the nodes in the range. The node number gives the owner, since nodes are numbered 1..NUMNP
+  std::vector< std::vector<Uint> > send_ids(nb_parts), recv_ids;
+  std::vector< std::vector<Real> > send_coords(nb_parts), recv_coords;
+  TextScanner scanner(range.data(range_begin));
+  if (nodes_begin < nodes_end)
+    scanner.seek(range.data(nodes_begin));
+  while (nodes_begin < nodes_end && range.offset(scanner.position()) < nodes_end)
+  {
+    Uint node_number;
+    if (!scanner.read(node_number) || node_number == 0 || node_number > m_headerData.NUMNP)
+      throw ParsingFailed(FromHere(),"Invalid node at offset " + to_str(range.offset(scanner.position())) + " in " + fp.string());
+    const Uint dest = m_hash->subhash(NODES).part_of_obj(node_number-1);
+    send_ids[dest].push_back(node_number);
+    for (Uint dim=0; dim<m_headerData.NDFCD; ++dim)
+    {
+      Real coord;
+      if (!scanner.read(coord))
+        throw ParsingFailed(FromHere(),"Missing coordinates for node " + to_str(node_number) + " in " + fp.string());
+      send_coords[dest].push_back(coord);
+    }
+    scanner.skip_line();
+    scanner.skip_whitespace();
+  }
+  exchange_parts(send_ids, recv_ids);
+  exchange_parts(send_coords, recv_coords);
+  send_ids.assign(nb_parts, std::vector<Uint>());
+  send_coords.assign(nb_parts, std::vector<Real>());
+
+  // Parse the elements that start in the range: element number, type, number of nodes and nodes
+  std::vector< std::vector<Uint> > send_elements(nb_parts), recv_elements;
+  if (elements_begin < elements_end)
+  {
+    scanner.seek(range.data(elements_begin));
+    while (range.offset(scanner.position()) < elements_end && detail::is_continuation_line(scanner.position()))
+      scanner.skip_line();
+    scanner.skip_whitespace();
+  }
+  while (elements_begin < elements_end && range.offset(scanner.position()) < elements_end)
+  {
+    Uint element_number, neu_type, nb_element_nodes;
+    if (!scanner.read(element_number) || !scanner.read(neu_type) || !scanner.read(nb_element_nodes) || element_number == 0 || element_number > m_headerData.NELEM)
+      throw ParsingFailed(FromHere(),"Invalid element at offset " + to_str(range.offset(scanner.position())) + " in " + fp.string());
+
+    std::vector<Uint>& record = send_elements[m_hash->subhash(ELEMS).part_of_obj(element_number-1)];
+    record.push_back(element_number);
+    record.push_back(neu_type);
+    record.push_back(nb_element_nodes);
+    for (Uint j=0; j<nb_element_nodes; ++j)
+    {
+      Uint node_number;
+      if (!scanner.read(node_number) || node_number == 0 || node_number > m_headerData.NUMNP)
+        throw ParsingFailed(FromHere(),"Missing nodes for element " + to_str(element_number) + " in " + fp.string());
+      record.push_back(node_number);
+    }
+    scanner.skip_line();
+    scanner.skip_whitespace();
+  }
+  exchange_parts(send_elements, recv_elements);
+  send_elements.clear();
+
+  // Owned nodes, in file order since the ranges are
+  m_node_to_coord_idx.clear();
+  std::vector<Uint> node_ids;
+  std::vector<Real> node_coords;
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    for (Uint n=0; n<recv_ids[p].size(); ++n)
+    {
+      m_node_to_coord_idx[recv_ids[p][n]] = node_ids.size();
+      node_ids.push_back(recv_ids[p][n]);
+    }
+    node_coords.insert(node_coords.end(), recv_coords[p].begin(), recv_coords[p].end());
+  }
+  const Uint nb_owned_nodes = node_ids.size();
+
+  // Ask the owners of the other nodes of the owned elements for their coordinates
+  std::vector< std::vector<Uint> > send_requests(nb_parts), recv_requests;
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    for (Uint i=0; i<recv_elements[p].size(); i += 3 + recv_elements[p][i+2])
+    {
+      for (Uint j=0; j<recv_elements[p][i+2]; ++j)
+      {
+        const Uint node_number = recv_elements[p][i+3+j];
+        if (m_node_to_coord_idx.insert(std::make_pair(node_number, node_ids.size())).second)
+        {
+          node_ids.push_back(node_number);
+          send_requests[m_hash->subhash(NODES).part_of_obj(node_number-1)].push_back(node_number);
+        }
+      }
+    }
+  }
+  exchange_parts(send_requests, recv_requests);
+
+  std::vector< std::vector<Real> > send_answers(nb_parts), recv_answers;
+  for (Uint p=0; p<nb_parts; ++p)
+  {
+    boost_foreach(const Uint node_number, recv_requests[p])
+    {
+      std::map<Uint,Uint>::const_iterator it = m_node_to_coord_idx.find(node_number);
+      if (it == m_node_to_coord_idx.end() || it->second >= nb_owned_nodes)
+        throw ParsingFailed(FromHere(),"Node " + to_str(node_number) + " is not in " + fp.string());
+      send_answers[p].insert(send_answers[p].end(), &node_coords[it->second*m_headerData.NDFCD], &node_coords[it->second*m_headerData.NDFCD] + m_headerData.NDFCD);
+    }
+  }
+  exchange_parts(send_answers, recv_answers);
+
+  // The ghost nodes were requested in order, per owner
+  std::vector<Uint> answer_idx(nb_parts, 0);
+  node_coords.resize(node_ids.size()*m_headerData.NDFCD);
+  for (Uint n=nb_owned_nodes; n<node_ids.size(); ++n)
+  {
+    const Uint owner = m_hash->subhash(NODES).part_of_obj(node_ids[n]-1);
+    std::copy(&recv_answers[owner][answer_idx[owner]], &recv_answers[owner][answer_idx[owner]] + m_headerData.NDFCD, &node_coords[n*m_headerData.NDFCD]);
+    answer_idx[owner] += m_headerData.NDFCD;
+  }
+
+  Dictionary& nodes = m_mesh->geometry_fields();
+  nodes.resize(node_ids.size());
+  for (Uint n=0; n<node_ids.size(); ++n)
+  {
+    nodes.rank()[n] = n < nb_owned_nodes ? part : m_hash->subhash(NODES).part_of_obj(node_ids[n]-1);
+    nodes.glb_idx()[n] = node_ids[n];
+    for (Uint dim=0; dim<m_headerData.NDFCD; ++dim)
+      nodes.coordinates()[n][dim] = node_coords[n*m_headerData.NDFCD+dim];
+  }
+
+  // Store the owned elements in the temporary region, as read_connectivity does
+  m_tmp = Handle<Region>(m_region->create_region("main").handle<Component>());
+  m_global_to_tmp.clear();
+  {
+    std::map<std::string,Handle< Elements > > elements = create_cells_in_region(*m_tmp,nodes,m_supported_types);
+    std::map<std::string,boost::shared_ptr< Connectivity::Buffer > > buffer = create_connectivity_buffermap(elements);
+    std::vector<Uint> cf_element;
+    for (Uint p=0; p<nb_parts; ++p)
+    {
+      for (Uint i=0; i<recv_elements[p].size(); i += 3 + recv_elements[p][i+2])
+      {
+        const Uint element_number = recv_elements[p][i];
+        const Uint neu_type = recv_elements[p][i+1];
+        const Uint nb_element_nodes = recv_elements[p][i+2];
+        cf_element.resize(nb_element_nodes);
+        for (Uint j=0; j<nb_element_nodes; ++j)
+          cf_element[m_nodes_neu_to_cf[neu_type][j]] = m_node_to_coord_idx[recv_elements[p][i+3+j]];
+        const std::string etype_CF = element_type(neu_type,nb_element_nodes);
+        const Uint table_idx = buffer[etype_CF]->add_row(cf_element);
+        m_global_to_tmp[element_number] = std::make_pair(elements[etype_CF],table_idx);
+      }
+    }
+  } // the buffers are flushed here
+  m_node_to_coord_idx.clear();
+  recv_elements.clear();
+
+  // Boundary entries go to the owner of their element, tagged with the index of their set
+  if (options().value<bool>("read_boundaries"))
+  {
+    std::vector<std::string> names(m_headerData.NBSETS);
+    std::vector< std::vector<Uint> > send_entries(nb_parts), recv_entries;
+    for (Uint t=0; t<m_headerData.NBSETS; ++t)
+    {
+      m_file.seekg(static_cast<std::streamoff>(sections[BOUNDARY_CONDITIONS][t]),std::ios::beg);
+      Uint NENTRY;
+      read_boundary_header(names[t], NENTRY);
+      const FileRange::OffsetT entries_begin = std::max(range_begin, static_cast<FileRange::OffsetT>(m_file.tellg()));
+      const FileRange::OffsetT entries_end = std::min(range_end, detail::section_end(sections[END_OF_SECTION], sections[BOUNDARY_CONDITIONS][t]));
+      if (entries_begin < entries_end)
+        scanner.seek(range.data(entries_begin));
+      while (entries_begin < entries_end && range.offset(scanner.position()) < entries_end)
+      {
+        Uint ELEM, ETYPE, FACE;
+        if (!scanner.read(ELEM) || !scanner.read(ETYPE) || !scanner.read(FACE) || ELEM == 0 || ELEM > m_headerData.NELEM)
+          throw ParsingFailed(FromHere(),"Invalid entry in boundary condition set " + names[t] + " of " + fp.string());
+        std::vector<Uint>& entry = send_entries[m_hash->subhash(ELEMS).part_of_obj(ELEM-1)];
+        entry.push_back(t);
+        entry.push_back(ELEM);
+        entry.push_back(ETYPE);
+        entry.push_back(FACE);
+        scanner.skip_line();
+        scanner.skip_whitespace();
+      }
+    }
+    exchange_parts(send_entries, recv_entries);
+
+    std::vector< std::vector<Uint> > entries(m_headerData.NBSETS);
+    for (Uint p=0; p<nb_parts; ++p)
+    {
+      for (Uint i=0; i<recv_entries[p].size(); i += 4)
+        entries[recv_entries[p][i]].insert(entries[recv_entries[p][i]].end(), &recv_entries[p][i+1], &recv_entries[p][i+1] + 3);
+    }
+    for (Uint t=0; t<m_headerData.NBSETS; ++t)
+      add_boundary_faces(names[t], entries[t]);
+  }
+
+  if (options().value<bool>("read_groups"))
+  {
+    std::vector<GroupData> groups(m_headerData.NGRPS);
+    std::vector< std::vector<Uint> > send_members(nb_parts), recv_members;
+    for (Uint g=0; g<m_headerData.NGRPS; ++g)
+    {
+      m_file.seekg(static_cast<std::streamoff>(sections[ELEMENT_GROUP][g]),std::ios::beg);
+      read_group_header(groups[g]);
+      if (m_headerData.NGRPS == 1)
+        break;
+
+      const FileRange::OffsetT members_begin = std::max(range_begin, static_cast<FileRange::OffsetT>(m_file.tellg()));
+      const FileRange::OffsetT members_end = std::min(range_end, detail::section_end(sections[END_OF_SECTION], sections[ELEMENT_GROUP][g]));
+      if (members_begin < members_end)
+        scanner.seek(range.data(members_begin));
+      Uint I;
+      while (members_begin < members_end && range.offset(scanner.position()) < members_end && scanner.read(I))
+      {
+        if (I == 0 || I > m_headerData.NELEM)
+          throw ParsingFailed(FromHere(),"Invalid element in group " + groups[g].ELMMAT + " of " + fp.string());
+        std::vector<Uint>& member = send_members[m_hash->subhash(ELEMS).part_of_obj(I-1)];
+        member.push_back(g);
+        member.push_back(I);
+        scanner.skip_whitespace();
+      }
+    }
+
+    // Only one group: the temporary region is renamed
+    if (m_headerData.NGRPS == 1)
+    {
+      m_tmp->rename(groups[0].ELMMAT);
+      m_tmp.reset();
+    }
+    else
+    {
+      exchange_parts(send_members, recv_members);
+      for (Uint p=0; p<nb_parts; ++p)
+      {
+        for (Uint i=0; i<recv_members[p].size(); i += 2)
+          groups[recv_members[p][i]].ELEM.push_back(recv_members[p][i+1]);
+      }
+      distribute_groups(groups);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Reader::get_file_positions()
 {
   std::string nodal_coordinates("NODAL COORDINATES");
@@ -418,12 +748,10 @@ void Reader::read_connectivity()
 
 void Reader::read_groups()
 {
-  Dictionary& nodes = m_mesh->geometry_fields();
   cf3_assert(m_element_group_positions.size() == m_headerData.NGRPS)
 
   std::vector<GroupData> groups(m_headerData.NGRPS);
   std::string line;
-  int dummy;
 
   std::set<Uint>::const_iterator it;
 
@@ -431,19 +759,9 @@ void Reader::read_groups()
   {
     m_file.seekg(m_element_group_positions[g],std::ios::beg);
 
-    std::string ELMMAT;
-    Uint NGP, NELGP, MTYP, NFLAGS, I;
-    getline(m_file,line);  // ELEMENT GROUP...
-    m_file >> line >> NGP >> line >> NELGP >> line >> MTYP >> line >> NFLAGS >> ELMMAT;
-    groups[g].NGP    = NGP;
-    groups[g].NELGP  = NELGP;
-    groups[g].MTYP   = MTYP;
-    groups[g].NFLAGS = NFLAGS;
-    groups[g].ELMMAT = ELMMAT;
-    //groups[g].print();
-
-    for (Uint i=0; i<NFLAGS; ++i)
-      m_file >> dummy;
+    Uint I;
+    read_group_header(groups[g]);
+    const Uint NELGP = groups[g].NELGP;
 
 
     // 2 cases:
@@ -483,8 +801,32 @@ void Reader::read_groups()
     getline(m_file,line);  // ENDOFSECTION
   }
 
+  distribute_groups(groups);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_group_header(GroupData& group)
+{
+  std::string line;
+  int dummy;
+
+  getline(m_file,line);  // ELEMENT GROUP...
+  m_file >> line >> group.NGP >> line >> group.NELGP >> line >> group.MTYP >> line >> group.NFLAGS >> group.ELMMAT;
+  //group.print();
+
+  for (Uint i=0; i<group.NFLAGS; ++i)
+    m_file >> dummy;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::distribute_groups(const std::vector<GroupData>& groups)
+{
+  Dictionary& nodes = m_mesh->geometry_fields();
+
   // Create Region for each group
-  boost_foreach(GroupData& group, groups)
+  boost_foreach(const GroupData& group, groups)
   {
 
     Region& region = m_region->create_region(group.ELMMAT);
@@ -524,20 +866,51 @@ void Reader::read_boundaries()
     m_file.seekg(m_boundary_condition_positions[t],std::ios::beg);
 
     std::string NAME;
-    int ITYPE, NENTRY, NVALUES, IBCODE1, IBCODE2, IBCODE3, IBCODE4, IBCODE5;
-
-    // read header
-    getline(m_file,line);  // BOUNDARY CONDITIONS...
-    getline(m_file,line);  // header
-    std::stringstream ss(line);
-    ss >> NAME >> ITYPE >> NENTRY >> NVALUES >> IBCODE1 >> IBCODE2 >> IBCODE3 >> IBCODE4 >> IBCODE5;
-    if (ITYPE!=1) {
-      throw common::NotSupported(FromHere(),"error: supports only boundary condition data 1 (element/cell): page C-11 of user's guide");
-    }
-    if (IBCODE1!=6) {
-      throw common::NotSupported(FromHere(),"error: supports only IBCODE1 6 (ELEMENT_SIDE)");
+    Uint NENTRY;
+    read_boundary_header(NAME, NENTRY);
+
+    // read boundary elements connectivity
+    std::vector<Uint> entries;
+    entries.reserve(3*NENTRY);
+    for (Uint i=0; i<NENTRY; ++i)
+    {
+      Uint ELEM, ETYPE, FACE;
+      m_file >> ELEM >> ETYPE >> FACE;
+      entries.push_back(ELEM);
+      entries.push_back(ETYPE);
+      entries.push_back(FACE);
+      getline(m_file,line);  // finish the line (read new line)
     }
+    getline(m_file,line);  // ENDOFSECTION
+
+    add_boundary_faces(NAME, entries);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::read_boundary_header(std::string& NAME, Uint& NENTRY)
+{
+  int ITYPE, NVALUES, IBCODE1, IBCODE2, IBCODE3, IBCODE4, IBCODE5;
+
+  // read header
+  std::string line;
+  getline(m_file,line);  // BOUNDARY CONDITIONS...
+  getline(m_file,line);  // header
+  std::stringstream ss(line);
+  ss >> NAME >> ITYPE >> NENTRY >> NVALUES >> IBCODE1 >> IBCODE2 >> IBCODE3 >> IBCODE4 >> IBCODE5;
+  if (ITYPE!=1) {
+    throw common::NotSupported(FromHere(),"error: supports only boundary condition data 1 (element/cell): page C-11 of user's guide");
+  }
+  if (IBCODE1!=6) {
+    throw common::NotSupported(FromHere(),"error: supports only IBCODE1 6 (ELEMENT_SIDE)");
+  }
+}
 
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::add_boundary_faces(const std::string& NAME, const std::vector<Uint>& entries)
+{
     Region& bc_region = m_region->create_region(NAME);
     Dictionary& nodes = m_mesh->geometry_fields();
 
@@ -545,13 +918,11 @@ void Reader::read_boundaries()
     std::map<std::string,Handle< Elements > > elements = create_faces_in_region (bc_region,nodes,m_supported_types);
     std::map<std::string,boost::shared_ptr< Connectivity::Buffer > > buffer = create_connectivity_buffermap (elements);
 
-    // read boundary elements connectivity
-    for (int i=0; i<NENTRY; ++i)
+    for (Uint i=0; i<entries.size(); i+=3)
     {
-      int ELEM, ETYPE, FACE;
-      m_file >> ELEM >> ETYPE >> FACE;
-
-      Uint global_element = ELEM;
+      const Uint global_element = entries[i];
+      const Uint ETYPE = entries[i+1];
+      const Uint FACE = entries[i+2];
 
       std::map<Uint,Region_TableIndex_pair>::iterator it = m_global_to_tmp.find(global_element);
       if (it != m_global_to_tmp.end())
@@ -580,11 +951,7 @@ void Reader::read_boundaries()
         cf3_assert_desc(to_str(row.size())+"!="+to_str(buffer[face_type]->get_appointed().shape()[1]),row.size() == buffer[face_type]->get_appointed().shape()[1]);
         buffer[face_type]->add_row(row);
       }
-      getline(m_file,line);  // finish the line (read new line)
     }
-    getline(m_file,line);  // ENDOFSECTION
-
-  }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -125,6 +125,23 @@ private: // data
     Uint ITYPE, NENTRY, NVALUES, IBCODE1;
   };
 
+private: // functions
+
+  /// Read the mesh with each process parsing only its own byte range of the file
+  void read_partitioned(const boost::filesystem::path& fp);
+
+  /// Read the header of an element group, leaving the file at the element indices
+  void read_group_header(GroupData& group);
+
+  /// Move the elements of each group from the temporary region to a region for the group
+  void distribute_groups(const std::vector<GroupData>& groups);
+
+  /// Read the header of a boundary condition set, leaving the file at the entries
+  void read_boundary_header(std::string& NAME, Uint& NENTRY);
+
+  /// Create the faces of a boundary region, given the (element, element type, face) triplets of the entries
+  void add_boundary_faces(const std::string& NAME, const std::vector<Uint>& entries);
+
 }; // end Reader
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4,9 +4,12 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <boost/bind.hpp>
+
 #include "common/Builder.hpp"
 #include "common/FindComponents.hpp"
 #include "common/OptionList.hpp"
+#include "common/ThreadPool.hpp"
 
 #include "mesh/Cells.hpp"
 #include "mesh/Field.hpp"
@@ -33,7 +36,9 @@ common::ComponentBuilder < ComputeRHS, common::Action, solver::LibSolver > Compu
 
 ////////////////////////////////////////////////////////////////////////////////
 
-ComputeRHS::ComputeRHS ( const std::string& name ) : common::Action(name)
+ComputeRHS::ComputeRHS ( const std::string& name ) :
+  common::Action(name),
+  m_batch_size(32)
 {
   options().add("rhs",m_rhs).link_to(&m_rhs)
       .description("Right-Hand-Side of equations")
@@ -41,6 +46,9 @@ ComputeRHS::ComputeRHS ( const std::string& name ) : common::Action(name)
   options().add("wave_speed",m_ws).link_to(&m_ws)
       .description("Wave speed")
       .mark_basic();
+  options().add("batch_size",m_batch_size).link_to(&m_batch_size)
+      .pretty_name("Batch Size")
+      .description("Number of consecutive cells passed at once to the term computers");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -106,7 +114,9 @@ void ComputeRHS::compute_rhs(const Uint elem_idx, std::vector<RealVector>& rhs,
 
 void ComputeRHS::compute_rhs(mesh::Field& rhs, mesh::Field& wave_speed)
 {
-  const Uint nb_eqs = rhs.row_size();
+  if (m_batch_size == 0) throw BadValue(FromHere(), "batch_size must be at least 1");
+
+  ThreadPool& pool = ThreadPool::instance();
   mesh::Dictionary& dict = rhs.dict();
   boost_foreach(const Handle<mesh::Entities>& cells, dict.entities_range() )
   {
@@ -114,30 +124,102 @@ void ComputeRHS::compute_rhs(mesh::Field& rhs, mesh::Field& wave_speed)
     {
       const Space& space = dict.space(*cells);
 
-      // Element-loop
+      // Split the non-ghost elements in batches, so ghosts are skipped once here instead of in the element loop
       const Uint nb_elems = cells->size();
-      const Uint nb_sol_pts = space.shape_function().nb_nodes();
+      m_batches.clear();
+      Uint elem_idx = 0;
+      while (elem_idx < nb_elems)
+      {
+        while (elem_idx < nb_elems && cells->is_ghost(elem_idx)) ++elem_idx;
+        const Uint batch_begin = elem_idx;
+        while (elem_idx < nb_elems && elem_idx-batch_begin < m_batch_size && !cells->is_ghost(elem_idx)) ++elem_idx;
+        if (elem_idx != batch_begin)
+          m_batches.push_back(std::make_pair(batch_begin,elem_idx));
+      }
 
-      std::vector<RealVector> elem_rhs(nb_sol_pts,RealVector(nb_eqs));
-      std::vector<Real> elem_wave_speed(nb_sol_pts);
+      bool thread_safe = true;
+      for (Uint t=0; t<m_term_computers.size(); ++t)
+      {
+        if (m_loop_cells[t])
+          thread_safe &= m_term_computers[t]->thread_safe();
+      }
 
-      for (Uint elem_idx=0; elem_idx<nb_elems; ++elem_idx)
+      if (thread_safe && pool.nb_threads() > 1)
       {
-        if (cells->is_ghost(elem_idx)==false)
-        {
-          compute_rhs(elem_idx,elem_rhs,elem_wave_speed);
-
-          mesh::Connectivity::ConstRow nodes = space.connectivity()[elem_idx];
-          for (Uint sol_pt=0; sol_pt<nb_sol_pts; ++sol_pt)
-          {
-            for (Uint eq=0; eq<nb_eqs; ++eq)
-            {
-              rhs[nodes[sol_pt]][eq] = elem_rhs[sol_pt][eq];
-            }
-            wave_speed[nodes[sol_pt]][0] = elem_wave_speed[sol_pt];
-          }
-        }
+        m_buffers.resize(pool.nb_threads());
+        pool.run(boost::bind(&ComputeRHS::compute_batches, this, _1, pool.nb_threads(), boost::ref(rhs), boost::ref(wave_speed), boost::cref(space)));
+      }
+      else
+      {
+        if (m_buffers.empty()) m_buffers.resize(1);
+        compute_batches(0, 1, rhs, wave_speed, space);
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeRHS::compute_batches(const Uint thread_idx, const Uint nb_parts, mesh::Field& rhs, mesh::Field& wave_speed, const mesh::Space& space)
+{
+  Uint begin, end;
+  split_range(m_batches.size(), nb_parts, thread_idx, begin, end);
+  BatchBuffers& buffers = m_buffers[thread_idx];
+  for (Uint b=begin; b<end; ++b)
+  {
+    compute_batch(m_batches[b].first, m_batches[b].second, buffers, rhs, wave_speed, space);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void ComputeRHS::compute_batch(const Uint begin, const Uint end, BatchBuffers& buffers, mesh::Field& rhs, mesh::Field& wave_speed, const mesh::Space& space)
+{
+  const Uint nb_eqs = rhs.row_size();
+  const Uint nb_sol_pts = space.shape_function().nb_nodes();
+  const Uint batch_size = end-begin;
+  const Uint rhs_size = nb_sol_pts*nb_eqs*batch_size;
+  const Uint ws_size = nb_sol_pts*batch_size;
+
+  // assign and resize only reallocate when a larger batch than before is encountered
+  buffers.rhs.assign(rhs_size,0.);
+  buffers.ws.assign(ws_size,0.);
+  buffers.term.resize(rhs_size);
+  buffers.term_ws.resize(ws_size);
+
+  Real* batch_rhs = &buffers.rhs[0];
+  Real* batch_ws = &buffers.ws[0];
+  const Real* term = &buffers.term[0];
+  const Real* term_ws = &buffers.term_ws[0];
+
+  for (Uint t=0; t<m_term_computers.size(); ++t)
+  {
+    if (m_loop_cells[t])
+    {
+      m_term_computers[t]->compute_term_batch(begin,end,nb_eqs,&buffers.term[0],&buffers.term_ws[0]);
+      for (Uint i=0; i<rhs_size; ++i)
+      {
+        batch_rhs[i] += term[i];
+      }
+      for (Uint i=0; i<ws_size; ++i)
+      {
+        batch_ws[i] = std::max(batch_ws[i],term_ws[i]);
+      }
+    }
+  }
+
+  const mesh::Connectivity& connectivity = space.connectivity();
+  for (Uint e=0; e<batch_size; ++e)
+  {
+    mesh::Connectivity::ConstRow nodes = connectivity[begin+e];
+    for (Uint sol_pt=0; sol_pt<nb_sol_pts; ++sol_pt)
+    {
+      mesh::Field::Row rhs_row = rhs[nodes[sol_pt]];
+      for (Uint eq=0; eq<nb_eqs; ++eq)
+      {
+        rhs_row[eq] = batch_rhs[(sol_pt*nb_eqs+eq)*batch_size+e];
       }
+      wave_speed[nodes[sol_pt]][0] = batch_ws[sol_pt*batch_size+e];
     }
   }
 }
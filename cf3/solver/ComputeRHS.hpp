@@ -19,6 +19,7 @@ namespace cf3 {
     class Entities;
     class Field;
     class Dictionary;
+    class Space;
   }
   namespace solver {
     class TermComputer;
@@ -56,13 +57,36 @@ public:
   virtual bool loop_cells(const Handle<mesh::Entities const>& cells);
 
   /// @brief Compute the complete rhs for a given element, as well as the wave-speeds
-  virtual void compute_rhs(const Uint elem_idx, std::vector<RealVector>& rhs, std::vector<Real>& wave_speed);
+  ///
+  /// Uses the per-element TermComputer::compute_term, and gives the same result as compute_rhs(mesh::Field&, mesh::Field&)
+  /// for the element. It is not called by that function, so it is not virtual: terms are customized through the
+  /// TermComputer components.
+  void compute_rhs(const Uint elem_idx, std::vector<RealVector>& rhs, std::vector<Real>& wave_speed);
 
   /// @brief Compute the complete rhs in a field, as well as wave speeds
+  ///
+  /// Non-ghost cells are processed in batches of consecutive elements, using TermComputer::compute_term_batch.
+  /// If all term computers are thread-safe, the batches are distributed over the threads of the common::ThreadPool.
+  /// Each solution point is assumed to belong to a single cell, as is the case for discontinuous spaces.
   virtual void compute_rhs(mesh::Field& rhs, mesh::Field& wave_speed);
 
 private:
 
+  /// Scratch buffers for one batch, in the structure-of-arrays layout of TermComputer::compute_term_batch
+  struct BatchBuffers
+  {
+    std::vector<Real> rhs;
+    std::vector<Real> ws;
+    std::vector<Real> term;
+    std::vector<Real> term_ws;
+  };
+
+  /// Compute the part of the batches assigned to the given thread
+  void compute_batches(const Uint thread_idx, const Uint nb_parts, mesh::Field& rhs, mesh::Field& wave_speed, const mesh::Space& space);
+
+  /// Compute the rhs for the elements [begin, end) in the given buffers and copy the result to the fields
+  void compute_batch(const Uint begin, const Uint end, BatchBuffers& buffers, mesh::Field& rhs, mesh::Field& wave_speed, const mesh::Space& space);
+
   Handle< mesh::Field > m_rhs;  ///! Right hand side field
   Handle< mesh::Field > m_ws;   ///! Wave speed field
 
@@ -71,6 +95,12 @@ private:
 
   std::vector< RealVector > m_tmp_term;
   std::vector< Real > m_tmp_ws;
+
+  Uint m_batch_size;
+  /// Begin and end of the batches of non-ghost elements for the current cells
+  std::vector< std::pair<Uint,Uint> > m_batches;
+  /// Scratch buffers, one per thread
+  std::vector< BatchBuffers > m_buffers;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,107 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include "common/Builder.hpp"
+#include "common/OptionList.hpp"
+#include "common/StringConversion.hpp"
+#include "mesh/Cells.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/ShapeFunction.hpp"
+#include "mesh/Space.hpp"
+#include "solver/FieldTermComputer.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace solver {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < FieldTermComputer, TermComputer, LibSolver > FieldTermComputer_Builder;
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+FieldTermComputer::FieldTermComputer ( const std::string& name )
+  : TermComputer(name),
+    m_factor(1.)
+{
+  options().add("source",m_source).link_to(&m_source)
+    .description("Field with the value of the term in each solution point")
+    .mark_basic();
+  options().add("factor",m_factor).link_to(&m_factor)
+    .description("Factor multiplying the source field")
+    .mark_basic();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+bool FieldTermComputer::loop_cells(const Handle<mesh::Entities const>& cells)
+{
+  if ( is_null(m_source) ) throw common::SetupError( FromHere(), "source not configured" );
+
+  m_space.reset();
+  if ( is_null(Handle<mesh::Cells const>(cells)) || !m_source->dict().defined_for_entities(cells) )
+    return false;
+
+  m_space = m_source->dict().space(cells);
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void FieldTermComputer::compute_term(const Uint elem_idx, std::vector<RealVector>& term, std::vector<Real>& wave_speed)
+{
+  cf3_assert(is_not_null(m_space));
+  const mesh::Connectivity::ConstRow nodes = m_space->connectivity()[elem_idx];
+  const Uint nb_pts = nodes.size();
+  const Uint nb_eqs = m_source->row_size();
+  term.resize(nb_pts, RealVector(nb_eqs));
+  wave_speed.resize(nb_pts);
+  for (Uint pt=0; pt<nb_pts; ++pt)
+  {
+    term[pt].resize(nb_eqs);
+    const mesh::Field::ConstRow source = m_source->array()[nodes[pt]];
+    for (Uint eq=0; eq<nb_eqs; ++eq)
+    {
+      term[pt][eq] = m_factor*source[eq];
+    }
+    wave_speed[pt] = 0.;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+void FieldTermComputer::compute_term_batch(const Uint begin, const Uint end, const Uint nb_eqs, Real* term, Real* wave_speed)
+{
+  cf3_assert(is_not_null(m_space));
+  if ( m_source->row_size() != nb_eqs )
+    throw common::BadValue( FromHere(), "source field "+m_source->uri().string()+" has "+common::to_str(m_source->row_size())+" variables instead of "+common::to_str(nb_eqs) );
+
+  const mesh::Connectivity& connectivity = m_space->connectivity();
+  const mesh::Field::ArrayT& source = m_source->array();
+  const Uint nb_pts = m_space->shape_function().nb_nodes();
+  const Uint batch_size = end - begin;
+  for (Uint e=0; e<batch_size; ++e)
+  {
+    const mesh::Connectivity::ConstRow nodes = connectivity[begin+e];
+    for (Uint pt=0; pt<nb_pts; ++pt)
+    {
+      const mesh::Field::ConstRow source_row = source[nodes[pt]];
+      for (Uint eq=0; eq<nb_eqs; ++eq)
+      {
+        term[(pt*nb_eqs+eq)*batch_size+e] = m_factor*source_row[eq];
+      }
+      wave_speed[pt*batch_size+e] = 0.;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // solver
+} // cf3
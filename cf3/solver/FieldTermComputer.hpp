@@ -0,0 +1,71 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_solver_FieldTermComputer_hpp
+#define cf3_solver_FieldTermComputer_hpp
+
+#include "solver/TermComputer.hpp"
+
+// Forward declares
+namespace cf3
+{
+  namespace mesh
+  {
+    class Space;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace solver {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Term that is given by a field, scaled by a constant factor
+///
+/// Used for source terms that are prescribed or computed elsewhere. The source field must be defined
+/// in the same space as the right hand side, and the wave speed of the term is zero.
+/// The batch computation only reads the source field, so it can run on several threads at once.
+class solver_API FieldTermComputer : public TermComputer
+{
+public:
+
+  /// @brief Constructor
+  FieldTermComputer ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~FieldTermComputer() {}
+
+  /// @Get the class name
+  static std::string type_name () { return "FieldTermComputer"; }
+
+  /// @brief Loops over the cells for which the source field is defined
+  virtual bool loop_cells(const Handle<mesh::Entities const>& cells);
+
+  /// @brief Compute the term for given element in given vectors
+  virtual void compute_term(const Uint elem_idx, std::vector<RealVector>& term, std::vector<Real>& wave_speed);
+
+  /// @brief Copy the scaled source values of the batch directly in the structure-of-arrays buffers
+  virtual void compute_term_batch(const Uint begin, const Uint end, const Uint nb_eqs, Real* term, Real* wave_speed);
+
+  virtual bool thread_safe() const { return true; }
+
+private:
+
+  Handle<mesh::Field> m_source;
+  Real m_factor;
+
+  /// Space of the source field for the current cells
+  Handle<mesh::Space const> m_space;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // solver
+} // cf3
+
+#endif // cf3_solver_FieldTermComputer_hpp
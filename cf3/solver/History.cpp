@@ -97,7 +97,8 @@ void History::set(const std::string& var_name, const std::vector<Real>& var_valu
 
 bool History::resize_if_necessary()
 {
-  if (m_table_needs_resize)
+  // The buffer is also missing after the table was restored from a checkpoint
+  if (m_table_needs_resize || is_null(m_buffer))
   {
     if (is_not_null(m_buffer))
     {
@@ -69,6 +69,27 @@ void TermComputer::compute_term(mesh::Field& term, mesh::Field& wave_speed)
   }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+
+void TermComputer::compute_term_batch(const Uint begin, const Uint end, const Uint nb_eqs, Real* term, Real* wave_speed)
+{
+  const Uint batch_size = end - begin;
+  for (Uint e=begin; e<end; ++e)
+  {
+    compute_term(e,m_tmp_term,m_tmp_ws);
+    const Uint i = e-begin;
+    const Uint nb_pts = m_tmp_term.size();
+    for (Uint pt=0; pt<nb_pts; ++pt)
+    {
+      for (Uint eq=0; eq<nb_eqs; ++eq)
+      {
+        term[(pt*nb_eqs+eq)*batch_size+i] = m_tmp_term[pt][eq];
+      }
+      wave_speed[pt*batch_size+i] = m_tmp_ws[pt];
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // solver
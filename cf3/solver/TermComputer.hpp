@@ -55,6 +55,19 @@ public:
   /// @brief Compute the term for given element in given vectors
   virtual void compute_term(const Uint elem_idx, std::vector<RealVector>& term, std::vector<Real>& wave_speed) = 0;
 
+  /// @brief Compute the term for the batch of consecutive elements [begin, end)
+  ///
+  /// Results are stored in structure-of-arrays layout, so a loop over the elements of the batch is contiguous:
+  /// term[(pt*nb_eqs + eq)*batch_size + e] and wave_speed[pt*batch_size + e], with batch_size = end - begin
+  /// and e the index of the element in the batch. Both buffers are allocated by the caller and must be overwritten.
+  /// The default implementation calls the per-element compute_term for each element of the batch,
+  /// implementations should override this to avoid the virtual call and the RealVector temporaries per element.
+  virtual void compute_term_batch(const Uint begin, const Uint end, const Uint nb_eqs, Real* term, Real* wave_speed);
+
+  /// @brief True if compute_term_batch may be called concurrently from several threads for different batches
+  /// of the same cells. The default compute_term_batch uses member buffers, so this is false by default.
+  virtual bool thread_safe() const { return false; }
+
  private:
 
   Handle<mesh::Field> m_term_field;
@@ -13,6 +13,8 @@
 #include <boost/proto/traits.hpp>
 
 
+#include "common/Profiler.hpp"
+
 #include "math/MatrixTypes.hpp"
 
 #include "math/LSS/System.hpp"
@@ -125,6 +127,8 @@ struct BlockAssignmentOp<SystemMatrixTag, OpTagT>
         block_accumulator.mat(block_row, block_col) = rhs(row, col);
       }
     }
+    // Timed per block, so the report shows the insertion time next to the element loop that contains it
+    common::ScopedTimer timer("LSS::assembly");
     do_assign_op_matrix(OpTagT(), lss.matrix(), block_accumulator);
   }
 };
@@ -146,6 +150,7 @@ struct BlockAssignmentOp<SystemRHSTag, OpTagT>
       block_accumulator.rhs[block_idx] = rhs[i];
     }
 
+    common::ScopedTimer timer("LSS::assembly");
     do_assign_op_rhs(OpTagT(), lss.rhs(), block_accumulator);
   }
 };
@@ -20,6 +20,8 @@
 #include <boost/mpl/transform.hpp>
 #include <boost/mpl/vector_c.hpp>
 
+#include <boost/type_traits/is_same.hpp>
+
 #include "common/Component.hpp"
 #include "common/FindComponents.hpp"
 
@@ -35,6 +37,7 @@
 #include "mesh/ElementData.hpp"
 #include "mesh/Connectivity.hpp"
 
+#include "ElementGeometryCache.hpp"
 #include "ElementMatrix.hpp"
 #include "ElementOperations.hpp"
 #include "FieldSync.hpp"
@@ -87,16 +90,19 @@ public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   GeometricSupport(const mesh::Elements& elements) :
+    m_nodes_filled(false),
     m_coordinates(elements.geometry_fields().coordinates()),
-    m_connectivity(elements.geometry_space().connectivity())
+    m_connectivity(elements.geometry_space().connectivity()),
+    m_cached_gradient(0)
   {
   }
 
-  /// Update nodes for the current element and set the connectivity for the passed block accumulator
+  /// Set the current element. The nodes are only gathered when they are needed, since cached geometry doesn't use them
   void set_element(const Uint element_idx)
   {
     m_element_idx = element_idx;
-    mesh::fill(m_nodes, m_coordinates, m_connectivity[element_idx]);
+    m_nodes_filled = false;
+    m_cached_gradient = 0;
   }
 
   void update_block_connectivity(math::LSS::BlockAccumulator& block_accumulator)
@@ -107,6 +113,11 @@ public:
   /// Reference to the current nodes
   ValueResultT nodes() const
   {
+    if(!m_nodes_filled)
+    {
+      mesh::fill(m_nodes, m_coordinates, m_connectivity[m_element_idx]);
+      m_nodes_filled = true;
+    }
     return m_nodes;
   }
 
@@ -118,13 +129,13 @@ public:
 
   Real volume() const
   {
-    return EtypeT::volume(m_nodes);
+    return EtypeT::volume(nodes());
   }
 
   const typename EtypeT::CoordsT& coordinates(const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
     EtypeT::SF::compute_value(mapped_coords, m_sf);
-    m_eval_result.noalias() = m_sf * m_nodes;
+    m_eval_result.noalias() = m_sf * nodes();
     return m_eval_result;
   }
 
@@ -137,7 +148,7 @@ public:
   /// Jacobian matrix computed by the shape function
   const typename EtypeT::JacobianT& jacobian(const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
-    EtypeT::compute_jacobian(mapped_coords, m_nodes, m_jacobian_matrix);
+    EtypeT::compute_jacobian(mapped_coords, nodes(), m_jacobian_matrix);
     return m_jacobian_matrix;
   }
 
@@ -155,7 +166,7 @@ public:
 
   Real jacobian_determinant(const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
-    m_jacobian_determinant = EtypeT::jacobian_determinant(mapped_coords, m_nodes);
+    m_jacobian_determinant = EtypeT::jacobian_determinant(mapped_coords, nodes());
     return m_jacobian_determinant;
   }
 
@@ -167,7 +178,7 @@ public:
 
   const typename EtypeT::CoordsT& normal(const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
-    EtypeT::normal(mapped_coords, m_nodes, m_normal_vector);
+    EtypeT::normal(mapped_coords, nodes(), m_normal_vector);
     return m_normal_vector;
   }
 
@@ -185,13 +196,32 @@ public:
   /// Precompute jacobian for the given mapped coordinates
   void compute_jacobian(const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
+    m_cached_gradient = 0;
     compute_jacobian_dispatch(boost::mpl::bool_<EtypeT::dimension == EtypeT::dimensionality>(), mapped_coords);
   }
 
   /// Precompute the interpolated value (requires a computed EtypeT)
   void compute_coordinates() const
   {
-    m_eval_result.noalias() = m_sf * m_nodes;
+    m_eval_result.noalias() = m_sf * nodes();
+  }
+
+  /// Take the jacobian, its inverse and determinant and the coordinates from a Gauss point of the ElementGeometryCache,
+  /// instead of computing them. Only for volume elements.
+  void set_cached_geometry(const Real* cached) const
+  {
+    typedef CachedGeometryLayout<EtypeT> LayoutT;
+    m_jacobian_determinant = cached[LayoutT::determinant];
+    m_jacobian_matrix = Eigen::Map<const typename EtypeT::JacobianT>(cached + LayoutT::jacobian);
+    m_jacobian_inverse = Eigen::Map<const typename EtypeT::JacobianT>(cached + LayoutT::jacobian_inverse);
+    m_eval_result = Eigen::Map<const typename EtypeT::CoordsT>(cached + LayoutT::coordinates);
+    m_cached_gradient = cached + LayoutT::gradient;
+  }
+
+  /// Physical gradient of the shape functions at the current Gauss point if it came from the cache, null otherwise
+  const Real* cached_gradient() const
+  {
+    return m_cached_gradient;
   }
 
   /// Precompute normal (if we have a "face" type)
@@ -207,7 +237,7 @@ private:
 
   void compute_normal_dispatch(boost::mpl::true_, const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
-    EtypeT::normal(mapped_coords, m_nodes, m_normal_vector);
+    EtypeT::normal(mapped_coords, nodes(), m_normal_vector);
   }
 
   void compute_jacobian_dispatch(boost::mpl::false_, const typename EtypeT::MappedCoordsT&) const
@@ -216,14 +246,15 @@ private:
 
   void compute_jacobian_dispatch(boost::mpl::true_, const typename EtypeT::MappedCoordsT& mapped_coords) const
   {
-    EtypeT::compute_jacobian(mapped_coords, m_nodes, m_jacobian_matrix);
+    EtypeT::compute_jacobian(mapped_coords, nodes(), m_jacobian_matrix);
     bool is_invertible;
     m_jacobian_matrix.computeInverseAndDetWithCheck(m_jacobian_inverse, m_jacobian_determinant, is_invertible);
     cf3_assert(is_invertible);
   }
 
-  /// Stored node data
-  ValueT m_nodes;
+  /// Stored node data, filled on first access for each element
+  mutable ValueT m_nodes;
+  mutable bool m_nodes_filled;
 
   /// Coordinates table
   const common::Table<Real>& m_coordinates;
@@ -241,6 +272,7 @@ private:
   mutable typename EtypeT::JacobianT m_jacobian_inverse;
   mutable Real m_jacobian_determinant;
   mutable typename EtypeT::CoordsT m_normal_vector;
+  mutable const Real* m_cached_gradient;
 };
 
 /// Helper function to find a field starting from a region
@@ -366,11 +398,10 @@ public:
   {
     if(common::PE::Comm::instance().is_active())
     {
-      const Uint my_sync = m_need_sync ? 1 : 0;
-      Uint global_sync = 0;
-      common::PE::Comm::instance().all_reduce(common::PE::plus(), &my_sync, 1, &global_sync);
-      if(global_sync != 0)
-        FieldSynchronizer::instance().insert(m_field);
+      // The decision to synchronize is taken for all fields at once by the FieldSynchronizer
+      if(m_need_sync)
+        m_field.mark_modified();
+      FieldSynchronizer::instance().insert(m_field);
     }
   }
 
@@ -484,8 +515,25 @@ private:
   void compute_values_dispatch(boost::mpl::true_, const MappedCoordsT& mapped_coords) const
   {
     compute_values_dispatch(boost::mpl::false_(), mapped_coords);
-    EtypeT::SF::compute_gradient(mapped_coords, m_mapped_gradient_matrix);
-    m_gradient.noalias() = m_support.jacobian_inverse() * m_mapped_gradient_matrix;
+    if(!use_cached_gradient(boost::is_same<EtypeT, SupportEtypeT>()))
+    {
+      EtypeT::SF::compute_gradient(mapped_coords, m_mapped_gradient_matrix);
+      m_gradient.noalias() = m_support.jacobian_inverse() * m_mapped_gradient_matrix;
+    }
+  }
+
+  /// The cached gradient only applies to variables that use the shape functions of the support
+  bool use_cached_gradient(boost::false_type) const
+  {
+    return false;
+  }
+
+  bool use_cached_gradient(boost::true_type) const
+  {
+    if(m_support.cached_gradient() == 0)
+      return false;
+    m_gradient = Eigen::Map<const GradientT>(m_support.cached_gradient());
+    return true;
   }
 
   /// Value of the field in each element node
@@ -816,7 +864,8 @@ public:
     m_variables(variables),
     m_elements(elements),
     m_support(elements),
-    m_equation_data(m_variables_data)
+    m_equation_data(m_variables_data),
+    m_geometry_cache(elements)
   {
     boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(InitVariablesData(m_variables, m_elements, m_variables_data, m_support));
     for(Uint i = 0; i != CF3_PROTO_MAX_ELEMENT_MATRICES; ++i)
@@ -872,6 +921,14 @@ public:
     boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(PrecomputeData<ExprT>(m_variables_data, mapped_coords));
   }
 
+  /// Precompute element matrices at Gauss point gauss_idx of the quadrature of the given order, for the variables found in expr.
+  /// The geometry is taken from the ElementGeometryCache of the elements, if there is one.
+  template<Uint Order, typename ExprT>
+  void precompute_gauss_point(const Uint gauss_idx, const ExprT& e)
+  {
+    precompute_gauss_point_dispatch<Order>(boost::mpl::bool_<SupportEtypeT::dimension == SupportEtypeT::dimensionality>(), gauss_idx, e);
+  }
+
   /// Return the type of the data stored for variable I (I being an Integral Constant in the boost::mpl sense)
   template<typename I>
   struct DataType
@@ -949,6 +1006,12 @@ public:
     return m_element_rhs;
   };
 
+  /// Copies of the non-const scalars used by the expression, when it runs on several threads
+  ScalarCopies& scalar_copies()
+  {
+    return m_scalar_copies;
+  }
+
   /// Stores a mutable block accululator, always up-to-date with index mapping and correct size
   mutable math::LSS::BlockAccumulator block_accumulator;
 
@@ -974,6 +1037,36 @@ private:
   /// Filtered view of the data associated with equation variables
   const EquationDataT m_equation_data;
 
+  /// Precomputed geometry, if enabled for the elements
+  ElementGeometryCacheAccess m_geometry_cache;
+
+  ScalarCopies m_scalar_copies;
+
+  /// Only volume elements are cached
+  template<Uint Order, typename ExprT>
+  void precompute_gauss_point_dispatch(boost::mpl::false_, const Uint gauss_idx, const ExprT& e)
+  {
+    typedef mesh::Integrators::GaussMappedCoords<Order, SupportEtypeT::shape> GaussT;
+    precompute_element_matrices(GaussT::instance().coords.col(gauss_idx), e);
+  }
+
+  template<Uint Order, typename ExprT>
+  void precompute_gauss_point_dispatch(boost::mpl::true_, const Uint gauss_idx, const ExprT& e)
+  {
+    typedef mesh::Integrators::GaussMappedCoords<Order, SupportEtypeT::shape> GaussT;
+    const typename SupportEtypeT::MappedCoordsT mapped_coords = GaussT::instance().coords.col(gauss_idx);
+    const Real* cached = m_geometry_cache.template data<SupportEtypeT, Order>(m_element_idx, gauss_idx);
+    if(cached == 0)
+    {
+      precompute_element_matrices(mapped_coords, e);
+      return;
+    }
+
+    m_support.compute_shape_functions(mapped_coords);
+    m_support.set_cached_geometry(cached);
+    boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(PrecomputeData<ExprT>(m_variables_data, mapped_coords));
+  }
+
   ///////////// helper functions and structs /////////////
 
   /// Initializes the pointers in a VariablesDataT fusion sequence
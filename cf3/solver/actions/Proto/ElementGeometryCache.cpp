@@ -0,0 +1,136 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+#include "common/Signal.hpp"
+
+#include "common/XML/SignalOptions.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Tags.hpp"
+
+#include "ElementGeometryCache.hpp"
+
+namespace cf3 {
+namespace solver {
+namespace actions {
+namespace Proto {
+
+using namespace common;
+
+ComponentBuilder < ElementGeometryCache, Component, LibActions > ElementGeometryCache_Builder;
+
+ElementGeometryCache::ElementGeometryCache(const std::string& name) :
+  Component(name),
+  m_nb_elements(0),
+  m_nb_nodes(0)
+{
+  options().add("memory_budget", 256u)
+    .description("Maximum size of the cached data, in megabytes. Integration orders that don't fit are computed on the fly.")
+    .pretty_name("Memory Budget")
+    .attach_trigger(boost::bind(&ElementGeometryCache::invalidate, this));
+
+  regist_signal("invalidate")
+    .description("Drop the cached data, so it is recomputed on next use")
+    .pretty_name("Invalidate")
+    .connect(boost::bind(&ElementGeometryCache::signal_invalidate, this, _1));
+
+  Core::instance().event_handler().connect_to_event(mesh::Tags::event_mesh_changed(), this, &ElementGeometryCache::on_mesh_changed_event);
+}
+
+ElementGeometryCache::~ElementGeometryCache()
+{
+}
+
+void ElementGeometryCache::invalidate()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_entries.clear();
+}
+
+void ElementGeometryCache::signal_invalidate(SignalArgs& args)
+{
+  invalidate();
+}
+
+std::size_t ElementGeometryCache::memory_usage() const
+{
+  std::size_t nb_values = 0;
+  for(EntriesT::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    nb_values += it->second.values.size();
+  return nb_values * sizeof(Real);
+}
+
+void ElementGeometryCache::on_mesh_changed_event(SignalArgs& args)
+{
+  Handle<mesh::Elements> elements(parent());
+  if(is_null(elements))
+    return;
+
+  SignalOptions options(args);
+  const URI mesh_uri = options.value<URI>("mesh_uri");
+  if(mesh_uri == find_parent_component<mesh::Mesh>(*elements).uri())
+    invalidate();
+}
+
+void ElementGeometryCache::check_sizes()
+{
+  const mesh::Elements& elements = *Handle<mesh::Elements const>(parent());
+  const Uint nb_elements = elements.size();
+  const Uint nb_nodes = elements.geometry_fields().coordinates().size();
+  if(nb_elements != m_nb_elements || nb_nodes != m_nb_nodes)
+  {
+    m_entries.clear();
+    m_nb_elements = nb_elements;
+    m_nb_nodes = nb_nodes;
+  }
+}
+
+bool ElementGeometryCache::fits_budget(const std::size_t nb_values) const
+{
+  const std::size_t budget = static_cast<std::size_t>(options().value<Uint>("memory_budget")) * 1024 * 1024;
+  return memory_usage() + nb_values * sizeof(Real) <= budget;
+}
+
+ElementGeometryCache& enable_geometry_cache(mesh::Elements& elements, const Uint memory_budget)
+{
+  Handle<ElementGeometryCache> cache(elements.get_child(ElementGeometryCache::default_name()));
+  if(is_null(cache))
+    cache = elements.create_component<ElementGeometryCache>(ElementGeometryCache::default_name());
+  if(cache->options().value<Uint>("memory_budget") != memory_budget)
+    cache->options().set("memory_budget", memory_budget);
+  return *cache;
+}
+
+void enable_geometry_cache(mesh::Region& region, const Uint memory_budget)
+{
+  boost_foreach(mesh::Elements& elements, find_components_recursively<mesh::Elements>(region))
+  {
+    enable_geometry_cache(elements, memory_budget);
+  }
+}
+
+void disable_geometry_cache(mesh::Region& region)
+{
+  boost_foreach(mesh::Elements& elements, find_components_recursively<mesh::Elements>(region))
+  {
+    if(is_not_null(elements.get_child(ElementGeometryCache::default_name())))
+      elements.remove_component(ElementGeometryCache::default_name());
+  }
+}
+
+} // namespace Proto
+} // namespace actions
+} // namespace solver
+} // namespace cf3
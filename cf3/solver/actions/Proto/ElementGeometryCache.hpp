@@ -0,0 +1,254 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_solver_actions_Proto_ElementGeometryCache_hpp
+#define cf3_solver_actions_Proto_ElementGeometryCache_hpp
+
+#include <map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "common/Component.hpp"
+#include "common/Log.hpp"
+#include "common/Table.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementData.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Integrators/Gauss.hpp"
+
+#include "solver/actions/LibActions.hpp"
+
+/// @file
+/// Storage for the geometric data of the elements at the Gauss points, for meshes that do not move
+
+namespace cf3 {
+namespace mesh { class Region; }
+namespace solver {
+namespace actions {
+namespace Proto {
+
+/// Position of the cached values for a single Gauss point of a volume element type, in Reals
+template<typename EtypeT>
+struct CachedGeometryLayout
+{
+  static const Uint dim = EtypeT::dimension;
+  /// Jacobian determinant
+  static const Uint determinant = 0;
+  /// Jacobian matrix, in Eigen storage order
+  static const Uint jacobian = 1;
+  /// Inverse of the jacobian
+  static const Uint jacobian_inverse = jacobian + dim*dim;
+  /// Coordinates of the Gauss point
+  static const Uint coordinates = jacobian_inverse + dim*dim;
+  /// Gradient of the shape functions in physical coordinates
+  static const Uint gradient = coordinates + dim;
+  /// Total number of values per Gauss point
+  static const Uint size = gradient + dim*EtypeT::nb_nodes;
+};
+
+/// Jacobians, their inverse and determinant, coordinates and physical shape function gradients at the Gauss points of
+/// all elements of the parent Elements. This avoids recomputing the geometry in every element loop when the mesh does not move.
+/// The cache is opt-in: Proto element loops only use it if it exists as a child of the Elements, see enable_geometry_cache.
+/// The data for each integration order is computed on first use, unless it would exceed the memory budget, in which case the
+/// geometry is computed on the fly as before. Only volume elements are cached.
+///
+/// The cache is cleared when the number of elements or nodes changes, or when the mesh_changed event is raised for the parent mesh.
+/// Code that moves nodes without changing their number must raise that event or call invalidate().
+class solver_actions_API ElementGeometryCache : public common::Component
+{
+public:
+  ElementGeometryCache(const std::string& name);
+  virtual ~ElementGeometryCache();
+
+  static std::string type_name() { return "ElementGeometryCache"; }
+
+  /// Name of the cache component in the Elements
+  static std::string default_name() { return "proto_geometry_cache"; }
+
+  /// Cached data for quadrature of the given order, CachedGeometryLayout<EtypeT>::size values per Gauss point, stored by element first.
+  /// Computes the data on first use. Thread safe.
+  /// @return null if the data would exceed the memory budget
+  template<typename EtypeT, Uint Order>
+  const Real* data();
+
+  /// Drop all cached data, e.g. after the coordinates were modified.
+  /// Must not be called while an element loop is using the cache.
+  void invalidate();
+
+  /// Number of bytes used by the cached data
+  std::size_t memory_usage() const;
+
+  /// Signal to invalidate the cache
+  void signal_invalidate(common::SignalArgs& args);
+
+  /// Signal handler for the mesh changed event
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+private:
+  /// Data for one integration order
+  struct Entry
+  {
+    Entry() : rejected(false) {}
+    std::vector<Real> values;
+    /// True if the data did not fit in the memory budget
+    bool rejected;
+  };
+
+  /// Clear the data if the number of elements or nodes changed since it was computed. Called with the mutex locked.
+  void check_sizes();
+
+  /// True if nb_values more Reals fit in the memory budget. Called with the mutex locked.
+  bool fits_budget(const std::size_t nb_values) const;
+
+  typedef std::map<Uint, Entry> EntriesT;
+  EntriesT m_entries;
+
+  Uint m_nb_elements;
+  Uint m_nb_nodes;
+
+  boost::mutex m_mutex;
+};
+
+/// Compute the geometric data for every element and Gauss point
+template<typename EtypeT, Uint Order>
+void compute_element_geometry(const mesh::Elements& elements, std::vector<Real>& values)
+{
+  typedef mesh::Integrators::GaussMappedCoords<Order, EtypeT::shape> GaussT;
+  typedef CachedGeometryLayout<EtypeT> LayoutT;
+
+  const common::Table<Real>& coordinates = elements.geometry_fields().coordinates();
+  const mesh::Connectivity& connectivity = elements.geometry_space().connectivity();
+  const Uint nb_elements = connectivity.size();
+  values.resize(static_cast<std::size_t>(nb_elements) * GaussT::nb_points * LayoutT::size);
+
+  typename EtypeT::NodesT nodes;
+  typename EtypeT::SF::ValueT sf;
+  typename EtypeT::SF::GradientT mapped_gradient;
+  typename EtypeT::JacobianT jacobian;
+  typename EtypeT::JacobianT jacobian_inverse;
+  Real determinant;
+  bool is_invertible;
+
+  Real* result = values.empty() ? 0 : &values[0];
+  for(Uint elem = 0; elem != nb_elements; ++elem)
+  {
+    mesh::fill(nodes, coordinates, connectivity[elem]);
+    for(Uint i = 0; i != GaussT::nb_points; ++i, result += LayoutT::size)
+    {
+      // Same operations as GeometricSupport and EtypeTVariableData, so cached results are identical to computed ones
+      const typename EtypeT::MappedCoordsT mapped_coords = GaussT::instance().coords.col(i);
+      EtypeT::compute_jacobian(mapped_coords, nodes, jacobian);
+      jacobian.computeInverseAndDetWithCheck(jacobian_inverse, determinant, is_invertible);
+      cf3_assert(is_invertible);
+      EtypeT::SF::compute_value(mapped_coords, sf);
+      EtypeT::SF::compute_gradient(mapped_coords, mapped_gradient);
+
+      result[LayoutT::determinant] = determinant;
+      Eigen::Map<typename EtypeT::JacobianT>(result + LayoutT::jacobian) = jacobian;
+      Eigen::Map<typename EtypeT::JacobianT>(result + LayoutT::jacobian_inverse) = jacobian_inverse;
+      Eigen::Map<typename EtypeT::CoordsT>(result + LayoutT::coordinates).noalias() = (sf * nodes).transpose();
+      Eigen::Map<typename EtypeT::SF::GradientT>(result + LayoutT::gradient).noalias() = jacobian_inverse * mapped_gradient;
+    }
+  }
+}
+
+template<typename EtypeT, Uint Order>
+const Real* ElementGeometryCache::data()
+{
+  typedef mesh::Integrators::GaussMappedCoords<Order, EtypeT::shape> GaussT;
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  check_sizes();
+
+  Entry& entry = m_entries[Order];
+  if(entry.values.empty() && !entry.rejected)
+  {
+    const std::size_t nb_values = static_cast<std::size_t>(m_nb_elements) * GaussT::nb_points * CachedGeometryLayout<EtypeT>::size;
+    if(nb_values == 0)
+    {
+      entry.rejected = true;
+    }
+    else if(!fits_budget(nb_values))
+    {
+      entry.rejected = true;
+      CFdebug << "Not caching the geometry of order " << Order << " for " << uri().path() << ": memory budget exceeded" << CFendl;
+    }
+    else
+    {
+      const mesh::Elements& elements = *Handle<mesh::Elements const>(parent());
+      compute_element_geometry<EtypeT, Order>(elements, entry.values);
+    }
+  }
+
+  return entry.rejected ? 0 : &entry.values[0];
+}
+
+/// Accessor to the cache of an Elements component, as used by a single ElementData.
+/// The pointers returned by the cache are stored, so the lock is only taken on the first access for each order.
+class ElementGeometryCacheAccess
+{
+public:
+  /// Largest integration order that is cached
+  static const Uint max_order = 16;
+
+  ElementGeometryCacheAccess(mesh::Elements& elements) :
+    m_cache(elements.get_child(ElementGeometryCache::default_name()))
+  {
+    for(Uint i = 0; i <= max_order; ++i)
+    {
+      m_data[i] = 0;
+      m_looked_up[i] = false;
+    }
+  }
+
+  /// Cached data for the given element and Gauss point, or null if there is none
+  template<typename EtypeT, Uint Order>
+  const Real* data(const Uint element_idx, const Uint gauss_idx)
+  {
+    if(Order > max_order || is_null(m_cache))
+      return 0;
+
+    // Keeps the index in range for orders that are not cached
+    static const Uint idx = Order > max_order ? 0 : Order;
+    if(!m_looked_up[idx])
+    {
+      m_data[idx] = m_cache->template data<EtypeT, Order>();
+      m_looked_up[idx] = true;
+    }
+
+    if(m_data[idx] == 0)
+      return 0;
+
+    typedef mesh::Integrators::GaussMappedCoords<Order, EtypeT::shape> GaussT;
+    return m_data[idx] + (static_cast<std::size_t>(element_idx) * GaussT::nb_points + gauss_idx) * CachedGeometryLayout<EtypeT>::size;
+  }
+
+private:
+  Handle<ElementGeometryCache> m_cache;
+  const Real* m_data[max_order+1];
+  bool m_looked_up[max_order+1];
+};
+
+/// Enable the geometry cache for the given elements, creating it if needed
+/// @param [in] memory_budget  Maximum size of the cached data, in megabytes
+ElementGeometryCache& enable_geometry_cache(mesh::Elements& elements, const Uint memory_budget = 256);
+
+/// Enable the geometry cache for all Elements in the region. The memory budget applies to each Elements separately.
+void enable_geometry_cache(mesh::Region& region, const Uint memory_budget = 256);
+
+/// Remove the geometry caches from all Elements in the region
+void disable_geometry_cache(mesh::Region& region);
+
+} // namespace Proto
+} // namespace actions
+} // namespace solver
+} // namespace cf3
+
+#endif // cf3_solver_actions_Proto_ElementGeometryCache_hpp
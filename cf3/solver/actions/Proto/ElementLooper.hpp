@@ -16,9 +16,17 @@
 #include <boost/mpl/for_each.hpp>
 #include <boost/mpl/filter_view.hpp>
 
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "common/Profiler.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "mesh/ElementColoring.hpp"
+
 #include "ElementData.hpp"
 #include "ElementExpressionWrapper.hpp"
 #include "ElementGrammar.hpp"
+#include "Transforms.hpp"
 
 #include "mesh/Mesh.hpp"
 #include "mesh/Space.hpp"
@@ -154,15 +162,86 @@ struct ExpressionRunner
 
 
 
+/// Runs the elements of one colour, distributing them over the threads of the ThreadPool.
+/// Each thread has its own copy of the data and of the wrapped expression, since both hold temporary results.
+/// The non-const scalars in the expression are replaced by per-thread copies, so they can hold per-element
+/// values such as stabilization coefficients. These copies are discarded after the loop.
+template<typename ExprT, typename DataT>
+struct ColoredElementRunner
+{
+  ColoredElementRunner(const ExprT& expr, boost::ptr_vector<DataT>& data, const mesh::ElementColoring& coloring, const Uint color) :
+    m_expr(expr),
+    m_data(data),
+    m_coloring(coloring),
+    m_color(color)
+  {
+  }
+
+  void operator()(const Uint thread_idx) const
+  {
+    common::ScopedTimer timer("Proto::element_colour");
+    DataT& data = m_data[thread_idx];
+    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
+    run(WrapExpression()(ThreadLocalScalars()(m_expr, mapped_coords, data), mapped_coords, data), data, thread_idx);
+  }
+
+private:
+  template<typename FilteredExprT>
+  void run(const FilteredExprT& expr, DataT& data, const Uint thread_idx) const
+  {
+    Uint begin, end;
+    common::split_range(m_coloring.color_size(m_color), m_data.size(), thread_idx, begin, end);
+
+    ElementGrammar grammar;
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Uint elem = m_coloring.element(m_color, i);
+      data.set_element(elem);
+      grammar(expr, elem, data);
+    }
+  }
+
+  const ExprT& m_expr;
+  boost::ptr_vector<DataT>& m_data;
+  const mesh::ElementColoring& m_coloring;
+  const Uint m_color;
+};
+
 /// Helper struct to launch execution once all shape functions have been determined
 template<typename DataT>
 struct ElementLooperImpl
 {
-  template<typename ExprT>
-  void operator()(const ExprT& expr, DataT& data, const Uint nb_elems) const
+  template<typename ExprT, typename VariablesT>
+  void operator()(const ExprT& expr, VariablesT& variables, mesh::Elements& elements) const
   {
-    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
-    run(WrapExpression()(expr, mapped_coords, data), data, nb_elems);
+    // Assembly into a linear system is safe as well: elements of the same colour never share a node, so each thread
+    // writes to different rows of the matrix and the LSS backends support concurrent block insertion on disjoint rows.
+    // Assignments to lit() on a non-const variable, such as lit(volume) += ..., and non-const matrices are shared by
+    // all threads, so such expressions always run serially and in the natural element order, also in reproducible mode.
+    typedef typename boost::result_of<HasSharedWrite(ExprT)>::type HasSharedWriteT;
+
+    common::ThreadPool& pool = common::ThreadPool::instance();
+    if(HasSharedWriteT::value || (pool.nb_threads() == 1 && !pool.reproducible()))
+    {
+      DataT data(variables, elements);
+      const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
+      run(WrapExpression()(expr, mapped_coords, data), data, elements.size());
+      return;
+    }
+
+    // Threaded execution, colour by colour, with a copy of the data for each thread
+    const Uint nb_threads = pool.nb_threads();
+    boost::ptr_vector<DataT> thread_data;
+    thread_data.reserve(nb_threads);
+    for(Uint i = 0; i != nb_threads; ++i)
+      thread_data.push_back(new DataT(variables, elements));
+
+    const mesh::ElementColoring& coloring = mesh::element_coloring(elements);
+    const Uint nb_colors = coloring.nb_colors();
+    for(Uint color = 0; color != nb_colors; ++color)
+    {
+      pool.run(ColoredElementRunner<ExprT, DataT>(expr, thread_data, coloring, color));
+    }
   }
 
 private:
@@ -196,9 +275,7 @@ struct ExpressionRunner<ElementTypesT, ExprT, SupportETYPE, VariablesT, Variable
       INVALID_ELEMENT_EXPRESSION,
       (ElementGrammar));
 
-    DataT data(variables, elements);
-
-    ElementLooperImpl<DataT>()(expression, data, elements.size());
+    ElementLooperImpl<DataT>()(expression, variables, elements);
   }
 
 private:
@@ -237,8 +314,11 @@ struct ElementLooper
     if(!mesh::IsElementType<ETYPE>()(m_elements.element_type()))
       return;
 
-    dispatch(boost::mpl::int_<boost::mpl::size< boost::mpl::filter_view< ElementTypesT, mesh::IsCompatibleWith<ETYPE> > >::value>(), sf);
-    
+    {
+      common::ScopedTimer timer("Proto::element_loop");
+      dispatch(boost::mpl::int_<boost::mpl::size< boost::mpl::filter_view< ElementTypesT, mesh::IsCompatibleWith<ETYPE> > >::value>(), sf);
+    }
+
     FieldSynchronizer::instance().synchronize();
   }
 
@@ -252,9 +332,7 @@ struct ElementLooper
     // Verify the types match, and throw an error if non-matching fields are found
     boost::fusion::for_each(m_variables, CheckSameEtype<ETYPE>(m_elements));
 
-    DataT data(m_variables, m_elements);
-
-    ElementLooperImpl<DataT>()(m_expr, data, m_elements.size());
+    ElementLooperImpl<DataT>()(m_expr, m_variables, m_elements);
   }
 
   /// Static dispatch in case different ETYPE are possible
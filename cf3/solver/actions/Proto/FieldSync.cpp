@@ -4,6 +4,8 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include "common/Profiler.hpp"
+
 #include "common/PE/Comm.hpp"
 
 #include "FieldSync.hpp"
@@ -33,10 +35,14 @@ void FieldSynchronizer::synchronize()
 {
   if(common::PE::Comm::instance().is_active())
   {
+    common::ScopedTimer timer("Proto::synchronize");
+    std::vector< Handle<mesh::Field> > fields;
+    fields.reserve(m_fields.size());
     for(FieldsT::iterator field_it = m_fields.begin(); field_it != m_fields.end(); ++field_it)
     {
-      field_it->second->synchronize();
+      fields.push_back(field_it->second);
     }
+    mesh::Field::synchronize_fields(fields, true);
   }
 
   m_fields.clear();
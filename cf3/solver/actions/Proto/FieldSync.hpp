@@ -25,10 +25,11 @@ public:
   /// Singleton implementation
   static FieldSynchronizer& instance();
 
-  /// Insert a field to synchronize
+  /// Insert a field to synchronize. This must be done on all ranks, the field is only exchanged
+  /// if it is marked as modified on at least one rank
   void insert(mesh::Field& f);
 
-  /// Sync fields and clear the list
+  /// Sync the modified fields and clear the list. Fields sharing a comm pattern are sent in a single message per neighbour.
   void synchronize();
 
 private:
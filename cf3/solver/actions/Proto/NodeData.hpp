@@ -117,11 +117,10 @@ struct NodeVarData< ScalarField >
   {
     if(common::PE::Comm::instance().is_active())
     {
-      const Uint my_sync = m_need_synchronization ? 1 : 0;
-      Uint global_sync = 0;
-      common::PE::Comm::instance().all_reduce(common::PE::plus(), &my_sync, 1, &global_sync);
-      if(global_sync != 0)
-        FieldSynchronizer::instance().insert(m_field);
+      // The decision to synchronize is taken for all fields at once by the FieldSynchronizer
+      if(m_need_synchronization)
+        m_field.mark_modified();
+      FieldSynchronizer::instance().insert(m_field);
     }
   }
 
@@ -204,11 +203,10 @@ struct NodeVarData<VectorField, Dim>
   {
     if(common::PE::Comm::instance().is_active())
     {
-      const Uint my_sync = m_need_synchronization ? 1 : 0;
-      Uint global_sync = 0;
-      common::PE::Comm::instance().all_reduce(common::PE::plus(), &my_sync, 1, &global_sync);
-      if(global_sync != 0)
-        FieldSynchronizer::instance().insert(m_field);
+      // The decision to synchronize is taken for all fields at once by the FieldSynchronizer
+      if(m_need_synchronization)
+        m_field.mark_modified();
+      FieldSynchronizer::instance().insert(m_field);
     }
   }
 
@@ -7,6 +7,8 @@
 #ifndef cf3_solver_actions_Proto_NodeLooper_hpp
 #define cf3_solver_actions_Proto_NodeLooper_hpp
 
+#include "common/Profiler.hpp"
+
 #include "mesh/Functions.hpp"
 
 #include "FieldSync.hpp"
@@ -214,7 +216,10 @@ struct NodeLooper
       return;
 
     // Execute with known dimension
-    NodeLooperDim<ExprT, NbDimsT>(m_expr, m_region, m_variables)();
+    {
+      common::ScopedTimer timer("Proto::node_loop");
+      NodeLooperDim<ExprT, NbDimsT>(m_expr, m_region, m_variables)();
+    }
     
     FieldSynchronizer::instance().synchronize();
   }
@@ -11,6 +11,7 @@
 #include "common/Builder.hpp"
 #include "common/Log.hpp"
 #include "common/OptionComponent.hpp"
+#include "common/Profiler.hpp"
 #include "common/URI.hpp"
 
 #include "mesh/Region.hpp"
@@ -118,6 +119,7 @@ void ProtoAction::execute()
   if(m_loop_regions.empty())
     CFwarn << "No regions to loop over for action " << uri().string() << CFendl;
 
+  ScopedTimer timer(name());
   boost_foreach(const Handle< Region >& region, m_loop_regions)
   {
     if(is_null(m_implementation->m_expression))
@@ -7,10 +7,17 @@
 #ifndef cf3_solver_actions_Proto_Transforms_hpp
 #define cf3_solver_actions_Proto_Transforms_hpp
 
+#include <map>
+
 #include <boost/accumulators/accumulators_fwd.hpp>
+#include <boost/any.hpp>
 
 #include <boost/fusion/container/vector/convert.hpp>
+#include <boost/mpl/and.hpp>
+#include <boost/mpl/bool.hpp>
 #include <boost/mpl/max.hpp>
+#include <boost/mpl/not.hpp>
+#include <boost/mpl/or.hpp>
 #include <boost/mpl/range_c.hpp>
 #include <boost/mpl/transform.hpp>
 #include <boost/mpl/vector_c.hpp>
@@ -22,6 +29,13 @@
 #include <boost/proto/context/callable.hpp>
 #include <boost/proto/context/null.hpp>
 
+#include <boost/type_traits/is_arithmetic.hpp>
+#include <boost/type_traits/is_base_of.hpp>
+#include <boost/type_traits/is_const.hpp>
+#include <boost/type_traits/remove_const.hpp>
+
+#include "math/MatrixTypes.hpp"
+
 #include "Functions.hpp"
 #include "Terminals.hpp"
 
@@ -110,6 +124,144 @@ struct ExpressionProperties
   >::type VariablesT;
 };
 
+/// True if T is a non-const reference to a scalar
+template<typename T>
+struct IsWritableScalarReference : boost::mpl::false_
+{
+};
+
+template<typename T>
+struct IsWritableScalarReference<T&> :
+  boost::mpl::and_< boost::mpl::not_< boost::is_const<T> >, boost::is_arithmetic<T> >
+{
+};
+
+/// True if T is a non-const reference to an Eigen matrix
+template<typename T>
+struct IsWritableMatrixReference : boost::mpl::false_
+{
+};
+
+template<typename T>
+struct IsWritableMatrixReference<T&> :
+  boost::mpl::and_< boost::mpl::not_< boost::is_const<T> >, boost::is_base_of<Eigen::MatrixBase<T>, T> >
+{
+};
+
+/// Checks the type of the value stored in a terminal, giving mpl::true_ if it satisfies PredicateT
+template<template<typename> class PredicateT>
+struct TerminalValueIs :
+  boost::proto::transform< TerminalValueIs<PredicateT> >
+{
+  template<typename ExprT, typename StateT, typename DataT>
+  struct impl : boost::proto::transform_impl<ExprT, StateT, DataT>
+  {
+    typedef boost::mpl::bool_
+    <
+      PredicateT<typename boost::remove_const<typename impl::expr>::type::proto_child0>::value
+    > result_type;
+
+    result_type operator()(typename impl::expr_param, typename impl::state_param, typename impl::data_param) const
+    {
+      return result_type();
+    }
+  };
+};
+
+/// Matches the assignment operators, with a terminal on the left hand side
+struct TerminalAssignment :
+  boost::proto::or_
+  <
+    boost::proto::assign< boost::proto::terminal<boost::proto::_>, boost::proto::_ >,
+    boost::proto::plus_assign< boost::proto::terminal<boost::proto::_>, boost::proto::_ >,
+    boost::proto::minus_assign< boost::proto::terminal<boost::proto::_>, boost::proto::_ >,
+    boost::proto::multiplies_assign< boost::proto::terminal<boost::proto::_>, boost::proto::_ >,
+    boost::proto::divides_assign< boost::proto::terminal<boost::proto::_>, boost::proto::_ >
+  >
+{
+};
+
+/// Evaluates to mpl::true_ if the expression writes to a value outside of the expression that all threads would share:
+/// an assignment to lit(x) on a non-const scalar x, such as the reduction lit(volume) += ..., or any lit() on a non-const matrix.
+/// Other non-const scalars, e.g. the tau arguments written by the UFEM compute_tau, get a copy for each thread (see ThreadLocalScalars).
+struct HasSharedWrite :
+  boost::proto::or_
+  <
+    boost::proto::when
+    <
+      boost::proto::terminal< boost::proto::_ >,
+      TerminalValueIs<IsWritableMatrixReference>
+    >,
+    boost::proto::when
+    <
+      TerminalAssignment,
+      boost::mpl::or_
+      <
+        TerminalValueIs<IsWritableScalarReference>(boost::proto::_left),
+        HasSharedWrite(boost::proto::_left),
+        HasSharedWrite(boost::proto::_right)
+      >()
+    >,
+    boost::proto::when
+    <
+      boost::proto::nary_expr<boost::proto::_, boost::proto::vararg<boost::proto::_> >,
+      boost::proto::fold<boost::proto::_, boost::mpl::false_(), boost::mpl::or_<HasSharedWrite, boost::proto::_state>()>
+    >
+  >
+{};
+
+/// Copies of the non-const scalars referred to by an expression, keyed on the address of the original.
+/// A copy starts out with the value of the original at the time it is first requested.
+class ScalarCopies
+{
+public:
+  template<typename T>
+  T& get(T& original)
+  {
+    boost::any& copy = m_copies[&original];
+    if(copy.empty())
+      copy = original;
+    return *boost::any_cast<T>(&copy);
+  }
+
+private:
+  std::map<const void*, boost::any> m_copies;
+};
+
+/// Replaces a terminal referring to a non-const scalar with a terminal referring to its copy in data.scalar_copies()
+struct CopyWritableScalar :
+  boost::proto::transform< CopyWritableScalar >
+{
+  template<typename ExprT, typename StateT, typename DataT>
+  struct impl : boost::proto::transform_impl<ExprT, StateT, DataT>
+  {
+    typedef typename boost::proto::terminal
+    <
+      typename boost::remove_const<typename impl::expr>::type::proto_child0
+    >::type result_type;
+
+    result_type operator()(typename impl::expr_param expr, typename impl::state_param, typename impl::data_param data) const
+    {
+      result_type result = { data.scalar_copies().get(boost::proto::value(expr)) };
+      return result;
+    }
+  };
+};
+
+/// Gives each thread its own copy of the non-const scalars referred to by an expression, so they can be used as
+/// per-element scratch values. The data must provide the copies through a scalar_copies() method.
+struct ThreadLocalScalars :
+  boost::proto::or_
+  <
+    boost::proto::when
+    <
+      boost::proto::and_< boost::proto::terminal<boost::proto::_>, boost::proto::if_< TerminalValueIs<IsWritableScalarReference> > >,
+      CopyWritableScalar
+    >,
+    boost::proto::nary_expr< boost::proto::_, boost::proto::vararg<ThreadLocalScalars> >
+  >
+{};
+
 /// Copy the terminal values to a fusion list
 template<typename VarsT>
 struct CopyNumberedVars
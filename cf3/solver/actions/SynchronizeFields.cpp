@@ -39,6 +39,10 @@ SynchronizeFields::SynchronizeFields ( const std::string& name ) : solver::Actio
   options().add("Fields", dummy)
       .description("Fields to synchronize")
       .attach_trigger ( boost::bind ( &SynchronizeFields::config_fields,   this ) );
+
+  options().add("only_modified", false)
+      .pretty_name("Only Modified")
+      .description("Skip the fields that were not marked as modified since their last synchronization");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -64,12 +68,7 @@ void SynchronizeFields::config_fields()
 
 void SynchronizeFields::execute()
 {
-  boost_foreach(Handle<Field> ptr, m_fields)
-  {
-    if( is_null(ptr) ) continue; // skip if pointer invalid
-
-    ptr->synchronize();
-  }
+  Field::synchronize_fields(m_fields, options().value<bool>("only_modified"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,6 +100,7 @@ CNode::CNode( const std::string & name, const QString & component_type, Type typ
     .description("Update component options")
     .connect(boost::bind(&CNode::reply_configure, this, _1));
 
+  // Called with the frames that the server forwards from the tree updates of its NotificationQueue
   regist_signal( "tree_updated" )
     .description("Event that notifies a path has changed")
     .connect(boost::bind(&CNode::reply_update_tree, this, _1));
@@ -0,0 +1,91 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <boost/bind.hpp>
+
+#include "cf3/common/BasicExceptions.hpp"
+#include "cf3/common/Builder.hpp"
+#include "cf3/common/OptionList.hpp"
+
+#include "cf3/physics/euler/euler2d/BatchRiemannSolver.hpp"
+#include "cf3/physics/euler/euler2d/Functions.hpp"
+
+namespace cf3 {
+namespace physics {
+namespace euler {
+namespace euler2d {
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < BatchRiemannSolver, common::Component, LibEuler > BatchRiemannSolver_Builder;
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+BatchRiemannSolver::BatchRiemannSolver(const std::string& name) :
+  solver::RiemannSolver<RiemannTerm>(name),
+  m_scheme_name("roe"),
+  m_scheme(ROE),
+  m_gamma(1.4)
+{
+  std::vector<std::string> schemes;
+  schemes.push_back("roe");
+  schemes.push_back("rusanov");
+  schemes.push_back("hlle");
+
+  options().add("scheme", m_scheme_name).link_to(&m_scheme_name)
+      .description("Approximate Riemann solver: roe, rusanov or hlle")
+      .pretty_name("Scheme")
+      .mark_basic()
+      .attach_trigger(boost::bind(&BatchRiemannSolver::trigger_scheme, this))
+      .restricted_list() = std::vector<boost::any>(schemes.begin(), schemes.end());
+
+  options().add("gamma", m_gamma).link_to(&m_gamma)
+      .description("Specific heat ratio, used to compute the primitive variables of the batched states")
+      .pretty_name("Gamma");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+void BatchRiemannSolver::trigger_scheme()
+{
+  if      (m_scheme_name == "roe")     m_scheme = ROE;
+  else if (m_scheme_name == "rusanov") m_scheme = RUSANOV;
+  else if (m_scheme_name == "hlle")    m_scheme = HLLE;
+  else throw common::BadValue(FromHere(), "Unknown Riemann solver scheme " + m_scheme_name);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+void BatchRiemannSolver::compute_riemann_flux( const Data& left, const Data& right, const ColVector_NDIM& normal,
+                                               RowVector_NEQS& flux, Real& wave_speed )
+{
+  switch (m_scheme)
+  {
+    case ROE:     compute_roe_flux(left, right, normal, flux, wave_speed);     break;
+    case RUSANOV: compute_rusanov_flux(left, right, normal, flux, wave_speed); break;
+    case HLLE:    compute_hlle_flux(left, right, normal, flux, wave_speed);    break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+void BatchRiemannSolver::compute_riemann_flux( const Uint nb_faces, const Real* left, const Real* right, const Real* normal,
+                                               Real* flux, Real* wave_speed )
+{
+  switch (m_scheme)
+  {
+    case ROE:     compute_roe_flux_batch(nb_faces, m_gamma, left, right, normal, flux, wave_speed);     break;
+    case RUSANOV: compute_rusanov_flux_batch(nb_faces, m_gamma, left, right, normal, flux, wave_speed); break;
+    case HLLE:    compute_hlle_flux_batch(nb_faces, m_gamma, left, right, normal, flux, wave_speed);    break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+} // euler2d
+} // euler
+} // physics
+} // cf3
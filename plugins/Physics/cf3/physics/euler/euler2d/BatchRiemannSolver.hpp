@@ -0,0 +1,86 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+/// @file BatchRiemannSolver.hpp
+/// @brief Riemann solver for Euler 2D that evaluates batches of faces
+
+#ifndef cf3_physics_euler_euler2d_BatchRiemannSolver_hpp
+#define cf3_physics_euler_euler2d_BatchRiemannSolver_hpp
+
+#include "cf3/solver/RiemannSolver.hpp"
+
+#include "cf3/physics/euler/LibEuler.hpp"
+#include "cf3/physics/euler/euler2d/Data.hpp"
+
+namespace cf3 {
+namespace physics {
+namespace euler {
+namespace euler2d {
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Types of the Euler 2D equations, as needed by solver::RiemannSolver
+struct RiemannTerm
+{
+  typedef euler2d::Data           DATA;
+  typedef euler2d::ColVector_NDIM ColVector_NDIM;
+  typedef euler2d::RowVector_NEQS RowVector_NEQS;
+
+  static std::string type_name() { return "euler2d"; }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Riemann solver for Euler 2D, that can also compute the fluxes for a batch of faces at once
+///
+/// The scheme is selected with the option "scheme" (roe, rusanov or hlle). The single-face
+/// compute_riemann_flux uses the functions of Functions.hpp, the batched version uses their
+/// *_batch counterparts, working on structure-of-arrays data.
+class euler_API BatchRiemannSolver : public solver::RiemannSolver<RiemannTerm>
+{
+public:
+
+  /// @brief Constructor
+  BatchRiemannSolver(const std::string& name);
+
+  /// @brief Virtual destructor
+  virtual ~BatchRiemannSolver() {}
+
+  /// @brief Get the class name
+  static std::string type_name () { return "BatchRiemannSolver"; }
+
+  /// @brief Compute the flux for one face
+  virtual void compute_riemann_flux( const Data& left, const Data& right, const ColVector_NDIM& normal,
+                                     RowVector_NEQS& flux, Real& wave_speed );
+
+  /// @brief Compute the fluxes for nb_faces faces, in the structure-of-arrays layout of compute_roe_flux_batch
+  /// @param [in]  left        Conservative left states, left[eq*nb_faces+f]
+  /// @param [in]  right       Conservative right states, right[eq*nb_faces+f]
+  /// @param [in]  normal      Unit normals, normal[d*nb_faces+f]
+  /// @param [out] flux        Fluxes, flux[eq*nb_faces+f]
+  /// @param [out] wave_speed  Maximum absolute wave speed for each face
+  virtual void compute_riemann_flux( const Uint nb_faces, const Real* left, const Real* right, const Real* normal,
+                                     Real* flux, Real* wave_speed );
+
+private:
+
+  void trigger_scheme();
+
+  enum Scheme { ROE, RUSANOV, HLLE };
+
+  std::string m_scheme_name;
+  Scheme m_scheme;
+  Real m_gamma;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+} // euler2d
+} // euler
+} // physics
+} // cf3
+
+#endif // cf3_physics_euler_euler2d_BatchRiemannSolver_hpp
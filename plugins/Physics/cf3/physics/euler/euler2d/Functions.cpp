@@ -199,6 +199,152 @@ void compute_hlle_flux( const Data& left, const Data& right, const ColVector_NDI
   }
   compute_convective_wave_speed(roe,normal,wave_speed);
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+/// Primitive quantities of one face side, computed from the conservative state
+struct BatchState
+{
+  Real rho, u, v, p, H, c, un;
+
+  BatchState(const Real gamma, const Real* cons, const Uint f, const Uint nb_faces, const Real nx, const Real ny)
+  {
+    rho = cons[f];
+    const Real inv_rho = 1./rho;
+    u = cons[nb_faces+f]*inv_rho;
+    v = cons[2*nb_faces+f]*inv_rho;
+    const Real E = cons[3*nb_faces+f]*inv_rho;
+    p = (gamma-1.)*rho*(E - 0.5*(u*u+v*v));
+    H = E + p*inv_rho;
+    c = std::sqrt(gamma*p*inv_rho);
+    un = u*nx + v*ny;
+  }
+
+  /// Component eq of the convective flux
+  Real flux(const Uint eq, const Real nx, const Real ny) const
+  {
+    const Real rho_un = rho*un;
+    switch(eq)
+    {
+      case 0: return rho_un;
+      case 1: return rho_un*u + p*nx;
+      case 2: return rho_un*v + p*ny;
+      default: return rho_un*H;
+    }
+  }
+};
+
+/// Roe average of two states, as in compute_roe_average
+struct BatchRoeState
+{
+  Real rho, u, v, H, U2, c2, c, un;
+
+  BatchRoeState(const Real gamma, const BatchState& left, const BatchState& right, const Real nx, const Real ny)
+  {
+    const Real sqrt_rhoL = std::sqrt(left.rho);
+    const Real sqrt_rhoR = std::sqrt(right.rho);
+    const Real inv_sum = 1./(sqrt_rhoL + sqrt_rhoR);
+    rho = sqrt_rhoL*sqrt_rhoR;
+    u   = (sqrt_rhoL*left.u + sqrt_rhoR*right.u) * inv_sum;
+    v   = (sqrt_rhoL*left.v + sqrt_rhoR*right.v) * inv_sum;
+    H   = (sqrt_rhoL*left.H + sqrt_rhoR*right.H) * inv_sum;
+    U2  = u*u + v*v;
+    c2  = (gamma-1.)*(H-0.5*U2/rho);
+    c   = std::sqrt(c2);
+    un  = u*nx + v*ny;
+  }
+};
+
+} // detail
+
+void compute_rusanov_flux_batch( const Uint nb_faces, const Real gamma,
+                                 const Real* left, const Real* right, const Real* normal,
+                                 Real* flux, Real* wave_speed )
+{
+  for (Uint f=0; f<nb_faces; ++f)
+  {
+    const Real nx = normal[f];
+    const Real ny = normal[nb_faces+f];
+    const detail::BatchState L(gamma, left,  f, nb_faces, nx, ny);
+    const detail::BatchState R(gamma, right, f, nb_faces, nx, ny);
+    const Real ws = std::max(std::abs(L.un)+L.c, std::abs(R.un)+R.c);
+    for (Uint eq=0; eq<NEQS; ++eq)
+    {
+      const Uint idx = eq*nb_faces+f;
+      flux[idx] = 0.5*(L.flux(eq,nx,ny)+R.flux(eq,nx,ny)) - 0.5*ws*(right[idx]-left[idx]);
+    }
+    wave_speed[f] = ws;
+  }
+}
+
+void compute_roe_flux_batch( const Uint nb_faces, const Real gamma,
+                             const Real* left, const Real* right, const Real* normal,
+                             Real* flux, Real* wave_speed )
+{
+  for (Uint f=0; f<nb_faces; ++f)
+  {
+    const Real nx = normal[f];
+    const Real ny = normal[nb_faces+f];
+    const detail::BatchState L(gamma, left,  f, nb_faces, nx, ny);
+    const detail::BatchState R(gamma, right, f, nb_faces, nx, ny);
+    const detail::BatchRoeState roe(gamma, L, R, nx, ny);
+
+    // Wave strengths, multiplied with half the absolute wave speed
+    const Real du   = R.u - L.u;
+    const Real dv   = R.v - L.v;
+    const Real drho = R.rho - L.rho;
+    const Real dp   = R.p - L.p;
+    const Real dun  = du*nx + dv*ny;
+    const Real dus  = du*ny - dv*nx;
+    const Real dp_c2 = dp/roe.c2;
+    const Real a0 = 0.5*std::abs(roe.un)        * (drho - dp_c2);
+    const Real a1 = 0.5*std::abs(roe.un)        * (dus * roe.rho);
+    const Real a2 = 0.5*std::abs(roe.un+roe.c)  * 0.5*(dp_c2 + dun*roe.rho/roe.c);
+    const Real a3 = 0.5*std::abs(roe.un-roe.c)  * 0.5*(dp_c2 - dun*roe.rho/roe.c);
+
+    // Dissipation, using the columns of the right eigenvectors
+    const Real us = roe.u*ny - roe.v*nx;
+    const Real diss0 = a0 + a2 + a3;
+    const Real diss1 = a0*roe.u + a1*ny + a2*(roe.u+roe.c*nx) + a3*(roe.u-roe.c*nx);
+    const Real diss2 = a0*roe.v - a1*nx + a2*(roe.v+roe.c*ny) + a3*(roe.v-roe.c*ny);
+    const Real diss3 = a0*0.5*roe.U2 + a1*us + a2*(roe.H+roe.c*roe.un) + a3*(roe.H-roe.c*roe.un);
+
+    flux[f]            = 0.5*(L.flux(0,nx,ny)+R.flux(0,nx,ny)) - diss0;
+    flux[nb_faces+f]   = 0.5*(L.flux(1,nx,ny)+R.flux(1,nx,ny)) - diss1;
+    flux[2*nb_faces+f] = 0.5*(L.flux(2,nx,ny)+R.flux(2,nx,ny)) - diss2;
+    flux[3*nb_faces+f] = 0.5*(L.flux(3,nx,ny)+R.flux(3,nx,ny)) - diss3;
+    wave_speed[f] = std::abs(roe.un) + roe.c;
+  }
+}
+
+void compute_hlle_flux_batch( const Uint nb_faces, const Real gamma,
+                              const Real* left, const Real* right, const Real* normal,
+                              Real* flux, Real* wave_speed )
+{
+  for (Uint f=0; f<nb_faces; ++f)
+  {
+    const Real nx = normal[f];
+    const Real ny = normal[nb_faces+f];
+    const detail::BatchState L(gamma, left,  f, nb_faces, nx, ny);
+    const detail::BatchState R(gamma, right, f, nb_faces, nx, ny);
+    const detail::BatchRoeState roe(gamma, L, R, nx, ny);
+
+    // Clipping the wave speeds to zero selects the upwind flux in the supersonic cases
+    // without branching: this gives the left flux if sL >= 0 and the right flux if sR <= 0
+    const Real sL = std::min(std::min(L.un-L.c, roe.un-roe.c), 0.);
+    const Real sR = std::max(std::max(R.un+R.c, roe.un+roe.c), 0.);
+    const Real inv_ds = 1./(sR-sL);
+    for (Uint eq=0; eq<NEQS; ++eq)
+    {
+      const Uint idx = eq*nb_faces+f;
+      flux[idx] = (sR*L.flux(eq,nx,ny) - sL*R.flux(eq,nx,ny) + sL*sR*(right[idx]-left[idx])) * inv_ds;
+    }
+    wave_speed[f] = std::abs(roe.un) + roe.c;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 } // euler2d
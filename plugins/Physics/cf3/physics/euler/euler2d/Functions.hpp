@@ -63,6 +63,31 @@ void compute_roe_flux( const Data& left, const Data& right, const ColVector_NDIM
 void compute_hlle_flux( const Data& left, const Data& right, const ColVector_NDIM& normal,
                         RowVector_NEQS& flux, Real& wave_speed );
 
+/// @name Batched Riemann solvers
+/// Evaluate the Riemann flux for nb_faces faces at once, with all data in structure-of-arrays layout:
+/// left[eq*nb_faces+f] and right[eq*nb_faces+f] are the conservative states, normal[d*nb_faces+f] the
+/// unit normals, flux[eq*nb_faces+f] and wave_speed[f] the results, for face f.
+/// The face loops are branch-free, so the compiler can map consecutive faces on SIMD lanes.
+/// Results are the same as for the single-face versions, up to round-off.
+//@{
+
+/// @brief Rusanov Approximate Riemann solver for a batch of faces
+void compute_rusanov_flux_batch( const Uint nb_faces, const Real gamma,
+                                 const Real* left, const Real* right, const Real* normal,
+                                 Real* flux, Real* wave_speed );
+
+/// @brief Roe Approximate Riemann solver for a batch of faces
+void compute_roe_flux_batch( const Uint nb_faces, const Real gamma,
+                             const Real* left, const Real* right, const Real* normal,
+                             Real* flux, Real* wave_speed );
+
+/// @brief HLLE Approximate Riemann solver for a batch of faces
+void compute_hlle_flux_batch( const Uint nb_faces, const Real gamma,
+                              const Real* left, const Real* right, const Real* normal,
+                              Real* flux, Real* wave_speed );
+
+//@}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 } // euler2d
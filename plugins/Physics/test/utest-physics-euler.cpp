@@ -16,6 +16,8 @@
 #include "cf3/common/Environment.hpp"
 #include "cf3/physics/euler/euler1d/Functions.hpp"
 #include "cf3/physics/euler/euler2d/Functions.hpp"
+#include "cf3/physics/euler/euler2d/BatchRiemannSolver.hpp"
+#include "cf3/common/OptionList.hpp"
 
 using namespace std;
 using namespace cf3;
@@ -169,6 +171,60 @@ BOOST_AUTO_TEST_CASE( Test_Euler2D_riemann )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( Test_Euler2D_riemann_batch )
+{
+  // Faces with subsonic, supersonic to the right and supersonic to the left flow
+  const Uint nb_faces = 4;
+  euler2d::RowVector_NEQS prim_left[nb_faces], prim_right[nb_faces];
+  prim_left[0] << 4.696,    0.,   0., 404400;  prim_right[0] << 1.408,    0.,  0., 101100;
+  prim_left[1] << 1.225,   30.,  10., 101300;  prim_right[1] << 1.1,     20., -5., 95000;
+  prim_left[2] << 1.225,  900., 100., 101300;  prim_right[2] << 1.2,    850., 90., 100000;
+  prim_left[3] << 1.225, -900., 100., 101300;  prim_right[3] << 1.2,   -850., 90., 100000;
+  euler2d::ColVector_NDIM normals[nb_faces];
+  normals[0] << 0., 1.;
+  normals[1] << 1., 1.;
+  normals[2] << 1., 0.1;
+  normals[3] << 1., 0.;
+
+  std::vector<euler2d::Data> left(nb_faces), right(nb_faces);
+  std::vector<Real> left_soa(euler2d::NEQS*nb_faces), right_soa(euler2d::NEQS*nb_faces), normal_soa(euler2d::NDIM*nb_faces);
+  for (Uint f=0; f<nb_faces; ++f)
+  {
+    normals[f].normalize();
+    left[f].gamma=1.4;  left[f].R=287.05;  left[f].compute_from_primitive(prim_left[f]);
+    right[f].gamma=1.4; right[f].R=287.05; right[f].compute_from_primitive(prim_right[f]);
+    for (Uint eq=0; eq<euler2d::NEQS; ++eq)
+    {
+      left_soa[eq*nb_faces+f] = left[f].cons[eq];
+      right_soa[eq*nb_faces+f] = right[f].cons[eq];
+    }
+    for (Uint d=0; d<euler2d::NDIM; ++d)
+      normal_soa[d*nb_faces+f] = normals[f][d];
+  }
+
+  boost::shared_ptr<euler2d::BatchRiemannSolver> riemann = allocate_component<euler2d::BatchRiemannSolver>("riemann");
+  const std::string schemes[] = {"roe", "rusanov", "hlle"};
+  std::vector<Real> flux_soa(euler2d::NEQS*nb_faces), wave_speed_soa(nb_faces);
+  for (Uint s=0; s<3; ++s)
+  {
+    riemann->options().set("scheme", schemes[s]);
+    riemann->compute_riemann_flux(nb_faces, &left_soa[0], &right_soa[0], &normal_soa[0], &flux_soa[0], &wave_speed_soa[0]);
+    for (Uint f=0; f<nb_faces; ++f)
+    {
+      euler2d::RowVector_NEQS flux;
+      Real wave_speed;
+      riemann->compute_riemann_flux(left[f], right[f], normals[f], flux, wave_speed);
+      BOOST_CHECK_CLOSE(wave_speed_soa[f], wave_speed, 1e-10);
+      for (Uint eq=0; eq<euler2d::NEQS; ++eq)
+        BOOST_CHECK_SMALL(flux_soa[eq*nb_faces+f] - flux[eq], 1e-8*(1.+std::abs(flux[eq])));
+    }
+  }
+
+  BOOST_CHECK_THROW(riemann->options().set("scheme", std::string("unknown")), BadValue);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
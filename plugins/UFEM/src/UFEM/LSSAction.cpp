@@ -14,6 +14,7 @@
 #include "math/VariableManager.hpp"
 #include "math/VariablesDescriptor.hpp"
 
+#include "math/LSS/MatrixFreeMatrix.hpp"
 #include "math/LSS/System.hpp"
 
 #include "mesh/Domain.hpp"
@@ -142,12 +143,12 @@ LSS::System& LSSAction::create_lss(const std::string& matrix_builder, const std:
 void LSSAction::signature_create_lss(SignalArgs& node)
 {
   SignalOptions options(node);
-  options.add("matrix_builder", "cf3.math.LSS.TrilinosFEVbrMatrix")
+  options.add("matrix_builder", LSS::System::default_matrix_builder())
     .pretty_name("Matrix Builder")
     .description("Name for the matrix builder to use when constructing the LSS")
     .mark_basic();
 
-  options.add("solution_strategy", "cf3.math.LSS.TrilinosStratimikosStrategy")
+  options.add("solution_strategy", LSS::System::default_solution_strategy())
     .pretty_name("Solution Strategy")
     .description("Builder name for the solution strategy to use.");
 }
@@ -195,7 +196,7 @@ void LSSAction::on_regions_set()
     Handle< List<Uint> > used_node_map = m_implementation->m_lss->create_component< List<Uint> >("used_node_map");
 
     std::vector<Uint> node_connectivity, starting_indices;
-    boost::shared_ptr< List<Uint> > used_nodes = build_sparsity(m_loop_regions, *m_dictionary, node_connectivity, starting_indices, *gids, *ranks, *used_node_map);
+    boost::shared_ptr< List<Uint> > used_nodes = build_sparsity_cached(m_loop_regions, *m_dictionary, node_connectivity, starting_indices, *gids, *ranks, *used_node_map);
     if(is_not_null(get_child(used_nodes->name())))
       remove_component(used_nodes->name());
     add_component(used_nodes);
@@ -219,6 +220,12 @@ void LSSAction::on_regions_set()
     else
       m_implementation->m_lss->create(comm_pattern, descriptor.size(), node_connectivity, starting_indices);
 
+    // A matrix-free operator is applied by running the assembly again
+    Handle<LSS::MatrixFreeMatrix> matrix_free(m_implementation->m_lss->matrix());
+    Handle<common::Action> assembly(get_child("Assembly"));
+    if(is_not_null(matrix_free) && is_not_null(assembly) && is_null(matrix_free->options().value< Handle<common::Action> >("operator_action")))
+      matrix_free->options().set("operator_action", assembly);
+
     CFdebug << "Finished creating LSS" << CFendl;
     configure_option_recursively(solver::Tags::regions(), options().option(solver::Tags::regions()).value());
     configure_option_recursively("lss", m_implementation->m_lss);
@@ -286,6 +286,11 @@ void Solver::mesh_loaded(mesh::Mesh& mesh)
 void Solver::mesh_changed(Mesh& mesh)
 {
   CFdebug << "UFEM::Solver: Reacting to mesh_changed signal" << CFendl;
+  // Sparsity patterns built for the old mesh can't be reused
+  BOOST_FOREACH(Dictionary& dict, find_components_recursively<Dictionary>(mesh))
+  {
+    clear_sparsity_cache(dict);
+  }
   configure_option_recursively("dictionary", mesh.geometry_fields().handle<Dictionary>());
   m_need_field_creation = true;
 }
@@ -4,11 +4,21 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
-#include <set>
+#include <algorithm>
 
+#include <boost/ref.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
 #include "common/FindComponents.hpp"
+#include "common/Group.hpp"
+#include "common/Log.hpp"
+#include "common/StringConversion.hpp"
 #include "common/List.hpp"
+#include "common/ThreadPool.hpp"
 #include "common/PE/Comm.hpp"
+#include "common/XML/SignalOptions.hpp"
 
 #include "mesh/Region.hpp"
 #include "mesh/Mesh.hpp"
@@ -17,6 +27,7 @@
 #include "mesh/Functions.hpp"
 #include "mesh/Connectivity.hpp"
 #include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
 
 #include "UFEM/SparsityBuilder.hpp"
 
@@ -28,6 +39,82 @@ using namespace mesh;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace detail
+{
+
+/// Computes the sorted, unique list of neighbours for a range of nodes, using the node to element connectivity.
+/// Each thread handles a contiguous range of nodes and stores its result in its own CSR arrays.
+struct NodeNeighbours
+{
+  NodeNeighbours(const std::vector<const Connectivity*>& connectivities,
+                 const std::vector<Uint>& element_offsets,
+                 const std::vector<Uint>& node_elements_start,
+                 const std::vector<Uint>& node_elements,
+                 const List<Uint>& used_node_map,
+                 const Uint nb_parts) :
+    connectivities(connectivities),
+    element_offsets(element_offsets),
+    node_elements_start(node_elements_start),
+    node_elements(node_elements),
+    used_node_map(used_node_map),
+    nb_parts(nb_parts),
+    neighbours(nb_parts),
+    counts(nb_parts)
+  {
+  }
+
+  void operator()(const Uint part)
+  {
+    const Uint nb_nodes = node_elements_start.size() - 1;
+    Uint begin, end;
+    split_range(nb_nodes, nb_parts, part, begin, end);
+
+    std::vector<Uint>& part_neighbours = neighbours[part];
+    std::vector<Uint>& part_counts = counts[part];
+    part_counts.resize(end - begin);
+    for(Uint node = begin; node != end; ++node)
+    {
+      const Uint row_begin = part_neighbours.size();
+      for(Uint i = node_elements_start[node]; i != node_elements_start[node+1]; ++i)
+      {
+        const Uint elem = node_elements[i];
+        const Uint entities_idx = std::upper_bound(element_offsets.begin(), element_offsets.end(), elem) - element_offsets.begin() - 1;
+        BOOST_FOREACH(const Uint other_node, (*connectivities[entities_idx])[elem - element_offsets[entities_idx]])
+        {
+          part_neighbours.push_back(used_node_map[other_node]);
+        }
+      }
+      std::sort(part_neighbours.begin() + row_begin, part_neighbours.end());
+      part_neighbours.erase(std::unique(part_neighbours.begin() + row_begin, part_neighbours.end()), part_neighbours.end());
+      part_counts[node - begin] = part_neighbours.size() - row_begin;
+    }
+  }
+
+  const std::vector<const Connectivity*>& connectivities;
+  const std::vector<Uint>& element_offsets;
+  const std::vector<Uint>& node_elements_start;
+  const std::vector<Uint>& node_elements;
+  const List<Uint>& used_node_map;
+  const Uint nb_parts;
+
+  /// Neighbours and number of neighbours of each node, for each part
+  std::vector< std::vector<Uint> > neighbours;
+  std::vector< std::vector<Uint> > counts;
+};
+
+/// Less-than on the first item of a pair, for the reverse GID map
+struct CompareFirst
+{
+  bool operator()(const std::pair<Uint, Uint>& a, const std::pair<Uint, Uint>& b) const
+  {
+    return a.first < b.first;
+  }
+};
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
 boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region> >& regions, const Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, List<Uint>& gids, List<Uint>& ranks, List<Uint>& used_node_map)
 {
   // Get some data from the dictionary
@@ -64,7 +151,7 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
     {
       ++nb_local_nodes;
     }
-    ranks[i] = dict_rank[i];
+    ranks[i] = dict_rank[node_idx];
   }
 
   // Get the layout of the new GIDs across CPUs
@@ -128,17 +215,23 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
     std::vector<int> recv_map; recv_map.reserve(recv_size);
     std::vector<int> send_map; send_map.reserve(send_size);
     
-    std::map<Uint, Uint> gids_reverse_map;
+    // Reverse GID map, as a sorted list of (gid, local index) pairs
+    std::vector< std::pair<Uint, Uint> > gids_reverse_map(nb_global_nodes);
     for(Uint i = 0; i != nb_global_nodes; ++i)
-      gids_reverse_map[dict_gid[i]] = i;
+      gids_reverse_map[i] = std::make_pair(dict_gid[i], i);
+    std::sort(gids_reverse_map.begin(), gids_reverse_map.end(), detail::CompareFirst());
 
     for(Uint i = 0; i != nb_procs; ++i)
     {
       recv_map.insert(recv_map.end(), lids_to_receive[i].begin(), lids_to_receive[i].end());
-      const std::vector<Uint> send_gids_i = gids_to_send[i];
+      const std::vector<Uint>& send_gids_i = gids_to_send[i];
       const Uint len_send_gids_i = send_gids_i.size();
       for(Uint j = 0; j != len_send_gids_i; ++j)
-        send_map.push_back(gids_reverse_map[send_gids_i[j]]);
+      {
+        const std::vector< std::pair<Uint, Uint> >::const_iterator found = std::lower_bound(gids_reverse_map.begin(), gids_reverse_map.end(), std::make_pair(send_gids_i[j], Uint(0)), detail::CompareFirst());
+        cf3_assert(found != gids_reverse_map.end() && found->first == send_gids_i[j]);
+        send_map.push_back(found->second);
+      }
     }
     
     // Update the GIDs for the ghosts
@@ -153,43 +246,208 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
     }
   }
 
-  std::vector< std::set<Uint> > connectivity_sets(nb_used_nodes);
-  start_indices.assign(nb_used_nodes+1, 0);
-
-  // Determine the number of connected nodes for each element
+  // Node to element connectivity in CSR format, with the elements numbered consecutively over all used entities
+  std::vector<const Connectivity*> connectivities;
+  std::vector<Uint> element_offsets(1, 0);
   BOOST_FOREACH(const Handle<Entities const>& elements, used_entities)
   {
-    const Connectivity& connectivity = elements->geometry_space().connectivity();
+    connectivities.push_back(&elements->geometry_space().connectivity());
+    element_offsets.push_back(element_offsets.back() + connectivities.back()->size());
+  }
+  element_offsets.pop_back();
+
+  std::vector<Uint> node_elements_start(nb_used_nodes+1, 0);
+  BOOST_FOREACH(const Connectivity* connectivity, connectivities)
+  {
+    const Uint nb_elems = connectivity->size();
+    for(Uint elem = 0; elem != nb_elems; ++elem)
+    {
+      BOOST_FOREACH(const Uint node, (*connectivity)[elem])
+      {
+        ++node_elements_start[used_node_map[node]+1];
+      }
+    }
+  }
+  for(Uint i = 1; i != nb_used_nodes+1; ++i)
+    node_elements_start[i] += node_elements_start[i-1];
+
+  std::vector<Uint> node_elements(node_elements_start.back());
+  std::vector<Uint> node_elements_fill(node_elements_start.begin(), node_elements_start.end() - 1);
+  for(Uint i = 0; i != connectivities.size(); ++i)
+  {
+    const Connectivity& connectivity = *connectivities[i];
     const Uint nb_elems = connectivity.size();
-    const Uint nb_elem_nodes = connectivity.row_size();
     for(Uint elem = 0; elem != nb_elems; ++elem)
     {
-      BOOST_FOREACH(const Uint node_a, connectivity[elem])
+      BOOST_FOREACH(const Uint node, connectivity[elem])
       {
-        BOOST_FOREACH(const Uint node_b, connectivity[elem])
-        {
-          connectivity_sets[used_node_map[node_a]].insert(used_node_map[node_b]);
-        }
+        node_elements[node_elements_fill[used_node_map[node]]++] = element_offsets[i] + elem;
       }
     }
   }
+  std::vector<Uint>().swap(node_elements_fill);
+
+  // Sorted unique neighbours of each node, computed in parallel over contiguous ranges of nodes.
+  // The pool calls every part up to its number of threads, so parts beyond the number of nodes get an empty range.
+  ThreadPool& pool = ThreadPool::instance();
+  const Uint nb_parts = pool.in_parallel_region() ? 1 : pool.nb_threads();
+  detail::NodeNeighbours neighbours(connectivities, element_offsets, node_elements_start, node_elements, used_node_map, nb_parts);
+  if(nb_parts == 1)
+    neighbours(0);
+  else
+    pool.run(boost::ref(neighbours));
 
-  // Sum the number of connected nodes to get the real start indices
-  const Uint start_indices_end = start_indices.size();
-  for(Uint i = 1; i != start_indices_end; ++i)
+  // Sum the number of connected nodes to get the start indices
+  start_indices.resize(nb_used_nodes+1);
+  start_indices[0] = 0;
+  Uint node = 0;
+  for(Uint part = 0; part != nb_parts; ++part)
   {
-    start_indices[i] = connectivity_sets[i-1].size() + start_indices[i-1];
+    BOOST_FOREACH(const Uint count, neighbours.counts[part])
+    {
+      start_indices[node+1] = start_indices[node] + count;
+      ++node;
+    }
   }
+  cf3_assert(node == nb_used_nodes);
 
+  node_connectivity.clear();
   node_connectivity.reserve(start_indices.back());
-  for(Uint node = 0; node != nb_used_nodes; ++node)
+  for(Uint part = 0; part != nb_parts; ++part)
   {
-    node_connectivity.insert(node_connectivity.begin() + start_indices[node], connectivity_sets[node].begin(), connectivity_sets[node].end());
+    node_connectivity.insert(node_connectivity.end(), neighbours.neighbours[part].begin(), neighbours.neighbours[part].end());
+    std::vector<Uint>().swap(neighbours.neighbours[part]);
   }
 
   return used_nodes_ptr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < CachedSparsity, Component, LibUFEM > CachedSparsity_Builder;
+
+CachedSparsity::CachedSparsity(const std::string& name) :
+  Component(name),
+  nb_nodes(0),
+  nb_elements(0),
+  m_mesh_changed(false)
+{
+  Core::instance().event_handler().connect_to_event(mesh::Tags::event_mesh_changed(), this, &CachedSparsity::on_mesh_changed_event);
+}
+
+bool CachedSparsity::is_valid() const
+{
+  return !m_mesh_changed && is_not_null(gids) && is_not_null(ranks) && is_not_null(used_node_map) && is_not_null(used_nodes);
+}
+
+void CachedSparsity::on_mesh_changed_event(SignalArgs& args)
+{
+  Handle<Mesh const> mesh(find_parent_component_ptr<Mesh>(*this));
+  if(is_null(mesh))
+    return;
+
+  XML::SignalOptions options(args);
+  if(options.value<URI>("mesh_uri") != mesh->uri())
+    return;
+
+  std::vector<Uint>().swap(node_connectivity);
+  std::vector<Uint>().swap(start_indices);
+  m_mesh_changed = true;
+}
+
+namespace detail
+{
+  template<typename T>
+  void copy_list(const List<T>& from, List<T>& to)
+  {
+    to.resize(from.size());
+    std::copy(from.array().begin(), from.array().end(), to.array().begin());
+  }
+
+  /// Total number of volume elements in the regions
+  Uint count_volume_elements(const std::vector< Handle<Region> >& regions)
+  {
+    Uint result = 0;
+    BOOST_FOREACH(const Handle<Region>& region, regions)
+    {
+      BOOST_FOREACH(const Entities& entities, find_components_recursively_with_filter<Entities>(*region, IsElementsVolume()))
+      {
+        result += entities.size();
+      }
+    }
+    return result;
+  }
+
+  const std::string& sparsity_cache_name()
+  {
+    static const std::string name("UFEMSparsityCache");
+    return name;
+  }
+}
+
+boost::shared_ptr< List<Uint> > build_sparsity_cached(const std::vector< Handle<Region> >& regions, Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, List<Uint>& gids, List<Uint>& ranks, List<Uint>& used_node_map)
+{
+  std::vector<URI> region_uris;
+  BOOST_FOREACH(const Handle<Region>& region, regions)
+  {
+    region_uris.push_back(region->uri());
+  }
+  const Uint nb_elements = detail::count_volume_elements(regions);
+
+  Handle<Group> cache(dictionary.get_child(detail::sparsity_cache_name()));
+  if(is_null(cache))
+    cache = dictionary.create_component<Group>(detail::sparsity_cache_name());
+
+  // Drop the entries for an old mesh, or of which the lists were removed together with their system
+  std::vector<std::string> stale_entries;
+  BOOST_FOREACH(const CachedSparsity& cached, find_components<CachedSparsity>(*cache))
+  {
+    if(!cached.is_valid() || cached.nb_nodes != dictionary.size())
+      stale_entries.push_back(cached.name());
+  }
+  BOOST_FOREACH(const std::string& name, stale_entries)
+  {
+    cache->remove_component(name);
+  }
+
+  BOOST_FOREACH(const CachedSparsity& cached, find_components<CachedSparsity>(*cache))
+  {
+    if(cached.regions != region_uris || cached.nb_elements != nb_elements)
+      continue;
+
+    CFdebug << "Reusing the sparsity built for the same regions in " << cached.uri().path() << CFendl;
+    node_connectivity = cached.node_connectivity;
+    start_indices = cached.start_indices;
+    detail::copy_list(*cached.gids, gids);
+    detail::copy_list(*cached.ranks, ranks);
+    detail::copy_list(*cached.used_node_map, used_node_map);
+    boost::shared_ptr< List<Uint> > used_nodes = allocate_component< List<Uint> >(mesh::Tags::nodes_used());
+    detail::copy_list(*cached.used_nodes, *used_nodes);
+    return used_nodes;
+  }
+
+  boost::shared_ptr< List<Uint> > used_nodes = build_sparsity(regions, dictionary, node_connectivity, start_indices, gids, ranks, used_node_map);
+
+  CachedSparsity& cached = *cache->create_component<CachedSparsity>("Sparsity" + common::to_str(cache->count_children()));
+  cached.regions = region_uris;
+  cached.nb_nodes = dictionary.size();
+  cached.nb_elements = nb_elements;
+  cached.node_connectivity = node_connectivity;
+  cached.start_indices = start_indices;
+  cached.gids = gids.handle< List<Uint> >();
+  cached.ranks = ranks.handle< List<Uint> >();
+  cached.used_node_map = used_node_map.handle< List<Uint> >();
+  cached.used_nodes = Handle< List<Uint> const >(used_nodes);
+
+  return used_nodes;
+}
+
+void clear_sparsity_cache(Dictionary& dictionary)
+{
+  if(is_not_null(dictionary.get_child(detail::sparsity_cache_name())))
+    dictionary.remove_component(detail::sparsity_cache_name());
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 
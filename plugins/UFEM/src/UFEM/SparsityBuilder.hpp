@@ -7,6 +7,11 @@
 #ifndef cf3_UFEM_SparsityBuilder_hpp
 #define cf3_UFEM_SparsityBuilder_hpp
 
+#include <vector>
+
+#include "common/Component.hpp"
+#include "common/URI.hpp"
+
 #include "UFEM/LibUFEM.hpp"
 
 namespace cf3 {
@@ -31,6 +36,46 @@ namespace UFEM {
 /// Size is number of nodes + 1, so the last item is the size of node_connectivity
 UFEM_API boost::shared_ptr< common::List< Uint > > build_sparsity(const std::vector< Handle<mesh::Region> >& regions, const mesh::Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, common::List<Uint>& gids, common::List<Uint>& ranks, common::List<Uint>& used_node_map);
 
+/// Result of build_sparsity for a set of regions, stored below the dictionary. The lists that are also kept by the
+/// system that built the sparsity are referenced rather than copied, only the node connectivity is stored.
+/// The entry becomes invalid when the mesh_changed event is raised for the mesh of the dictionary.
+class UFEM_API CachedSparsity : public common::Component
+{
+public:
+  CachedSparsity(const std::string& name);
+
+  static std::string type_name () { return "CachedSparsity"; }
+
+  /// False if the mesh changed or one of the referenced lists was removed since the sparsity was built
+  bool is_valid() const;
+
+  /// Regions for which the sparsity was built
+  std::vector<common::URI> regions;
+  /// Number of nodes in the dictionary and of volume elements in the regions when the sparsity was built
+  Uint nb_nodes;
+  Uint nb_elements;
+  std::vector<Uint> node_connectivity;
+  std::vector<Uint> start_indices;
+  /// Lists filled by build_sparsity, owned by the system and action that built the sparsity
+  Handle< common::List<Uint> const > gids;
+  Handle< common::List<Uint> const > ranks;
+  Handle< common::List<Uint> const > used_node_map;
+  Handle< common::List<Uint> const > used_nodes;
+
+private:
+  /// Invalidates the entry if the mesh of the dictionary changed
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+  bool m_mesh_changed;
+};
+
+/// Same as build_sparsity, but the result is cached in the dictionary, so systems over the same regions
+/// are only built once. Entries for a mesh that changed are rebuilt.
+UFEM_API boost::shared_ptr< common::List< Uint > > build_sparsity_cached(const std::vector< Handle<mesh::Region> >& regions, mesh::Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, common::List<Uint>& gids, common::List<Uint>& ranks, common::List<Uint>& used_node_map);
+
+/// Remove the cached sparsity from the dictionary
+UFEM_API void clear_sparsity_cache(mesh::Dictionary& dictionary);
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 
 } // UFEM
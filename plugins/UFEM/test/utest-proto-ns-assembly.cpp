@@ -18,7 +18,11 @@
 #include "common/Core.hpp"
 #include "common/Environment.hpp"
 #include "common/Group.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+#include "common/Profiler.hpp"
 
+#include "mesh/Connectivity.hpp"
 #include "mesh/Domain.hpp"
 #include "mesh/LagrangeP1/Triag2D.hpp"
 #include "mesh/LagrangeP1/Tetra3D.hpp"
@@ -49,24 +53,25 @@ typedef std::vector<Uint> SizesT;
 
 struct NavierStokesAssemblyFixture
 {
+  /// Set up a Navier-Stokes model on the given mesh, which only assembles the system
   template<Uint Dim, typename ExprT>
-  void run_model(const boost::shared_ptr<Mesh>& mesh, const ExprT& initial_condition_expression, const Real eps = 1e-12)
+  cf3::math::LSS::System& setup_model(const boost::shared_ptr<Mesh>& mesh, const ExprT& initial_condition_expression)
   {
-    boost::shared_ptr<common::Group> root = allocate_component<Group>("Root");
-    Handle<ModelUnsteady> model = root->create_component<ModelUnsteady>("NavierStokes");
+    root = allocate_component<Group>("Root");
+    model = root->create_component<ModelUnsteady>("NavierStokes");
     Domain& domain = model->create_domain("Domain");
     physics::PhysModel& physical_model = model->create_physics("cf3.UFEM.NavierStokesPhysics");
 
     Handle<UFEM::Solver> solver(model->create_solver("cf3.UFEM.Solver").handle());
     Handle<InitialConditions> ic = solver->create_initial_conditions();
-    Handle<UFEM::LSSActionUnsteady> lss_action(solver->add_unsteady_solver("cf3.UFEM.NavierStokes"));
+    lss_action = Handle<UFEM::LSSActionUnsteady>(solver->add_unsteady_solver("cf3.UFEM.NavierStokes"));
 
     physical_model.options().set("density", 1.);
     physical_model.options().set("dynamic_viscosity", 1.);
     physical_model.options().set("reference_velocity", 1.);
 
-    Time& time = model->create_time();
-    time.options().set("time_step", 1.);
+    time = model->create_time().handle<Time>();
+    time->options().set("time_step", 1.);
 
     ic->remove_component(lss_action->solution_tag());
 
@@ -74,34 +79,128 @@ struct NavierStokesAssemblyFixture
     mesh->raise_mesh_loaded();
 
     solver->configure_option_recursively("regions", std::vector<URI>(1, mesh->topology().uri()));
-    math::LSS::System& lss = lss_action->create_lss("cf3.math.LSS.TrilinosFEVbrMatrix");
+    cf3::math::LSS::System& lss = lss_action->create_lss("cf3.math.LSS.TrilinosFEVbrMatrix");
 
     const std::vector<std::string> disabled_actions = boost::assign::list_of("BoundaryConditions")("SolveLSS")("Update");
     lss_action->options().set("disabled_actions", disabled_actions);
 
-    lss_action->options().set("use_specializations", true);
-    time.options().set("end_time", 1.);
     solver->create_fields();
     for_each_node<Dim>(mesh->topology(), initial_condition_expression);
-    model->simulate();
 
-    const Uint matsize = lss.matrix()->blockcol_size()*lss.matrix()->neq();
+    return lss;
+  }
 
-    RealMatrix spec_result(matsize, matsize);
-    for(Uint i = 0; i != matsize; ++i)
-      for(Uint j = 0; j != matsize; ++j)
-        lss.matrix()->get_value(i, j, spec_result(i,j));
+  template<Uint Dim, typename ExprT>
+  void run_model(const boost::shared_ptr<Mesh>& mesh, const ExprT& initial_condition_expression, const Real eps = 1e-12)
+  {
+    cf3::math::LSS::System& lss = setup_model<Dim>(mesh, initial_condition_expression);
+
+    lss_action->options().set("use_specializations", true);
+    time->options().set("end_time", 1.);
+    model->simulate();
+    const RealMatrix spec_result = dense_matrix(lss);
 
     lss_action->options().set("use_specializations", false);
-    time.options().set("end_time", 2.);
+    time->options().set("end_time", 2.);
     model->simulate();
+    const RealMatrix generic_result = dense_matrix(lss);
+
+    check_close(generic_result, spec_result, eps);
+  }
 
-    RealMatrix generic_result(matsize, matsize);
+  /// Compare the system assembled using a single thread with the one using several threads
+  template<Uint Dim, typename ExprT>
+  void run_threaded(const boost::shared_ptr<Mesh>& mesh, const ExprT& initial_condition_expression, const bool use_specializations)
+  {
+    cf3::math::LSS::System& lss = setup_model<Dim>(mesh, initial_condition_expression);
+    lss_action->options().set("use_specializations", use_specializations);
+
+    Core::instance().environment().options().set("nb_threads", 1u);
+    time->options().set("end_time", 1.);
+    model->simulate();
+    const RealMatrix serial_matrix = dense_matrix(lss);
+    const std::vector<Real> serial_rhs = rhs_values(lss);
+
+    Core::instance().environment().options().set("nb_threads", 4u);
+    Core::instance().environment().options().set("profiling", true);
+    Profiler::instance().reset();
+    time->options().set("end_time", 2.);
+    model->simulate();
+    Core::instance().environment().options().set("profiling", false);
+    Core::instance().environment().options().set("nb_threads", 1u);
+
+    // Element colours run by the workers of the pool are timed at the root of their call tree,
+    // while those of the calling thread are nested in Proto::element_loop
+    Uint nb_worker_calls = 0;
+    boost_foreach(const ProfileEntry& entry, Profiler::instance().collect())
+    {
+      if(entry.path.size() == 1 && entry.path.front() == "Proto::element_colour")
+        nb_worker_calls += entry.max_calls;
+    }
+    BOOST_CHECK(nb_worker_calls > 0);
+    const RealMatrix threaded_matrix = dense_matrix(lss);
+    const std::vector<Real> threaded_rhs = rhs_values(lss);
+
+    check_close(threaded_matrix, serial_matrix, 1e-10);
+    BOOST_REQUIRE_EQUAL(threaded_rhs.size(), serial_rhs.size());
+    for(Uint i = 0; i != serial_rhs.size(); ++i)
+      BOOST_CHECK_CLOSE(threaded_rhs[i], serial_rhs[i], 1e-10);
+  }
+
+  RealMatrix dense_matrix(cf3::math::LSS::System& lss)
+  {
+    const Uint matsize = lss.matrix()->blockcol_size()*lss.matrix()->neq();
+    RealMatrix result(matsize, matsize);
     for(Uint i = 0; i != matsize; ++i)
       for(Uint j = 0; j != matsize; ++j)
-        lss.matrix()->get_value(i, j, generic_result(i,j));
+        lss.matrix()->get_value(i, j, result(i,j));
+    return result;
+  }
 
-    check_close(generic_result, spec_result, eps);
+  std::vector<Real> rhs_values(cf3::math::LSS::System& lss)
+  {
+    std::vector<Real> result(lss.matrix()->blockrow_size()*lss.matrix()->neq());
+    for(Uint i = 0; i != result.size(); ++i)
+      lss.rhs()->get_value(i, result[i]);
+    return result;
+  }
+
+  /// Unit square split into n x n squares, each cut into two triangles
+  boost::shared_ptr<Mesh> create_triangle_grid(const Uint n)
+  {
+    boost::shared_ptr<Mesh> mesh_ptr = allocate_component<Mesh>("mesh");
+    Mesh& mesh = *mesh_ptr;
+    mesh.initialize_nodes((n+1)*(n+1), 2);
+    Dictionary& geometry_dict = mesh.geometry_fields();
+    Field& coords = geometry_dict.coordinates();
+    for(Uint j = 0; j <= n; ++j)
+    {
+      for(Uint i = 0; i <= n; ++i)
+      {
+        coords[j*(n+1)+i][0] = Real(i) / Real(n);
+        coords[j*(n+1)+i][1] = Real(j) / Real(n);
+      }
+    }
+
+    Elements& cells = mesh.topology().create_region("cells").create_elements("cf3.mesh.LagrangeP1.Triag2D", geometry_dict);
+    cells.resize(2*n*n);
+    Connectivity& connectivity = cells.geometry_space().connectivity();
+    for(Uint j = 0; j != n; ++j)
+    {
+      for(Uint i = 0; i != n; ++i)
+      {
+        const Uint corner = j*(n+1)+i;
+        const Uint elem = 2*(j*n+i);
+        connectivity[elem][0] = corner;
+        connectivity[elem][1] = corner+1;
+        connectivity[elem][2] = corner+n+2;
+        connectivity[elem+1][0] = corner;
+        connectivity[elem+1][1] = corner+n+2;
+        connectivity[elem+1][2] = corner+n+1;
+      }
+    }
+
+    return mesh_ptr;
   }
 
   boost::shared_ptr<Mesh> create_triangle(const RealVector2& a, const RealVector2& b, const RealVector2& c)
@@ -146,6 +245,11 @@ struct NavierStokesAssemblyFixture
       for(Uint j = 0; j != a.cols(); ++j)
         BOOST_CHECK_CLOSE(a(i,j), b(i,j), eps);
   }
+
+  boost::shared_ptr<common::Group> root;
+  Handle<ModelUnsteady> model;
+  Handle<UFEM::LSSActionUnsteady> lss_action;
+  Handle<Time> time;
 };
 
 BOOST_FIXTURE_TEST_SUITE( NavierStokesAssemblySuite, NavierStokesAssemblyFixture )
@@ -202,4 +306,14 @@ BOOST_AUTO_TEST_CASE( GenericTetraVortex )
   run_model<3>(create_tetra(RealVector3(100.2, 100.1, 99.9), RealVector3(100.75, 99.9, 100.05), RealVector3(100.33, 100.83, 100.23), RealVector3(100.1, 99.9, 100.67)), u = n_op*coordinates / (coordinates[0]*coordinates[0] + coordinates[1]*coordinates[1]), 0.2);
 }
 
+// The stabilization coefficients are computed per element into scalars that each thread copies,
+// so the threaded assembly must give the same system as the serial one
+BOOST_AUTO_TEST_CASE( ThreadedGridVortex )
+{
+  RealMatrix2 n_op; n_op << 0., 1., -1., 0.;
+  FieldVariable<0, VectorField> u("Velocity", "navier_stokes_solution");
+  run_threaded<2>(create_triangle_grid(6), u = n_op*coordinates + coordinates, true);
+  run_threaded<2>(create_triangle_grid(6), u = n_op*coordinates + coordinates, false);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,17 +7,26 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for heat-conduction related proto operations"
 
+#include <set>
+
 #include <boost/assign.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include "common/Core.hpp"
 #include "common/Environment.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/Group.hpp"
+#include "common/ThreadPool.hpp"
 
 #include "common/PE/CommPattern.hpp"
 
 #include "math/LSS/System.hpp"
 
+#include "mesh/Connectivity.hpp"
 #include "mesh/Domain.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Space.hpp"
 #include "mesh/LagrangeP1/Line1D.hpp"
 
 #include "solver/Model.hpp"
@@ -45,6 +54,59 @@ using namespace cf3::mesh;
 
 using namespace boost::assign;
 
+/// Sparsity built using a set of neighbours for each node, as before the CSR builder
+void reference_sparsity(const Mesh& mesh, const List<Uint>& used_node_map, const Uint nb_used_nodes, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices)
+{
+  std::vector< std::set<Uint> > connectivity_sets(nb_used_nodes);
+  boost_foreach(const Entities& elements, find_components_recursively_with_filter<Entities>(mesh.topology(), IsElementsVolume()))
+  {
+    boost_foreach(Connectivity::ConstRow row, elements.geometry_space().connectivity().array())
+    {
+      boost_foreach(const Uint node_a, row)
+      {
+        boost_foreach(const Uint node_b, row)
+        {
+          connectivity_sets[used_node_map[node_a]].insert(used_node_map[node_b]);
+        }
+      }
+    }
+  }
+
+  node_connectivity.clear();
+  start_indices.assign(1, 0);
+  boost_foreach(const std::set<Uint>& neighbours, connectivity_sets)
+  {
+    node_connectivity.insert(node_connectivity.end(), neighbours.begin(), neighbours.end());
+    start_indices.push_back(node_connectivity.size());
+  }
+}
+
+/// Compare the sparsity built using 1, 3 and 8 threads with the reference
+void check_threaded_sparsity(Mesh& mesh)
+{
+  const std::vector< Handle<Region> > regions(1, mesh.topology().handle<Region>());
+  boost::shared_ptr< List<Uint> > gids = allocate_component< List<Uint> >("GIDs");
+  boost::shared_ptr< List<Uint> > ranks = allocate_component< List<Uint> >("Ranks");
+  boost::shared_ptr< List<Uint> > used_node_map = allocate_component< List<Uint> >("used_node_map");
+
+  std::vector<Uint> reference_connectivity, reference_start_indices;
+  const Uint nb_threads[] = {1, 3, 8};
+  for(Uint i = 0; i != 3; ++i)
+  {
+    ThreadPool::instance().set_nb_threads(nb_threads[i]);
+    std::vector<Uint> node_connectivity, start_indices;
+    boost::shared_ptr< List<Uint> > used_nodes = UFEM::build_sparsity(regions, mesh.geometry_fields(), node_connectivity, start_indices, *gids, *ranks, *used_node_map);
+    ThreadPool::instance().set_nb_threads(1);
+
+    if(i == 0)
+      reference_sparsity(mesh, *used_node_map, used_nodes->size(), reference_connectivity, reference_start_indices);
+
+    BOOST_CHECK_EQUAL(start_indices.size(), used_nodes->size() + 1);
+    BOOST_CHECK(start_indices == reference_start_indices);
+    BOOST_CHECK(node_connectivity == reference_connectivity);
+  }
+}
+
 struct UFEMBuildSparsityFixture
 {
   UFEMBuildSparsityFixture() :
@@ -297,6 +359,61 @@ BOOST_AUTO_TEST_CASE( Sparsity3DHexaChannel )
   lss.matrix()->print("utest-ufem-buildsparsity_heat_matrix_3DHexaChannel.plt");
 }
 
+BOOST_AUTO_TEST_CASE( ThreadedSparsity )
+{
+  Mesh& mesh = *root.create_component<Mesh>("ThreadedSparsityMesh");
+  Tools::MeshGeneration::create_rectangle_tris(mesh, 5., 5., 5, 5);
+  check_threaded_sparsity(mesh);
+}
+
+// Less nodes than threads
+BOOST_AUTO_TEST_CASE( ThreadedSparsitySmallMesh )
+{
+  Mesh& mesh = *root.create_component<Mesh>("SmallMesh");
+  Tools::MeshGeneration::create_line(mesh, 1., 2);
+  BOOST_CHECK_EQUAL(mesh.geometry_fields().size(), 3u);
+  check_threaded_sparsity(mesh);
+}
+
+BOOST_AUTO_TEST_CASE( SparsityCache )
+{
+  Mesh& mesh = *root.create_component<Mesh>("CachedSparsityMesh");
+  Tools::MeshGeneration::create_rectangle_tris(mesh, 5., 5., 5, 5);
+  const std::vector< Handle<Region> > regions(1, mesh.topology().handle<Region>());
+  Dictionary& dict = mesh.geometry_fields();
+
+  Group& system1 = *root.create_component<Group>("System1");
+  Group& system2 = *root.create_component<Group>("System2");
+  std::vector<Uint> connectivity1, start_indices1, connectivity2, start_indices2;
+  boost::shared_ptr< List<Uint> > used_nodes1 = UFEM::build_sparsity_cached(regions, dict, connectivity1, start_indices1, *system1.create_component< List<Uint> >("GIDs"), *system1.create_component< List<Uint> >("Ranks"), *system1.create_component< List<Uint> >("used_node_map"));
+  system1.add_component(used_nodes1);
+  boost::shared_ptr< List<Uint> > used_nodes2 = UFEM::build_sparsity_cached(regions, dict, connectivity2, start_indices2, *system2.create_component< List<Uint> >("GIDs"), *system2.create_component< List<Uint> >("Ranks"), *system2.create_component< List<Uint> >("used_node_map"));
+
+  Component& cache = *dict.get_child("UFEMSparsityCache");
+  BOOST_CHECK_EQUAL(cache.count_children(), 1u);
+  const UFEM::CachedSparsity& cached = *Handle<UFEM::CachedSparsity>(cache.get_child("Sparsity0"));
+  BOOST_CHECK(cached.is_valid());
+  BOOST_CHECK(connectivity1 == connectivity2);
+  BOOST_CHECK(start_indices1 == start_indices2);
+  BOOST_CHECK(used_nodes1->array() == used_nodes2->array());
+  BOOST_CHECK(Handle< List<Uint> >(system1.get_child("GIDs"))->array() == Handle< List<Uint> >(system2.get_child("GIDs"))->array());
+
+  // The entry is dropped when the mesh changes
+  mesh.raise_mesh_changed();
+  BOOST_CHECK(!cached.is_valid());
+  BOOST_CHECK(cached.node_connectivity.empty());
+  system2.remove_component("GIDs");
+  used_nodes2 = UFEM::build_sparsity_cached(regions, dict, connectivity2, start_indices2, *system2.create_component< List<Uint> >("GIDs"), *system2.get_child("Ranks")->handle< List<Uint> >(), *system2.get_child("used_node_map")->handle< List<Uint> >());
+  BOOST_CHECK_EQUAL(cache.count_children(), 1u);
+  BOOST_CHECK(connectivity1 == connectivity2);
+
+  // Removing the lists of the system that built the sparsity also invalidates it
+  const UFEM::CachedSparsity& rebuilt = *find_component_ptr<UFEM::CachedSparsity>(cache);
+  BOOST_CHECK(rebuilt.is_valid());
+  system2.remove_component("GIDs");
+  BOOST_CHECK(!rebuilt.is_valid());
+}
+
 BOOST_AUTO_TEST_CASE( Heat1DComponent )
 {
   Core::instance().environment().options().set("log_level", 4u);
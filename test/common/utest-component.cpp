@@ -19,6 +19,7 @@
 #include "common/Link.hpp"
 #include "common/OptionList.hpp"
 #include "common/PropertyList.hpp"
+#include "common/ThreadPool.hpp"
 
 #include "common/XML/Protocol.hpp"
 #include "common/XML/SignalFrame.hpp"
@@ -297,6 +298,98 @@ BOOST_AUTO_TEST_CASE( clear )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( access_component_cache )
+{
+  boost::shared_ptr<Component> root = allocate_component<Group> ( "root" );
+  Handle<Component> a = root->create_component<Group>("a");
+  Handle<Component> b = a->create_component<Group>("b");
+
+  // repeated lookups give the same result
+  BOOST_CHECK(root->access_component(URI("a/b", URI::Scheme::CPATH)) == b);
+  BOOST_CHECK(root->access_component(URI("a/b", URI::Scheme::CPATH)) == b);
+  BOOST_CHECK(b->access_component(URI("../..", URI::Scheme::CPATH)) == root->handle());
+
+  // renaming, moving and removing invalidate the cached paths
+  b->rename("c");
+  BOOST_CHECK(is_null(root->access_component(URI("a/b", URI::Scheme::CPATH))));
+  BOOST_CHECK(root->access_component(URI("a/c", URI::Scheme::CPATH)) == b);
+
+  b->move_to(*root);
+  BOOST_CHECK(is_null(root->access_component(URI("a/c", URI::Scheme::CPATH))));
+  BOOST_CHECK(b->access_component(URI("..", URI::Scheme::CPATH)) == root->handle());
+
+  root->remove_component("c");
+  BOOST_CHECK(is_null(root->access_component(URI("c", URI::Scheme::CPATH))));
+
+  Handle<Component> new_b = a->create_component<Group>("b");
+  BOOST_CHECK(root->access_component(URI("a/b", URI::Scheme::CPATH)) == new_b);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( descendants_index )
+{
+  boost::shared_ptr<Component> root = allocate_component<Group> ( "root" );
+  Handle<Component> a = root->create_component<Group>("a");
+  a->create_component<Component>("b");
+  Handle<Component> c = a->create_component<Group>("c");
+
+  // the list is reused while the tree does not change
+  boost::shared_ptr< const std::vector< boost::shared_ptr<Group> > > groups = root->descendants<Group>();
+  BOOST_CHECK_EQUAL(groups->size(), 2u);
+  BOOST_CHECK(root->descendants<Group>() == groups);
+  BOOST_CHECK_EQUAL(count(find_components_recursively<Group>(*root)), 2u);
+  BOOST_CHECK_EQUAL(count(find_components_recursively(*root)), 3u);
+
+  // adding or removing below a component invalidates its list
+  Handle<Component> d = c->create_component<Group>("d");
+  BOOST_CHECK(root->descendants<Group>() != groups);
+  BOOST_CHECK_EQUAL(root->descendants<Group>()->size(), 3u);
+  BOOST_CHECK(root->descendants<Group>()->back().get() == d.get());
+
+  a->remove_component("c");
+  BOOST_CHECK_EQUAL(root->descendants<Group>()->size(), 1u);
+  BOOST_CHECK_EQUAL(count(find_components_recursively<Group>(*root)), 1u);
+
+  // the cache does not keep removed components alive
+  BOOST_CHECK(is_null(c));
+  BOOST_CHECK(is_null(d));
+}
+
+/// Each thread resolves the same path a number of times, counting the lookups that returned the expected component
+void threaded_lookups(const Uint thread_idx, const Component& root, const URI& path, const Handle<Component>& expected, std::vector<Uint>& nb_found)
+{
+  for(Uint i = 0; i != 100; ++i)
+  {
+    if(root.access_component(path) == expected)
+      ++nb_found[thread_idx];
+  }
+}
+
+BOOST_AUTO_TEST_CASE( access_component_threads )
+{
+  boost::shared_ptr<Component> root = allocate_component<Group> ( "root" );
+  Handle<Component> b = root->create_component<Group>("a")->create_component<Group>("b");
+  const URI path("a/b", URI::Scheme::CPATH);
+
+  ThreadPool& pool = ThreadPool::instance();
+  pool.set_nb_threads(4);
+  std::vector<Uint> nb_found(pool.nb_threads(), 0);
+  pool.run(boost::bind(threaded_lookups, _1, boost::cref(*root), boost::cref(path), boost::cref(b), boost::ref(nb_found)));
+  BOOST_FOREACH(const Uint found, nb_found)
+    BOOST_CHECK_EQUAL(found, 100u);
+
+  // A change made by the main thread invalidates the caches of all threads
+  b->rename("c");
+  nb_found.assign(pool.nb_threads(), 0);
+  pool.run(boost::bind(threaded_lookups, _1, boost::cref(*root), boost::cref(path), Handle<Component>(), boost::ref(nb_found)));
+  BOOST_FOREACH(const Uint found, nb_found)
+    BOOST_CHECK_EQUAL(found, 100u);
+  pool.set_nb_threads(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE_END()
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -12,11 +12,15 @@
 
 #include <iostream>
 
+#include "common/BasicExceptions.hpp"
 #include "common/Core.hpp"
 #include "common/OptionT.hpp"
 #include "common/OptionURI.hpp"
 #include "common/ConnectionManager.hpp"
 #include "common/EventHandler.hpp"
+#include "common/Group.hpp"
+#include "common/NotificationQueue.hpp"
+#include "common/StringConversion.hpp"
 #include "common/XML/SignalOptions.hpp"
 
 using namespace std;
@@ -162,6 +166,58 @@ struct DisplayIter : public ConnectionManager {
 
 };
 
+//------------------------------------------------------------------------------------------
+
+/// Counts the typed tree updates and remembers the last updated component
+
+struct TreeListener {
+
+  TreeListener() : triggered(0), throw_on_update(false)
+  {
+    connection = Core::instance().event_handler().connect_to_tree_updated( boost::bind(&TreeListener::on_tree_updated, this, _1) );
+  }
+
+  ~TreeListener()
+  {
+    connection.disconnect();
+  }
+
+  void on_tree_updated( Component& component )
+  {
+    last = component.uri();
+    ++triggered;
+    if(throw_on_update)
+      throw common::BadValue(FromHere(), "Listener failure");
+  }
+
+  Uint triggered;
+  URI last;
+  bool throw_on_update;
+  boost::signals2::connection connection;
+
+};
+
+//------------------------------------------------------------------------------------------
+
+/// Receives the notifications flushed by a NotificationQueue
+
+struct QueueListener {
+
+  QueueListener() : triggered(0) {}
+
+  void begin_notify() {}
+
+  void new_event( const std::string& name, SignalArgs& args )
+  {
+    last = URI(args.node.attribute_value("sender"));
+    ++triggered;
+  }
+
+  Uint triggered;
+  URI last;
+
+};
+
 //------------------------------------------------------------------------------------------
 // test fixtures
 
@@ -276,6 +332,108 @@ BOOST_FIXTURE_TEST_CASE( disconnect_from_event, local_fixture )
 
 #endif
 
+BOOST_AUTO_TEST_CASE( tree_updated )
+{
+  TreeListener listener;
+  Component& root = *Core::instance().root().create_component<Group>("tree_updated_root");
+  BOOST_CHECK ( listener.triggered == 1 );
+
+  Component& group = *root.create_component<Group>("group");
+  BOOST_CHECK ( listener.triggered == 2 );
+  BOOST_CHECK_EQUAL ( listener.last.string(), root.uri().string() );
+
+  // updates in the scope of a batch are notified once, for the scope
+  {
+    TreeUpdateBatch batch(root);
+    for( Uint i = 0; i != 10; ++i )
+      group.create_component<Group>("child" + to_str(i));
+    BOOST_CHECK ( listener.triggered == 2 );
+
+    // nested batches are notified by the outer one
+    {
+      TreeUpdateBatch inner(group);
+      group.create_component<Group>("nested");
+    }
+    BOOST_CHECK ( listener.triggered == 2 );
+
+    // updates outside the scope pass through
+    Core::instance().root().create_component<Group>("tree_updated_other");
+    BOOST_CHECK ( listener.triggered == 3 );
+  }
+  BOOST_CHECK ( listener.triggered == 4 );
+  BOOST_CHECK_EQUAL ( listener.last.string(), root.uri().string() );
+
+  // a batch without changes notifies nothing
+  {
+    TreeUpdateBatch batch(root);
+  }
+  BOOST_CHECK ( listener.triggered == 4 );
+
+  // commit notifies immediately, and only once
+  {
+    TreeUpdateBatch batch(root);
+    group.create_component<Group>("committed");
+    batch.commit();
+    BOOST_CHECK ( listener.triggered == 5 );
+  }
+  BOOST_CHECK ( listener.triggered == 5 );
+
+  // listener exceptions are passed on by commit, but not by the destructor
+  listener.throw_on_update = true;
+  {
+    TreeUpdateBatch batch(root);
+    group.create_component<Group>("commit_throws");
+    BOOST_CHECK_THROW ( batch.commit(), common::BadValue );
+  }
+  BOOST_CHECK ( listener.triggered == 6 );
+  {
+    TreeUpdateBatch batch(root);
+    group.create_component<Group>("destructor_throws");
+  }
+  BOOST_CHECK ( listener.triggered == 7 );
+  listener.throw_on_update = false;
+
+  // nothing is notified when the batch ends because of an exception
+  try
+  {
+    TreeUpdateBatch batch(root);
+    group.create_component<Group>("unwinding");
+    throw common::BadValue(FromHere(), "Bulk operation failure");
+  }
+  catch(common::BadValue&)
+  {
+  }
+  BOOST_CHECK ( listener.triggered == 7 );
+
+  // the batches were removed from the handler, so updates are notified directly again
+  group.create_component<Group>("after_batches");
+  BOOST_CHECK ( listener.triggered == 8 );
+  BOOST_CHECK_EQUAL ( listener.last.string(), group.uri().string() );
+
+  Core::instance().root().remove_component("tree_updated_other");
+  Core::instance().root().remove_component("tree_updated_root");
+}
+
+BOOST_AUTO_TEST_CASE( tree_updated_queue )
+{
+  // the queue forwards tree updates as frames, built from the typed signal.
+  // A second notifier is called as well, but does not make the queue listen twice
+  NotificationQueue queue;
+  QueueListener listener;
+  queue.add_notifier( "tree_updated", &QueueListener::new_event, &listener );
+  queue.add_notifier( "tree_updated", &QueueListener::new_event, &listener );
+
+  Component& root = *Core::instance().root().create_component<Group>("tree_updated_queue");
+  BOOST_CHECK_EQUAL ( queue.nb_notifications("tree_updated"), 1u );
+
+  queue.flush();
+  BOOST_CHECK_EQUAL ( queue.nb_notifications(), 0u );
+  BOOST_CHECK_EQUAL ( listener.triggered, 2u );
+  BOOST_CHECK_EQUAL ( listener.last.string(), Core::instance().root().uri().string() );
+
+  Core::instance().root().remove_component(root.name());
+}
+
 //------------------------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END()
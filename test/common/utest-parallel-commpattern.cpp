@@ -212,6 +212,71 @@ BOOST_AUTO_TEST_CASE( commpattern_mainstream )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( commpattern_split_phase )
+{
+  // general constants in this routine
+  const int nproc=PE::Comm::instance().size();
+  const int irank=PE::Comm::instance().rank();
+
+  // commpattern
+  boost::shared_ptr<CommPattern> pecp_ptr = allocate_component<CommPattern>("CommPattern");
+  CommPattern& pecp = *pecp_ptr;
+
+  // setup gid & rank
+  std::vector<Uint> gid;
+  std::vector<Uint> rank;
+  setupGidAndRank(gid,rank);
+  pecp.insert("gid",gid,1,false);
+
+  // additional arrays for testing
+  std::vector<int> v1;
+  for(int i=0;i<6*nproc;i++) v1.push_back(-((irank+1)*1000+i+1));
+  pecp.insert("v1",v1,1,true);
+  std::vector<double> v2;
+  for(int i=0;i<12*nproc;i++) v2.push_back((double)((irank+1)*1000+i+1));
+  pecp.insert("v2",v2,2,true);
+  const std::vector<int> v1_orig(v1);
+  const std::vector<double> v2_orig(v2);
+
+  pecp.setup(Handle<CommWrapper>(pecp.get_child("gid")),rank);
+
+  // both arrays in a single exchange, the second run reuses the persistent requests
+  for (int run=0; run<2; run++)
+  {
+    v1=v1_orig;
+    v2=v2_orig;
+    pecp.begin_synchronize_all();
+    BOOST_CHECK( pecp.is_synchronizing() );
+    BOOST_CHECK_THROW( pecp.begin_synchronize("v1"), ShouldNotBeHere );
+    pecp.end_synchronize();
+    BOOST_CHECK( !pecp.is_synchronizing() );
+
+    Uint idx=0;
+    Uint i;
+    for (i=0; i<  nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-0*nproc)/1)+1)*1000+idx+1)) );
+    for (   ; i<3*nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-1*nproc)/2)+1)*1000+idx+1)) );
+    for (   ; i<6*nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-3*nproc)/3)+1)*1000+idx+1)) );
+    idx=0;
+    for (i=0; i< 2*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-0*nproc)/2)+1)*1000+idx+1) );
+    for (   ; i< 6*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-2*nproc)/4)+1)*1000+idx+1) );
+    for (   ; i<12*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-6*nproc)/6)+1)*1000+idx+1) );
+  }
+
+  // one array at a time, with a different message size
+  v2=v2_orig;
+  pecp.begin_synchronize("v2");
+  pecp.end_synchronize();
+  Uint idx=0;
+  Uint i;
+  for (i=0; i< 2*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-0*nproc)/2)+1)*1000+idx+1) );
+  for (   ; i< 6*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-2*nproc)/4)+1)*1000+idx+1) );
+  for (   ; i<12*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-6*nproc)/6)+1)*1000+idx+1) );
+
+  BOOST_CHECK_THROW( pecp.end_synchronize(), ShouldNotBeHere );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( commpattern_external_synchronization )
 {
 /*
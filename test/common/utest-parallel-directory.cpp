@@ -0,0 +1,123 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::common::PE directory functions"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/directory.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( DirectorySuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK(PE::Comm::instance().is_active());
+}
+
+BOOST_AUTO_TEST_CASE( Lookup )
+{
+  const Uint rank = PE::Comm::instance().rank();
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint next = (rank + 1) % nb_procs;
+  const Uint nb_keys = 50;
+
+  // Keys owned by this rank, keys owned by the next rank and one key that nobody owns
+  std::vector<std::size_t> keys;
+  std::vector<bool> owned;
+  std::vector<Uint> values;
+  std::vector<Uint> ranks;
+  for(Uint k = 0; k != nb_keys; ++k)
+  {
+    keys.push_back(1000*rank + 7*k);
+    owned.push_back(true);
+    values.push_back(100*rank + k);
+    ranks.push_back(rank);
+  }
+  for(Uint k = 0; k != nb_keys; ++k)
+  {
+    keys.push_back(1000*next + 7*k);
+    owned.push_back(false);
+    values.push_back(0);
+    ranks.push_back(rank);
+  }
+  keys.push_back(1000*nb_procs + 3);
+  owned.push_back(false);
+  values.push_back(12345u);
+  ranks.push_back(rank);
+
+  BOOST_CHECK_EQUAL(PE::directory_lookup(keys, owned, values, ranks), 1u);
+
+  for(Uint k = 0; k != nb_keys; ++k)
+  {
+    BOOST_CHECK_EQUAL(values[k], 100*rank + k);
+    BOOST_CHECK_EQUAL(ranks[k], rank);
+    BOOST_CHECK_EQUAL(values[nb_keys + k], 100*next + k);
+    BOOST_CHECK_EQUAL(ranks[nb_keys + k], next);
+  }
+  BOOST_CHECK_EQUAL(values.back(), 12345u);
+  BOOST_CHECK_EQUAL(ranks.back(), rank);
+}
+
+BOOST_AUTO_TEST_CASE( Min )
+{
+  const Uint rank = PE::Comm::instance().rank();
+  const Uint nb_procs = PE::Comm::instance().size();
+
+  // Key 0 is shared by all ranks, key 1+rank only by this rank
+  std::vector<std::size_t> keys(2);
+  keys[0] = 0;
+  keys[1] = 1 + rank;
+  std::vector<Uint> values(2);
+  values[0] = 10 * ((rank + 1) % nb_procs);
+  values[1] = rank;
+  const std::vector<bool> ask(2, true);
+
+  std::vector<Uint> min_values, min_ranks;
+  PE::directory_min(keys, values, ask, true, min_values, min_ranks);
+  BOOST_CHECK_EQUAL(min_values[0], 0u);
+  BOOST_CHECK_EQUAL(min_ranks[0], nb_procs - 1);
+  BOOST_CHECK_EQUAL(min_values[1], rank);
+  BOOST_CHECK_EQUAL(min_ranks[1], rank);
+
+  // Without its own values, a rank finds nothing for the key it doesn't share
+  PE::directory_min(keys, values, ask, false, min_values, min_ranks);
+  const Uint expected_rank = rank == nb_procs - 1 ? 0 : nb_procs - 1;
+  BOOST_CHECK_EQUAL(min_ranks[0], expected_rank);
+  BOOST_CHECK_EQUAL(min_values[0], 10 * ((expected_rank + 1) % nb_procs));
+  BOOST_CHECK_EQUAL(min_ranks[1], std::numeric_limits<Uint>::max());
+}
+
+BOOST_AUTO_TEST_CASE( DirectoryRank )
+{
+  // All ranks must get a share of consecutive keys
+  const Uint nb_procs = 7;
+  std::vector<Uint> counts(nb_procs, 0);
+  for(Uint key = 0; key != 7000; ++key)
+    ++counts[PE::directory_rank(key, nb_procs)];
+  for(Uint i = 0; i != nb_procs; ++i)
+    BOOST_CHECK_GT(counts[i], 800u);
+}
+
+BOOST_AUTO_TEST_CASE( Finalize )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
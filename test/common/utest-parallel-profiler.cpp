@@ -0,0 +1,156 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::common::Profiler"
+
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Profiler.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "common/PE/Comm.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Find the entry with the given path, separated by slashes
+const ProfileEntry* find_entry(const std::vector<ProfileEntry>& entries, const std::string& path)
+{
+  for(std::vector<ProfileEntry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+  {
+    std::string entry_path;
+    for(Uint i = 0; i != entry->path.size(); ++i)
+      entry_path += (i == 0 ? "" : "/") + entry->path[i];
+    if(entry_path == path)
+      return &(*entry);
+  }
+  return 0;
+}
+
+/// Rank r calls the inner scope r+1 times
+void nested_scopes()
+{
+  ScopedTimer outer("outer");
+  for(Uint i = 0; i <= PE::Comm::instance().rank(); ++i)
+  {
+    ScopedTimer inner("inner");
+  }
+}
+
+void threaded_scope(const Uint)
+{
+  ScopedTimer timer("threaded");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( ProfilerSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK(PE::Comm::instance().is_active());
+}
+
+BOOST_AUTO_TEST_CASE( Disabled )
+{
+  BOOST_CHECK(!Profiler::instance().enabled());
+  nested_scopes();
+  BOOST_CHECK(Profiler::instance().collect().empty());
+}
+
+BOOST_AUTO_TEST_CASE( CallTree )
+{
+  const Uint nb_procs = PE::Comm::instance().size();
+
+  Profiler::instance().set_enabled(true);
+  nested_scopes();
+  nested_scopes();
+  Profiler::instance().set_enabled(false);
+
+  const std::vector<ProfileEntry> entries = Profiler::instance().collect();
+  BOOST_REQUIRE_EQUAL(entries.size(), 2u);
+
+  // Parents come before their children
+  BOOST_CHECK_EQUAL(entries[0].path.size(), 1u);
+  const ProfileEntry* outer = find_entry(entries, "outer");
+  const ProfileEntry* inner = find_entry(entries, "outer/inner");
+  BOOST_REQUIRE(outer != 0);
+  BOOST_REQUIRE(inner != 0);
+
+  BOOST_CHECK_EQUAL(outer->nb_ranks, nb_procs);
+  BOOST_CHECK_EQUAL(outer->min_calls, 2u);
+  BOOST_CHECK_EQUAL(outer->max_calls, 2u);
+  BOOST_CHECK_EQUAL(inner->min_calls, 2u);
+  BOOST_CHECK_EQUAL(inner->max_calls, 2u*nb_procs);
+
+  BOOST_CHECK_LE(outer->min_time, outer->avg_time);
+  BOOST_CHECK_LE(outer->avg_time, outer->max_time);
+  BOOST_CHECK_LE(inner->max_time, outer->max_time);
+  BOOST_CHECK_LE(outer->fastest_call, outer->slowest_call);
+
+  std::stringstream report;
+  Profiler::instance().print_report(report);
+  if(PE::Comm::instance().rank() == 0)
+    BOOST_CHECK(report.str().find("    inner: time:") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( Threads )
+{
+  ThreadPool::instance().set_nb_threads(3);
+  Profiler::instance().set_enabled(true);
+  Profiler::instance().reset();
+  ThreadPool::instance().run(boost::bind(threaded_scope, _1));
+  Profiler::instance().set_enabled(false);
+  ThreadPool::instance().set_nb_threads(1);
+
+  // Reset keeps the tree, but scopes without calls are not reported
+  const std::vector<ProfileEntry> entries = Profiler::instance().collect();
+  BOOST_CHECK(find_entry(entries, "outer") == 0);
+  const ProfileEntry* threaded = find_entry(entries, "threaded");
+  BOOST_REQUIRE(threaded != 0);
+  BOOST_CHECK_EQUAL(threaded->min_calls, 3u);
+  BOOST_CHECK_EQUAL(threaded->max_calls, 3u);
+}
+
+BOOST_AUTO_TEST_CASE( ResetRunningTimer )
+{
+  Profiler::instance().set_enabled(true);
+  {
+    ScopedTimer running("running");
+    Profiler::instance().reset();
+    ScopedTimer after_reset("after_reset");
+  }
+  Profiler::instance().set_enabled(false);
+
+  // The timer that was running during the reset is dropped, and no longer is the parent of new timers
+  const std::vector<ProfileEntry> entries = Profiler::instance().collect();
+  BOOST_CHECK(find_entry(entries, "running") == 0);
+  BOOST_CHECK(find_entry(entries, "running/after_reset") == 0);
+  const ProfileEntry* after_reset = find_entry(entries, "after_reset");
+  BOOST_REQUIRE(after_reset != 0);
+  BOOST_CHECK_EQUAL(after_reset->min_calls, 1u);
+}
+
+BOOST_AUTO_TEST_CASE( Finalize )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,134 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::common::ThreadPool"
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/ThreadPool.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Each thread sums its part of the range
+struct PartialSums
+{
+  PartialSums(const Uint size, std::vector<Uint>& sums) : m_size(size), m_sums(sums) {}
+
+  void operator()(const Uint thread_idx) const
+  {
+    Uint begin, end;
+    split_range(m_size, m_sums.size(), thread_idx, begin, end);
+    for(Uint i = begin; i != end; ++i)
+      m_sums[thread_idx] += i;
+  }
+
+  const Uint m_size;
+  std::vector<Uint>& m_sums;
+};
+
+/// Throws on the last thread
+void throwing_task(const Uint thread_idx, const Uint nb_threads)
+{
+  if(thread_idx == nb_threads - 1)
+    throw BadValue(FromHere(), "test error");
+}
+
+/// Runs a nested task
+void nested_task(const Uint thread_idx, std::vector<Uint>& counts)
+{
+  BOOST_CHECK(ThreadPool::instance().in_parallel_region());
+  std::vector<Uint> sums(ThreadPool::instance().nb_threads(), 0);
+  ThreadPool::instance().run(PartialSums(10, sums));
+  for(Uint i = 0; i != sums.size(); ++i)
+    counts[thread_idx] += sums[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( ThreadPoolSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( SplitRange )
+{
+  Uint begin, end;
+  Uint covered = 0;
+  for(Uint part = 0; part != 3; ++part)
+  {
+    split_range(10, 3, part, begin, end);
+    BOOST_CHECK_EQUAL(begin, covered);
+    BOOST_CHECK(end - begin == 3 || end - begin == 4);
+    covered = end;
+  }
+  BOOST_CHECK_EQUAL(covered, 10u);
+
+  split_range(2, 4, 3, begin, end);
+  BOOST_CHECK_EQUAL(begin, end);
+}
+
+BOOST_AUTO_TEST_CASE( Run )
+{
+  ThreadPool& pool = ThreadPool::instance();
+  BOOST_CHECK_EQUAL(pool.nb_threads(), 1u);
+
+  for(Uint nb_threads = 1; nb_threads != 5; ++nb_threads)
+  {
+    pool.set_nb_threads(nb_threads);
+    BOOST_CHECK_EQUAL(pool.nb_threads(), nb_threads);
+
+    // Run several times, to check the workers are reused properly
+    for(Uint run = 0; run != 10; ++run)
+    {
+      std::vector<Uint> sums(nb_threads, 0);
+      pool.run(PartialSums(1000, sums));
+      Uint total = 0;
+      for(Uint i = 0; i != nb_threads; ++i)
+        total += sums[i];
+      BOOST_CHECK_EQUAL(total, 499500u);
+    }
+  }
+
+  BOOST_CHECK(!pool.in_parallel_region());
+}
+
+BOOST_AUTO_TEST_CASE( Nested )
+{
+  ThreadPool& pool = ThreadPool::instance();
+  pool.set_nb_threads(3);
+
+  std::vector<Uint> counts(3, 0);
+  pool.run(boost::bind(nested_task, _1, boost::ref(counts)));
+  for(Uint i = 0; i != 3; ++i)
+    BOOST_CHECK_EQUAL(counts[i], 45u);
+}
+
+BOOST_AUTO_TEST_CASE( Exceptions )
+{
+  ThreadPool& pool = ThreadPool::instance();
+  pool.set_nb_threads(4);
+  BOOST_CHECK_THROW(pool.run(boost::bind(throwing_task, _1, 4u)), ParallelError);
+
+  // The pool must still be usable after an error
+  std::vector<Uint> sums(4, 0);
+  pool.run(PartialSums(10, sums));
+  BOOST_CHECK_EQUAL(sums[0] + sums[1] + sums[2] + sums[3], 45u);
+
+  BOOST_CHECK_THROW(pool.set_nb_threads(0), BadValue);
+
+  pool.set_nb_threads(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -10,6 +10,7 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <fstream>
 
 #include <boost/test/unit_test.hpp>
@@ -18,11 +19,13 @@
 
 #include "common/Log.hpp"
 #include "math/LSS/System.hpp"
+#include "math/LSS/Trilinos/TrilinosCrsMatrix.hpp"
 #include "math/VariablesDescriptor.hpp"
 
 /// @todo remove when finished debugging
 #include "common/PE/debug.hpp"
 #include "common/Environment.hpp"
+#include "common/ThreadPool.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -34,6 +37,42 @@ using namespace cf3::math::LSS;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Each thread repeatedly adds ones to the diagonal blocks of its part of the given nodes
+struct ConcurrentDiagonalAssembly
+{
+  ConcurrentDiagonalAssembly(LSS::System& sys, const std::vector<Uint>& nodes, const Uint neq, const Uint nb_repeats) :
+    m_sys(sys),
+    m_nodes(nodes),
+    m_neq(neq),
+    m_nb_repeats(nb_repeats)
+  {
+  }
+
+  void operator()(const Uint thread_idx) const
+  {
+    Uint begin, end;
+    common::split_range(m_nodes.size(), common::ThreadPool::instance().nb_threads(), thread_idx, begin, end);
+    LSS::BlockAccumulator ba;
+    ba.resize(1, m_neq);
+    ba.reset(1.);
+    for(Uint repeat = 0; repeat != m_nb_repeats; ++repeat)
+    {
+      for(Uint i = begin; i != end; ++i)
+      {
+        ba.indices[0] = m_nodes[i];
+        m_sys.add_values(ba);
+      }
+    }
+  }
+
+  LSS::System& m_sys;
+  const std::vector<Uint>& m_nodes;
+  const Uint m_neq;
+  const Uint m_nb_repeats;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct LSSAtomicFixture
 {
   /// common setup for each test case
@@ -1065,6 +1104,103 @@ BOOST_AUTO_TEST_CASE( solve_system_blocked )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( concurrent_assembly )
+{
+  boost::shared_ptr<common::PE::CommPattern> cp_ptr = common::allocate_component<common::PE::CommPattern>("commpattern");
+  common::PE::CommPattern& cp = *cp_ptr;
+  build_commpattern(cp);
+  boost::shared_ptr<LSS::System> sys(common::allocate_component<LSS::System>("sys"));
+  sys->options().option("matrix_builder").change_value(matrix_builder);
+  build_system(*sys,cp);
+  sys->reset();
+
+  // owned nodes that have a diagonal entry, each node is touched by only one thread
+  std::vector<Uint> nodes;
+  for (Uint i=0; i<(const Uint)rank_updatable.size(); i++)
+    if (rank_updatable[i] && std::count(node_connectivity.begin()+starting_indices[i],node_connectivity.begin()+starting_indices[i+1],i))
+      nodes.push_back(i);
+
+  const Uint nb_repeats = 100;
+  common::ThreadPool::instance().set_nb_threads(4);
+  common::ThreadPool::instance().run(ConcurrentDiagonalAssembly(*sys, nodes, neq, nb_repeats));
+  common::ThreadPool::instance().set_nb_threads(1);
+
+  LSS::BlockAccumulator ba;
+  ba.resize(1,neq);
+  BOOST_FOREACH(const Uint node, nodes)
+  {
+    ba.indices[0]=node;
+    sys->get_values(ba);
+    for (int i=0; i<neq; i++)
+    {
+      BOOST_CHECK_EQUAL(ba.rhs[i],static_cast<Real>(nb_repeats));
+      for (int j=0; j<neq; j++)
+        BOOST_CHECK_EQUAL(ba.mat(i,j),static_cast<Real>(nb_repeats));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( shared_structure )
+{
+  boost::shared_ptr<common::PE::CommPattern> cp_ptr = common::allocate_component<common::PE::CommPattern>("commpattern");
+  common::PE::CommPattern& cp = *cp_ptr;
+  build_commpattern(cp);
+
+  // Two systems with the same structure, which may share the graph but not the values
+  boost::shared_ptr<LSS::System> sys1(common::allocate_component<LSS::System>("sys1"));
+  sys1->options().option("matrix_builder").change_value(matrix_builder);
+  build_system(*sys1,cp);
+  boost::shared_ptr<LSS::System> sys2(common::allocate_component<LSS::System>("sys2"));
+  sys2->options().option("matrix_builder").change_value(matrix_builder);
+  sys2->create(cp,neq,node_connectivity,starting_indices);
+  sys1->reset(1.);
+  sys2->reset(2.);
+
+  BOOST_CHECK_EQUAL(sys1->matrix()->blockrow_size(), sys2->matrix()->blockrow_size());
+  BOOST_CHECK_EQUAL(sys1->matrix()->blockcol_size(), sys2->matrix()->blockcol_size());
+
+  // The CRS matrices share the structure through the cache, a system with other equations gets its own
+  Handle<LSS::TrilinosCrsMatrix> crs1(sys1->matrix());
+  Handle<LSS::TrilinosCrsMatrix> crs2(sys2->matrix());
+  if(matrix_builder == "cf3.math.LSS.TrilinosCrsMatrix")
+  {
+    BOOST_REQUIRE(is_not_null(crs1));
+    BOOST_REQUIRE(is_not_null(crs2));
+    BOOST_CHECK_EQUAL(&crs1->graph_structure(), &crs2->graph_structure());
+    BOOST_CHECK_EQUAL(crs1->graph_structure().graph.get(), crs2->graph_structure().graph.get());
+
+    boost::shared_ptr<LSS::System> sys3(common::allocate_component<LSS::System>("sys3"));
+    sys3->options().option("matrix_builder").change_value(matrix_builder);
+    sys3->create(cp,neq+1,node_connectivity,starting_indices);
+    Handle<LSS::TrilinosCrsMatrix> crs3(sys3->matrix());
+    BOOST_REQUIRE(is_not_null(crs3));
+    BOOST_CHECK(&crs3->graph_structure() != &crs1->graph_structure());
+  }
+
+  for (Uint i=0; i<(const Uint)rank_updatable.size(); i++)
+  {
+    if (rank_updatable[i] && std::count(node_connectivity.begin()+starting_indices[i],node_connectivity.begin()+starting_indices[i+1],i))
+    {
+      sys1->matrix()->add_value(i*neq,i*neq,3.);
+      Real val1, val2;
+      sys1->matrix()->get_value(i*neq,i*neq,val1);
+      sys2->matrix()->get_value(i*neq,i*neq,val2);
+      BOOST_CHECK_EQUAL(val1, 4.);
+      BOOST_CHECK_EQUAL(val2, 2.);
+    }
+  }
+
+  // Recreating a system after the other one is gone must still work
+  sys1.reset();
+  sys2->destroy();
+  sys2->create(cp,neq,node_connectivity,starting_indices);
+  BOOST_CHECK(sys2->is_created());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( finalize_mpi )
 {
   CFinfo.setFilterRankZero(true);
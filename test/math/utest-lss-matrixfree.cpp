@@ -0,0 +1,320 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::math::LSS::MatrixFreeMatrix"
+
+#include <cmath>
+
+#include <boost/assign/std/vector.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/Action.hpp"
+#include "common/BasicExceptions.hpp"
+#include "common/Core.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/PE/CommWrapper.hpp"
+
+#include "math/LSS/MatrixFreeMatrix.hpp"
+#include "math/LSS/System.hpp"
+#include "math/LSS/EmptyLSS/EmptyLSSVector.hpp"
+#include "math/LSS/Native/NativeMatrix.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+#include "coolfluid-packages.hpp"
+
+using namespace boost::assign;
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::PE;
+using namespace cf3::math;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Concrete matrix-free matrix, without a solver library
+class TestMatrixFree : public LSS::MatrixFreeMatrix
+{
+public:
+  TestMatrixFree(const std::string& name) : LSS::MatrixFreeMatrix(name) {}
+  static std::string type_name() { return "TestMatrixFree"; }
+  const std::string solvertype() { return "EmptyLSS"; }
+};
+
+/// Assembles the 1D Laplacian on a chain of nodes, with two equations per node, into a stored or matrix-free matrix
+class ChainAssembly : public common::Action
+{
+public:
+  ChainAssembly(const std::string& name) : common::Action(name), nb_executions(0) {}
+  static std::string type_name() { return "ChainAssembly"; }
+
+  void execute()
+  {
+    ++nb_executions;
+    LSS::BlockAccumulator block;
+    block.resize(2, 2);
+    const Uint nb_nodes = matrix->blockrow_size();
+    for(Uint i = 0; i != nb_nodes-1; ++i)
+    {
+      block.reset();
+      block.indices[0] = i;
+      block.indices[1] = i+1;
+      for(Uint eq = 0; eq != 2; ++eq)
+      {
+        // The second equation is scaled by 2
+        const Real scale = eq+1.;
+        block.mat(eq, eq) = scale;
+        block.mat(2+eq, 2+eq) = scale;
+        block.mat(eq, 2+eq) = -scale;
+        block.mat(2+eq, eq) = -scale;
+      }
+      matrix->add_values(block);
+    }
+  }
+
+  Handle<LSS::Matrix> matrix;
+  Uint nb_executions;
+};
+
+/// Assemble the chain into the matrix and set a RHS, with an extra diagonal, a symmetric Dirichlet condition
+/// on the first equation of node 0 and a plain one on the second equation of node 4
+void setup_system(LSS::Matrix& matrix, LSS::Vector& rhs, ChainAssembly& assembly)
+{
+  assembly.matrix = matrix.handle<LSS::Matrix>();
+  matrix.reset();
+  rhs.reset();
+  assembly.execute();
+  matrix.add_diagonal(std::vector<Real>(10, 0.5));
+  for(Uint i = 0; i != 5; ++i)
+  {
+    rhs.set_value(i, 0, Real(i));
+    rhs.set_value(i, 1, 1.-i);
+  }
+  matrix.symmetric_dirichlet(0, 0, 3., rhs);
+  matrix.set_row(4, 1, 1., 0.);
+  rhs.set_value(4, 1, -2.);
+}
+
+struct MatrixFreeFixture
+{
+  MatrixFreeFixture()
+  {
+    Component& root = Core::instance().root();
+    if(is_null(root.get_child("commpattern")))
+    {
+      CommPattern& cp = *root.create_component<CommPattern>("commpattern");
+      std::vector<Uint> gid, rnk;
+      gid += 0,1,2,3,4;
+      rnk += 0,0,0,0,0;
+      cp.insert("gid",gid,1,false);
+      cp.setup(Handle<CommWrapper>(cp.get_child("gid")),rnk);
+    }
+    cp = Handle<CommPattern>(root.get_child("commpattern"));
+
+    conn += 0,1, 0,1,2, 1,2,3, 2,3,4, 3,4;
+    startidx += 0,2,5,8,11,13;
+
+    matrix = allocate_component<TestMatrixFree>("Matrix");
+    solution = allocate_component<LSS::EmptyLSSVector>("Solution");
+    rhs = allocate_component<LSS::EmptyLSSVector>("RHS");
+    assembly = allocate_component<ChainAssembly>("Assembly");
+
+    solution->create(*cp, 2);
+    rhs->create(*cp, 2);
+    matrix->create(*cp, 2, conn, startidx, *solution, *rhs);
+    assembly->matrix = matrix->handle<LSS::Matrix>();
+    matrix->options().set("operator_action", assembly->handle<common::Action>());
+  }
+
+  Handle<CommPattern> cp;
+  std::vector<Uint> conn, startidx;
+  boost::shared_ptr<TestMatrixFree> matrix;
+  boost::shared_ptr<LSS::EmptyLSSVector> solution;
+  boost::shared_ptr<LSS::EmptyLSSVector> rhs;
+  boost::shared_ptr<ChainAssembly> assembly;
+};
+
+BOOST_AUTO_TEST_SUITE( MatrixFreeSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( InitMPI )
+{
+  Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+BOOST_FIXTURE_TEST_CASE( Apply, MatrixFreeFixture )
+{
+  BOOST_CHECK_EQUAL(matrix->blockrow_size(), 5u);
+  BOOST_CHECK_EQUAL(matrix->neq(), 2u);
+
+  // Assembling doesn't store anything
+  assembly->execute();
+  BOOST_CHECK_EQUAL(matrix->mode(), LSS::MatrixFreeMatrix::ASSEMBLE);
+
+  std::vector<Real> x(10), y;
+  for(Uint i = 0; i != 5; ++i)
+  {
+    x[2*i] = i*i;
+    x[2*i+1] = i;
+  }
+  matrix->apply(x, y);
+  BOOST_CHECK_EQUAL(assembly->nb_executions, 2u);
+  BOOST_CHECK_EQUAL(matrix->mode(), LSS::MatrixFreeMatrix::ASSEMBLE);
+
+  // -d2/dx2 of i^2 is -2 in the interior, the linear function only has a boundary contribution
+  BOOST_CHECK_CLOSE(y[0], -1., 1e-12);
+  BOOST_CHECK_CLOSE(y[1], -2., 1e-12);
+  for(Uint i = 1; i != 4; ++i)
+  {
+    BOOST_CHECK_CLOSE(y[2*i], -2., 1e-12);
+    BOOST_CHECK_SMALL(y[2*i+1], 1e-12);
+  }
+  BOOST_CHECK_CLOSE(y[8], 7., 1e-12);
+  BOOST_CHECK_CLOSE(y[9], 2., 1e-12);
+
+  std::vector<Real> diag;
+  matrix->get_diagonal(diag);
+  BOOST_CHECK_EQUAL(diag.size(), 10u);
+  BOOST_CHECK_EQUAL(diag[0], 1.);
+  BOOST_CHECK_EQUAL(diag[1], 2.);
+  BOOST_CHECK_EQUAL(diag[4], 2.);
+  BOOST_CHECK_EQUAL(diag[5], 4.);
+}
+
+BOOST_FIXTURE_TEST_CASE( BoundaryConditions, MatrixFreeFixture )
+{
+  std::vector<Real> extra_diag(10, 0.5);
+  matrix->add_diagonal(extra_diag);
+
+  // Symmetric condition for the first equation on node 0, and a plain one for the second equation on node 4
+  matrix->symmetric_dirichlet(0, 0, 3., *rhs);
+  matrix->set_row(4, 1, 1., 0.);
+
+  std::vector<Real> x(10, 1.), y;
+  matrix->apply(x, y);
+
+  BOOST_CHECK_EQUAL(y[0], 1.);
+  // Column 0 is eliminated, so row 2 only sees the diagonal and node 2
+  BOOST_CHECK_CLOSE(y[2], 1.5, 1e-12);
+  BOOST_CHECK_CLOSE(y[3], 0.5, 1e-12);
+  BOOST_CHECK_EQUAL(y[9], 1.);
+  // The column of a plain condition stays
+  BOOST_CHECK_CLOSE(y[7], 0.5, 1e-12);
+
+  std::vector<Real> diag;
+  matrix->get_diagonal(diag);
+  BOOST_CHECK_EQUAL(diag[0], 1.);
+  BOOST_CHECK_CLOSE(diag[1], 2.5, 1e-12);
+  BOOST_CHECK_CLOSE(diag[2], 2.5, 1e-12);
+  BOOST_CHECK_EQUAL(diag[9], 1.);
+
+  // Reset removes the conditions and the extra diagonal
+  matrix->reset();
+  matrix->apply(x, y);
+  for(Uint i = 0; i != 10; ++i)
+    BOOST_CHECK_SMALL(y[i], 1e-12);
+}
+
+BOOST_FIXTURE_TEST_CASE( CompareAssembled, MatrixFreeFixture )
+{
+  // Reference: the same system stored by the native backend
+  boost::shared_ptr<LSS::System> native = allocate_component<LSS::System>("native");
+  native->options().set("matrix_builder", std::string("cf3.math.LSS.NativeMatrix"));
+  native->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+  native->create(*cp, 2, conn, startidx);
+  boost::shared_ptr<ChainAssembly> native_assembly = allocate_component<ChainAssembly>("NativeAssembly");
+  setup_system(*native->matrix(), *native->rhs(), *native_assembly);
+
+  // Vectors that store their values, so the columns moved to the RHS can be checked
+  boost::shared_ptr<LSS::NativeVector> native_solution = allocate_component<LSS::NativeVector>("NativeSolution");
+  boost::shared_ptr<LSS::NativeVector> native_rhs = allocate_component<LSS::NativeVector>("NativeRHS");
+  native_solution->create(*cp, 2);
+  native_rhs->create(*cp, 2);
+  matrix->create(*cp, 2, conn, startidx, *native_solution, *native_rhs);
+  setup_system(*matrix, *native_rhs, *assembly);
+
+  // The column of the symmetric condition is only moved to the RHS before solving, and only once
+  matrix->prepare_solve(*native_solution, *native_rhs);
+  matrix->prepare_solve(*native_solution, *native_rhs);
+  const std::vector<Real>& reference_rhs = Handle<LSS::NativeVector>(native->rhs())->data();
+  for(Uint i = 0; i != 10; ++i)
+    BOOST_CHECK_SMALL(native_rhs->data()[i] - reference_rhs[i], 1e-12);
+
+  std::vector<Real> x(10), y, y_reference;
+  for(Uint i = 0; i != 10; ++i)
+    x[i] = std::sin(i+1.);
+  matrix->apply(x, y);
+  Handle<LSS::NativeMatrix>(native->matrix())->multiply(x, y_reference);
+  for(Uint i = 0; i != 10; ++i)
+    BOOST_CHECK_SMALL(y[i] - y_reference[i], 1e-12);
+
+  // The solution of the stored system solves the matrix-free one
+  native->solution_strategy()->options().set("tolerance", 1e-12);
+  native->solve();
+  matrix->apply(Handle<LSS::NativeVector>(native->solution())->data(), y);
+  for(Uint i = 0; i != 10; ++i)
+    BOOST_CHECK_SMALL(y[i] - native_rhs->data()[i], 1e-9);
+}
+
+#ifdef CF3_HAVE_TRILINOS
+BOOST_FIXTURE_TEST_CASE( TrilinosSolve, MatrixFreeFixture )
+{
+  const std::string builders[] = { "cf3.math.LSS.TrilinosCrsMatrix", "cf3.math.LSS.TrilinosMatrixFree" };
+  std::vector< std::vector<Real> > solutions(2, std::vector<Real>(10));
+  for(Uint b = 0; b != 2; ++b)
+  {
+    boost::shared_ptr<LSS::System> sys = allocate_component<LSS::System>("sys");
+    sys->options().set("matrix_builder", builders[b]);
+    sys->create(*cp, 2, conn, startidx);
+    Handle<LSS::MatrixFreeMatrix> matrix_free(sys->matrix());
+    if(is_not_null(matrix_free))
+      matrix_free->options().set("operator_action", assembly->handle<common::Action>());
+
+    setup_system(*sys->matrix(), *sys->rhs(), *assembly);
+    sys->solve();
+    for(Uint i = 0; i != 5; ++i)
+    {
+      for(Uint eq = 0; eq != 2; ++eq)
+        sys->solution()->get_value(i, eq, solutions[b][2*i+eq]);
+    }
+  }
+
+  BOOST_CHECK_CLOSE(solutions[1][0], 3., 1e-6);
+  BOOST_CHECK_CLOSE(solutions[1][9], -2., 1e-6);
+  for(Uint i = 0; i != 10; ++i)
+    BOOST_CHECK_SMALL(solutions[1][i] - solutions[0][i], 1e-7);
+}
+#endif
+
+BOOST_FIXTURE_TEST_CASE( Unsupported, MatrixFreeFixture )
+{
+  LSS::BlockAccumulator block;
+  block.resize(2, 2);
+  block.indices[0] = 0;
+  block.indices[1] = 1;
+  BOOST_CHECK_THROW(matrix->set_values(block), common::NotSupported);
+  BOOST_CHECK_THROW(matrix->set_row(0, 0, 1., 1.), common::NotSupported);
+  BOOST_CHECK_THROW(matrix->reset(1.), common::NotSupported);
+
+  matrix->options().set("operator_action", Handle<common::Action>());
+  std::vector<Real> x(10, 1.), y;
+  BOOST_CHECK_THROW(matrix->apply(x, y), common::SetupError);
+}
+
+BOOST_AUTO_TEST_CASE( FinalizeMPI )
+{
+  Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,274 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for the native LSS backend with ghost nodes"
+
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/OptionList.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/PE/CommWrapper.hpp"
+
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/System.hpp"
+#include "math/LSS/Native/NativeMatrix.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::PE;
+using namespace cf3::math;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// The chain of utest-lss-native, split in contiguous parts. Each rank stores its owned nodes and the neighbouring
+/// node of each adjacent part as ghost, in global order, so the local index is the global index minus an offset.
+struct DistributedFixture
+{
+  DistributedFixture() : nb_nodes(30), coupling(0.3)
+  {
+    Comm& comm = Comm::instance();
+    const Uint rank = comm.rank();
+    split_range(nb_nodes, comm.size(), rank, owned_begin, owned_end);
+    first_node = owned_begin == 0 ? 0 : owned_begin-1;
+    nb_local_nodes = (owned_end == nb_nodes ? owned_end : owned_end+1) - first_node;
+
+    Component& root = Core::instance().root();
+    if(is_null(root.get_child("commpattern")))
+    {
+      CommPattern& cp = *root.create_component<CommPattern>("commpattern");
+      std::vector<Uint> gid, rnk;
+      for(Uint i = 0; i != nb_local_nodes; ++i)
+      {
+        const Uint node = first_node + i;
+        gid.push_back(node);
+        rnk.push_back(node < owned_begin ? rank-1 : (node >= owned_end ? rank+1 : rank));
+      }
+      cp.insert("gid",gid,1,false);
+      cp.setup(Handle<CommWrapper>(cp.get_child("gid")),rnk);
+    }
+    cp = Handle<CommPattern>(root.get_child("commpattern"));
+
+    // Ghost rows also list their local neighbours, for symmetric_dirichlet
+    std::vector<Uint> conn, startidx;
+    startidx.push_back(0);
+    for(Uint i = 0; i != nb_local_nodes; ++i)
+    {
+      conn.push_back(i);
+      if(i != 0)
+        conn.push_back(i-1);
+      if(i != nb_local_nodes-1)
+        conn.push_back(i+1);
+      startidx.push_back(conn.size());
+    }
+
+    if(is_not_null(root.get_child("lss")))
+      root.remove_component("lss");
+    lss = root.create_component<LSS::System>("lss");
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeMatrix"));
+    lss->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+    lss->create(*cp, 2, conn, startidx);
+
+    matrix = Handle<LSS::NativeMatrix>(lss->matrix());
+    rhs = Handle<LSS::NativeVector>(lss->rhs());
+    solution = Handle<LSS::NativeVector>(lss->solution());
+    strategy = Handle<LSS::NativeStrategy>(lss->solution_strategy());
+  }
+
+  /// Element matrix entry, as in utest-lss-native
+  Real element_value(const Uint a, const Uint b) const
+  {
+    return a == b ? a+1. : coupling;
+  }
+
+  /// Add the local edges. The contributions to the ghost rows are dropped by the matrix.
+  void assemble()
+  {
+    LSS::BlockAccumulator block;
+    block.resize(2, 2);
+    for(Uint i = 0; i != nb_local_nodes-1; ++i)
+    {
+      block.reset();
+      block.indices[0] = i;
+      block.indices[1] = i+1;
+      for(Uint a = 0; a != 2; ++a)
+      {
+        for(Uint b = 0; b != 2; ++b)
+        {
+          block.mat(a, b) = element_value(a, b);
+          block.mat(2+a, 2+b) = element_value(a, b);
+          block.mat(a, 2+b) = -element_value(a, b);
+          block.mat(2+a, b) = -element_value(a, b);
+        }
+      }
+      matrix->add_values(block);
+    }
+    matrix->add_diagonal(std::vector<Real>(2*nb_local_nodes, 0.1));
+  }
+
+  /// Value of the known solution for a global node
+  Real exact(const Uint node, const Uint eq) const
+  {
+    return eq == 0 ? std::sin(Real(node)) : std::cos(0.5*node);
+  }
+
+  /// Product of the global matrix and the known solution, computed on the whole chain
+  Real exact_product(const Uint node, const Uint a) const
+  {
+    Real result = 0.1*exact(node, a);
+    for(Uint b = 0; b != 2; ++b)
+    {
+      if(node != 0)
+        result += element_value(a, b)*(exact(node, b) - exact(node-1, b));
+      if(node != nb_nodes-1)
+        result += element_value(a, b)*(exact(node, b) - exact(node+1, b));
+    }
+    return result;
+  }
+
+  /// Local vector with the known solution on the owned nodes and garbage on the ghosts
+  void exact_vector(std::vector<Real>& x) const
+  {
+    x.resize(2*nb_local_nodes);
+    for(Uint i = 0; i != nb_local_nodes; ++i)
+    {
+      const Uint node = first_node + i;
+      const bool owned = node >= owned_begin && node < owned_end;
+      for(Uint eq = 0; eq != 2; ++eq)
+        x[2*i+eq] = owned ? exact(node, eq) : 1e6;
+    }
+  }
+
+  bool is_owned(const Uint i) const
+  {
+    return first_node + i >= owned_begin && first_node + i < owned_end;
+  }
+
+  const Uint nb_nodes;
+  const Real coupling;
+  Uint owned_begin, owned_end;
+  Uint first_node;
+  Uint nb_local_nodes;
+  Handle<CommPattern> cp;
+  Handle<LSS::System> lss;
+  Handle<LSS::NativeMatrix> matrix;
+  Handle<LSS::NativeVector> rhs;
+  Handle<LSS::NativeVector> solution;
+  Handle<LSS::NativeStrategy> strategy;
+};
+
+BOOST_AUTO_TEST_SUITE( NativeMPISuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( InitMPI )
+{
+  Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK(Comm::instance().size() > 1);
+}
+
+BOOST_FIXTURE_TEST_CASE( Product, DistributedFixture )
+{
+  BOOST_CHECK(nb_local_nodes > owned_end - owned_begin);
+  assemble();
+
+  // The ghost entries of x are garbage, the halo exchange has to replace them
+  std::vector<Real> x, y;
+  exact_vector(x);
+  matrix->multiply(x, y);
+  for(Uint i = 0; i != nb_local_nodes; ++i)
+  {
+    if(!is_owned(i))
+      continue;
+    for(Uint eq = 0; eq != 2; ++eq)
+      BOOST_CHECK_SMALL(y[2*i+eq] - exact_product(first_node+i, eq), 1e-12);
+  }
+
+  // The dot product sums the owned entries of all ranks only
+  Real global_dot = 0.;
+  for(Uint node = 0; node != nb_nodes; ++node)
+    global_dot += exact(node, 0)*exact(node, 0) + exact(node, 1)*exact(node, 1);
+  BOOST_CHECK_CLOSE(matrix->dot(x, x), global_dot, 1e-10);
+
+  ThreadPool::instance().set_nb_threads(3);
+  std::vector<Real> y_threaded;
+  matrix->multiply(x, y_threaded);
+  const Real dot_threaded = matrix->dot(x, x);
+  ThreadPool::instance().set_nb_threads(1);
+  for(Uint i = 0; i != nb_local_nodes; ++i)
+  {
+    if(is_owned(i))
+      BOOST_CHECK_EQUAL(y[2*i], y_threaded[2*i]);
+  }
+  BOOST_CHECK_CLOSE(dot_threaded, global_dot, 1e-10);
+}
+
+BOOST_FIXTURE_TEST_CASE( Solve, DistributedFixture )
+{
+  assemble();
+  std::vector<Real> x;
+  exact_vector(x);
+  matrix->multiply(x, rhs->data());
+
+  // The first node of the second part has a condition, on the ranks that own it and that have it as ghost.
+  // The known solution satisfies it, so it still solves the system.
+  Uint other_begin, other_end;
+  split_range(nb_nodes, Comm::instance().size(), 1, other_begin, other_end);
+  if(other_begin >= first_node && other_begin < first_node + nb_local_nodes)
+    matrix->symmetric_dirichlet(other_begin - first_node, 1, exact(other_begin, 1), *rhs);
+
+  std::vector<std::string> solvers;
+  solvers.push_back("CG");
+  solvers.push_back("BiCGStab");
+  solvers.push_back("GMRES");
+  std::vector<std::string> preconditioners;
+  preconditioners.push_back("None");
+  preconditioners.push_back("Jacobi");
+  preconditioners.push_back("BlockJacobi");
+  preconditioners.push_back("ILU0");
+
+  strategy->options().set("tolerance", 1e-12);
+  strategy->options().set("gmres_restart", 10u);
+  for(Uint s = 0; s != solvers.size(); ++s)
+  {
+    for(Uint p = 0; p != preconditioners.size(); ++p)
+    {
+      BOOST_TEST_MESSAGE("Solving with " << solvers[s] << " and " << preconditioners[p]);
+      strategy->options().set("solver", solvers[s]);
+      strategy->options().set("preconditioner", preconditioners[p]);
+      solution->reset();
+      lss->solve();
+
+      BOOST_CHECK(strategy->relative_residual() < 1e-10);
+      for(Uint i = 0; i != nb_local_nodes; ++i)
+      {
+        if(!is_owned(i))
+          continue;
+        for(Uint eq = 0; eq != 2; ++eq)
+          BOOST_CHECK_SMALL(solution->data()[2*i+eq] - exact(first_node+i, eq), 1e-8);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( FinalizeMPI )
+{
+  Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,285 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for the native LSS backend"
+
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Core.hpp"
+#include "common/OptionList.hpp"
+#include "common/ThreadPool.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+#include "common/PE/CommWrapper.hpp"
+
+#include "math/LSS/BlockAccumulator.hpp"
+#include "math/LSS/System.hpp"
+#include "math/LSS/Native/NativeMatrix.hpp"
+#include "math/LSS/Native/NativeStrategy.hpp"
+#include "math/LSS/Native/NativeVector.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::common::PE;
+using namespace cf3::math;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Chain of nodes with two coupled equations per node. Each edge adds the element matrix [B -B; -B B],
+/// and a small diagonal term makes the system positive definite.
+struct NativeFixture
+{
+  NativeFixture() : nb_nodes(20), coupling(0.3)
+  {
+    Component& root = Core::instance().root();
+    if(is_null(root.get_child("commpattern")))
+    {
+      CommPattern& cp = *root.create_component<CommPattern>("commpattern");
+      std::vector<Uint> gid, rnk;
+      for(Uint i = 0; i != nb_nodes; ++i)
+      {
+        gid.push_back(i);
+        rnk.push_back(0);
+      }
+      cp.insert("gid",gid,1,false);
+      cp.setup(Handle<CommWrapper>(cp.get_child("gid")),rnk);
+    }
+    cp = Handle<CommPattern>(root.get_child("commpattern"));
+
+    // Unsorted columns, the matrix sorts them
+    std::vector<Uint> conn, startidx;
+    startidx.push_back(0);
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      conn.push_back(i);
+      if(i != 0)
+        conn.push_back(i-1);
+      if(i != nb_nodes-1)
+        conn.push_back(i+1);
+      startidx.push_back(conn.size());
+    }
+
+    if(is_not_null(root.get_child("lss")))
+      root.remove_component("lss");
+    lss = root.create_component<LSS::System>("lss");
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.NativeMatrix"));
+    lss->options().set("solution_strategy", std::string("cf3.math.LSS.NativeStrategy"));
+    lss->create(*cp, 2, conn, startidx);
+
+    matrix = Handle<LSS::NativeMatrix>(lss->matrix());
+    rhs = Handle<LSS::NativeVector>(lss->rhs());
+    solution = Handle<LSS::NativeVector>(lss->solution());
+    strategy = Handle<LSS::NativeStrategy>(lss->solution_strategy());
+  }
+
+  void assemble()
+  {
+    LSS::BlockAccumulator block;
+    block.resize(2, 2);
+    for(Uint i = 0; i != nb_nodes-1; ++i)
+    {
+      block.reset();
+      block.indices[0] = i;
+      block.indices[1] = i+1;
+      for(Uint a = 0; a != 2; ++a)
+      {
+        for(Uint b = 0; b != 2; ++b)
+        {
+          const Real value = a == b ? a+1. : coupling;
+          block.mat(a, b) = value;
+          block.mat(2+a, 2+b) = value;
+          block.mat(a, 2+b) = -value;
+          block.mat(2+a, b) = -value;
+        }
+      }
+      matrix->add_values(block);
+    }
+    matrix->add_diagonal(std::vector<Real>(2*nb_nodes, 0.1));
+  }
+
+  /// Fill the RHS so the solution is known
+  void manufacture(std::vector<Real>& exact)
+  {
+    exact.resize(2*nb_nodes);
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      exact[2*i] = std::sin(Real(i));
+      exact[2*i+1] = std::cos(0.5*i);
+    }
+    matrix->multiply(exact, rhs->data());
+  }
+
+  const Uint nb_nodes;
+  const Real coupling;
+  Handle<CommPattern> cp;
+  Handle<LSS::System> lss;
+  Handle<LSS::NativeMatrix> matrix;
+  Handle<LSS::NativeVector> rhs;
+  Handle<LSS::NativeVector> solution;
+  Handle<LSS::NativeStrategy> strategy;
+};
+
+BOOST_AUTO_TEST_SUITE( NativeSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( InitMPI )
+{
+  Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+BOOST_FIXTURE_TEST_CASE( Assembly, NativeFixture )
+{
+  BOOST_CHECK(is_not_null(matrix));
+  BOOST_CHECK(is_not_null(rhs));
+  BOOST_CHECK(is_not_null(strategy));
+  BOOST_CHECK_EQUAL(matrix->blockrow_size(), nb_nodes);
+  BOOST_CHECK_EQUAL(matrix->neq(), 2u);
+
+  assemble();
+
+  Real value;
+  matrix->get_value(2, 2, value);
+  BOOST_CHECK_CLOSE(value, 2.1, 1e-12);
+  matrix->get_value(3, 2, value);
+  BOOST_CHECK_CLOSE(value, 2*coupling, 1e-12);
+  matrix->get_value(5, 2, value);
+  BOOST_CHECK_CLOSE(value, -coupling, 1e-12);
+  matrix->get_value(3, 3, value);
+  BOOST_CHECK_CLOSE(value, 4.1, 1e-12);
+
+  std::vector<Uint> rows, cols;
+  std::vector<Real> values;
+  matrix->debug_data(rows, cols, values);
+  BOOST_CHECK_EQUAL(values.size(), 4*(3*nb_nodes-2));
+
+  // Not in the sparsity pattern
+  BOOST_CHECK_THROW(matrix->add_value(0, 8, 1.), common::BadValue);
+
+  // The product of a constant vector only sees the diagonal term
+  std::vector<Real> x(2*nb_nodes, 1.), y;
+  matrix->multiply(x, y);
+  for(Uint i = 0; i != 2*nb_nodes; ++i)
+    BOOST_CHECK_CLOSE(y[i], 0.1, 1e-10);
+}
+
+BOOST_FIXTURE_TEST_CASE( Threads, NativeFixture )
+{
+  assemble();
+
+  std::vector<Real> x;
+  manufacture(x);
+  const std::vector<Real> y_serial = rhs->data();
+  const Real dot_serial = matrix->dot(x, y_serial);
+
+  ThreadPool::instance().set_nb_threads(3);
+  std::vector<Real> y_threaded;
+  matrix->multiply(x, y_threaded);
+  const Real dot_threaded = matrix->dot(x, y_threaded);
+  ThreadPool::instance().set_nb_threads(1);
+
+  for(Uint i = 0; i != 2*nb_nodes; ++i)
+    BOOST_CHECK_EQUAL(y_serial[i], y_threaded[i]);
+  BOOST_CHECK_EQUAL(dot_serial, dot_threaded);
+}
+
+BOOST_FIXTURE_TEST_CASE( Solve, NativeFixture )
+{
+  assemble();
+  std::vector<Real> exact;
+  manufacture(exact);
+
+  std::vector<std::string> solvers;
+  solvers.push_back("CG");
+  solvers.push_back("BiCGStab");
+  solvers.push_back("GMRES");
+  std::vector<std::string> preconditioners;
+  preconditioners.push_back("None");
+  preconditioners.push_back("Jacobi");
+  preconditioners.push_back("BlockJacobi");
+  preconditioners.push_back("ILU0");
+
+  strategy->options().set("tolerance", 1e-12);
+  strategy->options().set("gmres_restart", 10u);
+  for(Uint s = 0; s != solvers.size(); ++s)
+  {
+    for(Uint p = 0; p != preconditioners.size(); ++p)
+    {
+      BOOST_TEST_MESSAGE("Solving with " << solvers[s] << " and " << preconditioners[p]);
+      strategy->options().set("solver", solvers[s]);
+      strategy->options().set("preconditioner", preconditioners[p]);
+      solution->reset();
+      lss->solve();
+
+      BOOST_CHECK(strategy->iterations() > 0);
+      BOOST_CHECK(strategy->relative_residual() < 1e-10);
+      for(Uint i = 0; i != 2*nb_nodes; ++i)
+        BOOST_CHECK_SMALL(solution->data()[i] - exact[i], 1e-8);
+    }
+  }
+
+  // For a tridiagonal block matrix, ILU(0) is the exact factorization
+  strategy->options().set("solver", std::string("GMRES"));
+  strategy->options().set("preconditioner", std::string("ILU0"));
+  solution->reset();
+  lss->solve();
+  BOOST_CHECK_EQUAL(strategy->iterations(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE( BoundaryConditions, NativeFixture )
+{
+  assemble();
+  rhs->reset();
+
+  matrix->symmetric_dirichlet(0, 1, 5., *rhs);
+
+  Real value;
+  matrix->get_value(1, 1, value);
+  BOOST_CHECK_EQUAL(value, 1.);
+  matrix->get_value(0, 1, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  matrix->get_value(3, 1, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  matrix->get_value(1, 0, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+  matrix->get_value(1, 2, value);
+  BOOST_CHECK_EQUAL(value, 0.);
+
+  rhs->get_value(0, 1, value);
+  BOOST_CHECK_EQUAL(value, 5.);
+  rhs->get_value(0, 0, value);
+  BOOST_CHECK_CLOSE(value, -5.*coupling, 1e-12);
+  rhs->get_value(1, 0, value);
+  BOOST_CHECK_CLOSE(value, 5.*coupling, 1e-12);
+
+  matrix->set_row(nb_nodes-1, 0, 1., 0.);
+  rhs->set_value(nb_nodes-1, 0, -2.);
+
+  strategy->options().set("solver", std::string("BiCGStab"));
+  strategy->options().set("tolerance", 1e-12);
+  solution->reset();
+  lss->solve();
+  solution->get_value(0, 1, value);
+  BOOST_CHECK_CLOSE(value, 5., 1e-8);
+  solution->get_value(nb_nodes-1, 0, value);
+  BOOST_CHECK_CLOSE(value, -2., 1e-8);
+}
+
+BOOST_AUTO_TEST_CASE( FinalizeMPI )
+{
+  Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,181 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh::actions::Renumber on a partitioned mesh"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/actions/Renumber.hpp"
+
+#include "mesh/Cells.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Coordinates of each node and global nodes of each element, by global index
+struct MeshSnapshot
+{
+  MeshSnapshot(const Mesh& mesh)
+  {
+    const Dictionary& geometry = mesh.geometry_fields();
+    for(Uint i = 0; i != geometry.size(); ++i)
+    {
+      coordinates[geometry.glb_idx()[i]] = std::make_pair(geometry.coordinates()[i][XX], geometry.coordinates()[i][YY]);
+      ranks[geometry.glb_idx()[i]] = geometry.rank()[i];
+    }
+
+    boost_foreach(const Entities& entities, find_components_recursively<Entities>(mesh.topology()))
+    {
+      const Connectivity& connectivity = entities.geometry_space().connectivity();
+      for(Uint e = 0; e != entities.size(); ++e)
+      {
+        std::vector<Uint>& nodes = element_nodes[entities.uri().path()][entities.glb_idx()[e]];
+        boost_foreach(const Uint node, connectivity[e])
+          nodes.push_back(geometry.glb_idx()[node]);
+      }
+    }
+  }
+
+  std::map< Uint, std::pair<Real, Real> > coordinates;
+  std::map< Uint, Uint > ranks;
+  std::map< std::string, std::map< Uint, std::vector<Uint> > > element_nodes;
+};
+
+/// Value of the test field at a node
+Real node_value(const Dictionary& geometry, const Uint i)
+{
+  return geometry.coordinates()[i][XX] + 2.*geometry.coordinates()[i][YY];
+}
+
+/// Set the owned values of the test field and invalidate the ghosts, then check that synchronizing restores the ghosts
+void check_synchronize(Field& node_field)
+{
+  const Dictionary& geometry = node_field.dict();
+  for(Uint i = 0; i != node_field.size(); ++i)
+    node_field[i][0] = geometry.is_ghost(i) ? -1. : node_value(geometry, i);
+
+  node_field.synchronize();
+
+  for(Uint i = 0; i != node_field.size(); ++i)
+    BOOST_CHECK_SMALL(node_field[i][0] - node_value(geometry, i), 1e-12);
+}
+
+/// Check that the renumbered mesh describes the same partitioned geometry, with the owned nodes first
+void check_mesh(Mesh& mesh, const MeshSnapshot& original)
+{
+  const MeshSnapshot renumbered(mesh);
+  BOOST_CHECK(renumbered.coordinates == original.coordinates);
+  BOOST_CHECK(renumbered.ranks == original.ranks);
+  BOOST_CHECK(renumbered.element_nodes == original.element_nodes);
+
+  const Dictionary& geometry = mesh.geometry_fields();
+  bool found_ghost = false;
+  for(Uint i = 0; i != geometry.size(); ++i)
+  {
+    if(geometry.is_ghost(i))
+      found_ghost = true;
+    else
+      BOOST_CHECK(!found_ghost);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( RenumberMPI_TestSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK(PE::Comm::instance().size() > 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( RenumberPartitioned )
+{
+  Component& root = Core::instance().root();
+  Handle<MeshGenerator> generator = root.create_component<SimpleMeshGenerator>("generator");
+  generator->options().set("mesh", root.uri()/"mesh");
+  std::vector<Real> lengths(2);
+  lengths[XX] = 4.;
+  lengths[YY] = 1.;
+  generator->options().set("lengths", lengths);
+  std::vector<Uint> nb_cells(2);
+  nb_cells[XX] = 40u;
+  nb_cells[YY] = 10u;
+  generator->options().set("nb_cells", nb_cells);
+  Mesh& mesh = generator->generate();
+
+  Dictionary& geometry = mesh.geometry_fields();
+  Uint nb_ghosts = 0;
+  for(Uint i = 0; i != geometry.size(); ++i)
+  {
+    if(geometry.is_ghost(i))
+      ++nb_ghosts;
+  }
+  BOOST_CHECK(nb_ghosts > 0);
+
+  // Build the comm pattern before renumbering, so it has to follow the new node order
+  Field& node_field = geometry.create_field("node_field");
+  node_field.parallelize();
+  check_synchronize(node_field);
+  const MeshSnapshot original(mesh);
+
+  Cells& cells = *find_component_ptr_recursively<Cells>(mesh.topology());
+  BOOST_CHECK(element_coloring(cells).is_valid());
+
+  Handle<Renumber> renumber = root.create_component<Renumber>("renumber");
+  renumber->transform(mesh);
+  check_mesh(mesh, original);
+  check_synchronize(node_field);
+
+  // The colouring refers to the old element order
+  BOOST_CHECK(!Handle<ElementColoring>(cells.get_child("element_coloring"))->is_valid());
+  BOOST_CHECK(element_coloring(cells).is_valid());
+
+  renumber->options().set("algorithm", std::string("Hilbert"));
+  renumber->transform(mesh);
+  check_mesh(mesh, original);
+  check_synchronize(node_field);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Terminate )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
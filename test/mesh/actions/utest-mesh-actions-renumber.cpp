@@ -0,0 +1,165 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh::actions::Renumber"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/actions/Renumber.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Nodes of each element and the coordinates of each node, by global index
+struct MeshSnapshot
+{
+  MeshSnapshot(const Mesh& mesh)
+  {
+    const Dictionary& geometry = mesh.geometry_fields();
+    for(Uint i = 0; i != geometry.size(); ++i)
+      coordinates[geometry.glb_idx()[i]] = std::make_pair(geometry.coordinates()[i][XX], geometry.coordinates()[i][YY]);
+
+    boost_foreach(const Entities& entities, find_components_recursively<Entities>(mesh.topology()))
+    {
+      const Connectivity& connectivity = entities.geometry_space().connectivity();
+      for(Uint e = 0; e != entities.size(); ++e)
+      {
+        std::vector<Uint>& nodes = element_nodes[entities.uri().path()][entities.glb_idx()[e]];
+        boost_foreach(const Uint node, connectivity[e])
+          nodes.push_back(geometry.glb_idx()[node]);
+      }
+    }
+  }
+
+  std::map< Uint, std::pair<Real, Real> > coordinates;
+  std::map< std::string, std::map< Uint, std::vector<Uint> > > element_nodes;
+};
+
+/// Fill the test fields from the coordinates
+void init_fields(Mesh& mesh)
+{
+  Field& node_field = mesh.geometry_fields().field("node_field");
+  for(Uint i = 0; i != node_field.size(); ++i)
+    node_field[i][0] = mesh.geometry_fields().coordinates()[i][XX] + 2.*mesh.geometry_fields().coordinates()[i][YY];
+
+  Field& elem_field = Handle<Dictionary>(mesh.get_child("elems_P0"))->field("elem_field");
+  for(Uint i = 0; i != elem_field.size(); ++i)
+    elem_field[i][0] = Handle<Dictionary>(mesh.get_child("elems_P0"))->coordinates()[i][XX];
+}
+
+/// Check that the renumbered mesh describes the same geometry with consistent fields
+void check_mesh(Mesh& mesh, const MeshSnapshot& original)
+{
+  const MeshSnapshot renumbered(mesh);
+  BOOST_CHECK(renumbered.coordinates == original.coordinates);
+  BOOST_CHECK(renumbered.element_nodes == original.element_nodes);
+
+  const Dictionary& geometry = mesh.geometry_fields();
+  const Field& node_field = geometry.field("node_field");
+  for(Uint i = 0; i != node_field.size(); ++i)
+    BOOST_CHECK_SMALL(node_field[i][0] - geometry.coordinates()[i][XX] - 2.*geometry.coordinates()[i][YY], 1e-12);
+
+  Dictionary& elems = *Handle<Dictionary>(mesh.get_child("elems_P0"));
+  const Field& elem_field = elems.field("elem_field");
+  boost_foreach(const Handle<Entities>& entities, elems.entities_range())
+  {
+    const Connectivity& elem_connectivity = entities->space(elems).connectivity();
+    const Connectivity& node_connectivity = entities->geometry_space().connectivity();
+    for(Uint e = 0; e != entities->size(); ++e)
+    {
+      Real centroid = 0.;
+      boost_foreach(const Uint node, node_connectivity[e])
+        centroid += geometry.coordinates()[node][XX];
+      centroid /= static_cast<Real>(node_connectivity.row_size());
+      BOOST_CHECK_SMALL(elem_field[elem_connectivity[e][0]][0] - centroid, 1e-12);
+    }
+  }
+}
+
+/// Largest difference between the indices of two nodes of the same element
+Uint bandwidth(const Mesh& mesh)
+{
+  Uint result = 0;
+  boost_foreach(const Handle<Space>& space, mesh.geometry_fields().spaces())
+  {
+    boost_foreach(Connectivity::ConstRow row, space->connectivity().array())
+    {
+      const Uint min_node = *std::min_element(row.begin(), row.end());
+      const Uint max_node = *std::max_element(row.begin(), row.end());
+      result = std::max(result, max_node - min_node);
+    }
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( Renumber_TestSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( RenumberRCMAndHilbert )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 4., 1., 40, 10);
+  mesh->geometry_fields().create_field("node_field");
+  mesh->create_discontinuous_space("elems_P0", "cf3.mesh.LagrangeP0").create_field("elem_field");
+  init_fields(*mesh);
+  const MeshSnapshot original(*mesh);
+
+  // The generator numbers along the long side, so RCM must reduce the bandwidth
+  const Uint original_bandwidth = bandwidth(*mesh);
+
+  Handle<Renumber> renumber = Core::instance().root().create_component<Renumber>("renumber");
+  renumber->transform(*mesh);
+  check_mesh(*mesh, original);
+  BOOST_CHECK_LT(bandwidth(*mesh), original_bandwidth);
+
+  renumber->options().set("algorithm", std::string("Hilbert"));
+  renumber->transform(*mesh);
+  check_mesh(*mesh, original);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Terminate )
+{
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
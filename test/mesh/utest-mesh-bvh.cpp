@@ -0,0 +1,159 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh bounding volume hierarchy"
+
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/assign/list_of.hpp>
+
+#include "common/Core.hpp"
+#include "common/OptionList.hpp"
+#include "common/Table.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/MeshGenerator.hpp"
+#include "mesh/BoundingVolumeHierarchy.hpp"
+#include "mesh/ElementFinderBVH.hpp"
+#include "mesh/StencilComputerBVH.hpp"
+
+using namespace cf3;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( BoundingVolumeHierarchy_TestSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( queries )
+{
+  // 5x5 quads of size 2, numbered row by row
+  boost::shared_ptr< MeshGenerator > mesh_generator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","mesh_generator");
+  Core::instance().root().add_component(mesh_generator);
+  mesh_generator->options().set("mesh",Core::instance().root().uri()/"mesh");
+  mesh_generator->options().set("lengths",std::vector<Real>(2,10.));
+  mesh_generator->options().set("nb_cells",std::vector<Uint>(2,5));
+  mesh_generator->options().set("part",0u);
+  mesh_generator->options().set("nb_parts",1u);
+  Mesh& mesh = mesh_generator->generate();
+
+  BoundingVolumeHierarchy& bvh = *mesh.create_component<BoundingVolumeHierarchy>("bvh");
+  bvh.options().set("mesh", mesh.handle<Mesh>());
+  bvh.options().set("nb_elems_per_leaf", 2u);
+
+  Entity element;
+  RealVector2 coord;
+
+  coord << 1. , 1. ;
+  BOOST_CHECK(bvh.find_element(coord, element));
+  BOOST_CHECK_EQUAL(element.idx,0u);
+
+  coord << 3. , 1. ;
+  BOOST_CHECK(bvh.find_element(coord, element));
+  BOOST_CHECK_EQUAL(element.idx,1u);
+
+  coord << 1. , 3. ;
+  BOOST_CHECK(bvh.find_element(coord, element));
+  BOOST_CHECK_EQUAL(element.idx,5u);
+
+  coord << 11. , 1. ;
+  BOOST_CHECK(!bvh.find_element(coord, element));
+
+  // Batched point location keeps the order of the coordinates
+  Table<Real>& coordinates = *Core::instance().root().create_component< Table<Real> >("coordinates");
+  coordinates.set_row_size(2);
+  coordinates.resize(4);
+  coordinates[0][XX] = 9.;   coordinates[0][YY] = 9.;
+  coordinates[1][XX] = 1.;   coordinates[1][YY] = 1.;
+  coordinates[2][XX] = 20.;  coordinates[2][YY] = 1.;
+  coordinates[3][XX] = 5.;   coordinates[3][YY] = 3.;
+  std::vector<Entity> elements;
+  BOOST_CHECK_EQUAL(bvh.find_elements(coordinates, elements), 3u);
+  BOOST_CHECK_EQUAL(elements[0].idx, 24u);
+  BOOST_CHECK_EQUAL(elements[1].idx, 0u);
+  BOOST_CHECK(is_null(elements[2].comp));
+  BOOST_CHECK_EQUAL(elements[3].idx, 7u);
+
+  // The 5 centroids closest to the centroid of element 7 are the element and its 4 face neighbours
+  coord << 5. , 3. ;
+  std::vector<Entity> nearest;
+  bvh.find_nearest(coord, 5u, nearest);
+  BOOST_REQUIRE_EQUAL(nearest.size(), 5u);
+  BOOST_CHECK_EQUAL(nearest[0].idx, 7u);
+  std::set<Uint> neighbours;
+  for (Uint i=1; i<nearest.size(); ++i)
+    neighbours.insert(nearest[i].idx);
+  const std::set<Uint> expected = boost::assign::list_of(2u)(6u)(8u)(12u);
+  BOOST_CHECK(neighbours == expected);
+
+  bvh.find_nearest(coord, 100u, nearest);
+  BOOST_CHECK_EQUAL(nearest.size(), 25u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finder_and_stencil )
+{
+  Mesh& mesh = *Handle<Mesh>(Core::instance().root().get_child("mesh"));
+  Handle<Dictionary> dict = mesh.geometry_fields().handle<Dictionary>();
+
+  Handle<ElementFinderBVH> finder = Core::instance().root().create_component<ElementFinderBVH>("finder");
+  finder->options().set("dict", dict);
+
+  SpaceElem found;
+  RealVector2 coord;
+  coord << 5. , 3. ;
+  BOOST_CHECK(finder->find_element(coord, found));
+  BOOST_CHECK_EQUAL(found.idx, 7u);
+
+  // Outside of the mesh, the element with the closest centroid is returned
+  coord << 11. , 1. ;
+  BOOST_CHECK(finder->find_element(coord, found));
+  BOOST_CHECK_EQUAL(found.idx, 4u);
+  finder->options().set("find_closest", false);
+  BOOST_CHECK(!finder->find_element(coord, found));
+
+  Handle<StencilComputerBVH> stencil_computer = Core::instance().root().create_component<StencilComputerBVH>("stencilcomputer");
+  stencil_computer->options().set("dict", dict);
+
+  SpaceElem space_elem = SpaceElem(mesh.elements()[0]->space(*dict),7);
+  std::vector<SpaceElem> stencil;
+  stencil_computer->options().set("stencil_size", 1u);
+  stencil_computer->compute_stencil(space_elem, stencil);
+  BOOST_REQUIRE_EQUAL(stencil.size(), 1u);
+  BOOST_CHECK_EQUAL(stencil[0].idx, 7u);
+
+  stencil_computer->options().set("stencil_size", 9u);
+  stencil_computer->compute_stencil(space_elem, stencil);
+  BOOST_CHECK_EQUAL(stencil.size(), 9u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( terminate )
+{
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
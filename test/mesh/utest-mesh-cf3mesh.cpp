@@ -0,0 +1,181 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::cf3mesh::Writer and Reader"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionArray.hpp"
+#include "common/OptionT.hpp"
+#include "common/PropertyList.hpp"
+#include "common/List.hpp"
+#include "common/Table.hpp"
+
+#include "math/VariablesDescriptor.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshMetadata.hpp"
+#include "mesh/MeshReader.hpp"
+#include "mesh/MeshWriter.hpp"
+#include "mesh/Space.hpp"
+
+#include "solver/History.hpp"
+#include "solver/Time.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+
+using namespace cf3;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Check that two tables hold exactly the same values
+template<typename ValueT>
+void check_equal(const Table<ValueT>& a, const Table<ValueT>& b)
+{
+  BOOST_REQUIRE_EQUAL(a.size(), b.size());
+  BOOST_REQUIRE_EQUAL(a.row_size(), b.row_size());
+  for(Uint i = 0; i != a.size(); ++i)
+    for(Uint j = 0; j != a.row_size(); ++j)
+      BOOST_CHECK_EQUAL(a[i][j], b[i][j]);
+}
+
+template<typename ValueT>
+void check_equal(const List<ValueT>& a, const List<ValueT>& b)
+{
+  BOOST_REQUIRE_EQUAL(a.size(), b.size());
+  for(Uint i = 0; i != a.size(); ++i)
+    BOOST_CHECK_EQUAL(a[i], b[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( CF3MeshSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( WriteRead )
+{
+  Component& root = Core::instance().root();
+
+  Handle<Mesh> mesh = root.create_component<Mesh>("mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 5., 5., 5, 5);
+  mesh->metadata()["time"] = 0.25;
+  mesh->metadata()["iter"] = 7u;
+
+  Dictionary& elems_dict = mesh->create_discontinuous_space("elems_P1", "cf3.mesh.LagrangeP1");
+  Field& solution = elems_dict.create_field("solution", "u[scalar],v[vector]");
+  for(Uint i = 0; i != solution.size(); ++i)
+    for(Uint j = 0; j != solution.row_size(); ++j)
+      solution[i][j] = 0.1 * i + j;
+
+  Field& node_field = mesh->geometry_fields().create_field("temperature");
+  for(Uint i = 0; i != node_field.size(); ++i)
+    node_field[i][0] = 1. / (i + 1.);
+
+  // State of a solver
+  Handle<solver::Time> time = root.create_component<solver::Time>("time");
+  time->options().set("current_time", 1.5);
+  time->options().set("iteration", 3u);
+  time->options().set("time_step", 0.5);
+  time->options().set("end_time", 10.);
+
+  Handle<solver::History> history = root.create_component<solver::History>("history");
+  history->options().set("dimension", 2u);
+  history->options().set("logging", false);
+  for(Uint i = 0; i != 3; ++i)
+  {
+    history->set("residual", 1e-3 / (i + 1.));
+    history->set("velocity", std::vector<Real>(2, i + 1.));
+    history->save_entry();
+  }
+
+  std::vector<URI> state_uris;
+  state_uris.push_back(time->uri());
+  state_uris.push_back(history->uri());
+
+  boost::shared_ptr< MeshWriter > writer = build_component_abstract_type<MeshWriter>("cf3.mesh.cf3mesh.Writer", "meshwriter");
+  writer->options().set("state", state_uris);
+  history->table(); // flushes the buffered entries
+  writer->write_from_to(*mesh, URI("checkpoint.cf3mesh"));
+
+  // The restarted run has a new time step and end time, which must survive the restart
+  Handle<solver::Time> restarted_time = root.create_component<solver::Time>("restarted_time");
+  restarted_time->options().set("time_step", 0.25);
+  restarted_time->options().set("end_time", 20.);
+
+  Handle<solver::History> restarted_history = root.create_component<solver::History>("restarted_history");
+  restarted_history->options().set("dimension", 2u);
+  restarted_history->options().set("logging", false);
+
+  std::vector<URI> restarted_uris;
+  restarted_uris.push_back(restarted_time->uri());
+  restarted_uris.push_back(restarted_history->uri());
+
+  Handle<Mesh> restarted = root.create_component<Mesh>("restarted");
+  boost::shared_ptr< MeshReader > reader = build_component_abstract_type<MeshReader>("cf3.mesh.cf3mesh.Reader", "meshreader");
+  reader->options().set("state", restarted_uris);
+  reader->read_mesh_into(URI("checkpoint.cf3mesh"), *restarted);
+
+  BOOST_CHECK_EQUAL(boost::any_cast<Real>(restarted->metadata()["time"]), 0.25);
+  BOOST_CHECK_EQUAL(boost::any_cast<Uint>(restarted->metadata()["iter"]), 7u);
+  BOOST_CHECK_EQUAL(restarted->dimension(), mesh->dimension());
+
+  BOOST_REQUIRE_EQUAL(restarted->elements().size(), mesh->elements().size());
+  for(Uint i = 0; i != mesh->elements().size(); ++i)
+  {
+    const Entities& original = *mesh->elements()[i];
+    const Entities& restored = *restarted->elements()[i];
+    BOOST_CHECK_EQUAL(restored.name(), original.name());
+    BOOST_CHECK_EQUAL(restored.element_type().derived_type_name(), original.element_type().derived_type_name());
+    check_equal(restored.glb_idx(), original.glb_idx());
+    check_equal(restored.rank(), original.rank());
+    check_equal(restored.geometry_space().connectivity(), original.geometry_space().connectivity());
+    check_equal(restored.space(*Handle<Dictionary>(restarted->get_child("elems_P1"))).connectivity(), original.space(elems_dict).connectivity());
+  }
+
+  check_equal(restarted->geometry_fields().glb_idx(), mesh->geometry_fields().glb_idx());
+  check_equal(restarted->geometry_fields().coordinates(), mesh->geometry_fields().coordinates());
+  check_equal(restarted->geometry_fields().field("temperature"), node_field);
+
+  Handle<Dictionary> restored_dict(restarted->get_child("elems_P1"));
+  BOOST_REQUIRE(is_not_null(restored_dict));
+  BOOST_CHECK(restored_dict->discontinuous());
+  check_equal(restored_dict->glb_idx(), elems_dict.glb_idx());
+  check_equal(restored_dict->field("solution"), solution);
+  BOOST_CHECK_EQUAL(restored_dict->field("solution").descriptor().description(), solution.descriptor().description());
+
+  BOOST_CHECK_EQUAL(restarted_time->current_time(), 1.5);
+  BOOST_CHECK_EQUAL(restarted_time->iter(), 3u);
+  BOOST_CHECK_EQUAL(restarted_time->dt(), 0.25);
+  BOOST_CHECK_EQUAL(restarted_time->end_time(), 20.);
+
+  BOOST_CHECK_EQUAL(restarted_history->properties().value<Real>("residual"), history->properties().value<Real>("residual"));
+  BOOST_CHECK_EQUAL(restarted_history->variables()->description(), history->variables()->description());
+  check_equal(*restarted_history->table(), *history->table());
+
+  // New entries are appended to the restored history
+  restarted_history->set("residual", 1e-4);
+  restarted_history->set("velocity", std::vector<Real>(2, 4.));
+  restarted_history->save_entry();
+  BOOST_CHECK_EQUAL(restarted_history->table()->size(), 4u);
+  BOOST_CHECK_EQUAL((*restarted_history->table())[3][0], 1e-4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
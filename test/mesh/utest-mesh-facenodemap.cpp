@@ -0,0 +1,105 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::FaceNodeMap"
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+#include "mesh/FaceNodeMap.hpp"
+
+using namespace cf3;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Faces of a structured grid of quads, with node i+j*(n+1). Face f is the bottom
+/// side of quad f if f < n*n, and otherwise the top side of quad f-n*n, in reverse order.
+struct GridFaces
+{
+  GridFaces(const Uint n) : n(n) {}
+
+  Uint operator()(const Uint face, Uint* nodes) const
+  {
+    const Uint quad = face % (n*n);
+    const Uint i = quad % n;
+    const Uint j = quad / n + (face < n*n ? 0 : 1);
+    nodes[0] = i + j*(n+1);
+    nodes[1] = i+1 + j*(n+1);
+    if (face >= n*n)
+      std::swap(nodes[0], nodes[1]);
+    return 2;
+  }
+
+  const Uint n;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( FaceNodeMapSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Keys )
+{
+  FaceNodeMap face_map(4);
+  BOOST_CHECK_EQUAL(face_map.stride(), 4u);
+
+  const Uint quad1[] = {7, 3, 5, 1};
+  const Uint quad2[] = {5, 1, 7, 3};
+  const Uint tri[] = {7, 3, 5};
+  std::vector<Uint> key1(4), key2(4), key3(4);
+  const std::size_t hash1 = face_map.make_key(quad1, 4, &key1[0]);
+  const std::size_t hash2 = face_map.make_key(quad2, 4, &key2[0]);
+  const std::size_t hash3 = face_map.make_key(tri, 3, &key3[0]);
+
+  BOOST_CHECK_EQUAL(key1[0], 1u);
+  BOOST_CHECK_EQUAL(key1[3], 7u);
+  BOOST_CHECK(key1 == key2);
+  BOOST_CHECK_EQUAL(hash1, hash2);
+  BOOST_CHECK_EQUAL(key3[3], FaceNodeMap::not_found());
+
+  BOOST_CHECK_EQUAL(face_map.insert(&key1[0], hash1, 10u), FaceNodeMap::not_found());
+  BOOST_CHECK_EQUAL(face_map.insert(&key2[0], hash2, 11u), 10u);
+  BOOST_CHECK_EQUAL(face_map.find(&key3[0], hash3), FaceNodeMap::not_found());
+  BOOST_CHECK_EQUAL(face_map.insert(&key3[0], hash3, 12u), FaceNodeMap::not_found());
+  BOOST_CHECK_EQUAL(face_map.find(&key3[0], hash3), 12u);
+  BOOST_CHECK_EQUAL(face_map.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE( Grid )
+{
+  // Every bottom side of row j+1 is the top side of row j
+  const Uint n = 100;
+  const GridFaces faces(n);
+  FaceNodeMap face_map(2);
+
+  std::vector<Uint> keys;
+  std::vector<std::size_t> hashes;
+  face_map.make_keys(faces, 0, 2*n*n, keys, hashes);
+  BOOST_CHECK_EQUAL(keys.size(), 4*n*n);
+
+  Uint nb_matches = 0;
+  for(Uint face = 0; face != 2*n*n; ++face)
+  {
+    const Uint existing = face_map.insert(&keys[2*face], hashes[face], face);
+    if(existing != FaceNodeMap::not_found())
+    {
+      BOOST_CHECK_EQUAL(existing, face - n*n + n);
+      ++nb_matches;
+    }
+  }
+  BOOST_CHECK_EQUAL(nb_matches, n*(n-1));
+  BOOST_CHECK_EQUAL(face_map.size(), n*n + n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,113 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::FileRange"
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/StringConversion.hpp"
+
+#include "mesh/FileRange.hpp"
+
+using namespace cf3;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// File with a header line, nb_lines numbered lines of varying length and a footer line
+struct FileRangeFixture
+{
+  FileRangeFixture() : path("utest-mesh-filerange.txt"), nb_lines(1000)
+  {
+    boost::filesystem::ofstream file(path);
+    file << "$Header\n";
+    for(Uint i = 0; i != nb_lines; ++i)
+    {
+      file << i << " " << 0.5*i;
+      for(Uint j = 0; j != i % 7; ++j)
+        file << " " << j;
+      file << "\n";
+    }
+    file << "$End\n";
+  }
+
+  ~FileRangeFixture()
+  {
+    boost::filesystem::remove(path);
+  }
+
+  const boost::filesystem::path path;
+  const Uint nb_lines;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( FileRangeSuite, FileRangeFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( PartsCoverEveryLineOnce )
+{
+  const Uint nb_parts = 7;
+  FileRange::OffsetT previous_end = 0;
+  Uint next_line = 0;
+  for(Uint part = 0; part != nb_parts; ++part)
+  {
+    FileRange range(path, part, nb_parts);
+    BOOST_CHECK_EQUAL(range.begin(), previous_end);
+    previous_end = range.end();
+
+    TextScanner scanner(range.data(range.begin()));
+    if(part == 0)
+      scanner.skip_line();
+    scanner.skip_whitespace();
+    while(range.offset(scanner.position()) < range.end() && *scanner.position() != '$')
+    {
+      Uint line_nb;
+      Real value;
+      BOOST_CHECK(scanner.read(line_nb));
+      BOOST_CHECK(scanner.read(value));
+      BOOST_CHECK_EQUAL(line_nb, next_line);
+      BOOST_CHECK_EQUAL(value, 0.5*line_nb);
+      ++next_line;
+      scanner.skip_line();
+      scanner.skip_whitespace();
+    }
+  }
+  BOOST_CHECK_EQUAL(previous_end, boost::filesystem::file_size(path));
+  BOOST_CHECK_EQUAL(next_line, nb_lines);
+}
+
+BOOST_AUTO_TEST_CASE( FindLinesAndExtend )
+{
+  std::vector<std::string> keywords;
+  keywords.push_back("$Header");
+  keywords.push_back("$End");
+
+  FileRange range(path, 0, 3);
+  std::vector< std::vector<FileRange::OffsetT> > offsets;
+  range.find_lines(keywords, offsets);
+  BOOST_CHECK_EQUAL(offsets[0].size(), 1u);
+  BOOST_CHECK_EQUAL(offsets[0][0], 0u);
+  BOOST_CHECK(offsets[1].empty());
+
+  // Extending up to the end of the file brings in the footer
+  while(range.extend(100));
+  BOOST_CHECK_EQUAL(range.end(), range.file_size());
+  range.find_lines(keywords, offsets);
+  BOOST_CHECK_EQUAL(offsets[1].size(), 1u);
+  BOOST_CHECK_EQUAL(offsets[1][0], range.file_size() - 5);
+  BOOST_CHECK_EQUAL(*range.data(range.end()), '\0');
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
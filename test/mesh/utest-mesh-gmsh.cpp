@@ -7,6 +7,9 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::gmsh::Reader"
 
+#include <fstream>
+
+#include <boost/cstdint.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include "common/Log.hpp"
@@ -14,10 +17,12 @@
 
 
 #include "common/Core.hpp"
+#include "common/FindComponents.hpp"
 #include "common/Environment.hpp"
 
 #include "math/VariablesDescriptor.hpp"
 
+#include "mesh/Connectivity.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/MeshReader.hpp"
@@ -311,6 +316,202 @@ BOOST_AUTO_TEST_CASE( read_2d_mesh_mix_p1_out )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( binary_format )
+{
+  boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+  Mesh& mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_mix_p1_binary");
+  meshreader->read_mesh_into("../../resources/rectangle-mix-p1.msh",mesh);
+
+  Field& nodal = mesh.geometry_fields().create_field("nodal" , "nodal[vector]");
+  for (Uint n=0; n<nodal.size(); ++n)
+  {
+    for(Uint j=0; j<nodal.row_size(); ++j)
+      nodal[n][j] = n + 0.25*j;
+  }
+
+  // A discontinuous field is written as $ElementNodeData
+  Dictionary& elems_P1 = mesh.create_discontinuous_space("elems_P1","cf3.mesh.LagrangeP1");
+  Field& element_nodal = elems_P1.create_field("element_nodal" , "element_nodal[vector]");
+  for (Uint i=0; i<element_nodal.size(); ++i)
+  {
+    for(Uint j=0; j<element_nodal.row_size(); ++j)
+      element_nodal[i][j] = i + 0.5*j;
+  }
+
+  // Write the same mesh and fields in ASCII and binary format
+  std::vector<URI> fields;
+  fields.push_back(nodal.uri());
+  fields.push_back(element_nodal.uri());
+  boost::shared_ptr< MeshWriter > mesh_writer =
+    build_component_abstract_type<MeshWriter> ("cf3.mesh.gmsh.Writer", "GmshWriter" );
+  mesh_writer->options().set("mesh",mesh.handle<Mesh const>());
+  mesh_writer->options().set("fields",fields);
+  mesh_writer->options().set("file",URI("rectangle-mix-p1-ascii.msh"));
+  mesh_writer->execute();
+  mesh_writer->options().set("binary",true);
+  mesh_writer->options().set("file",URI("rectangle-mix-p1-binary.msh"));
+  mesh_writer->execute();
+
+  Mesh& ascii_mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_mix_p1_ascii_in");
+  meshreader->read_mesh_into("rectangle-mix-p1-ascii_P0.msh",ascii_mesh);
+  Mesh& binary_mesh = *Core::instance().root().create_component<Mesh>("mesh_2d_mix_p1_binary_in");
+  meshreader->read_mesh_into("rectangle-mix-p1-binary_P0.msh",binary_mesh);
+
+  BOOST_CHECK_EQUAL(binary_mesh.dimension(), ascii_mesh.dimension());
+  BOOST_CHECK_EQUAL(find_component<Region>(binary_mesh).recursive_elements_count(true), find_component<Region>(ascii_mesh).recursive_elements_count(true));
+  BOOST_CHECK_EQUAL(binary_mesh.geometry_fields().size(), ascii_mesh.geometry_fields().size());
+
+  const common::Table<Real>& ascii_coords = ascii_mesh.geometry_fields().coordinates();
+  const common::Table<Real>& binary_coords = binary_mesh.geometry_fields().coordinates();
+  Handle<Field const> ascii_nodal(ascii_mesh.geometry_fields().get_child("nodal"));
+  Handle<Field const> binary_nodal(binary_mesh.geometry_fields().get_child("nodal"));
+  BOOST_REQUIRE(is_not_null(ascii_nodal));
+  BOOST_REQUIRE(is_not_null(binary_nodal));
+  for (Uint n=0; n<binary_coords.size(); ++n)
+  {
+    BOOST_CHECK_EQUAL(binary_mesh.geometry_fields().glb_idx()[n], ascii_mesh.geometry_fields().glb_idx()[n]);
+    for (Uint d=0; d<binary_coords.row_size(); ++d)
+      BOOST_CHECK_CLOSE(binary_coords[n][d] + 1., ascii_coords[n][d] + 1., 1e-5);
+    for (Uint j=0; j<binary_nodal->row_size(); ++j)
+      BOOST_CHECK_EQUAL((*binary_nodal)[n][j], (*ascii_nodal)[n][j]);
+  }
+
+  Handle<Component const> ascii_dict = ascii_mesh.get_child("discontinuous_geometry");
+  Handle<Component const> binary_dict = binary_mesh.get_child("discontinuous_geometry");
+  BOOST_REQUIRE(is_not_null(ascii_dict));
+  BOOST_REQUIRE(is_not_null(binary_dict));
+  Handle<Field const> ascii_element_nodal(ascii_dict->get_child("element_nodal"));
+  Handle<Field const> binary_element_nodal(binary_dict->get_child("element_nodal"));
+  BOOST_REQUIRE(is_not_null(ascii_element_nodal));
+  BOOST_REQUIRE(is_not_null(binary_element_nodal));
+  BOOST_REQUIRE_EQUAL(binary_element_nodal->size(), ascii_element_nodal->size());
+  BOOST_CHECK(binary_element_nodal->size() > 0);
+  for (Uint i=0; i<binary_element_nodal->size(); ++i)
+  {
+    for (Uint j=0; j<binary_element_nodal->row_size(); ++j)
+      BOOST_CHECK_EQUAL((*binary_element_nodal)[i][j], (*ascii_element_nodal)[i][j]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Write the bytes of a value in the reverse order of this machine, as a machine of the other endianness would
+template<typename T>
+void write_swapped(std::ofstream& file, const T value)
+{
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  for (Uint i=sizeof(T); i!=0; --i)
+    file.put(bytes[i-1]);
+}
+
+/// Header of a data section with one scalar variable
+void write_data_header(std::ofstream& file, const std::string& section, const std::string& name, const Uint nb_entries)
+{
+  file << "$" << section << "\n1\n\"" << name << "\"\n1\n0\n3\n0\n1\n" << nb_entries << "\n";
+}
+
+BOOST_AUTO_TEST_CASE( binary_format_swapped )
+{
+  // Two triangles on the unit square, in a binary file of the other endianness
+  const Real coords[4][2] = { {0., 0.}, {1., 0.}, {1., 1.}, {0., 1.} };
+  const Uint triangles[2][3] = { {1, 2, 3}, {1, 3, 4} };
+  {
+    std::ofstream file("swapped.msh", std::ios_base::out | std::ios_base::binary);
+    file << "$MeshFormat\n2.2 1 8\n";
+    write_swapped<boost::int32_t>(file, 1);
+    file << "\n$EndMeshFormat\n";
+    file << "$PhysicalNames\n1\n2 1 \"Cells\"\n$EndPhysicalNames\n";
+
+    file << "$Nodes\n4\n";
+    for (Uint n=0; n<4; ++n)
+    {
+      write_swapped<boost::int32_t>(file, n+1);
+      write_swapped<double>(file, coords[n][XX]);
+      write_swapped<double>(file, coords[n][YY]);
+      write_swapped<double>(file, 0.);
+    }
+    file << "\n$EndNodes\n";
+
+    // One block of 2 triangles with 2 tags: physical and elementary entity
+    file << "$Elements\n2\n";
+    write_swapped<boost::int32_t>(file, 2);
+    write_swapped<boost::int32_t>(file, 2);
+    write_swapped<boost::int32_t>(file, 2);
+    for (Uint e=0; e<2; ++e)
+    {
+      write_swapped<boost::int32_t>(file, e+1);
+      write_swapped<boost::int32_t>(file, 1);
+      write_swapped<boost::int32_t>(file, 1);
+      for (Uint j=0; j<3; ++j)
+        write_swapped<boost::int32_t>(file, triangles[e][j]);
+    }
+    file << "\n$EndElements\n";
+
+    write_data_header(file, "NodeData", "node_scalar", 4);
+    for (Uint n=0; n<4; ++n)
+    {
+      write_swapped<boost::int32_t>(file, n+1);
+      write_swapped<double>(file, 10.*(n+1));
+    }
+    file << "\n$EndNodeData\n";
+
+    // Not read, but has to be skipped to find the next section
+    write_data_header(file, "ElementData", "element_scalar", 2);
+    for (Uint e=0; e<2; ++e)
+    {
+      write_swapped<boost::int32_t>(file, e+1);
+      write_swapped<double>(file, -1.);
+    }
+    file << "\n$EndElementData\n";
+
+    write_data_header(file, "ElementNodeData", "element_node_scalar", 2);
+    for (Uint e=0; e<2; ++e)
+    {
+      write_swapped<boost::int32_t>(file, e+1);
+      write_swapped<boost::int32_t>(file, 3);
+      for (Uint j=0; j<3; ++j)
+        write_swapped<double>(file, 100.*(e+1) + triangles[e][j]);
+    }
+    file << "\n$EndElementNodeData\n";
+  }
+
+  boost::shared_ptr< MeshReader > meshreader = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+  Mesh& mesh = *Core::instance().root().create_component<Mesh>("mesh_swapped");
+  meshreader->read_mesh_into("swapped.msh",mesh);
+
+  const Dictionary& geometry = mesh.geometry_fields();
+  BOOST_REQUIRE_EQUAL(geometry.size(), 4u);
+  Handle<Field const> node_scalar(geometry.get_child("node_scalar"));
+  BOOST_REQUIRE(is_not_null(node_scalar));
+  for (Uint n=0; n<4; ++n)
+  {
+    const Uint gmsh_node = geometry.glb_idx()[n]+1;
+    BOOST_CHECK_EQUAL(geometry.coordinates()[n][XX], coords[gmsh_node-1][XX]);
+    BOOST_CHECK_EQUAL(geometry.coordinates()[n][YY], coords[gmsh_node-1][YY]);
+    BOOST_CHECK_EQUAL((*node_scalar)[n][0], 10.*gmsh_node);
+  }
+
+  Handle<Component const> dict = mesh.get_child("discontinuous_geometry");
+  BOOST_REQUIRE(is_not_null(dict));
+  Handle<Field const> element_node_scalar(dict->get_child("element_node_scalar"));
+  BOOST_REQUIRE(is_not_null(element_node_scalar));
+  Handle<Entities const> cells = find_component_ptr_recursively<Entities>(mesh.topology());
+  BOOST_REQUIRE(is_not_null(cells));
+  BOOST_REQUIRE_EQUAL(cells->size(), 2u);
+  const Space& space = element_node_scalar->space(*cells);
+  for (Uint e=0; e<2; ++e)
+  {
+    const Uint gmsh_element = cells->glb_idx()[e]+1;
+    for (Uint j=0; j<3; ++j)
+    {
+      const Uint gmsh_node = geometry.glb_idx()[cells->geometry_space().connectivity()[e][j]]+1;
+      BOOST_CHECK_EQUAL((*element_node_scalar)[space.connectivity()[e][j]][0], 100.*gmsh_element + gmsh_node);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( finalize_mpi )
 {
   Core::instance().terminate();
@@ -7,6 +7,8 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Tests mesh octtree"
 
+#include <algorithm>
+
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/assign/std/vector.hpp>
@@ -179,6 +181,19 @@ BOOST_AUTO_TEST_CASE( Octtree_parallel )
   BOOST_CHECK_EQUAL(ranks[0] , 0u);
   BOOST_CHECK_EQUAL(ranks[1] , 1u);
 
+  // Only other ranks whose partition contains the coordinate are candidates
+  BOOST_CHECK(octtree.is_partition_index_created());
+  RealVector coord(2);
+  coord << 5., 2.5;
+  std::vector<Uint> candidates;
+  octtree.find_candidate_ranks(coord, candidates);
+  BOOST_CHECK(std::find(candidates.begin(), candidates.end(), PE::Comm::instance().rank()) == candidates.end());
+  if (PE::Comm::instance().rank() != 0)
+    BOOST_CHECK(std::find(candidates.begin(), candidates.end(), 0u) != candidates.end());
+  coord << 50., 2.5;
+  octtree.find_candidate_ranks(coord, candidates);
+  BOOST_CHECK(candidates.empty());
+
 
 //  MeshWriter& gmsh_writer = mesh.create_component("gmsh_writer","cf3.mesh.gmsh.Writer").as_type<MeshWriter>();
 //  gmsh_writer.write_from_to(mesh,"octtree.msh");
@@ -0,0 +1,237 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Compares the partitioned_read of the gmsh and neu readers with their serial read"
+
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+#include "common/StringConversion.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshReader.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// The local part of a mesh, by global index and independently of it
+struct MeshSnapshot
+{
+  MeshSnapshot(const Mesh& mesh)
+  {
+    const Dictionary& geometry = mesh.geometry_fields();
+    for(Uint i = 0; i != geometry.size(); ++i)
+    {
+      const std::vector<Real> coords(geometry.coordinates()[i].begin(), geometry.coordinates()[i].end());
+      node_coordinates[geometry.glb_idx()[i]] = coords;
+      node_ranks[geometry.glb_idx()[i]] = geometry.rank()[i];
+      nodes.insert(std::make_pair(coords, geometry.rank()[i]));
+    }
+
+    boost_foreach(const Entities& entities, find_components_recursively<Entities>(mesh.topology()))
+    {
+      const std::string path = entities.uri().path().substr(mesh.uri().path().size());
+      const Connectivity& connectivity = entities.geometry_space().connectivity();
+      for(Uint e = 0; e != entities.size(); ++e)
+      {
+        std::vector<Uint>& element_glb = element_nodes[path][entities.glb_idx()[e]];
+        std::vector<Real> element_coords;
+        boost_foreach(const Uint node, connectivity[e])
+        {
+          element_glb.push_back(geometry.glb_idx()[node]);
+          used_nodes.push_back(geometry.glb_idx()[node]);
+          element_coords.insert(element_coords.end(), geometry.coordinates()[node].begin(), geometry.coordinates()[node].end());
+        }
+        elements.insert(std::make_pair(path, element_coords));
+      }
+    }
+  }
+
+  std::map< Uint, std::vector<Real> > node_coordinates;
+  std::map< Uint, Uint > node_ranks;
+  std::map< std::string, std::map< Uint, std::vector<Uint> > > element_nodes;
+  /// Global indices of the nodes used by the local elements
+  std::vector<Uint> used_nodes;
+
+  /// Coordinates and rank of the nodes
+  std::set< std::pair< std::vector<Real>, Uint > > nodes;
+  /// Region and node coordinates of the elements
+  std::multiset< std::pair< std::string, std::vector<Real> > > elements;
+};
+
+/// Read the file into a new mesh, with or without partitioned_read
+Mesh& read_mesh(const std::string& reader_type, const std::string& file, const bool partitioned_read)
+{
+  Component& root = Core::instance().root();
+  const std::string name = partitioned_read ? "partitioned" : "serial";
+  if(is_not_null(root.get_child(name)))
+    root.remove_component(name);
+
+  Mesh& mesh = *root.create_component<Mesh>(name);
+  boost::shared_ptr<MeshReader> reader = build_component_abstract_type<MeshReader>(reader_type, "reader");
+  reader->options().set("partitioned_read", partitioned_read);
+  reader->read_mesh_into(URI(file), mesh);
+  return mesh;
+}
+
+/// Global indices of the nodes used by the elements of any process
+std::set<Uint> all_used_nodes(const MeshSnapshot& snapshot)
+{
+  std::vector< std::vector<Uint> > used_per_part;
+  PE::Comm::instance().all_gather(snapshot.used_nodes, used_per_part);
+  std::set<Uint> result;
+  boost_foreach(const std::vector<Uint>& used, used_per_part)
+    result.insert(used.begin(), used.end());
+  return result;
+}
+
+/// The partitioned gmsh read gives the same elements and global indices as the serial read. It drops the owned
+/// nodes that no element uses, which the serial read keeps. Returns the total number of dropped nodes.
+Uint compare_gmsh(const std::string& file)
+{
+  const MeshSnapshot serial(read_mesh("cf3.mesh.gmsh.Reader", file, false));
+  const MeshSnapshot partitioned(read_mesh("cf3.mesh.gmsh.Reader", file, true));
+
+  BOOST_CHECK(partitioned.element_nodes == serial.element_nodes);
+
+  for(std::map< Uint, std::vector<Real> >::const_iterator it = partitioned.node_coordinates.begin(); it != partitioned.node_coordinates.end(); ++it)
+  {
+    BOOST_REQUIRE(serial.node_coordinates.count(it->first));
+    BOOST_CHECK(serial.node_coordinates.find(it->first)->second == it->second);
+    BOOST_CHECK_EQUAL(serial.node_ranks.find(it->first)->second, partitioned.node_ranks.find(it->first)->second);
+  }
+
+  const std::set<Uint> used_nodes = all_used_nodes(serial);
+  const Uint rank = PE::Comm::instance().rank();
+  Uint nb_dropped = 0;
+  for(std::map< Uint, std::vector<Real> >::const_iterator it = serial.node_coordinates.begin(); it != serial.node_coordinates.end(); ++it)
+  {
+    if(partitioned.node_coordinates.count(it->first))
+      continue;
+    BOOST_CHECK_EQUAL(serial.node_ranks.find(it->first)->second, rank);
+    BOOST_CHECK(!used_nodes.count(it->first));
+    ++nb_dropped;
+  }
+
+  Uint total_dropped = 0;
+  PE::Comm::instance().all_reduce(PE::plus(), &nb_dropped, 1, &total_dropped);
+  return total_dropped;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE( PartitionedReadSuite )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  BOOST_CHECK(PE::Comm::instance().size() > 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Gmsh )
+{
+  BOOST_CHECK_EQUAL(compare_gmsh("../../resources/rectangle-tg-p1.msh"), 0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( GmshNumbering )
+{
+  // The same mesh with contiguous and with sparse gmsh numbers, and a node that no element uses
+  const Uint nb_nodes = 7;
+  const Real coords[nb_nodes][2] = { {0., 0.}, {1., 0.}, {2., 0.}, {5., 5.}, {0., 1.}, {1., 1.}, {2., 1.} };
+  const Uint triangles[4][3] = { {0, 1, 5}, {0, 5, 4}, {1, 2, 6}, {1, 6, 5} };
+  const std::string header = "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n";
+  const std::string physical_names = "$PhysicalNames\n1\n2 1 \"Cells\"\n$EndPhysicalNames\n";
+  for(Uint step = 1; step != 11; step += 9)
+  {
+    std::stringstream body;
+    body << "$Nodes\n" << nb_nodes << "\n";
+    for(Uint n = 0; n != nb_nodes; ++n)
+      body << step*(n+1) << " " << coords[n][XX] << " " << coords[n][YY] << " 0\n";
+    body << "$EndNodes\n$Elements\n4\n";
+    for(Uint e = 0; e != 4; ++e)
+      body << e+1 << " 2 2 1 1 " << step*(triangles[e][0]+1) << " " << step*(triangles[e][1]+1) << " " << step*(triangles[e][2]+1) << "\n";
+    body << "$EndElements\n";
+
+    if(PE::Comm::instance().rank() == 0)
+    {
+      boost::filesystem::ofstream with_names("utest-mesh-partitioned-read-" + to_str(step) + ".msh");
+      with_names << header << physical_names << body.str();
+      boost::filesystem::ofstream without_names("utest-mesh-partitioned-read-nonames.msh");
+      without_names << header << body.str();
+    }
+  }
+  PE::Comm::instance().barrier();
+
+  BOOST_CHECK_EQUAL(compare_gmsh("utest-mesh-partitioned-read-1.msh"), 1u);
+
+  // Both reads use the gmsh number minus one as global index. The serial read accepts gaps,
+  // the partitioned read owns the nodes by position in the file and refuses them on all processes.
+  const MeshSnapshot sparse(read_mesh("cf3.mesh.gmsh.Reader", "utest-mesh-partitioned-read-10.msh", false));
+  for(std::map< Uint, std::vector<Real> >::const_iterator it = sparse.node_coordinates.begin(); it != sparse.node_coordinates.end(); ++it)
+    BOOST_CHECK_EQUAL((it->first+1) % 10, 0u);
+  BOOST_CHECK_THROW(read_mesh("cf3.mesh.gmsh.Reader", "utest-mesh-partitioned-read-10.msh", true), ParsingFailed);
+
+  // All processes see the missing section, so they all throw
+  BOOST_CHECK_THROW(read_mesh("cf3.mesh.gmsh.Reader", "utest-mesh-partitioned-read-nonames.msh", true), ParsingFailed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Neu )
+{
+  // Both reads are numbered by GlobalNumbering, so compare the coordinates
+  const char* files[] = { "../../resources/quadtriag.neu", "../../resources/hextet.neu" };
+  for(Uint f = 0; f != 2; ++f)
+  {
+    const MeshSnapshot serial(read_mesh("cf3.mesh.neu.Reader", files[f], false));
+    const MeshSnapshot partitioned(read_mesh("cf3.mesh.neu.Reader", files[f], true));
+    BOOST_CHECK(partitioned.nodes == serial.nodes);
+    BOOST_CHECK(partitioned.elements == serial.elements);
+    BOOST_CHECK_EQUAL(partitioned.node_coordinates.size(), serial.node_coordinates.size());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Terminate )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -380,6 +380,59 @@ BOOST_AUTO_TEST_CASE( minitest )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( synchronize_fields_batched )
+{
+  Mesh& mesh = *Handle<Mesh>(Core::instance().root().access_component(URI("//line")));
+  Dictionary& nodes = mesh.geometry_fields();
+  const Uint my_rank = PE::Comm::instance().rank();
+
+  Field& scalar = nodes.create_field("batch_scalar");
+  Field& vector = nodes.create_field("batch_vector", "v[vector]");
+  scalar.parallelize();
+  vector.parallelize();
+
+  // Owned nodes get the rank, ghosts are reset
+  std::vector< Handle<Field> > fields;
+  fields.push_back(scalar.handle<Field>());
+  fields.push_back(vector.handle<Field>());
+  boost_foreach(const Handle<Field>& field, fields)
+  {
+    for (Uint n=0; n<field->size(); ++n)
+      for (Uint j=0; j<field->row_size(); ++j)
+        (*field)[n][j] = nodes.rank()[n] == my_rank ? my_rank : -1.;
+  }
+
+  // Both fields go in a single exchange
+  BOOST_CHECK(scalar.is_modified());
+  Field::synchronize_fields(fields);
+  BOOST_CHECK(!scalar.is_modified());
+  BOOST_CHECK(!vector.is_modified());
+  for (Uint n=0; n<nodes.size(); ++n)
+  {
+    BOOST_CHECK_EQUAL( scalar[n][0] , static_cast<Real>(nodes.rank()[n]) );
+    for (Uint j=0; j<vector.row_size(); ++j)
+      BOOST_CHECK_EQUAL( vector[n][j] , static_cast<Real>(nodes.rank()[n]) );
+  }
+
+  // Unmodified fields are skipped
+  for (Uint n=0; n<nodes.size(); ++n)
+    if (nodes.rank()[n] != my_rank)
+      scalar[n][0] = -1.;
+  Field::synchronize_fields(fields, true);
+  for (Uint n=0; n<nodes.size(); ++n)
+    if (nodes.rank()[n] != my_rank)
+      BOOST_CHECK_EQUAL( scalar[n][0] , -1. );
+
+  // The field is exchanged on all ranks if any rank modified it
+  if (my_rank == 0)
+    scalar.mark_modified();
+  Field::synchronize_fields(fields, true);
+  for (Uint n=0; n<nodes.size(); ++n)
+    BOOST_CHECK_EQUAL( scalar[n][0] , static_cast<Real>(nodes.rank()[n]) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( finalize_mpi )
 {
   PE::Comm::instance().finalize();
@@ -7,15 +7,24 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::tecplot::Writer"
 
+#include <fstream>
+#include <iterator>
+
+#include <boost/assign/list_of.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include "common/BoostFilesystem.hpp"
+#include "common/Foreach.hpp"
+
 #include "common/Log.hpp"
 #include "common/Core.hpp"
 #include "common/OptionList.hpp"
 #include "common/OptionComponent.hpp"
 #include "common/OptionArray.hpp"
 #include "common/OptionURI.hpp"
+#include "common/ThreadPool.hpp"
 #include "mesh/MeshWriter.hpp"
+#include "mesh/VTKXML/Writer.hpp"
 
 #include "Tools/MeshGeneration/MeshGeneration.hpp"
 
@@ -30,6 +39,24 @@ using namespace cf3::common;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+std::string file_contents(const std::string& path)
+{
+  std::ifstream file(path.c_str(), std::ios_base::in | std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+boost::shared_ptr< VTKXML::Writer > create_writer(Mesh& mesh, const URI& file)
+{
+  boost::shared_ptr< VTKXML::Writer > vtk_writer = allocate_component<VTKXML::Writer>("meshwriter");
+  std::vector<URI> fields; fields.push_back(mesh.geometry_fields().coordinates().uri());
+  vtk_writer->options().set("fields",fields);
+  vtk_writer->options().set("mesh",mesh.handle<Mesh>());
+  vtk_writer->options().set("file",file);
+  return vtk_writer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_SUITE( VTKXMLSuite )
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -52,6 +79,55 @@ BOOST_AUTO_TEST_CASE( WriteGrid )
   BOOST_CHECK(true);
 }
 
+BOOST_AUTO_TEST_CASE( WriteGridThreaded )
+{
+  Handle<Mesh> mesh(Core::instance().root().get_child("mesh"));
+  ThreadPool::instance().set_nb_threads(4);
+
+  const std::vector<std::string> modes = boost::assign::list_of("zlib")("fast")("none");
+  boost_foreach(const std::string& mode, modes)
+  {
+    boost::shared_ptr< MeshWriter > vtk_writer = build_component_abstract_type<MeshWriter>("cf3.mesh.VTKXML.Writer","meshwriter");
+    std::vector<URI> fields; fields.push_back(mesh->geometry_fields().coordinates().uri());
+    vtk_writer->options().set("fields",fields);
+    vtk_writer->options().set("mesh",mesh);
+    vtk_writer->options().set("compression",mode);
+    vtk_writer->options().set("file",URI("grid-" + mode + ".vtu"));
+    vtk_writer->execute();
+    BOOST_CHECK(boost::filesystem::exists("grid-" + mode + "_P0.vtu"));
+  }
+
+  // The blocks don't depend on the number of threads, so the output is the same as the single threaded one
+  BOOST_CHECK(file_contents("grid-zlib_P0.vtu") == file_contents("grid_P0.vtu"));
+
+  ThreadPool::instance().set_nb_threads(1);
+}
+
+BOOST_AUTO_TEST_CASE( WriteGridAsynchronous )
+{
+  Handle<Mesh> mesh(Core::instance().root().get_child("mesh"));
+  boost::filesystem::create_directories("vtkxml-sync");
+  boost::filesystem::create_directories("vtkxml-async");
+
+  boost::shared_ptr< VTKXML::Writer > sync_writer = create_writer(*mesh, URI("vtkxml-sync/grid.vtu"));
+  sync_writer->execute();
+
+  boost::shared_ptr< VTKXML::Writer > vtk_writer = create_writer(*mesh, URI("vtkxml-async/grid.vtu"));
+  vtk_writer->options().set("asynchronous",true);
+  vtk_writer->execute();
+
+  // Modifying the mesh must not affect the file being written
+  const Real x0 = mesh->geometry_fields().coordinates()[0][0];
+  mesh->geometry_fields().coordinates()[0][0] = 100.;
+
+  vtk_writer->wait();
+  mesh->geometry_fields().coordinates()[0][0] = x0;
+
+  BOOST_CHECK(boost::filesystem::exists("vtkxml-async/grid_P0.vtu"));
+  BOOST_CHECK(file_contents("vtkxml-async/grid_P0.vtu") == file_contents("vtkxml-sync/grid_P0.vtu"));
+  BOOST_CHECK(file_contents("vtkxml-async/grid.pvtu") == file_contents("vtkxml-sync/grid.pvtu"));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -18,6 +18,7 @@
 #include "solver/Model.hpp"
 #include "solver/Solver.hpp"
 
+#include "solver/actions/Proto/ElementGeometryCache.hpp"
 #include "solver/actions/Proto/ElementLooper.hpp"
 #include "solver/actions/Proto/Expression.hpp"
 #include "solver/actions/Proto/Functions.hpp"
@@ -25,7 +26,9 @@
 #include "solver/actions/Proto/Terminals.hpp"
 
 #include "common/Core.hpp"
+#include "common/Environment.hpp"
 #include "common/Log.hpp"
+#include "common/OptionList.hpp"
 
 #include "math/MatrixTypes.hpp"
 
@@ -300,6 +303,21 @@ struct Counter
 
 MakeSFOp<Counter>::type counter = {};
 
+/// Custom op that stores a value that differs per element in its argument, like a stabilization coefficient
+struct StoreFirstX
+{
+  /// Dummy result
+  typedef void result_type;
+
+  template<typename VarT>
+  result_type operator()(const VarT& var, Real& arg) const
+  {
+    arg = var.support().nodes()(0, 0);
+  }
+};
+
+MakeSFOp<StoreFirstX>::type store_first_x = {};
+
 /// Test a custom operator that modifies its arguments
 BOOST_AUTO_TEST_CASE( VoidOp )
 {
@@ -703,6 +721,164 @@ BOOST_AUTO_TEST_CASE( AddElementValues )
   BOOST_CHECK_EQUAL(y_check, 0.);
 }
 
+BOOST_AUTO_TEST_CASE( ThreadedElementLoop )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("threaded_elems_mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 6., 3., 30, 15);
+
+  mesh->geometry_fields().create_field( "threaded_solution", "Temperature[v]" ).add_tag("threaded_solution");
+
+  FieldVariable<0, VectorField > T("Temperature", "threaded_solution");
+
+  // Const, since expressions that refer to non-const variables run serially
+  const Eigen::Matrix<Real, 8, 8> vals = Eigen::Matrix<Real, 8, 8>::Identity();
+
+  // Threaded run, where neighbouring elements scatter into shared nodes
+  Core::instance().environment().options().set("nb_threads", 4u);
+  for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >
+  (
+    mesh->topology(),
+    T += diagonal(vals)
+  );
+
+  Real check = 0;
+  for_each_node(mesh->topology(), lit(check) += T[_i]);
+  BOOST_CHECK_EQUAL(check, 8.*30.*15.);
+
+  // In reproducible mode, the result must not depend on the number of threads
+  Core::instance().environment().options().set("reproducible_loops", true);
+  const Field& field = mesh->geometry_fields().field("threaded_solution");
+  std::vector< std::vector<Real> > results;
+  for(Uint nb_threads = 1; nb_threads != 4; ++nb_threads)
+  {
+    Core::instance().environment().options().set("nb_threads", nb_threads);
+    for_each_node(mesh->topology(), T[_i] = 0.);
+    for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >
+    (
+      mesh->topology(),
+      T += diagonal(vals) * (nodes[0][0] + 0.1)
+    );
+    results.push_back(std::vector<Real>(field.array().data(), field.array().data() + field.array().num_elements()));
+  }
+
+  BOOST_CHECK(results[0] == results[1]);
+  BOOST_CHECK(results[0] == results[2]);
+
+  // Scalars written by an operation are per-element scratch values, with a copy for each thread
+  Core::instance().environment().options().set("reproducible_loops", false);
+  std::vector<Real> scratch_results;
+  std::vector<Real> first_x_after;
+  for(Uint nb_threads = 1; nb_threads != 5; nb_threads += 3)
+  {
+    Core::instance().environment().options().set("nb_threads", nb_threads);
+    for_each_node(mesh->topology(), T[_i] = 0.);
+    Real first_x = -1.;
+    for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >
+    (
+      mesh->topology(),
+      group
+      (
+        store_first_x(T, lit(first_x)),
+        T += diagonal(vals) * lit(first_x)
+      )
+    );
+    Real sum = 0;
+    for_each_node(mesh->topology(), lit(sum) += T[_i]);
+    scratch_results.push_back(sum);
+    first_x_after.push_back(first_x);
+  }
+  BOOST_CHECK_CLOSE(scratch_results[0], scratch_results[1], 1e-10);
+  // The serial loop writes to the variable itself, the threaded loop only to the copies
+  BOOST_CHECK(first_x_after[0] > 0.);
+  BOOST_CHECK_EQUAL(first_x_after[1], -1.);
+
+  // Accumulating into a shared variable falls back to a serial loop, so no contributions are lost
+  Core::instance().environment().options().set("nb_threads", 4u);
+  Real area = 0.;
+  for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >
+  (
+    mesh->topology(),
+    lit(area) += volume
+  );
+  BOOST_CHECK_CLOSE(area, 18., 1e-10);
+
+  Core::instance().environment().options().set("reproducible_loops", false);
+  Core::instance().environment().options().set("nb_threads", 1u);
+
+  // The colouring is dropped when the mesh changes, since the connectivity may be different
+  Elements& elements = find_component_recursively<Elements>(mesh->topology());
+  BOOST_CHECK(element_coloring(elements).is_valid());
+  mesh->raise_mesh_changed();
+  BOOST_CHECK(!Handle<ElementColoring>(elements.get_child("element_coloring"))->is_valid());
+  BOOST_CHECK(element_coloring(elements).is_valid());
+}
+
+BOOST_AUTO_TEST_CASE( GeometryCache )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("geometry_cache_mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 6., 3., 12, 6);
+
+  mesh->geometry_fields().create_field( "geometry_cache_solution", "Temperature" ).add_tag("geometry_cache_solution");
+  FieldVariable<0, ScalarField> T("Temperature", "geometry_cache_solution");
+  for_each_node(mesh->topology(), T = coordinates[0] * coordinates[1]);
+
+  typedef Eigen::Matrix<Real, 4, 4> StiffnessT;
+  StiffnessT stiffness;
+  Real x_integral;
+
+  std::vector<StiffnessT> stiffness_results;
+  std::vector<Real> x_results;
+  for(Uint i = 0; i != 3; ++i)
+  {
+    if(i == 1)
+      enable_geometry_cache(mesh->topology());
+
+    stiffness.setZero();
+    x_integral = 0.;
+    for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >
+    (
+      mesh->topology(),
+      group
+      (
+        lit(stiffness) += integral<2>(transpose(nabla(T))*nabla(T)*jacobian_determinant),
+        element_quadrature(lit(x_integral) += coordinates[0] * T)
+      )
+    );
+    stiffness_results.push_back(stiffness);
+    x_results.push_back(x_integral);
+  }
+
+  // The cached geometry gives the same results as computing it
+  Elements& elements = find_component_recursively<Elements>(mesh->topology());
+  ElementGeometryCache& cache = enable_geometry_cache(elements);
+  BOOST_CHECK(cache.memory_usage() > 0);
+  for(Uint i = 1; i != 3; ++i)
+  {
+    BOOST_CHECK_CLOSE(x_results[i], x_results[0], 1e-10);
+    for(Uint j = 0; j != 4; ++j)
+      for(Uint k = 0; k != 4; ++k)
+        BOOST_CHECK_CLOSE(stiffness_results[i](j,k), stiffness_results[0](j,k), 1e-10);
+  }
+
+  // Moving the nodes requires invalidating the cache
+  Field& coords = mesh->geometry_fields().coordinates();
+  for(Uint i = 0; i != coords.size(); ++i)
+    coords[i][XX] *= 2.;
+  cache.invalidate();
+  Real area = 0.;
+  for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >(mesh->topology(), lit(area) += integral<1>(jacobian_determinant));
+  BOOST_CHECK_CLOSE(area, 36., 1e-10);
+
+  // Without budget, the geometry is computed on the fly
+  enable_geometry_cache(elements, 0);
+  area = 0.;
+  for_each_element< boost::mpl::vector1<LagrangeP1::Quad2D> >(mesh->topology(), lit(area) += integral<1>(jacobian_determinant));
+  BOOST_CHECK_CLOSE(area, 36., 1e-10);
+  BOOST_CHECK_EQUAL(cache.memory_usage(), 0u);
+
+  disable_geometry_cache(mesh->topology());
+  BOOST_CHECK(is_null(elements.get_child(ElementGeometryCache::default_name())));
+}
 
 BOOST_AUTO_TEST_CASE( NodeIndexLoop )
 {
@@ -0,0 +1,208 @@
+// Copyright (C) 2010-2011 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::solver::ComputeRHS"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/Foreach.hpp"
+#include "common/OptionList.hpp"
+
+#include "mesh/Cells.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/MeshGenerator.hpp"
+#include "mesh/ShapeFunction.hpp"
+#include "mesh/Space.hpp"
+
+#include "solver/ComputeRHS.hpp"
+#include "solver/FieldTermComputer.hpp"
+#include "solver/LibSolver.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::solver;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Term computer that only implements the per-element interface, so ComputeRHS uses the default batch
+class ElementIndexComputer : public TermComputer
+{
+public:
+  ElementIndexComputer(const std::string& name) : TermComputer(name), m_nb_eqs(3) {}
+
+  static std::string type_name () { return "ElementIndexComputer"; }
+
+  virtual bool loop_cells(const Handle<Entities const>& cells)
+  {
+    if(is_null(Handle<Cells const>(cells)))
+      return false;
+    m_nb_pts = cells->element_type().nb_nodes();
+    return true;
+  }
+
+  virtual void compute_term(const Uint elem_idx, std::vector<RealVector>& term, std::vector<Real>& wave_speed)
+  {
+    term.resize(m_nb_pts, RealVector(m_nb_eqs));
+    wave_speed.resize(m_nb_pts);
+    for(Uint pt = 0; pt != m_nb_pts; ++pt)
+    {
+      term[pt].resize(m_nb_eqs);
+      for(Uint eq = 0; eq != m_nb_eqs; ++eq)
+        term[pt][eq] = 0.5*elem_idx + 0.25*pt - 0.125*eq;
+      wave_speed[pt] = 1. + elem_idx%7 + 0.1*pt;
+    }
+  }
+
+private:
+  Uint m_nb_eqs;
+  Uint m_nb_pts;
+};
+
+ComponentBuilder < ElementIndexComputer, TermComputer, LibSolver > ElementIndexComputer_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ComputeRHSFixture
+{
+  ComputeRHSFixture() : root(Core::instance().root())
+  {
+  }
+
+  /// Create a mesh with a discontinuous space and a source field that differs in every solution point
+  Mesh& create_mesh(const std::string& name)
+  {
+    boost::shared_ptr< MeshGenerator > mesh_generator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator", name+"_generator");
+    root.add_component(mesh_generator);
+    mesh_generator->options().set("mesh", root.uri()/name);
+    mesh_generator->options().set("lengths", std::vector<Real>(2, 4.));
+    mesh_generator->options().set("nb_cells", std::vector<Uint>(2, 10));
+    Mesh& mesh = mesh_generator->generate();
+
+    Dictionary& dict = mesh.create_discontinuous_space("solution_space", "cf3.mesh.LagrangeP1");
+    Field& source = dict.create_field("source", "source[3]");
+    for(Uint i = 0; i != source.size(); ++i)
+      for(Uint eq = 0; eq != 3; ++eq)
+        source[i][eq] = 0.01*i + eq;
+    dict.create_field("rhs", "rhs[3]");
+    dict.create_field("wave_speed", "ws[1]");
+    return mesh;
+  }
+
+  /// Reference result, using the per-element interface of ComputeRHS
+  void compute_per_cell(ComputeRHS& compute_rhs, Field& rhs, Field& wave_speed)
+  {
+    const Uint nb_eqs = rhs.row_size();
+    boost_foreach(const Handle<Entities>& cells, rhs.dict().entities_range())
+    {
+      if(!compute_rhs.loop_cells(cells))
+        continue;
+      const Space& space = rhs.dict().space(*cells);
+      const Uint nb_pts = space.shape_function().nb_nodes();
+      std::vector<RealVector> elem_rhs(nb_pts, RealVector(nb_eqs));
+      std::vector<Real> elem_ws(nb_pts);
+      for(Uint elem = 0; elem != cells->size(); ++elem)
+      {
+        compute_rhs.compute_rhs(elem, elem_rhs, elem_ws);
+        Connectivity::ConstRow nodes = space.connectivity()[elem];
+        for(Uint pt = 0; pt != nb_pts; ++pt)
+        {
+          for(Uint eq = 0; eq != nb_eqs; ++eq)
+            rhs[nodes[pt]][eq] = elem_rhs[pt][eq];
+          wave_speed[nodes[pt]][0] = elem_ws[pt];
+        }
+      }
+    }
+  }
+
+  void check_equal(const Field& a, const Field& b)
+  {
+    BOOST_REQUIRE_EQUAL(a.size(), b.size());
+    BOOST_REQUIRE_EQUAL(a.row_size(), b.row_size());
+    for(Uint i = 0; i != a.size(); ++i)
+      for(Uint j = 0; j != a.row_size(); ++j)
+        BOOST_CHECK_EQUAL(a[i][j], b[i][j]);
+  }
+
+  Component& root;
+};
+
+BOOST_FIXTURE_TEST_SUITE( ComputeRHSSuite, ComputeRHSFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init )
+{
+  Core::instance().initiate(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+}
+
+BOOST_AUTO_TEST_CASE( BatchesMatchPerCell )
+{
+  Mesh& mesh = create_mesh("mesh");
+  Dictionary& dict = *Handle<Dictionary>(mesh.get_child("solution_space"));
+  Field& rhs = dict.field("rhs");
+  Field& wave_speed = dict.field("wave_speed");
+
+  Handle<ComputeRHS> compute_rhs = root.create_component<ComputeRHS>("compute_rhs");
+  Handle<FieldTermComputer> source_term = compute_rhs->create_component<FieldTermComputer>("source_term");
+  source_term->options().set("source", dict.field("source").handle<Field>());
+  source_term->options().set("factor", 2.);
+  BOOST_CHECK(source_term->thread_safe());
+
+  // Only the thread-safe computer: the batches may run on several threads
+  Field& reference = dict.create_field("reference", "reference[3]");
+  Field& reference_ws = dict.create_field("reference_ws", "reference_ws[1]");
+  compute_per_cell(*compute_rhs, reference, reference_ws);
+  BOOST_CHECK_CLOSE(reference[5][1], 2.*(0.05 + 1.), 1e-12);
+
+  for(Uint nb_threads = 1; nb_threads != 5; nb_threads += 3)
+  {
+    Core::instance().environment().options().set("nb_threads", nb_threads);
+    for(Uint batch_size = 1; batch_size < 64; batch_size *= 7)
+    {
+      compute_rhs->options().set("batch_size", batch_size);
+      rhs = 0.;
+      wave_speed = 0.;
+      compute_rhs->compute_rhs(rhs, wave_speed);
+      check_equal(rhs, reference);
+      check_equal(wave_speed, reference_ws);
+    }
+  }
+
+  // Adding a computer that is not thread-safe makes the loop serial, the result is the sum of the terms
+  compute_rhs->create_component<ElementIndexComputer>("element_index");
+  compute_per_cell(*compute_rhs, reference, reference_ws);
+  for(Uint nb_threads = 1; nb_threads != 5; nb_threads += 3)
+  {
+    Core::instance().environment().options().set("nb_threads", nb_threads);
+    compute_rhs->options().set("batch_size", 7u);
+    rhs = 0.;
+    wave_speed = 0.;
+    compute_rhs->compute_rhs(rhs, wave_speed);
+    check_equal(rhs, reference);
+    check_equal(wave_speed, reference_ws);
+  }
+
+  Core::instance().environment().options().set("nb_threads", 1u);
+}
+
+BOOST_AUTO_TEST_CASE( finalize )
+{
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////